@@ -22,6 +22,7 @@
 #include <multipass/cli/return_codes.h>
 #include <multipass/disabled_copy_move.h>
 #include <multipass/format.h>
+#include <multipass/logging/trace.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
 #include <multipass/terminal.h>
 #include <multipass/utils.h>
@@ -76,6 +77,10 @@ protected:
         auto rpc_method = std::bind(rpc_func, stub, std::placeholders::_1);
 
         grpc::ClientContext context;
+        // Lets the daemon trace what it does for this call as part of the command's trace
+        if (const auto span_context = logging::current_span_context(); span_context.is_valid())
+            context.AddMetadata("traceparent", span_context.to_traceparent());
+
         std::unique_ptr<grpc::ClientReaderWriterInterface<Request, ReplyType>> client = rpc_method(&context);
 
         client->Write(request);
@@ -31,6 +31,8 @@ public:
     std::string format(const FindReply& list) const override;
     std::string format(const VersionReply& list, const std::string& client_version) const override;
     std::string format(const AliasDict& aliases) const override;
+    std::unique_ptr<StreamedFormat<InfoReply>> streamed_info_format() const override;
+    std::unique_ptr<StreamedFormat<ListReply>> streamed_list_format() const override;
 };
 }
 #endif // MULTIPASS_CSV_FORMATTER
@@ -24,12 +24,23 @@
 #include <multipass/cli/alias_dict.h>
 #include <multipass/cli/client_platform.h>
 
+#include <memory>
 #include <string>
 
 namespace multipass
 {
 constexpr auto default_id_str = "default";
 
+// Renders replies that come in parts, each with some of the instances, as each part arrives
+template <typename Reply>
+class StreamedFormat : private DisabledCopyMove
+{
+public:
+    virtual ~StreamedFormat() = default;
+    virtual std::string next(const Reply& part) = 0; // text for the instances in this part
+    virtual std::string end() = 0;                   // text that closes the output, after the last part
+};
+
 class Formatter : private DisabledCopyMove
 {
 public:
@@ -41,6 +52,10 @@ public:
     virtual std::string format(const VersionReply& reply, const std::string& client_version) const = 0;
     virtual std::string format(const AliasDict& aliases) const = 0;
 
+    // Formatters that need all instances at once keep these defaults, which gather the parts and format them at the end
+    virtual std::unique_ptr<StreamedFormat<InfoReply>> streamed_info_format() const;
+    virtual std::unique_ptr<StreamedFormat<ListReply>> streamed_list_format() const;
+
 protected:
     Formatter() = default;
 
@@ -50,5 +65,39 @@ protected:
         return std::map<typename D::key_type, typename D::mapped_type>(unsorted_dict.cbegin(), unsorted_dict.cend());
     }
 };
+
+template <typename Reply>
+class GatheringFormat final : public StreamedFormat<Reply>
+{
+public:
+    explicit GatheringFormat(const Formatter& formatter) : formatter{formatter}
+    {
+    }
+
+    std::string next(const Reply& part) override
+    {
+        gathered.MergeFrom(part);
+        return {};
+    }
+
+    std::string end() override
+    {
+        return formatter.format(gathered);
+    }
+
+private:
+    const Formatter& formatter;
+    Reply gathered;
+};
+
+inline std::unique_ptr<StreamedFormat<InfoReply>> Formatter::streamed_info_format() const
+{
+    return std::make_unique<GatheringFormat<InfoReply>>(*this);
+}
+
+inline std::unique_ptr<StreamedFormat<ListReply>> Formatter::streamed_list_format() const
+{
+    return std::make_unique<GatheringFormat<ListReply>>(*this);
+}
 }
 #endif // MULTIPASS_FORMATTER_H
@@ -60,12 +60,29 @@ constexpr auto autostart_key = "client.gui.autostart";                // idem
 constexpr auto winterm_key = "client.apps.windows-terminal.profiles"; // idem
 constexpr auto hotkey_key = "client.gui.hotkey";                      // idem
 constexpr auto mirror_key = "local.image.mirror";                     // idem; this defines the mirror of simple streams
+constexpr auto native_mounts_driver_key = "local.native-mounts.driver";       // idem
+constexpr auto virtiofs_cache_key = "local.native-mounts.virtiofs-cache";     // idem
+constexpr auto virtiofs_threads_key = "local.native-mounts.virtiofs-threads"; // idem
+constexpr auto sshfs_shared_server_key = "local.classic-mounts.shared-server"; // idem; one SSH session per instance
+constexpr auto ssh_multiplexing_key = "client.ssh-multiplexing";                // idem
+constexpr auto warm_pool_size_key = "local.warm-pool.size";                     // idem
+constexpr auto warm_pool_image_key = "local.warm-pool.image";                   // idem
+constexpr auto warm_pool_cores_key = "local.warm-pool.cores";                   // idem; "cpus" is taken by instances
+constexpr auto warm_pool_mem_size_key = "local.warm-pool.mem-size";             // idem
+constexpr auto warm_pool_disk_size_key = "local.warm-pool.disk-size";           // idem
+constexpr auto metrics_address_key = "local.metrics.address";                   // idem; off when empty
+constexpr auto tracing_file_key = "local.tracing.file";                         // idem; off when empty
 
 [[maybe_unused]] // hands off clang-format
 constexpr auto key_examples = {autostart_key, driver_key, mounts_key};
 
 constexpr auto petenv_default = "primary";
 constexpr auto hotkey_default = "Ctrl+Alt+U";                         // idem; translates to Cmd+Opt+U on macOS
+constexpr auto native_mounts_driver_default = "9p";
+constexpr auto virtiofs_cache_default = "auto";
+constexpr auto virtiofs_threads_default = "0"; // leave it up to virtiofsd
+constexpr auto sshfs_shared_server_default = "false";
+constexpr auto warm_pool_size_default = "0"; // no instances are made ahead of launches
 
 constexpr auto timeout_exit_code = 5;
 
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_JSON_LINES_SPAN_EXPORTER_H
+#define MULTIPASS_JSON_LINES_SPAN_EXPORTER_H
+
+#include <multipass/logging/trace.h>
+
+#include <QFile>
+
+#include <mutex>
+#include <string>
+
+namespace multipass
+{
+namespace logging
+{
+// Appends spans to a file, one OTLP/JSON export request per line, as the OpenTelemetry file exporter does
+class JsonLinesSpanExporter : public SpanExporter
+{
+public:
+    JsonLinesSpanExporter(const QString& path, std::string service_name);
+    void export_span(const SpanData& span) override;
+
+private:
+    const std::string service_name;
+    std::mutex mutex;
+    QFile file;
+};
+} // namespace logging
+} // namespace multipass
+#endif // MULTIPASS_JSON_LINES_SPAN_EXPORTER_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_TRACE_H
+#define MULTIPASS_TRACE_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+namespace logging
+{
+// Where a span sits, as in W3C trace context: a trace id of 32 and a span id of 16 lowercase hex digits
+struct SpanContext
+{
+    std::string trace_id;
+    std::string span_id;
+
+    bool is_valid() const;
+
+    // As passed on to other processes, e.g. "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"
+    std::string to_traceparent() const;
+    static SpanContext from_traceparent(const std::string& traceparent); // invalid when malformed
+};
+
+// The context of the span that is current on this thread, invalid when there is none
+SpanContext current_span_context();
+
+// Makes a context from elsewhere (another thread or process) current on this thread for as long as it lives
+class ScopedSpanContext : private DisabledCopyMove
+{
+public:
+    explicit ScopedSpanContext(SpanContext context);
+    ~ScopedSpanContext();
+
+private:
+    const SpanContext previous;
+};
+
+// A finished span, in what can be exported as OTLP
+struct SpanData
+{
+    std::string name;
+    SpanContext context;
+    std::string parent_span_id; // empty for the root of a trace
+    std::chrono::system_clock::time_point start;
+    std::chrono::system_clock::time_point end;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    bool failed{false};
+
+    // A single line with the span as an OTLP/JSON span object
+    std::string to_json() const;
+    static std::optional<SpanData> from_json(const std::string& json);
+};
+
+class SpanExporter : private DisabledCopyMove
+{
+public:
+    SpanExporter() = default;
+    virtual ~SpanExporter() = default;
+
+    virtual void export_span(const SpanData& span) = 0; // may be called from any thread
+};
+
+void set_span_exporter(std::shared_ptr<SpanExporter> exporter);
+bool is_tracing(); // whether finished spans go anywhere
+void export_span(const SpanData& span);
+
+// Times a piece of work as a child of the given span, or of the current one by default, making itself current on
+// this thread for as long as it lives. Without a parent, it starts a new trace. Ids are made up even when nothing is
+// traced here, so that they can be passed on to processes that do trace.
+class Span : private DisabledCopyMove
+{
+public:
+    explicit Span(std::string name, const SpanContext& parent = current_span_context());
+    ~Span();
+
+    const SpanContext& context() const;
+    void set_attribute(std::string key, std::string value);
+    void set_failed();
+
+private:
+    SpanData data;
+    const SpanContext previous;
+};
+} // namespace logging
+} // namespace multipass
+#endif // MULTIPASS_TRACE_H
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_METRICS_H
+#define MULTIPASS_METRICS_H
+
+#include "disabled_copy_move.h"
+#include "singleton.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define MP_METRICS multipass::metrics::Registry::instance()
+
+namespace multipass
+{
+namespace metrics
+{
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter : private DisabledCopyMove
+{
+public:
+    Counter() = default;
+
+    void increment(std::uint64_t by = 1) noexcept
+    {
+        value.fetch_add(by, std::memory_order_relaxed);
+    }
+
+    std::uint64_t get() const noexcept
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> value{0};
+};
+
+class Gauge : private DisabledCopyMove
+{
+public:
+    Gauge() = default;
+
+    void set(std::int64_t new_value) noexcept
+    {
+        value.store(new_value, std::memory_order_relaxed);
+    }
+
+    void add(std::int64_t by) noexcept
+    {
+        value.fetch_add(by, std::memory_order_relaxed);
+    }
+
+    std::int64_t get() const noexcept
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::int64_t> value{0};
+};
+
+// Durations, counted in fixed buckets that go from 100us to 5min, which suits anything from an SFTP request to a launch
+class Histogram : private DisabledCopyMove
+{
+public:
+    static constexpr std::array<std::chrono::microseconds::rep, 13> bucket_bounds{
+        100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 60000000, 300000000};
+
+    struct Snapshot
+    {
+        std::array<std::uint64_t, bucket_bounds.size() + 1> counts{}; // the last one is for anything longer
+        std::uint64_t sum_micros{0};
+
+        std::uint64_t count() const;
+        Snapshot operator-(const Snapshot& earlier) const;
+
+        // As passed on between processes, e.g. "1500 3 0 ..."
+        std::string serialise() const;
+        static std::optional<Snapshot> deserialise(const std::string& serialised);
+    };
+
+    Histogram() = default;
+
+    void observe(std::chrono::nanoseconds duration) noexcept;
+    void add(const Snapshot& snapshot) noexcept; // e.g. what another process observed
+    Snapshot snapshot() const noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_bounds.size() + 1> counts{};
+    std::atomic<std::uint64_t> sum_micros{0};
+};
+
+// Called on every scrape, for values that are looked up then rather than kept up to date, e.g. instance states
+using GaugeCallback = std::function<std::vector<std::pair<Labels, double>>()>;
+
+// Where metrics live, to be exported in the Prometheus text format
+class Registry : public Singleton<Registry>
+{
+public:
+    Registry(const Singleton<Registry>::PrivatePass&) noexcept;
+
+    // Metrics are created on first use and then kept for good, so that they can be held on to and updated without
+    // locking. The same name and labels always give back the same metric.
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {});
+
+    // There is one callback per name, replaced by setting another one. Whoever sets it removes it when the values it
+    // looks up are gone.
+    void set_gauge_callback(const std::string& name, const std::string& help, GaugeCallback callback);
+    void remove_gauge_callback(const std::string& name);
+
+    std::vector<std::pair<Labels, Histogram::Snapshot>> histogram_snapshots(const std::string& name) const;
+
+    // Whether the metrics are being scraped, so that other processes know to report theirs here
+    void set_served(bool value) noexcept;
+    bool is_served() const noexcept;
+
+    std::string exposition() const;
+
+private:
+    template <typename Metric>
+    struct Family
+    {
+        std::string help;
+        std::map<Labels, std::unique_ptr<Metric>> metrics;
+    };
+
+    template <typename Metric>
+    Metric& find_or_create(std::map<std::string, Family<Metric>>& families, const std::string& name,
+                           const std::string& help, const Labels& labels);
+
+    mutable std::mutex mutex;
+    std::map<std::string, Family<Counter>> counters;
+    std::map<std::string, Family<Gauge>> gauges;
+    std::map<std::string, Family<Histogram>> histograms;
+    std::map<std::string, std::pair<std::string, GaugeCallback>> gauge_callbacks;
+    std::atomic<bool> served{false};
+};
+} // namespace metrics
+} // namespace multipass
+#endif // MULTIPASS_METRICS_H
@@ -24,9 +24,12 @@
 #include <multipass/ssh/ssh_key_provider.h>
 
 #include <chrono>
+#include <exception>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace multipass
 {
@@ -49,6 +52,27 @@ public:
     virtual void init_mount(VirtualMachine* vm, const std::string& target_path, const VMMount& vm_mount) = 0;
     virtual void start_mount(VirtualMachine* vm, ServerVariant server, const std::string& target_path,
                              const std::chrono::milliseconds& timeout = std::chrono::minutes(5)) = 0;
+    // Starts several mounts of the same instance, returning the errors of the ones that failed, by target path.
+    // Handlers that can bring mounts up side by side override this, it starts them one after the other otherwise.
+    virtual std::unordered_map<std::string, std::exception_ptr>
+    start_mounts(VirtualMachine* vm, ServerVariant server, const std::vector<std::string>& target_paths,
+                 const std::chrono::milliseconds& timeout = std::chrono::minutes(5))
+    {
+        std::unordered_map<std::string, std::exception_ptr> errors;
+        for (const auto& target_path : target_paths)
+        {
+            try
+            {
+                start_mount(vm, server, target_path, timeout);
+            }
+            catch (...)
+            {
+                errors[target_path] = std::current_exception();
+            }
+        }
+
+        return errors;
+    }
     virtual void stop_mount(const std::string& instance, const std::string& path) = 0;
     virtual void stop_all_mounts_for_instance(const std::string& instance) = 0;
     virtual bool has_instance_already_mounted(const std::string& instance, const std::string& path) const = 0;
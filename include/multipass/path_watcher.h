@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_PATH_WATCHER_H
+#define MULTIPASS_PATH_WATCHER_H
+
+#include <multipass/disabled_copy_move.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace multipass
+{
+// Keeps track of changes in directories, so that what is known about their contents can be thrown away in time
+class PathWatcher : private DisabledCopyMove
+{
+public:
+    using UPtr = std::unique_ptr<PathWatcher>;
+
+    virtual ~PathWatcher() = default;
+
+    // Watch the entries of a directory, not recursively. Returns false if it cannot be watched, which includes when
+    // as many directories as the watcher allows are watched already.
+    virtual bool watch(const std::string& dir) = 0;
+
+    // Stop watching a directory, or all of them, so that the watches go back to the system
+    virtual void unwatch(const std::string& dir) = 0;
+    virtual void clear() = 0;
+
+    // The paths that changed since the last call, without waiting for more. No value means the changes could not
+    // be pinned down (e.g. events were lost, or directories moved), so that anything may have changed. All watches
+    // are dropped then.
+    virtual std::optional<std::vector<std::string>> changed_paths() = 0;
+
+protected:
+    PathWatcher() = default;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_PATH_WATCHER_H
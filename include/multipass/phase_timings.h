@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_PHASE_TIMINGS_H
+#define MULTIPASS_PHASE_TIMINGS_H
+
+#include "disabled_copy_move.h"
+
+#include <multipass/logging/trace.h>
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace multipass
+{
+// How long each phase of a longer operation (e.g. a launch) took, in the order the phases finished. When tracing,
+// the phases are also spans of the given one.
+class PhaseTimings : private DisabledCopyMove
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Phase = std::pair<std::string, std::chrono::milliseconds>;
+
+    explicit PhaseTimings(logging::SpanContext span_context = logging::current_span_context());
+
+    void add(const std::string& phase, Clock::duration duration);
+    std::vector<Phase> phases() const;
+    std::string summary() const; // e.g. "download 12.5s, verify 0.8s"
+
+    // The timings that code running on this thread should add to, if any. This saves passing them down through
+    // interfaces that know nothing of them, e.g. from the daemon to the image vault.
+    static PhaseTimings* current();
+
+    // Makes the given timings (which may be null) and their span current on this thread for as long as it lives
+    class Scope : private DisabledCopyMove
+    {
+    public:
+        explicit Scope(PhaseTimings* timings);
+        ~Scope();
+
+    private:
+        PhaseTimings* const previous;
+        std::optional<logging::ScopedSpanContext> span_scope;
+    };
+
+    const logging::SpanContext span_context; // of the operation, which the phases are spans of
+
+private:
+    mutable std::mutex mutex;
+    std::vector<Phase> phase_list;
+};
+
+// Adds how long it ran to the given timings, under the given phase, when stopped or destroyed
+class PhaseTimer : private DisabledCopyMove
+{
+public:
+    explicit PhaseTimer(std::string phase, PhaseTimings* timings = PhaseTimings::current());
+    ~PhaseTimer();
+
+    void stop(); // only the first stop counts
+
+private:
+    const std::string phase;
+    PhaseTimings* const timings;
+    const PhaseTimings::Clock::time_point start;
+    std::optional<logging::Span> span;
+    bool stopped{false};
+};
+} // namespace multipass
+#endif // MULTIPASS_PHASE_TIMINGS_H
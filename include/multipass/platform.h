@@ -22,6 +22,7 @@
 #include <multipass/days.h>
 #include <multipass/logging/logger.h>
 #include <multipass/network_interface_info.h>
+#include <multipass/path_watcher.h>
 #include <multipass/process/process.h>
 #include <multipass/process/process_spec.h>
 #include <multipass/settings/setting_spec.h>
@@ -60,6 +61,8 @@ public:
     virtual int chown(const char* path, unsigned int uid, unsigned int gid) const;
     virtual int chmod(const char* path, unsigned int mode) const;
     virtual bool link(const char* target, const char* link) const;
+    // Copies length bytes between open files, letting the filesystem share or copy the blocks where it can
+    virtual bool copy_file_data(int from_fd, qint64 from_offset, int to_fd, qint64 to_offset, qint64 length) const;
     virtual bool symlink(const char* target, const char* link, bool is_dir) const;
     virtual int utime(const char* path, int atime, int mtime) const;
     virtual QDir get_alias_scripts_folder() const;
@@ -87,8 +90,11 @@ VirtualMachineFactory::UPtr vm_backend(const Path& data_dir);
 logging::Logger::UPtr make_logger(logging::Level level);
 UpdatePrompt::UPtr make_update_prompt();
 std::unique_ptr<Process> make_sshfs_server_process(const SSHFSServerConfig& config);
+// Lets a running sshfs_server reach all the mounts in config; returns false if it cannot
+bool update_sshfs_server_confinement(const SSHFSServerConfig& config);
 std::unique_ptr<Process> make_process(std::unique_ptr<ProcessSpec>&& process_spec);
 int symlink_attr_from(const char* path, sftp_attributes_struct* attr);
+PathWatcher::UPtr make_path_watcher(); // null if the platform cannot watch for file changes
 bool is_image_url_supported();
 
 std::function<int()> make_quit_watchdog(); // call while single-threaded; call result later, in dedicated thread
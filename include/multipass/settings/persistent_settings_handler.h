@@ -21,7 +21,9 @@
 #include "setting_spec.h"
 #include "settings_handler.h"
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 
 namespace multipass
@@ -29,21 +31,32 @@ namespace multipass
 class PersistentSettingsHandler : public SettingsHandler
 {
 public:
+    using SettingsMaker = std::function<SettingSpec::Set()>;
+
     PersistentSettingsHandler(QString filename, SettingSpec::Set settings); // no nulls please
+
+    // Leaves making the setting specs to the first call that needs them, so that registering is cheap for callers
+    // that may never look at a setting
+    static std::unique_ptr<PersistentSettingsHandler> deferred(QString filename, SettingsMaker make_settings);
+
     QString get(const QString& key) const override;
     void set(const QString& key, const QString& val) override;
     std::set<QString> keys() const override;
 
 private:
+    PersistentSettingsHandler(QString filename, SettingSpec::Set settings, SettingsMaker make_settings);
     const SettingSpec& get_setting(const QString& key) const; // throws on unknown key
 
 private:
     using SettingMap = std::map<QString, SettingSpec::UPtr>;
     static SettingMap convert(SettingSpec::Set);
+    const SettingMap& get_settings() const; // makes the specs first, if deferred
 
 private:
     QString filename;
-    SettingMap settings;
+    mutable SettingsMaker make_settings;
+    mutable SettingMap settings;
+    mutable std::once_flag settings_made;
     mutable std::mutex mutex;
 };
 } // namespace multipass
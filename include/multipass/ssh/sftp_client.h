@@ -44,6 +44,7 @@ public:
     {
         Recursive = 1,
         MakeParent = 2,
+        Sync = 4,
     };
     Q_DECLARE_FLAGS(Flags, Flag)
 
@@ -60,12 +61,14 @@ public:
     virtual ~SFTPClient() = default;
 
 private:
-    void push_file(const fs::path& source_path, const fs::path& target_path);
+    void push_file(const fs::path& source_path, const fs::path& target_path, Flags flags = {});
     void pull_file(const fs::path& source_path, const fs::path& target_path);
-    bool push_dir(const fs::path& source_path, const fs::path& target_path);
+    bool push_dir(const fs::path& source_path, const fs::path& target_path, Flags flags = {});
     bool pull_dir(const fs::path& source_path, const fs::path& target_path);
     void do_push_file(std::istream& source, const fs::path& target_path);
     void do_pull_file(const fs::path& source_path, std::ostream& target);
+    bool sync_file(const fs::path& source_path, const fs::path& target_path);
+    void set_remote_times(const fs::path& source_path, const fs::path& target_path);
 
     SSHSessionUPtr ssh_session;
     SFTPSessionUPtr sftp;
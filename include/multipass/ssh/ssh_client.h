@@ -46,6 +46,9 @@ public:
     int exec(const std::vector<std::vector<std::string>>& args_list);
     void connect();
 
+    // The command line that exec runs for args_list, with each set of args run after the previous one succeeds
+    static std::string cmd_line_for(const std::vector<std::vector<std::string>>& args_list);
+
 private:
     void handle_ssh_events();
     int exec_string(const std::string& cmd_line);
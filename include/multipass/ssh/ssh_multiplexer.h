@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SSH_MULTIPLEXER_H
+#define MULTIPASS_SSH_MULTIPLEXER_H
+
+#include <multipass/ssh/ssh_session.h>
+
+#include <libssh/libssh.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace multipass
+{
+class Terminal;
+
+// Shares one authenticated SSH session to an instance between commands, much like OpenSSH's ControlMaster. The
+// master serves the session on a local socket, which is told apart by the daemon it got the instance from. Each command
+// hands its standard streams over to the master, which connects them to a new channel, and then waits for the exit
+// status. Masters know nothing of the instance beyond their session, so commands get whatever else they need, like
+// mounts or whether the instance still runs, from the daemon.
+class SSHMultiplexer
+{
+public:
+    SSHMultiplexer(const std::string& server_address, const std::string& instance_name, const std::string& host,
+                   int port, const std::string& username, const std::string& priv_key_blob);
+    ~SSHMultiplexer();
+
+    // Serves commands until the session drops, a client asks to stop, or no command ran for idle_timeout
+    void serve(std::chrono::milliseconds idle_timeout);
+
+    // Runs cmd_line (a shell when empty) through the master for the instance of the given daemon, if there is one
+    static std::optional<int> exec(const std::string& server_address, const std::string& instance_name,
+                                   const std::string& cmd_line, Terminal* term);
+
+    // Stops the masters of the given daemon for the given instances, or all of its masters when none is given
+    static void stop_masters(const std::string& server_address, const std::vector<std::string>& instance_names);
+
+private:
+    struct Client;
+
+    static int on_new_client(socket_t fd, int revents, void* userdata);
+    static int on_client_message(socket_t fd, int revents, void* userdata);
+    void accept_client(int control_fd);
+    void start_command(Client& client, const std::string& cmd_line, bool pty, int columns, int rows,
+                       const std::string& term_type);
+    void finish_commands();
+    void end_command(Client& client, int exit_status);
+
+    const std::string socket_path;
+    int listen_fd{-1};
+    std::unique_ptr<SSHSession> ssh_session;
+    std::unique_ptr<ssh_event_struct, void (*)(ssh_event)> event;
+    std::vector<int> pending_clients;
+    std::vector<std::unique_ptr<Client>> clients;
+    bool stop_requested{false};
+};
+} // namespace multipass
+#endif // MULTIPASS_SSH_MULTIPLEXER_H
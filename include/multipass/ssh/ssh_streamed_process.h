@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SSH_STREAMED_PROCESS_H
+#define MULTIPASS_SSH_STREAMED_PROCESS_H
+
+#include <libssh/libssh.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace multipass
+{
+// Runs a command on a channel of its own, passing input and output along as they come rather than all at once
+class SSHStreamedProcess
+{
+public:
+    // Called with each chunk of output, returning false to give up on the command
+    using OutputHandler = std::function<bool(const std::string& output, bool is_stderr)>;
+
+    SSHStreamedProcess(ssh_session session, const std::string& cmd);
+    ~SSHStreamedProcess();
+
+    // Queues input for the command, blocking while too much of it is still waiting to be sent. These two may be
+    // called from another thread than run().
+    void write_input(const std::string& input);
+    void close_input();
+
+    // Passes input and output along until the command exits. Returns its exit status, or nothing when the output
+    // handler gave up.
+    std::optional<int> run(const OutputHandler& handle_output);
+
+private:
+    std::optional<int> pump(const OutputHandler& handle_output);
+    bool pass_input(); // returns whether any input or its end was sent
+    int read_output(std::string& buffer, bool is_stderr, int timeout);
+    void finish();
+
+    using ChannelUPtr = std::unique_ptr<ssh_channel_struct, void (*)(ssh_channel)>;
+
+    ssh_session session;
+    ChannelUPtr channel;
+    std::mutex input_mutex;
+    std::condition_variable input_sent;
+    std::deque<std::string> pending_input;
+    size_t pending_input_size{0};
+    bool input_closed{false};
+    bool eof_sent{false};
+    bool finished{false};
+};
+} // namespace multipass
+#endif // MULTIPASS_SSH_STREAMED_PROCESS_H
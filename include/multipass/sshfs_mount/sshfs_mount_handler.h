@@ -24,7 +24,13 @@
 #include <multipass/ssh/ssh_key_provider.h>
 #include <multipass/sshfs_server_config.h>
 
+#include <QString>
+
+#include <deque>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace multipass
 {
@@ -35,11 +41,15 @@ class SSHFSMountHandler : public QObject, public MountHandler
 {
     Q_OBJECT
 public:
-    explicit SSHFSMountHandler(const SSHKeyProvider& ssh_key_provider);
+    // If cache_dir is given, the sshfs command lines discovered in each instance are kept there across restarts
+    explicit SSHFSMountHandler(const SSHKeyProvider& ssh_key_provider, const QString& cache_dir = {});
 
     void init_mount(VirtualMachine* vm, const std::string& target_path, const VMMount& vm_mount) override;
     void start_mount(VirtualMachine* vm, ServerVariant server, const std::string& target_path,
                      const std::chrono::milliseconds& timeout = std::chrono::minutes(5)) override;
+    std::unordered_map<std::string, std::exception_ptr>
+    start_mounts(VirtualMachine* vm, ServerVariant server, const std::vector<std::string>& target_paths,
+                 const std::chrono::milliseconds& timeout = std::chrono::minutes(5)) override;
 
     void stop_mount(const std::string& instance, const std::string& path) override;
     void stop_all_mounts_for_instance(const std::string& instance) override;
@@ -47,9 +57,43 @@ public:
     bool has_instance_already_mounted(const std::string& instance, const std::string& path) const override;
 
 private:
+    // An sshfs_server process, along with the mounts it is to serve
+    struct MountProcess
+    {
+        std::string target_path;
+        std::vector<std::string> targets;
+        std::shared_ptr<Process> process;
+    };
+
+    // A running sshfs_server that takes more mounts of its instance
+    struct SharedServer
+    {
+        SSHFSServerConfig config;        // with all the mounts it was asked for
+        std::deque<std::string> replies; // its reports on the mounts that were asked for later
+    };
+
+    bool already_started(const std::string& instance, const std::string& target_path);
+    void install_sshfs_if_needed(VirtualMachine* vm, ServerVariant server, const std::chrono::milliseconds& timeout);
+    MountProcess make_mount_process(VirtualMachine* vm, const std::string& target_path);
+    void register_mount_process(VirtualMachine* vm, const MountProcess& mount, QByteArray output);
+    void start_mount_process(VirtualMachine* vm, ServerVariant server, const std::string& target_path,
+                             const std::chrono::milliseconds& timeout);
+    bool join_shared_server(VirtualMachine* vm, const std::string& target_path,
+                            const std::chrono::milliseconds& timeout);
+    void drop_sshfs_exec_line(const std::string& instance);
+    void persist_sshfs_exec_lines() const;
+    std::vector<std::string> sort_out_group_mounts(const std::string& instance,
+                                                   const std::vector<std::string>& targets,
+                                                   const std::string& output);
+
+    const QString sshfs_exec_lines_path;
+    std::unordered_map<std::string, std::string> sshfs_exec_lines;
     std::unordered_map<std::string, std::unordered_map<std::string, SSHFSServerConfig>> sshfs_server_configs;
-    std::unordered_map<std::string, std::unordered_map<std::string, qt_delete_later_unique_ptr<Process>>>
-        mount_processes;
+    // Failures of mounts that were started along with another one, reported when they are started themselves
+    std::unordered_map<std::string, std::unordered_map<std::string, std::string>> failed_mounts;
+    // With a shared sshfs_server, several mounts of an instance map to the same process
+    std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<Process>>> mount_processes;
+    std::unordered_map<Process*, SharedServer> shared_servers;
 };
 
 } // namespace multipass
@@ -19,13 +19,23 @@
 #define MULTIPASS_SSHFS_SERVER_CONFIG_H
 
 #include <multipass/id_mappings.h>
+#include <multipass/vm_mount.h>
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace multipass
 {
 
+struct SSHFSMountConfig
+{
+    std::string source_path;
+    std::string target_path;
+    id_mappings gid_mappings;
+    id_mappings uid_mappings;
+};
+
 struct SSHFSServerConfig
 {
     std::string host;
@@ -37,6 +47,12 @@ struct SSHFSServerConfig
     std::string target_path;
     id_mappings gid_mappings;
     id_mappings uid_mappings;
+    std::string sshfs_exec_line; // a previously discovered sshfs command line, if any
+    VMMount::Profile profile{VMMount::Profile::Default}; // applies to the additional mounts too
+    bool report_sftp_stats{false}; // for the daemon's metrics, on stdout
+    std::string trace_parent;      // the span that the mounts are started in, as W3C trace context, when tracing
+    std::vector<SSHFSMountConfig> additional_mounts; // served by the same process, on the same instance
+    bool shared_server{false}; // takes more mounts of the instance on stdin, over the same SSH session
 };
 
 } // namespace multipass
@@ -59,6 +59,16 @@ public:
     virtual void start() = 0;
     virtual void shutdown() = 0;
     virtual void suspend() = 0;
+    // Like shutdown() and suspend(), but without waiting for the instance to get there, which current_state() tells.
+    // Backends that cannot ask without waiting do both.
+    virtual void request_shutdown()
+    {
+        shutdown();
+    };
+    virtual void request_suspend()
+    {
+        suspend();
+    };
     virtual State current_state() = 0;
     virtual int ssh_port() = 0;
     virtual std::string ssh_hostname()
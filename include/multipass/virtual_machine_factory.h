@@ -59,6 +59,14 @@ public:
     virtual void prepare_networking(std::vector<NetworkInterface>& extra_interfaces) = 0; // note the arg may be updated
     virtual VMImage prepare_source_image(const VMImage& source_image) = 0;
     virtual void prepare_instance_image(const VMImage& instance_image, const VirtualMachineDescription& desc) = 0;
+
+    /** Makes the destination's instance image out of the source's, which must belong to a stopped instance.
+     *
+     * @param source_image The instance image of the instance being cloned
+     * @param destination_image Where the clone's instance image goes, as recorded by the vault
+     */
+    virtual void clone_instance_image(const VMImage& source_image, const VMImage& destination_image) = 0;
+
     virtual void hypervisor_health_check() = 0;
     virtual QString get_backend_directory_name() = 0;
     virtual QString get_backend_version_string() = 0;
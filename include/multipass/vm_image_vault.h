@@ -90,6 +90,9 @@ public:
     virtual VMImageHost* image_host_for(const std::string& remote_name) const = 0;
     virtual std::vector<std::pair<std::string, VMImageInfo>> all_info_for(const Query& query) const = 0;
 
+    // Records an instance image for the destination, next to where the source's is, without making the image itself
+    virtual VMImage clone(const std::string& source_name, const std::string& destination_name) = 0;
+
 protected:
     VMImageVault() = default;
 };
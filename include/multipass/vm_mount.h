@@ -32,10 +32,18 @@ struct VMMount
         Native = 1
     };
 
+    // How classic mounts trade memory and consistency for speed
+    enum class Profile : int
+    {
+        Default = 0,
+        Throughput = 1 // larger requests and, where the instance supports it, writeback caching
+    };
+
     std::string source_path;
     id_mappings gid_mappings;
     id_mappings uid_mappings;
     MountType mount_type;
+    Profile profile{Profile::Default};
 };
 
 inline bool operator==(const VMMount& a, const VMMount& b)
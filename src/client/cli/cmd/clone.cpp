@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "clone.h"
+#include "common_cli.h"
+
+#include "animated_spinner.h"
+
+#include <multipass/cli/argparser.h>
+
+#include <QTimeZone>
+
+namespace mp = multipass;
+namespace cmd = multipass::cmd;
+
+mp::ReturnCode cmd::Clone::run(mp::ArgParser* parser)
+{
+    auto ret = parse_args(parser);
+    if (ret != ParseCode::Ok)
+    {
+        return parser->returnCodeFrom(ret);
+    }
+
+    AnimatedSpinner spinner{cout};
+    auto on_success = [this, &spinner](mp::CloneReply& reply) {
+        spinner.stop();
+        cout << reply.reply_message() << "\n";
+        return ReturnCode::Ok;
+    };
+
+    auto on_failure = [this, &spinner](grpc::Status& status) {
+        spinner.stop();
+        return standard_failure_handler_for(name(), cerr, status);
+    };
+
+    spinner.start("Cloning " + request.source_name());
+    request.set_time_zone(QTimeZone::systemTimeZoneId().toStdString());
+    request.set_verbosity_level(parser->verbosityLevel());
+    return dispatch(&RpcMethod::clone, request, on_success, on_failure);
+}
+
+std::string cmd::Clone::name() const
+{
+    return "clone";
+}
+
+QString cmd::Clone::short_help() const
+{
+    return QStringLiteral("Clone a stopped instance");
+}
+
+QString cmd::Clone::description() const
+{
+    return QStringLiteral("Create a new instance from the disk of a stopped one. The clone shares the\n"
+                          "source's disk as it was when cloned, and gets a name, MAC addresses and\n"
+                          "cloud-init instance ID of its own. It is left stopped.");
+}
+
+mp::ParseCode cmd::Clone::parse_args(mp::ArgParser* parser)
+{
+    parser->addPositionalArgument("source", "Name of the instance to clone", "<source>");
+
+    QCommandLineOption name_option({"n", "name"},
+                                   "Name for the clone. Defaults to the source's name followed by \"-clone\"\n"
+                                   "and the first number not in use.",
+                                   "name");
+    parser->addOption(name_option);
+
+    auto status = parser->commandParse(this);
+    if (status != ParseCode::Ok)
+        return status;
+
+    if (parser->positionalArguments().count() != 1)
+    {
+        cerr << "Wrong number of arguments\n";
+        return ParseCode::CommandLineError;
+    }
+
+    request.set_source_name(parser->positionalArguments().first().toStdString());
+    if (parser->isSet(name_option))
+        request.set_destination_name(parser->value(name_option).toStdString());
+
+    return status;
+}
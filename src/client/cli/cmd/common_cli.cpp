@@ -20,10 +20,12 @@
 #include "animated_spinner.h"
 
 #include <multipass/cli/argparser.h>
+#include <multipass/cli/client_common.h>
 #include <multipass/cli/format_utils.h>
 #include <multipass/constants.h>
 #include <multipass/exceptions/cmd_exceptions.h>
 #include <multipass/exceptions/settings_exceptions.h>
+#include <multipass/ssh/ssh_multiplexer.h>
 
 #include <QCommandLineOption>
 #include <QString>
@@ -104,6 +106,13 @@ std::string cmd::instance_action_message_for(const mp::InstanceNames& instance_n
     return message;
 }
 
+void cmd::stop_ssh_multiplexers(const mp::InstanceNames& instance_names)
+{
+    // Sessions to instances that are going away are of no more use, so masters do not wait for them to drop
+    std::vector<std::string> names{instance_names.instance_name().begin(), instance_names.instance_name().end()};
+    SSHMultiplexer::stop_masters(mp::client::get_server_address(), names);
+}
+
 mp::ReturnCode cmd::run_cmd(const QStringList& args, const mp::ArgParser* parser, std::ostream& cout,
                             std::ostream& cerr)
 {
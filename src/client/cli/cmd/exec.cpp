@@ -19,7 +19,16 @@
 #include "common_cli.h"
 
 #include <multipass/cli/argparser.h>
+#include <multipass/cli/client_common.h>
+#include <multipass/constants.h>
+#include <multipass/settings/settings.h>
 #include <multipass/ssh/ssh_client.h>
+#include <multipass/ssh/ssh_multiplexer.h>
+
+#include <QCoreApplication>
+#include <QProcess>
+
+#include <chrono>
 
 namespace mp = multipass;
 namespace cmd = multipass::cmd;
@@ -28,6 +37,8 @@ namespace
 {
 const QString work_dir_option_name{"working-directory"};
 const QString no_dir_mapping_option{"no-map-working-directory"};
+const QString multiplexer_option_name{"serve-ssh-multiplexer"};
+constexpr auto multiplexer_idle_timeout = std::chrono::minutes{10};
 
 auto is_dir_mounted(const QStringList& split_current_dir, const QStringList& split_source_dir)
 {
@@ -42,6 +53,62 @@ auto is_dir_mounted(const QStringList& split_current_dir, const QStringList& spl
 
     return true;
 }
+
+std::optional<std::string> mapped_work_dir(const mp::SSHInfoReply& reply)
+{
+    // The host directory on which the user is executing the command.
+    QString clean_exec_dir = QDir::cleanPath(QDir::current().canonicalPath());
+    QStringList split_exec_dir = clean_exec_dir.split('/');
+
+    std::optional<std::string> work_dir;
+    for (const auto& mount : reply.ssh_info().begin()->second.mount_paths())
+    {
+        auto source_dir = QDir(QString::fromStdString(mount.source_path()));
+        auto clean_source_dir = QDir::cleanPath(source_dir.absolutePath());
+        QStringList split_source_dir = clean_source_dir.split('/');
+
+        // If the directory is mounted, we need to `cd` to it in the instance before executing the command.
+        if (is_dir_mounted(split_exec_dir, split_source_dir))
+        {
+            for (int i = 0; i < split_source_dir.size(); ++i)
+                split_exec_dir.removeFirst();
+            work_dir = mount.target_path() + '/' + split_exec_dir.join('/').toStdString();
+        }
+    }
+
+    return work_dir;
+}
+
+std::vector<std::vector<std::string>> make_args_list(const std::optional<std::string>& dir,
+                                                     const std::vector<std::string>& args)
+{
+    if (!dir)
+        return {{args}};
+
+    if (args[0] == "sudo")
+    {
+        // If we are running through 'sudo' and need to change directory, it might happen that the default user
+        // does not have access to the folder and thus the cd command will fail. Additionally, `cd` cannot be
+        // ran with sudo, what forces us to run everything through `sh`.
+        auto sh_args = fmt::format("cd {} && {}", *dir, fmt::join(args, " "));
+        return {{"sudo", "sh", "-c", sh_args}};
+    }
+
+    return {{"cd", *dir}, {args}};
+}
+
+void start_multiplexer(const std::string& instance_name)
+{
+    // The master gets its streams out of the way, so that pipes to this command do not wait on it
+    QProcess master;
+    master.setProgram(QCoreApplication::applicationFilePath());
+    master.setArguments({"exec", QStringLiteral("--%1").arg(multiplexer_option_name),
+                         QString::fromStdString(instance_name)});
+    master.setStandardInputFile(QProcess::nullDevice());
+    master.setStandardOutputFile(QProcess::nullDevice());
+    master.setStandardErrorFile(QProcess::nullDevice());
+    master.startDetached();
+}
 } // namespace
 
 mp::ReturnCode cmd::Exec::run(mp::ArgParser* parser)
@@ -54,11 +121,19 @@ mp::ReturnCode cmd::Exec::run(mp::ArgParser* parser)
 
     auto instance_name = ssh_info_request.instance_name(0);
 
+    if (parser->isSet(multiplexer_option_name))
+        return serve_multiplexed(instance_name, parser);
+
     std::vector<std::string> args;
     for (int i = 1; i < parser->positionalArguments().size(); ++i)
         args.push_back(parser->positionalArguments().at(i).toStdString());
 
     std::optional<std::string> work_dir;
+    // Decide whether the working directory must be mapped. There are two cases to consider:
+    // 1. when executing an alias, see if the working directory is set to "map";
+    // 2. when not executing an alias, see if the user did not specify the no-mapping argument.
+    // If one of these two things is true, then prepend the appropriate `cd` to the command to be ran.
+    bool map_work_dir = false;
     if (parser->isSet(work_dir_option_name))
     {
         // If the user asked for a working directory, prepend the appropriate `cd`.
@@ -66,58 +141,40 @@ mp::ReturnCode cmd::Exec::run(mp::ArgParser* parser)
     }
     else
     {
-        // Decide whether the working directory must be mapped. There are two cases to consider:
-        // 1. when executing an alias, see if the working directory is set to "map";
-        // 2. when not executing an alias, see if the user did not specify the no-mapping argument.
-        // If one of these two things is true, then prepend the appropriate `cd` to the command to be ran.
-        if ((parser->executeAlias() && parser->executeAlias()->working_directory == "map") ||
-            (!parser->executeAlias() && !parser->isSet(no_dir_mapping_option)))
+        map_work_dir = (parser->executeAlias() && parser->executeAlias()->working_directory == "map") ||
+                       (!parser->executeAlias() && !parser->isSet(no_dir_mapping_option));
+    }
+
+    // The mounts to map the working directory with come along with the SSH info
+    ssh_info_request.set_with_mounts(map_work_dir);
+
+    // Even with a master, the daemon is asked first, so that mounts are current and instances that were stopped or
+    // deleted by anyone are not reached through sessions that outlived them
+    const auto multiplexing = MP_SETTINGS.get_as<bool>(ssh_multiplexing_key);
+    const auto server_address = mp::client::get_server_address();
+
+    auto on_success = [this, &args, &work_dir, &instance_name, &server_address, map_work_dir,
+                       multiplexing](mp::SSHInfoReply& reply) {
+        if (map_work_dir && !reply.ssh_info().empty())
+            work_dir = mapped_work_dir(reply);
+
+        if (multiplexing && !reply.ssh_info().empty())
         {
-            // The host directory on which the user is executing the command.
-            QString clean_exec_dir = QDir::cleanPath(QDir::current().canonicalPath());
-            QStringList split_exec_dir = clean_exec_dir.split('/');
-
-            auto on_info_success = [&work_dir, &split_exec_dir](mp::InfoReply& reply) {
-                for (const auto& mount : reply.info(0).mount_info().mount_paths())
-                {
-                    auto source_dir = QDir(QString::fromStdString(mount.source_path()));
-                    auto clean_source_dir = QDir::cleanPath(source_dir.absolutePath());
-                    QStringList split_source_dir = clean_source_dir.split('/');
-
-                    // If the directory is mounted, we need to `cd` to it in the instance before executing the command.
-                    if (is_dir_mounted(split_exec_dir, split_source_dir))
-                    {
-                        for (int i = 0; i < split_source_dir.size(); ++i)
-                            split_exec_dir.removeFirst();
-                        work_dir = mount.target_path() + '/' + split_exec_dir.join('/').toStdString();
-                    }
-                }
-
-                return ReturnCode::Ok;
-            };
-
-            auto on_info_failure = [this](grpc::Status& status) {
-                return standard_failure_handler_for(name(), cerr, status);
-            };
-
-            info_request.set_verbosity_level(parser->verbosityLevel());
-
-            InstanceNames instance_names;
-            auto info_instance_name = instance_names.add_instance_name();
-            info_instance_name->append(instance_name);
-            info_request.mutable_instance_names()->CopyFrom(instance_names);
-            info_request.set_no_runtime_information(true);
-
-            dispatch(&RpcMethod::info, info_request, on_info_success, on_info_failure);
-            // TODO: what to do with the returned value?
+            const auto cmd_line = SSHClient::cmd_line_for(make_args_list(work_dir, args));
+            if (auto exit_code = SSHMultiplexer::exec(server_address, instance_name, cmd_line, term); exit_code)
+                return static_cast<mp::ReturnCode>(*exit_code);
+
+            // Later commands go through the master, while this one goes on with its own session
+            start_multiplexer(instance_name);
         }
-    }
 
-    auto on_success = [this, &args, &work_dir](mp::SSHInfoReply& reply) {
         return exec_success(reply, work_dir, args, term);
     };
 
-    auto on_failure = [this, &instance_name, parser](grpc::Status& status) {
+    auto on_failure = [this, &instance_name, &server_address, parser, multiplexing](grpc::Status& status) {
+        if (multiplexing)
+            SSHMultiplexer::stop_masters(server_address, {instance_name});
+
         if (status.error_code() == grpc::StatusCode::ABORTED)
             return run_cmd_and_retry({"multipass", "start", QString::fromStdString(instance_name)}, parser, cout, cerr);
         else
@@ -166,24 +223,7 @@ mp::ReturnCode cmd::Exec::exec_success(const mp::SSHInfoReply& reply, const std:
         auto console_creator = [&term](auto channel) { return Console::make_console(channel, term); };
         mp::SSHClient ssh_client{host, port, username, priv_key_blob, console_creator};
 
-        std::vector<std::vector<std::string>> all_args;
-        if (dir)
-        {
-            if (args[0] == "sudo")
-            {
-                // If we are running through 'sudo' and need to change directory, it might happen that the default user
-                // does not have access to the folder and thus the cd command will fail. Additionally, `cd` cannot be
-                // ran with sudo, what forces us to run everything through `sh`.
-                auto sh_args = fmt::format("cd {} && {}", *dir, fmt::join(args, " "));
-                all_args = {{"sudo", "sh", "-c", sh_args}};
-            }
-            else
-                all_args = {{"cd", *dir}, {args}};
-        }
-        else
-            all_args = {{args}};
-
-        return static_cast<mp::ReturnCode>(ssh_client.exec(all_args));
+        return static_cast<mp::ReturnCode>(ssh_client.exec(make_args_list(dir, args)));
     }
     catch (const std::exception& e)
     {
@@ -192,6 +232,38 @@ mp::ReturnCode cmd::Exec::exec_success(const mp::SSHInfoReply& reply, const std:
     }
 }
 
+mp::ReturnCode cmd::Exec::serve_multiplexed(const std::string& instance_name, mp::ArgParser* parser)
+{
+    auto on_success = [this, &instance_name](mp::SSHInfoReply& reply) {
+        if (reply.ssh_info().empty())
+            return ReturnCode::Ok;
+
+        const auto& ssh_info = reply.ssh_info().begin()->second;
+        try
+        {
+            SSHMultiplexer multiplexer{mp::client::get_server_address(),
+                                       instance_name,
+                                       ssh_info.host(),
+                                       ssh_info.port(),
+                                       ssh_info.username(),
+                                       ssh_info.priv_key_base64()};
+            multiplexer.serve(multiplexer_idle_timeout);
+        }
+        catch (const std::exception& e)
+        {
+            cerr << "exec failed: " << e.what() << "\n";
+            return ReturnCode::CommandFail;
+        }
+
+        return ReturnCode::Ok;
+    };
+
+    auto on_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
+
+    ssh_info_request.set_verbosity_level(parser->verbosityLevel());
+    return dispatch(&RpcMethod::ssh_info, ssh_info_request, on_success, on_failure);
+}
+
 mp::ParseCode cmd::Exec::parse_args(mp::ArgParser* parser)
 {
     parser->addPositionalArgument("name", "Name of instance to execute the command on", "<name>");
@@ -201,8 +273,13 @@ mp::ParseCode cmd::Exec::parse_args(mp::ArgParser* parser)
     QCommandLineOption noDirMappingOption({"n", no_dir_mapping_option},
                                           "Do not map the host execution path to a mounted path");
 
+    // Used to start the master that later commands share the SSH session of, see `client.ssh-multiplexing`
+    QCommandLineOption multiplexerOption(multiplexer_option_name, "Serve the SSH session to the instance");
+    multiplexerOption.setFlags(QCommandLineOption::HiddenFromHelp);
+
     parser->addOptions({workDirOption});
     parser->addOptions({noDirMappingOption});
+    parser->addOptions({multiplexerOption});
 
     auto status = parser->commandParse(this);
 
@@ -223,7 +300,7 @@ mp::ParseCode cmd::Exec::parse_args(mp::ArgParser* parser)
         cerr << fmt::format("Options --{} and --{} clash\n", work_dir_option_name, no_dir_mapping_option);
         status = ParseCode::CommandLineError;
     }
-    else if (parser->positionalArguments().count() < 2)
+    else if (parser->positionalArguments().count() < (parser->isSet(multiplexer_option_name) ? 1 : 2))
     {
         cerr << "Wrong number of arguments\n";
         status = ParseCode::CommandLineError;
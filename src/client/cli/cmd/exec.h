@@ -22,6 +22,7 @@
 
 #include <multipass/cli/alias_dict.h>
 #include <multipass/cli/command.h>
+#include <multipass/ssh/ssh_multiplexer.h>
 
 namespace multipass
 {
@@ -46,10 +47,10 @@ public:
 
 private:
     SSHInfoRequest ssh_info_request;
-    InfoRequest info_request;
     AliasDict aliases;
 
     ParseCode parse_args(ArgParser* parser);
+    ReturnCode serve_multiplexed(const std::string& instance_name, ArgParser* parser);
 };
 } // namespace cmd
 } // namespace multipass
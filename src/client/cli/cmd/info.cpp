@@ -32,16 +32,36 @@ mp::ReturnCode cmd::Info::run(mp::ArgParser* parser)
         return parser->returnCodeFrom(ret);
     }
 
-    auto on_success = [this](mp::InfoReply& reply) {
-        cout << chosen_formatter->format(reply);
+    // Whether the daemon streams or not, instances are formatted as their replies come
+    auto streamed_format = chosen_formatter->streamed_info_format();
+
+    auto on_success = [this, &streamed_format](mp::InfoReply& reply) {
+        cout << streamed_format->end();
 
         return ReturnCode::Ok;
     };
 
-    auto on_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
+    // Instances that came before a failure were already printed, so their output is closed rather than left open
+    bool any_printed{false};
+    auto on_failure = [this, &streamed_format, &any_printed](grpc::Status& status) {
+        if (any_printed)
+            cout << streamed_format->end();
+
+        return standard_failure_handler_for(name(), cerr, status);
+    };
+
+    auto streaming_callback = [this, &streamed_format, &any_printed](
+                                  mp::InfoReply& reply, grpc::ClientReaderWriterInterface<InfoRequest, InfoReply>*) {
+        if (!reply.log_line().empty())
+            cerr << reply.log_line();
+
+        const auto text = streamed_format->next(reply);
+        any_printed = any_printed || !text.empty();
+        cout << text << std::flush;
+    };
 
     request.set_verbosity_level(parser->verbosityLevel());
-    return dispatch(&RpcMethod::info, request, on_success, on_failure);
+    return dispatch(&RpcMethod::info, request, on_success, on_failure, streaming_callback);
 }
 
 std::string cmd::Info::name() const { return "info"; }
@@ -74,6 +94,11 @@ mp::ParseCode cmd::Info::parse_args(mp::ArgParser* parser)
         "format", "table");
     parser->addOption(formatOption);
 
+    QCommandLineOption streamOption(
+        "stream", "Display each instance's information as soon as it is gathered, rather than all of it at the "
+                  "end.\nInstances still come in listing order");
+    parser->addOption(streamOption);
+
     auto status = parser->commandParse(this);
 
     if (status != ParseCode::Ok)
@@ -87,6 +112,7 @@ mp::ParseCode cmd::Info::parse_args(mp::ArgParser* parser)
 
     request.mutable_instance_names()->CopyFrom(add_instance_names(parser));
     request.set_no_runtime_information(parser->isSet(noRuntimeInfoOption));
+    request.set_streaming(parser->isSet(streamOption));
 
     status = handle_format_option(parser, &chosen_formatter, cerr);
 
@@ -153,12 +153,16 @@ mp::ReturnCode cmd::Launch::run(mp::ArgParser* parser)
             }
         }
 
-        for (const auto& [source, target] : mount_routes)
+        for (const auto& launched_name : launched_names)
         {
-            auto mount_ret = mount(parser, source, target);
-            if (ret == ReturnCode::Ok)
+            instance_name = launched_name;
+            for (const auto& [source, target] : mount_routes)
             {
-                ret = mount_ret;
+                auto mount_ret = mount(parser, source, target);
+                if (ret == ReturnCode::Ok)
+                {
+                    ret = mount_ret;
+                }
             }
         }
     }
@@ -228,6 +232,16 @@ mp::ParseCode cmd::Launch::parse_args(mp::ArgParser* parser)
                   .arg(petenv_name, mp::home_automount_dir);
 
     QCommandLineOption nameOption({"n", "name"}, name_option_desc, "name");
+    QCommandLineOption countOption("count",
+                                   "Number of alike instances to launch together, named <prefix>-1, <prefix>-2 and so "
+                                   "on. Default: 1.",
+                                   "count", "1");
+    QCommandLineOption namePrefixOption(
+        "name-prefix", "Prefix for the names of the instances launched with --count. Random if omitted.", "prefix");
+    QCommandLineOption parallelOption(
+        "parallel",
+        "Number of the instances launched with --count to prepare and boot at a time. Default: all of them.",
+        "parallel");
     QCommandLineOption cloudInitOption(
         "cloud-init", "Path or URL to a user-data cloud-init configuration, or '-' for stdin", "file> | <url");
     QCommandLineOption networkOption("network",
@@ -246,8 +260,8 @@ mp::ParseCode cmd::Launch::parse_args(mp::ArgParser* parser)
                                    "mount point will be the same as the absolute path of <local-path>",
                                    "local-path>:<instance-path");
 
-    parser->addOptions({cpusOption, diskOption, memOption, memOptionDeprecated, nameOption, cloudInitOption,
-                        networkOption, bridgedOption, mountOption});
+    parser->addOptions({cpusOption, diskOption, memOption, memOptionDeprecated, nameOption, countOption,
+                        namePrefixOption, parallelOption, cloudInitOption, networkOption, bridgedOption, mountOption});
 
     mp::cmd::add_timeout(parser);
 
@@ -299,6 +313,53 @@ mp::ParseCode cmd::Launch::parse_args(mp::ArgParser* parser)
         request.set_instance_name(parser->value(nameOption).toStdString());
     }
 
+    if (parser->isSet(countOption))
+    {
+        bool conversion_pass;
+        const auto& count_text = parser->value(countOption);
+        const int count = count_text.toInt(&conversion_pass);
+
+        if (!conversion_pass || count < 1)
+        {
+            fmt::print(cerr, "error: Invalid instance count '{}', need a positive integer value.\n", count_text);
+            return ParseCode::CommandLineError;
+        }
+
+        request.set_count(count);
+    }
+
+    if (request.count() > 1)
+    {
+        if (parser->isSet(nameOption))
+        {
+            cerr << "error: Cannot give one name to several instances, use \"--name-prefix\" instead.\n";
+            return ParseCode::CommandLineError;
+        }
+
+        request.set_name_prefix(parser->value(namePrefixOption).toStdString());
+    }
+    else if (parser->isSet(namePrefixOption) || parser->isSet(parallelOption))
+    {
+        cerr << "error: \"--name-prefix\" and \"--parallel\" only apply when launching several instances with "
+                "\"--count\".\n";
+        return ParseCode::CommandLineError;
+    }
+
+    if (parser->isSet(parallelOption))
+    {
+        bool conversion_pass;
+        const auto& parallel_text = parser->value(parallelOption);
+        const int max_parallel = parallel_text.toInt(&conversion_pass);
+
+        if (!conversion_pass || max_parallel < 1)
+        {
+            fmt::print(cerr, "error: Invalid parallel count '{}', need a positive integer value.\n", parallel_text);
+            return ParseCode::CommandLineError;
+        }
+
+        request.set_max_parallel(max_parallel);
+    }
+
     if (parser->isSet(cpusOption))
     {
         bool conversion_pass;
@@ -475,6 +536,12 @@ mp::ReturnCode cmd::Launch::request_launch(const ArgParser* parser)
         instance_name = QString::fromStdString(request.instance_name().empty() ? reply.vm_instance_name()
                                                                                : request.instance_name());
 
+        launched_names.clear();
+        for (const auto& launched_name : reply.vm_instance_names())
+            launched_names << QString::fromStdString(launched_name);
+        if (launched_names.isEmpty())
+            launched_names << instance_name;
+
         for (const auto& workspace_to_be_created : reply.workspaces_to_be_created())
         {
             auto home_dir = mpu::in_multipass_snap() ? QString::fromLocal8Bit(mpu::snap_real_home_dir())
@@ -501,7 +568,7 @@ mp::ReturnCode cmd::Launch::request_launch(const ArgParser* parser)
             }
         }
 
-        cout << "Launched: " << reply.vm_instance_name() << "\n";
+        cout << fmt::format("Launched: {}\n", fmt::join(launched_names, ", "));
 
         if (term->is_live() && update_available(reply.update_info()))
         {
@@ -534,7 +601,9 @@ mp::ReturnCode cmd::Launch::request_launch(const ArgParser* parser)
             }
             else if (error == LaunchError::INVALID_HOSTNAME)
             {
-                error_details = fmt::format("Invalid instance name supplied: {}", request.instance_name());
+                error_details = fmt::format("Invalid instance name supplied: {}", request.count() > 1
+                                                                                     ? request.name_prefix()
+                                                                                     : request.instance_name());
             }
             else if (error == LaunchError::INVALID_NETWORK)
             {
@@ -25,6 +25,7 @@
 #include <multipass/timer.h>
 
 #include <QString>
+#include <QStringList>
 
 #include <memory>
 #include <string>
@@ -61,6 +62,7 @@ private:
 
     std::vector<std::pair<QString, QString>> mount_routes;
     QString instance_name;
+    QStringList launched_names;
 
     AliasDict aliases;
 };
@@ -32,19 +32,43 @@ mp::ReturnCode cmd::List::run(mp::ArgParser* parser)
         return parser->returnCodeFrom(ret);
     }
 
-    auto on_success = [this](ListReply& reply) {
-        cout << chosen_formatter->format(reply);
+    // Whether the daemon streams or not, instances are formatted as their replies come
+    auto streamed_format = chosen_formatter->streamed_list_format();
+    UpdateInfo update_info;
 
-        if (term->is_live() && update_available(reply.update_info()))
-            cout << update_notice(reply.update_info());
+    auto on_success = [this, &streamed_format, &update_info](ListReply& reply) {
+        cout << streamed_format->end();
+
+        if (term->is_live() && update_available(update_info))
+            cout << update_notice(update_info);
 
         return ReturnCode::Ok;
     };
 
-    auto on_failure = [this](grpc::Status& status) { return standard_failure_handler_for(name(), cerr, status); };
+    // Instances that came before a failure were already printed, so their output is closed rather than left open
+    bool any_printed{false};
+    auto on_failure = [this, &streamed_format, &any_printed](grpc::Status& status) {
+        if (any_printed)
+            cout << streamed_format->end();
+
+        return standard_failure_handler_for(name(), cerr, status);
+    };
+
+    auto streaming_callback = [this, &streamed_format, &update_info, &any_printed](
+                                  ListReply& reply, grpc::ClientReaderWriterInterface<ListRequest, ListReply>*) {
+        if (!reply.log_line().empty())
+            cerr << reply.log_line();
+
+        if (reply.has_update_info()) // only the first reply has it when streaming
+            update_info = reply.update_info();
+
+        const auto text = streamed_format->next(reply);
+        any_printed = any_printed || !text.empty();
+        cout << text << std::flush;
+    };
 
     request.set_verbosity_level(parser->verbosityLevel());
-    return dispatch(&RpcMethod::list, request, on_success, on_failure);
+    return dispatch(&RpcMethod::list, request, on_success, on_failure, streaming_callback);
 }
 
 std::string cmd::List::name() const
@@ -76,7 +100,11 @@ mp::ParseCode cmd::List::parse_args(mp::ArgParser* parser)
     QCommandLineOption noIpv4Option("no-ipv4", "Do not query the instances for the IPv4's they are using");
     noIpv4Option.setFlags(QCommandLineOption::HiddenFromHelp);
 
-    parser->addOptions({formatOption, noIpv4Option});
+    QCommandLineOption streamOption(
+        "stream", "List each instance as soon as its details are gathered, rather than all of them at the end.\n"
+                  "Instances still come in listing order, and table columns fit the first ones");
+
+    parser->addOptions({formatOption, noIpv4Option, streamOption});
 
     auto status = parser->commandParse(this);
 
@@ -92,6 +120,7 @@ mp::ParseCode cmd::List::parse_args(mp::ArgParser* parser)
     }
 
     request.set_request_ipv4(!parser->isSet(noIpv4Option));
+    request.set_streaming(parser->isSet(streamOption));
 
     status = handle_format_option(parser, &chosen_formatter, cerr);
 
@@ -38,6 +38,8 @@ namespace
 constexpr auto category = "mount cmd";
 const QString default_mount_type{"classic"};
 const QString native_mount_type{"native"};
+const QString default_profile{"default"};
+const QString throughput_profile{"throughput"};
 
 auto convert_id_for(const QString& id_string)
 {
@@ -61,6 +63,18 @@ auto checked_mount_type(const QString& type)
     throw mp::ValidationException{fmt::format("Bad mount type '{}' specified, please use '{}' or '{}'", type,
                                               default_mount_type, native_mount_type)};
 }
+
+auto checked_profile(const QString& profile)
+{
+    if (profile == default_profile)
+        return mp::MountRequest_Profile_DEFAULT;
+
+    if (profile == throughput_profile)
+        return mp::MountRequest_Profile_THROUGHPUT;
+
+    throw mp::ValidationException{fmt::format("Bad mount profile '{}' specified, please use '{}' or '{}'", profile,
+                                              default_profile, throughput_profile)};
+}
 } // namespace
 
 mp::ReturnCode cmd::Mount::run(mp::ArgParser* parser)
@@ -148,8 +162,14 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
                                          "Native mounts use hypervisor and/or platform specific mounts.\n"
                                          "Valid types are: \'classic\' (default) and \'native\'",
                                          "type", default_mount_type);
+    QCommandLineOption profile_option({"p", "profile"},
+                                      "Specify how classic mounts are tuned.\n"
+                                      "The throughput profile uses larger requests and, where the instance "
+                                      "supports it, writeback caching, at the cost of some memory.\n"
+                                      "Valid profiles are: \'default\' (default) and \'throughput\'",
+                                      "profile", default_profile);
 
-    parser->addOptions({gid_mappings, uid_mappings, mount_type_option});
+    parser->addOptions({gid_mappings, uid_mappings, mount_type_option, profile_option});
 
     auto status = parser->commandParse(this);
     if (status != ParseCode::Ok)
@@ -294,6 +314,11 @@ mp::ParseCode cmd::Mount::parse_args(mp::ArgParser* parser)
     try
     {
         request.set_mount_type(checked_mount_type(parser->value(mount_type_option).toLower()));
+        request.set_profile(checked_profile(parser->value(profile_option).toLower()));
+
+        if (request.mount_type() == mp::MountRequest_MountType_NATIVE &&
+            request.profile() != mp::MountRequest_Profile_DEFAULT)
+            throw mp::ValidationException{"Mount profiles only apply to classic mounts"};
     }
     catch (mp::ValidationException& e)
     {
@@ -65,6 +65,7 @@ mp::ReturnCode cmd::Restart::run(mp::ArgParser* parser)
         spinner.start(reply.reply_message());
     };
 
+    stop_ssh_multiplexers(request.instance_names());
     request.set_verbosity_level(parser->verbosityLevel());
 
     std::unique_ptr<multipass::utils::Timer> timer;
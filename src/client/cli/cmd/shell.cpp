@@ -20,10 +20,12 @@
 
 #include "animated_spinner.h"
 #include <multipass/cli/argparser.h>
+#include <multipass/cli/client_common.h>
 #include <multipass/constants.h>
 #include <multipass/exceptions/cmd_exceptions.h>
 #include <multipass/settings/settings.h>
 #include <multipass/ssh/ssh_client.h>
+#include <multipass/ssh/ssh_multiplexer.h>
 #include <multipass/timer.h>
 
 #include <chrono>
@@ -54,7 +56,10 @@ mp::ReturnCode cmd::Shell::run(mp::ArgParser* parser)
     // at a time
     auto instance_name = request.instance_name()[0];
 
-    auto on_success = [this, &timer](mp::SSHInfoReply& reply) {
+    const auto multiplexing = MP_SETTINGS.get_as<bool>(ssh_multiplexing_key);
+    const auto server_address = mp::client::get_server_address();
+
+    auto on_success = [this, &timer, &instance_name, &server_address, multiplexing](mp::SSHInfoReply& reply) {
         if (timer)
             timer->stop();
 
@@ -62,6 +67,10 @@ mp::ReturnCode cmd::Shell::run(mp::ArgParser* parser)
         if (reply.ssh_info().empty())
             return ReturnCode::Ok;
 
+        // Shells do not start masters of their own, but use that of earlier commands if there is one
+        if (multiplexing && SSHMultiplexer::exec(server_address, instance_name, "", term))
+            return ReturnCode::Ok;
+
         // TODO: this should setup a reader that continously prints out
         // streaming replies from the server corresponding to stdout/stderr streams
         const auto& ssh_info = reply.ssh_info().begin()->second;
@@ -84,7 +93,10 @@ mp::ReturnCode cmd::Shell::run(mp::ArgParser* parser)
         return ReturnCode::Ok;
     };
 
-    auto on_failure = [this, &instance_name, parser](grpc::Status& status) {
+    auto on_failure = [this, &instance_name, &server_address, parser, multiplexing](grpc::Status& status) {
+        if (multiplexing)
+            SSHMultiplexer::stop_masters(server_address, {instance_name});
+
         QStringList retry_args{};
 
         if (status.error_code() == grpc::StatusCode::NOT_FOUND && instance_name == petenv_name.toStdString())
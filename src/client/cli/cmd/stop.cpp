@@ -46,6 +46,7 @@ mp::ReturnCode cmd::Stop::run(mp::ArgParser* parser)
         return standard_failure_handler_for(name(), cerr, status);
     };
 
+    stop_ssh_multiplexers(request.instance_names());
     spinner.start(instance_action_message_for(request.instance_names(), "Stopping "));
     request.set_verbosity_level(parser->verbosityLevel());
     return dispatch(&RpcMethod::stop, request, on_success, on_failure);
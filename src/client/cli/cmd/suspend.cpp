@@ -43,6 +43,7 @@ mp::ReturnCode cmd::Suspend::run(mp::ArgParser* parser)
         return standard_failure_handler_for(name(), cerr, status);
     };
 
+    stop_ssh_multiplexers(request.instance_names());
     spinner.start(instance_action_message_for(request.instance_names(), "Suspending "));
     request.set_verbosity_level(parser->verbosityLevel());
     return dispatch(&RpcMethod::suspend, request, on_success, on_failure);
@@ -129,12 +129,17 @@ mp::ParseCode cmd::Transfer::parse_args(mp::ArgParser* parser)
                                   "<destination>");
     parser->addOption({{"r", "recursive"}, "Recursively copy entire directories"});
     parser->addOption({{"p", "parents"}, "Make parent directories as needed"});
+    parser->addOption({"sync",
+                       "Only send the files, and the parts of files, that differ from those already in the instance. "
+                       "Needs python3 in the instance to send only the changed parts, otherwise changed files are "
+                       "sent whole"});
 
     if (auto status = parser->commandParse(this); status != ParseCode::Ok)
         return status;
 
     flags.setFlag(SFTPClient::Flag::Recursive, parser->isSet("r"));
     flags.setFlag(SFTPClient::Flag::MakeParent, parser->isSet("p"));
+    flags.setFlag(SFTPClient::Flag::Sync, parser->isSet("sync"));
 
     auto positionalArgs = parser->positionalArguments();
     if (positionalArgs.size() < 2)
@@ -151,10 +156,18 @@ mp::ParseCode cmd::Transfer::parse_args(mp::ArgParser* parser)
     const auto full_target = positionalArgs.takeLast();
     const auto& full_sources = positionalArgs;
 
-    if (const auto ret_opt = parse_streaming(full_sources, full_target, split_sources, split_target); ret_opt)
-        return ret_opt.value();
+    auto status = parse_streaming(full_sources, full_target, split_sources, split_target);
+    if (!status)
+        status = parse_non_streaming(split_sources, split_target);
 
-    return parse_non_streaming(split_sources, split_target);
+    if (status == ParseCode::Ok && flags.testFlag(SFTPClient::Flag::Sync) &&
+        !std::holds_alternative<LocalSourcesInstanceTarget>(arguments))
+    {
+        term->cerr() << "--sync is only supported when transferring from the host to an instance\n";
+        return ParseCode::CommandLineError;
+    }
+
+    return *status;
 }
 
 std::vector<std::pair<std::string, fs::path>> cmd::Transfer::args_to_instance_and_path(const QStringList& args)
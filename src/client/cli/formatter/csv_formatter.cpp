@@ -21,49 +21,119 @@
 
 #include <multipass/format.h>
 
+#include <utility>
+
 namespace mp = multipass;
 
+namespace
+{
+const auto info_header = "Name,State,Ipv4,Ipv6,Release,Image hash,Image release,Load,Disk usage,Disk total,Memory "
+                         "usage,Memory total,Mounts,AllIPv4,CPU(s)\n";
+const auto list_header = "Name,State,IPv4,IPv6,Release,AllIPv4\n";
+
+void format_info(fmt::memory_buffer& buf, const mp::InfoReply::Info& info)
+{
+    fmt::format_to(std::back_inserter(buf), "{},{},{},{},{},{},{},{},{},{},{},{},", info.name(),
+                   mp::format::status_string_for(info.instance_status()), info.ipv4_size() ? info.ipv4(0) : "",
+                   info.ipv6_size() ? info.ipv6(0) : "", info.current_release(), info.id(), info.image_release(),
+                   info.load(), info.disk_usage(), info.disk_total(), info.memory_usage(), info.memory_total());
+
+    auto mount_paths = info.mount_info().mount_paths();
+    for (auto mount = mount_paths.cbegin(); mount != mount_paths.cend(); ++mount)
+    {
+        fmt::format_to(std::back_inserter(buf), "{} => {};", mount->source_path(), mount->target_path());
+    }
+
+    fmt::format_to(std::back_inserter(buf), ",\"{}\";,{}\n", fmt::join(info.ipv4(), ","), info.cpu_count());
+}
+
+void format_list_instance(fmt::memory_buffer& buf, const mp::ListVMInstance& instance)
+{
+    fmt::format_to(std::back_inserter(buf), "{},{},{},{},{},\"{}\"\n", instance.name(),
+                   mp::format::status_string_for(instance.instance_status()),
+                   instance.ipv4_size() ? instance.ipv4(0) : "", instance.ipv6_size() ? instance.ipv6(0) : "",
+                   instance.current_release().empty() ? "Not Available"
+                                                      : fmt::format("Ubuntu {}", instance.current_release()),
+                   fmt::join(instance.ipv4(), ","));
+}
+
+// Rows go out as they come, after the header, which goes out even when no row does
+template <typename Reply>
+class StreamedCSV : public mp::StreamedFormat<Reply>
+{
+public:
+    explicit StreamedCSV(std::string header) : header{std::move(header)}
+    {
+    }
+
+    std::string next(const Reply& part) override
+    {
+        fmt::memory_buffer buf;
+        format_rows(buf, part);
+
+        return buf.size() ? std::exchange(header, {}) + fmt::to_string(buf) : std::string{};
+    }
+
+    std::string end() override
+    {
+        return std::exchange(header, {});
+    }
+
+private:
+    virtual void format_rows(fmt::memory_buffer& buf, const Reply& part) const = 0;
+
+    std::string header;
+};
+
+class StreamedCSVInfo final : public StreamedCSV<mp::InfoReply>
+{
+public:
+    StreamedCSVInfo() : StreamedCSV{info_header}
+    {
+    }
+
+private:
+    void format_rows(fmt::memory_buffer& buf, const mp::InfoReply& part) const override
+    {
+        for (const auto& info : mp::format::sorted(part.info()))
+            format_info(buf, info);
+    }
+};
+
+class StreamedCSVList final : public StreamedCSV<mp::ListReply>
+{
+public:
+    StreamedCSVList() : StreamedCSV{list_header}
+    {
+    }
+
+private:
+    void format_rows(fmt::memory_buffer& buf, const mp::ListReply& part) const override
+    {
+        for (const auto& instance : mp::format::sorted(part.instances()))
+            format_list_instance(buf, instance);
+    }
+};
+} // namespace
+
 std::string mp::CSVFormatter::format(const InfoReply& reply) const
 {
     fmt::memory_buffer buf;
-    fmt::format_to(
-        std::back_inserter(buf),
-        "Name,State,Ipv4,Ipv6,Release,Image hash,Image release,Load,Disk usage,Disk total,Memory usage,Memory "
-        "total,Mounts,AllIPv4,CPU(s)\n");
+    fmt::format_to(std::back_inserter(buf), "{}", info_header);
 
     for (const auto& info : format::sorted(reply.info()))
-    {
-        fmt::format_to(std::back_inserter(buf), "{},{},{},{},{},{},{},{},{},{},{},{},", info.name(),
-                       mp::format::status_string_for(info.instance_status()), info.ipv4_size() ? info.ipv4(0) : "",
-                       info.ipv6_size() ? info.ipv6(0) : "", info.current_release(), info.id(), info.image_release(),
-                       info.load(), info.disk_usage(), info.disk_total(), info.memory_usage(), info.memory_total());
-
-        auto mount_paths = info.mount_info().mount_paths();
-        for (auto mount = mount_paths.cbegin(); mount != mount_paths.cend(); ++mount)
-        {
-            fmt::format_to(std::back_inserter(buf), "{} => {};", mount->source_path(), mount->target_path());
-        }
-
-        fmt::format_to(std::back_inserter(buf), ",\"{}\";,{}\n", fmt::join(info.ipv4(), ","), info.cpu_count());
-    }
+        format_info(buf, info);
+
     return fmt::to_string(buf);
 }
 
 std::string mp::CSVFormatter::format(const ListReply& reply) const
 {
     fmt::memory_buffer buf;
-
-    fmt::format_to(std::back_inserter(buf), "Name,State,IPv4,IPv6,Release,AllIPv4\n");
+    fmt::format_to(std::back_inserter(buf), "{}", list_header);
 
     for (const auto& instance : format::sorted(reply.instances()))
-    {
-        fmt::format_to(std::back_inserter(buf), "{},{},{},{},{},\"{}\"\n", instance.name(),
-                       mp::format::status_string_for(instance.instance_status()),
-                       instance.ipv4_size() ? instance.ipv4(0) : "", instance.ipv6_size() ? instance.ipv6(0) : "",
-                       instance.current_release().empty() ? "Not Available"
-                                                          : fmt::format("Ubuntu {}", instance.current_release()),
-                       fmt::join(instance.ipv4(), ","));
-    }
+        format_list_instance(buf, instance);
 
     return fmt::to_string(buf);
 }
@@ -135,3 +205,13 @@ std::string mp::CSVFormatter::format(const mp::AliasDict& aliases) const
 
     return fmt::to_string(buf);
 }
+
+auto mp::CSVFormatter::streamed_info_format() const -> std::unique_ptr<StreamedFormat<InfoReply>>
+{
+    return std::make_unique<StreamedCSVInfo>();
+}
+
+auto mp::CSVFormatter::streamed_list_format() const -> std::unique_ptr<StreamedFormat<ListReply>>
+{
+    return std::make_unique<StreamedCSVList>();
+}
@@ -25,97 +25,212 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 
+#include <utility>
+
 namespace mp = multipass;
 
-std::string mp::JsonFormatter::format(const InfoReply& reply) const
+namespace
 {
-    QJsonObject info_json;
-    QJsonObject info_obj;
+QJsonObject info_to_json(const mp::InfoReply::Info& info)
+{
+    QJsonObject instance_info;
+    instance_info.insert("state", QString::fromStdString(mp::format::status_string_for(info.instance_status())));
+    instance_info.insert("image_hash", QString::fromStdString(info.id()));
+    instance_info.insert("image_release", QString::fromStdString(info.image_release()));
+    instance_info.insert("release", QString::fromStdString(info.current_release()));
+    instance_info.insert("cpu_count", QString::fromStdString(info.cpu_count()));
+
+    QJsonArray load;
+    if (!info.load().empty())
+    {
+        auto loads = mp::utils::split(info.load(), " ");
+        for (const auto& entry : loads)
+            load.append(std::stod(entry));
+    }
+    instance_info.insert("load", load);
+
+    QJsonObject disks;
+    QJsonObject disk;
+    if (!info.disk_usage().empty())
+        disk.insert("used", QString::fromStdString(info.disk_usage()));
+    if (!info.disk_total().empty())
+        disk.insert("total", QString::fromStdString(info.disk_total()));
+
+    // TODO: disk name should come from daemon
+    disks.insert("sda1", disk);
+    instance_info.insert("disks", disks);
+
+    QJsonObject memory;
+    if (!info.memory_usage().empty())
+        memory.insert("used", std::stoll(info.memory_usage()));
+    if (!info.memory_total().empty())
+        memory.insert("total", std::stoll(info.memory_total()));
+    instance_info.insert("memory", memory);
+
+    QJsonArray ipv4_addrs;
+    for (const auto& ip : info.ipv4())
+        ipv4_addrs.append(QString::fromStdString(ip));
+    instance_info.insert("ipv4", ipv4_addrs);
+
+    QJsonObject mounts;
+    for (const auto& mount : info.mount_info().mount_paths())
+    {
+        QJsonObject entry;
+        QJsonArray mount_uids;
+        QJsonArray mount_gids;
 
-    info_json.insert("errors", QJsonArray());
+        auto mount_maps = mount.mount_maps();
 
-    for (const auto& info : reply.info())
-    {
-        QJsonObject instance_info;
-        instance_info.insert("state", QString::fromStdString(mp::format::status_string_for(info.instance_status())));
-        instance_info.insert("image_hash", QString::fromStdString(info.id()));
-        instance_info.insert("image_release", QString::fromStdString(info.image_release()));
-        instance_info.insert("release", QString::fromStdString(info.current_release()));
-        instance_info.insert("cpu_count", QString::fromStdString(info.cpu_count()));
-
-        QJsonArray load;
-        if (!info.load().empty())
+        for (auto i = 0; i < mount_maps.uid_mappings_size(); ++i)
         {
-            auto loads = mp::utils::split(info.load(), " ");
-            for (const auto& entry : loads)
-                load.append(std::stod(entry));
+            auto uid_map_pair = mount_maps.uid_mappings(i);
+            auto host_uid = uid_map_pair.host_id();
+            auto instance_uid = uid_map_pair.instance_id();
+
+            mount_uids.append(
+                QString("%1:%2")
+                    .arg(QString::number(host_uid))
+                    .arg((instance_uid == mp::default_id) ? "default" : QString::number(instance_uid)));
         }
-        instance_info.insert("load", load);
-
-        QJsonObject disks;
-        QJsonObject disk;
-        if (!info.disk_usage().empty())
-            disk.insert("used", QString::fromStdString(info.disk_usage()));
-        if (!info.disk_total().empty())
-            disk.insert("total", QString::fromStdString(info.disk_total()));
-
-        // TODO: disk name should come from daemon
-        disks.insert("sda1", disk);
-        instance_info.insert("disks", disks);
-
-        QJsonObject memory;
-        if (!info.memory_usage().empty())
-            memory.insert("used", std::stoll(info.memory_usage()));
-        if (!info.memory_total().empty())
-            memory.insert("total", std::stoll(info.memory_total()));
-        instance_info.insert("memory", memory);
-
-        QJsonArray ipv4_addrs;
-        for (const auto& ip : info.ipv4())
-            ipv4_addrs.append(QString::fromStdString(ip));
-        instance_info.insert("ipv4", ipv4_addrs);
-
-        QJsonObject mounts;
-        for (const auto& mount : info.mount_info().mount_paths())
+        for (auto i = 0; i < mount_maps.gid_mappings_size(); ++i)
         {
-            QJsonObject entry;
-            QJsonArray mount_uids;
-            QJsonArray mount_gids;
-
-            auto mount_maps = mount.mount_maps();
-
-            for (auto i = 0; i < mount_maps.uid_mappings_size(); ++i)
-            {
-                auto uid_map_pair = mount_maps.uid_mappings(i);
-                auto host_uid = uid_map_pair.host_id();
-                auto instance_uid = uid_map_pair.instance_id();
-
-                mount_uids.append(
-                    QString("%1:%2")
-                        .arg(QString::number(host_uid))
-                        .arg((instance_uid == mp::default_id) ? "default" : QString::number(instance_uid)));
-            }
-            for (auto i = 0; i < mount_maps.gid_mappings_size(); ++i)
-            {
-                auto gid_map_pair = mount_maps.gid_mappings(i);
-                auto host_gid = gid_map_pair.host_id();
-                auto instance_gid = gid_map_pair.instance_id();
-
-                mount_gids.append(
-                    QString("%1:%2")
-                        .arg(QString::number(host_gid))
-                        .arg((instance_gid == mp::default_id) ? "default" : QString::number(instance_gid)));
-            }
-            entry.insert("uid_mappings", mount_uids);
-            entry.insert("gid_mappings", mount_gids);
-            entry.insert("source_path", QString::fromStdString(mount.source_path()));
-
-            mounts.insert(QString::fromStdString(mount.target_path()), entry);
+            auto gid_map_pair = mount_maps.gid_mappings(i);
+            auto host_gid = gid_map_pair.host_id();
+            auto instance_gid = gid_map_pair.instance_id();
+
+            mount_gids.append(
+                QString("%1:%2")
+                    .arg(QString::number(host_gid))
+                    .arg((instance_gid == mp::default_id) ? "default" : QString::number(instance_gid)));
         }
-        instance_info.insert("mounts", mounts);
+        entry.insert("uid_mappings", mount_uids);
+        entry.insert("gid_mappings", mount_gids);
+        entry.insert("source_path", QString::fromStdString(mount.source_path()));
+
+        mounts.insert(QString::fromStdString(mount.target_path()), entry);
+    }
+    instance_info.insert("mounts", mounts);
+
+    return instance_info;
+}
+
+QJsonObject list_instance_to_json(const mp::ListVMInstance& instance)
+{
+    QJsonObject instance_obj;
+    instance_obj.insert("name", QString::fromStdString(instance.name()));
+    instance_obj.insert("state", QString::fromStdString(mp::format::status_string_for(instance.instance_status())));
+
+    QJsonArray ipv4_addrs;
+    for (const auto& ip : instance.ipv4())
+        ipv4_addrs.append(QString::fromStdString(ip));
+    instance_obj.insert("ipv4", ipv4_addrs);
+
+    instance_obj.insert("release",
+                        QString::fromStdString(instance.current_release().empty()
+                                                   ? "Not Available"
+                                                   : fmt::format("Ubuntu {}", instance.current_release())));
+
+    return instance_obj;
+}
+
+// What goes between the brackets of a document's outermost object or array, indented as if it were nested in depth of
+// them (one being the document's own)
+QByteArray json_contents(const QJsonDocument& doc, int depth)
+{
+    const auto lines = doc.toJson().split('\n'); // newlines in values are escaped, so these are all whole lines
+    const auto indent = QByteArray(4 * (depth - 1), ' ');
+
+    QByteArray ret;
+    for (auto i = 1; i < lines.size() - 2; ++i) // skip the opening and closing lines and the empty one after them
+        ret += indent + lines[i] + '\n';
+    ret.chop(1);
+
+    return ret;
+}
+
+// Writes the document's opening up to its list of instances as soon as there is anything to write, then each
+// instance as it comes, so that the output amounts to what the whole reply would have been formatted into
+template <typename Reply>
+class StreamedJson : public mp::StreamedFormat<Reply>
+{
+public:
+    StreamedJson(QByteArray opening, QByteArray closing) : opening{std::move(opening)}, closing{std::move(closing)}
+    {
+    }
+
+    std::string next(const Reply& part) override
+    {
+        const auto contents = json_contents(part_to_json(part), 2);
+        if (contents.isEmpty())
+            return {};
+
+        QByteArray ret = std::exchange(opening, {});
+        if (any_contents)
+            ret += ",\n";
+
+        any_contents = true;
+        return (ret + contents).toStdString();
+    }
+
+    std::string end() override
+    {
+        return (opening + (any_contents ? "\n" : "") + closing).toStdString();
+    }
+
+private:
+    virtual QJsonDocument part_to_json(const Reply& part) const = 0;
+
+    QByteArray opening;
+    QByteArray closing;
+    bool any_contents{false};
+};
+
+class StreamedJsonInfo final : public StreamedJson<mp::InfoReply>
+{
+public:
+    StreamedJsonInfo() : StreamedJson{"{\n    \"errors\": [\n    ],\n    \"info\": {\n", "    }\n}\n"}
+    {
+    }
 
-        info_obj.insert(QString::fromStdString(info.name()), instance_info);
+private:
+    QJsonDocument part_to_json(const mp::InfoReply& part) const override
+    {
+        QJsonObject info_obj;
+        for (const auto& info : part.info())
+            info_obj.insert(QString::fromStdString(info.name()), info_to_json(info));
+
+        return QJsonDocument{info_obj};
     }
+};
+
+class StreamedJsonList final : public StreamedJson<mp::ListReply>
+{
+public:
+    StreamedJsonList() : StreamedJson{"{\n    \"list\": [\n", "    ]\n}\n"}
+    {
+    }
+
+private:
+    QJsonDocument part_to_json(const mp::ListReply& part) const override
+    {
+        QJsonArray instances;
+        for (const auto& instance : part.instances())
+            instances.append(list_instance_to_json(instance));
+
+        return QJsonDocument{instances};
+    }
+};
+} // namespace
+
+std::string mp::JsonFormatter::format(const InfoReply& reply) const
+{
+    QJsonObject info_json;
+    QJsonObject info_obj;
+
+    info_json.insert("errors", QJsonArray());
+
+    for (const auto& info : reply.info())
+        info_obj.insert(QString::fromStdString(info.name()), info_to_json(info));
     info_json.insert("info", info_obj);
 
     return QString(QJsonDocument(info_json).toJson()).toStdString();
@@ -127,23 +242,7 @@ std::string mp::JsonFormatter::format(const ListReply& reply) const
     QJsonArray instances;
 
     for (const auto& instance : reply.instances())
-    {
-        QJsonObject instance_obj;
-        instance_obj.insert("name", QString::fromStdString(instance.name()));
-        instance_obj.insert("state", QString::fromStdString(mp::format::status_string_for(instance.instance_status())));
-
-        QJsonArray ipv4_addrs;
-        for (const auto& ip : instance.ipv4())
-            ipv4_addrs.append(QString::fromStdString(ip));
-        instance_obj.insert("ipv4", ipv4_addrs);
-
-        instance_obj.insert("release",
-                            QString::fromStdString(instance.current_release().empty()
-                                                       ? "Not Available"
-                                                       : fmt::format("Ubuntu {}", instance.current_release())));
-
-        instances.append(instance_obj);
-    }
+        instances.append(list_instance_to_json(instance));
 
     list_json.insert("list", instances);
 
@@ -250,3 +349,13 @@ std::string mp::JsonFormatter::format(const mp::AliasDict& aliases) const
 
     return QString(QJsonDocument(aliases_json).toJson()).toStdString();
 }
+
+auto mp::JsonFormatter::streamed_info_format() const -> std::unique_ptr<StreamedFormat<InfoReply>>
+{
+    return std::make_unique<StreamedJsonInfo>();
+}
+
+auto mp::JsonFormatter::streamed_list_format() const -> std::unique_ptr<StreamedFormat<ListReply>>
+{
+    return std::make_unique<StreamedJsonList>();
+}
@@ -35,88 +35,186 @@ std::string to_usage(const std::string& usage, const std::string& total)
     return fmt::format("{} out of {}", mp::MemorySize{usage}.human_readable(), mp::MemorySize{total}.human_readable());
 }
 
-} // namespace
-std::string mp::TableFormatter::format(const InfoReply& reply) const
+void format_info(fmt::memory_buffer& buf, const mp::InfoReply::Info& info)
 {
-    fmt::memory_buffer buf;
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "Name:", info.name());
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
+                   "State:", mp::format::status_string_for(info.instance_status()));
 
-    for (const auto& info : format::sorted(reply.info()))
+    int ipv4_size = info.ipv4_size();
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "IPv4:", ipv4_size ? info.ipv4(0) : "--");
+
+    for (int i = 1; i < ipv4_size; ++i)
+        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "", info.ipv4(i));
+
+    if (int ipv6_size = info.ipv6_size())
     {
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "Name:", info.name());
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
-                       "State:", mp::format::status_string_for(info.instance_status()));
+        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "IPv6:", info.ipv6(0));
+
+        for (int i = 1; i < ipv6_size; ++i)
+            fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "", info.ipv6(i));
+    }
+
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
+                   "Release:", info.current_release().empty() ? "--" : info.current_release());
+    fmt::format_to(std::back_inserter(buf), "{:<16}", "Image hash:");
+    if (info.id().empty())
+        fmt::format_to(std::back_inserter(buf), "{}\n", "Not Available");
+    else
+        fmt::format_to(std::back_inserter(buf), "{}{}\n", info.id().substr(0, 12),
+                       !info.image_release().empty() ? fmt::format(" (Ubuntu {})", info.image_release()) : "");
+
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
+                   "CPU(s):", info.cpu_count().empty() ? "--" : info.cpu_count());
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "Load:", info.load().empty() ? "--" : info.load());
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
+                   "Disk usage:", to_usage(info.disk_usage(), info.disk_total()));
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
+                   "Memory usage:", to_usage(info.memory_usage(), info.memory_total()));
+
+    auto mount_paths = info.mount_info().mount_paths();
+    fmt::format_to(std::back_inserter(buf), "{:<16}{}", "Mounts:", mount_paths.empty() ? "--\n" : "");
+
+    for (auto mount = mount_paths.cbegin(); mount != mount_paths.cend(); ++mount)
+    {
+        if (mount != mount_paths.cbegin())
+            fmt::format_to(std::back_inserter(buf), "{:<16}", "");
+        fmt::format_to(std::back_inserter(buf), "{:{}} => {}\n", mount->source_path(),
+                       info.mount_info().longest_path_len(), mount->target_path());
+
+        auto mount_maps = mount->mount_maps();
+        auto uid_mappings_size = mount_maps.uid_mappings_size();
+
+        for (auto i = 0; i < uid_mappings_size; ++i)
+        {
+            auto uid_map_pair = mount_maps.uid_mappings(i);
+            auto host_uid = uid_map_pair.host_id();
+            auto instance_uid = uid_map_pair.instance_id();
+
+            fmt::format_to(std::back_inserter(buf), "{:>{}}{}:{}{}", (i == 0) ? "UID map: " : "", (i == 0) ? 29 : 0,
+                           std::to_string(host_uid),
+                           (instance_uid == mp::default_id) ? "default" : std::to_string(instance_uid),
+                           (i == uid_mappings_size - 1) ? "\n" : ", ");
+        }
+
+        for (auto gid_mapping = mount_maps.gid_mappings().cbegin(); gid_mapping != mount_maps.gid_mappings().cend();
+             ++gid_mapping)
+        {
+            auto host_gid = gid_mapping->host_id();
+            auto instance_gid = gid_mapping->instance_id();
+
+            fmt::format_to(std::back_inserter(buf), "{:>{}}{}:{}{}{}",
+                           (gid_mapping == mount_maps.gid_mappings().cbegin()) ? "GID map: " : "",
+                           (gid_mapping == mount_maps.gid_mappings().cbegin()) ? 29 : 0, std::to_string(host_gid),
+                           (instance_gid == mp::default_id) ? "default" : std::to_string(instance_gid),
+                           (std::next(gid_mapping) != mount_maps.gid_mappings().cend()) ? ", " : "",
+                           (std::next(gid_mapping) == mount_maps.gid_mappings().cend()) ? "\n" : "");
+        }
+    }
+}
+
+const auto list_row_format = "{:<{}}{:<{}}{:<{}}{:<}\n";
+const std::string::size_type state_column_width = 18;
+const std::string::size_type ip_column_width = 17;
 
-        int ipv4_size = info.ipv4_size();
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "IPv4:", ipv4_size ? info.ipv4(0) : "--");
+template <typename Instances>
+int list_name_column_width(const Instances& instances)
+{
+    return mp::format::column_width(
+        instances.begin(), instances.end(), [](const auto& instance) -> int { return instance.name().length(); }, 24);
+}
+
+void format_list_header(fmt::memory_buffer& buf, int name_column_width)
+{
+    fmt::format_to(std::back_inserter(buf), list_row_format, "Name", name_column_width, "State", state_column_width,
+                   "IPv4", ip_column_width, "Image");
+}
 
-        for (int i = 1; i < ipv4_size; ++i)
-            fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "", info.ipv4(i));
+void format_list_row(fmt::memory_buffer& buf, const mp::ListVMInstance& instance, int name_column_width)
+{
+    int ipv4_size = instance.ipv4_size();
+
+    fmt::format_to(std::back_inserter(buf), list_row_format, instance.name(), name_column_width,
+                   mp::format::status_string_for(instance.instance_status()), state_column_width,
+                   ipv4_size ? instance.ipv4(0) : "--", ip_column_width,
+                   instance.current_release().empty() ? "Not Available"
+                                                      : fmt::format("Ubuntu {}", instance.current_release()));
+
+    for (int i = 1; i < ipv4_size; ++i)
+    {
+        fmt::format_to(std::back_inserter(buf), list_row_format, "", name_column_width, "", state_column_width,
+                       instance.ipv4(i), instance.ipv4(i).size(), "");
+    }
+}
+
+class StreamedTableInfo final : public mp::StreamedFormat<mp::InfoReply>
+{
+public:
+    std::string next(const mp::InfoReply& part) override
+    {
+        fmt::memory_buffer buf;
 
-        if (int ipv6_size = info.ipv6_size())
+        for (const auto& info : mp::format::sorted(part.info()))
         {
-            fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "IPv6:", info.ipv6(0));
+            if (any_info)
+                fmt::format_to(std::back_inserter(buf), "\n");
 
-            for (int i = 1; i < ipv6_size; ++i)
-                fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "", info.ipv6(i));
+            format_info(buf, info);
+            any_info = true;
         }
 
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
-                       "Release:", info.current_release().empty() ? "--" : info.current_release());
-        fmt::format_to(std::back_inserter(buf), "{:<16}", "Image hash:");
-        if (info.id().empty())
-            fmt::format_to(std::back_inserter(buf), "{}\n", "Not Available");
-        else
-            fmt::format_to(std::back_inserter(buf), "{}{}\n", info.id().substr(0, 12),
-                           !info.image_release().empty() ? fmt::format(" (Ubuntu {})", info.image_release()) : "");
-
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
-                       "CPU(s):", info.cpu_count().empty() ? "--" : info.cpu_count());
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n", "Load:", info.load().empty() ? "--" : info.load());
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
-                       "Disk usage:", to_usage(info.disk_usage(), info.disk_total()));
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}\n",
-                       "Memory usage:", to_usage(info.memory_usage(), info.memory_total()));
-
-        auto mount_paths = info.mount_info().mount_paths();
-        fmt::format_to(std::back_inserter(buf), "{:<16}{}", "Mounts:", mount_paths.empty() ? "--\n" : "");
-
-        for (auto mount = mount_paths.cbegin(); mount != mount_paths.cend(); ++mount)
+        return fmt::to_string(buf);
+    }
+
+    std::string end() override
+    {
+        return any_info ? "" : "\n";
+    }
+
+private:
+    bool any_info{false};
+};
+
+// Columns are as wide as the first part needs, so names that come later may push the rest of their row further out
+class StreamedTableList final : public mp::StreamedFormat<mp::ListReply>
+{
+public:
+    std::string next(const mp::ListReply& part) override
+    {
+        fmt::memory_buffer buf;
+
+        if (part.instances().empty())
+            return {};
+
+        if (!name_column_width)
         {
-            if (mount != mount_paths.cbegin())
-                fmt::format_to(std::back_inserter(buf), "{:<16}", "");
-            fmt::format_to(std::back_inserter(buf), "{:{}} => {}\n", mount->source_path(),
-                           info.mount_info().longest_path_len(), mount->target_path());
-
-            auto mount_maps = mount->mount_maps();
-            auto uid_mappings_size = mount_maps.uid_mappings_size();
-
-            for (auto i = 0; i < uid_mappings_size; ++i)
-            {
-                auto uid_map_pair = mount_maps.uid_mappings(i);
-                auto host_uid = uid_map_pair.host_id();
-                auto instance_uid = uid_map_pair.instance_id();
-
-                fmt::format_to(std::back_inserter(buf), "{:>{}}{}:{}{}", (i == 0) ? "UID map: " : "", (i == 0) ? 29 : 0,
-                               std::to_string(host_uid),
-                               (instance_uid == mp::default_id) ? "default" : std::to_string(instance_uid),
-                               (i == uid_mappings_size - 1) ? "\n" : ", ");
-            }
-
-            for (auto gid_mapping = mount_maps.gid_mappings().cbegin(); gid_mapping != mount_maps.gid_mappings().cend();
-                 ++gid_mapping)
-            {
-                auto host_gid = gid_mapping->host_id();
-                auto instance_gid = gid_mapping->instance_id();
-
-                fmt::format_to(std::back_inserter(buf), "{:>{}}{}:{}{}{}",
-                               (gid_mapping == mount_maps.gid_mappings().cbegin()) ? "GID map: " : "",
-                               (gid_mapping == mount_maps.gid_mappings().cbegin()) ? 29 : 0, std::to_string(host_gid),
-                               (instance_gid == mp::default_id) ? "default" : std::to_string(instance_gid),
-                               (std::next(gid_mapping) != mount_maps.gid_mappings().cend()) ? ", " : "",
-                               (std::next(gid_mapping) == mount_maps.gid_mappings().cend()) ? "\n" : "");
-            }
+            name_column_width = list_name_column_width(part.instances());
+            format_list_header(buf, name_column_width);
         }
 
+        for (const auto& instance : mp::format::sorted(part.instances()))
+            format_list_row(buf, instance,
+                            std::max(name_column_width, static_cast<int>(instance.name().length()) + 2));
+
+        return fmt::to_string(buf);
+    }
+
+    std::string end() override
+    {
+        return name_column_width ? "" : "No instances found.\n";
+    }
+
+private:
+    int name_column_width{0};
+};
+} // namespace
+std::string mp::TableFormatter::format(const InfoReply& reply) const
+{
+    fmt::memory_buffer buf;
+
+    for (const auto& info : format::sorted(reply.info()))
+    {
+        format_info(buf, info);
         fmt::format_to(std::back_inserter(buf), "\n");
     }
 
@@ -138,31 +236,11 @@ std::string mp::TableFormatter::format(const ListReply& reply) const
     if (instances.empty())
         return "No instances found.\n";
 
-    const auto name_column_width = mp::format::column_width(
-        instances.begin(), instances.end(), [](const auto& interface) -> int { return interface.name().length(); }, 24);
-    const std::string::size_type state_column_width = 18;
-    const std::string::size_type ip_column_width = 17;
-
-    const auto row_format = "{:<{}}{:<{}}{:<{}}{:<}\n";
-    fmt::format_to(std::back_inserter(buf), row_format, "Name", name_column_width, "State", state_column_width, "IPv4",
-                   ip_column_width, "Image");
+    const auto name_column_width = list_name_column_width(instances);
+    format_list_header(buf, name_column_width);
 
     for (const auto& instance : format::sorted(reply.instances()))
-    {
-        int ipv4_size = instance.ipv4_size();
-
-        fmt::format_to(std::back_inserter(buf), row_format, instance.name(), name_column_width,
-                       mp::format::status_string_for(instance.instance_status()), state_column_width,
-                       ipv4_size ? instance.ipv4(0) : "--", ip_column_width,
-                       instance.current_release().empty() ? "Not Available"
-                                                          : fmt::format("Ubuntu {}", instance.current_release()));
-
-        for (int i = 1; i < ipv4_size; ++i)
-        {
-            fmt::format_to(std::back_inserter(buf), row_format, "", name_column_width, "", state_column_width,
-                           instance.ipv4(i), instance.ipv4(i).size(), "");
-        }
-    }
+        format_list_row(buf, instance, name_column_width);
 
     return fmt::to_string(buf);
 }
@@ -267,3 +345,13 @@ std::string mp::TableFormatter::format(const mp::AliasDict& aliases) const
 
     return fmt::to_string(buf);
 }
+
+auto mp::TableFormatter::streamed_info_format() const -> std::unique_ptr<StreamedFormat<InfoReply>>
+{
+    return std::make_unique<StreamedTableInfo>();
+}
+
+auto mp::TableFormatter::streamed_list_format() const -> std::unique_ptr<StreamedFormat<ListReply>>
+{
+    return std::make_unique<StreamedTableList>();
+}
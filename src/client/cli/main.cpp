@@ -20,6 +20,7 @@
 #include <multipass/cli/client_common.h>
 #include <multipass/console.h>
 #include <multipass/constants.h>
+#include <multipass/logging/trace.h>
 #include <multipass/top_catch_all.h>
 
 #include <QCoreApplication>
@@ -41,6 +42,9 @@ int main_impl(int argc, char* argv[])
     mp::ClientConfig config{mp::client::get_server_address(), mp::client::get_cert_provider(), term.get()};
     mp::Client client{config};
 
+    // Only for the daemon to tie together what it does for each call the command makes, the client exports nothing
+    mp::logging::Span command_span{mp::client_name};
+
     return client.run(QCoreApplication::arguments());
 }
 } // namespace
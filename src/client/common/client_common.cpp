@@ -42,6 +42,7 @@ namespace
 {
 const auto client_root = QStringLiteral("client");
 const auto autostart_default = QStringLiteral("true");
+const auto ssh_multiplexing_default = QStringLiteral("false");
 
 QString default_hotkey()
 {
@@ -179,15 +180,22 @@ QString mp::client::persistent_settings_filename()
 
 void mp::client::register_global_settings_handlers()
 {
-    auto settings = MP_PLATFORM.extra_client_settings(); // platform settings override inserts with the same key below
-    settings.insert(std::make_unique<BoolSettingSpec>(autostart_key, autostart_default));
-    settings.insert(std::make_unique<CustomSettingSpec>(mp::petenv_key, petenv_default, petenv_interpreter));
-    settings.insert(std::make_unique<CustomSettingSpec>(mp::hotkey_key, default_hotkey(), [](QString val) {
-        return mp::platform::interpret_setting(mp::hotkey_key, val);
-    }));
+    // Most commands never look at a client setting, so the specs (which ask the platform and Qt for defaults) are
+    // only made once some setting is actually needed
+    auto make_settings = [] {
+        auto settings = MP_PLATFORM.extra_client_settings(); // platform settings override inserts with the same key
+        settings.insert(std::make_unique<BoolSettingSpec>(autostart_key, autostart_default));
+        settings.insert(std::make_unique<BoolSettingSpec>(ssh_multiplexing_key, ssh_multiplexing_default));
+        settings.insert(std::make_unique<CustomSettingSpec>(mp::petenv_key, petenv_default, petenv_interpreter));
+        settings.insert(std::make_unique<CustomSettingSpec>(mp::hotkey_key, default_hotkey(), [](QString val) {
+            return mp::platform::interpret_setting(mp::hotkey_key, val);
+        }));
+
+        return settings;
+    };
 
     MP_SETTINGS.register_handler(
-        std::make_unique<PersistentSettingsHandler>(persistent_settings_filename(), std::move(settings)));
+        PersistentSettingsHandler::deferred(persistent_settings_filename(), std::move(make_settings)));
 }
 
 std::shared_ptr<grpc::Channel> mp::client::make_channel(const std::string& server_address,
@@ -18,6 +18,7 @@
 #include "daemon.h"
 #include "base_cloud_init_config.h"
 #include "instance_settings_handler.h"
+#include "metrics_server.h"
 
 #include <multipass/alias_definition.h>
 #include <multipass/constants.h>
@@ -26,18 +27,22 @@
 #include <multipass/exceptions/exitless_sshprocess_exception.h>
 #include <multipass/exceptions/invalid_memory_size_exception.h>
 #include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
+#include <multipass/exceptions/ssh_exception.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/exceptions/start_exception.h>
 #include <multipass/ip_address.h>
 #include <multipass/json_writer.h>
 #include <multipass/logging/client_logger.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
+#include <multipass/metrics.h>
 #include <multipass/name_generator.h>
 #include <multipass/network_interface.h>
 #include <multipass/platform.h>
 #include <multipass/query.h>
 #include <multipass/settings/settings.h>
 #include <multipass/ssh/ssh_session.h>
+#include <multipass/ssh/ssh_streamed_process.h>
 #include <multipass/top_catch_all.h>
 #include <multipass/utils.h>
 #include <multipass/version.h>
@@ -66,7 +71,9 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <optional>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -83,8 +90,16 @@ using error_string = std::string;
 
 constexpr auto category = "daemon";
 constexpr auto instance_db_name = "multipassd-vm-instances.json";
+constexpr auto warm_pool_db_name = "multipassd-warm-pool.json";
+constexpr auto instance_state_metric = "multipass_instance_state";
 constexpr auto reboot_cmd = "sudo reboot";
 constexpr auto stop_ssh_cmd = "sudo systemctl stop ssh";
+constexpr auto max_concurrent_execs = 64; // commands streamed through the daemon at once, others wait their turn
+constexpr auto exec_input_close_timeout = std::chrono::seconds(5); // for clients to close their side after the exit
+constexpr auto max_watchers = 32;
+constexpr auto lifecycle_poll_interval = std::chrono::milliseconds(100); // how often stopping instances are checked on
+constexpr auto lifecycle_settle_timeout = std::chrono::seconds(30); // as long as backends used to wait for them
+constexpr auto watch_heartbeat = std::chrono::seconds(10); // how long a watcher may go without hearing from the daemon
 const std::string sshfs_error_template = "Error enabling mount support in '{}'"
                                          "\n\nPlease install the 'multipass-sshfs' snap manually inside the instance.";
 
@@ -200,6 +215,24 @@ auto make_cloud_init_network_config(const std::string default_mac_addr,
     return network_data;
 }
 
+// Clones carry their source's machine-id along, so they must not ask for leases with the client ID derived from it
+auto make_clone_network_config(const std::string& default_mac_addr,
+                               const std::vector<mp::NetworkInterface>& extra_interfaces)
+{
+    auto network_data = make_cloud_init_network_config(default_mac_addr, extra_interfaces);
+
+    network_data["version"] = "2";
+    network_data["ethernets"]["default"]["match"]["macaddress"] = default_mac_addr;
+    network_data["ethernets"]["default"]["dhcp4"] = true;
+    network_data["ethernets"]["default"]["dhcp-identifier"] = "mac";
+
+    for (size_t i = 0; i < extra_interfaces.size(); ++i)
+        if (extra_interfaces[i].auto_mode)
+            network_data["ethernets"]["extra" + std::to_string(i)]["dhcp-identifier"] = "mac";
+
+    return network_data;
+}
+
 void prepare_user_data(YAML::Node& user_data_config, YAML::Node& vendor_config)
 {
     auto users = user_data_config["users"];
@@ -260,15 +293,16 @@ std::vector<mp::NetworkInterface> read_extra_interfaces(const QJsonObject& recor
     return extra_interfaces;
 }
 
-std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path, const mp::Path& cache_path)
+std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path, const mp::Path& cache_path,
+                                                     const char* db_name = instance_db_name)
 {
     QDir data_dir{data_path};
     QDir cache_dir{cache_path};
-    QFile db_file{data_dir.filePath(instance_db_name)};
+    QFile db_file{data_dir.filePath(db_name)};
     if (!db_file.open(QIODevice::ReadOnly))
     {
         // Try to open the old location
-        db_file.setFileName(cache_dir.filePath(instance_db_name));
+        db_file.setFileName(cache_dir.filePath(db_name));
         if (!db_file.open(QIODevice::ReadOnly))
             return {};
     }
@@ -340,8 +374,9 @@ std::unordered_map<std::string, mp::VMSpecs> load_db(const mp::Path& data_path,
             uid_mappings = mp::unique_id_mappings(uid_mappings);
             gid_mappings = mp::unique_id_mappings(gid_mappings);
             auto mount_type = mp::VMMount::MountType(entry.toObject()["mount_type"].toInt());
+            auto profile = mp::VMMount::Profile(entry.toObject()["profile"].toInt());
 
-            mp::VMMount mount{source_path, gid_mappings, uid_mappings, mount_type};
+            mp::VMMount mount{source_path, gid_mappings, uid_mappings, mount_type, profile};
             mounts[target_path] = mount;
         }
 
@@ -576,6 +611,98 @@ auto grpc_status_for(fmt::memory_buffer& errors)
                         fmt::format("The following errors occurred:\n{}", error_string), "");
 }
 
+bool needs_shutdown(mp::VirtualMachine::State state)
+{
+    using St = mp::VirtualMachine::State;
+    const auto skip_states = {St::off, St::stopped, St::suspended};
+
+    return std::none_of(cbegin(skip_states), cend(skip_states), [&state](const auto& st) { return state == st; });
+}
+
+// Whether an instance that was asked to stop or suspend is still getting there
+bool is_settling(mp::VirtualMachine::State state)
+{
+    using St = mp::VirtualMachine::State;
+    return state == St::running || state == St::delayed_shutdown || state == St::suspending;
+}
+
+std::optional<mp::SSHSession> shutdown_session_for(mp::VirtualMachine& vm, const mp::SSHKeyProvider& key_provider)
+{
+    try
+    {
+        return mp::SSHSession{vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), key_provider};
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Cannot open ssh session on \"{}\" shutdown: {}", vm.vm_name, e.what()));
+        return std::nullopt;
+    }
+}
+
+// Lets several threads report on the same stream, which gRPC only allows one write at a time on
+template <typename Reply, typename Request>
+class SerializedServer : public grpc::ServerReaderWriterInterface<Reply, Request>
+{
+public:
+    explicit SerializedServer(grpc::ServerReaderWriterInterface<Reply, Request>* server) : server{server}
+    {
+    }
+
+    void SendInitialMetadata() override
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        server->SendInitialMetadata();
+    }
+
+    bool Write(const Reply& msg, grpc::WriteOptions options) override
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return server->Write(msg, options);
+    }
+
+    bool NextMessageSize(uint32_t* sz) override
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return server->NextMessageSize(sz);
+    }
+
+    bool Read(Request* msg) override
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return server->Read(msg);
+    }
+
+private:
+    grpc::ServerReaderWriterInterface<Reply, Request>* server;
+    std::mutex mutex;
+};
+
+// Stands in for a client when the daemon makes instances of its own accord, with nobody to tell how it goes
+template <typename Reply, typename Request>
+class DiscardingServer : public grpc::ServerReaderWriterInterface<Reply, Request>
+{
+public:
+    void SendInitialMetadata() override
+    {
+    }
+
+    bool Write(const Reply& /*msg*/, grpc::WriteOptions /*options*/) override
+    {
+        return true;
+    }
+
+    bool NextMessageSize(uint32_t* /*sz*/) override
+    {
+        return false;
+    }
+
+    bool Read(Request* /*msg*/) override
+    {
+        return false;
+    }
+};
+
 auto connect_rpc(mp::DaemonRpc& rpc, mp::Daemon& daemon)
 {
     QObject::connect(&rpc, &mp::DaemonRpc::on_create, &daemon, &mp::Daemon::create);
@@ -587,7 +714,10 @@ auto connect_rpc(mp::DaemonRpc& rpc, mp::Daemon& daemon)
     QObject::connect(&rpc, &mp::DaemonRpc::on_networks, &daemon, &mp::Daemon::networks);
     QObject::connect(&rpc, &mp::DaemonRpc::on_mount, &daemon, &mp::Daemon::mount);
     QObject::connect(&rpc, &mp::DaemonRpc::on_recover, &daemon, &mp::Daemon::recover);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_clone, &daemon, &mp::Daemon::clone);
     QObject::connect(&rpc, &mp::DaemonRpc::on_ssh_info, &daemon, &mp::Daemon::ssh_info);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_exec, &daemon, &mp::Daemon::exec);
+    QObject::connect(&rpc, &mp::DaemonRpc::on_watch, &daemon, &mp::Daemon::watch);
     QObject::connect(&rpc, &mp::DaemonRpc::on_start, &daemon, &mp::Daemon::start);
     QObject::connect(&rpc, &mp::DaemonRpc::on_stop, &daemon, &mp::Daemon::stop);
     QObject::connect(&rpc, &mp::DaemonRpc::on_suspend, &daemon, &mp::Daemon::suspend);
@@ -834,6 +964,20 @@ bool is_ipv4_valid(const std::string& ipv4)
     return true;
 }
 
+mp::InstanceEvent make_instance_event(const std::string& name, mp::InstanceEvent::Kind kind,
+                                      mp::InstanceStatus::Status status, const std::string& ipv4 = {})
+{
+    mp::InstanceEvent event;
+    event.set_instance_name(name);
+    event.set_kind(kind);
+    event.mutable_instance_status()->set_status(status);
+
+    if (is_ipv4_valid(ipv4))
+        event.add_ipv4(ipv4);
+
+    return event;
+}
+
 void add_aliases(mp::FindReply& response, const std::string& remote_name, const mp::VMImageInfo& info,
                  const std::string& default_remote)
 {
@@ -878,6 +1022,27 @@ register_instance_mod(std::unordered_map<std::string, mp::VMSpecs>& vm_instance_
         vm_instance_specs, vm_instances, deleted_instances, preparing_instances, std::move(instance_persister)));
 }
 
+mp::VirtualMachineDescription description_from(const std::string& name, const mp::VMSpecs& spec,
+                                               const mp::VMImage& vm_image)
+{
+    const auto instance_dir = mp::utils::base_dir(vm_image.image_path);
+    const auto cloud_init_iso = instance_dir.filePath("cloud-init-config.iso");
+
+    return {spec.num_cores,
+            spec.mem_size,
+            spec.disk_space,
+            name,
+            spec.default_mac_address,
+            spec.extra_interfaces,
+            spec.ssh_username,
+            vm_image,
+            cloud_init_iso,
+            {},
+            {},
+            {},
+            {}};
+}
+
 } // namespace
 
 mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
@@ -885,10 +1050,18 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
       vm_instance_specs{load_db(
           mp::utils::backend_directory_path(config->data_directory, config->factory->get_backend_directory_name()),
           mp::utils::backend_directory_path(config->cache_directory, config->factory->get_backend_directory_name()))},
+      warm_instance_specs{load_db(
+          mp::utils::backend_directory_path(config->data_directory, config->factory->get_backend_directory_name()),
+          mp::utils::backend_directory_path(config->cache_directory, config->factory->get_backend_directory_name()),
+          warm_pool_db_name)},
       daemon_rpc{config->server_address, *config->cert_provider, config->client_cert_store.get()},
       instance_mod_handler{register_instance_mod(vm_instance_specs, vm_instances, deleted_instances,
-                                                 preparing_instances, [this] { persist_instances(); })}
+                                                 preparing_instances, [this] { persist_instances(); })},
+      guest_sessions{*config->ssh_key_provider},
+      warm_pool{config->warm_pool_size, config->warm_pool_profile}
 {
+    exec_thread_pool.setMaxThreadCount(max_concurrent_execs);
+    watch_thread_pool.setMaxThreadCount(max_watchers);
     connect_rpc(daemon_rpc, *this);
     std::vector<std::string> invalid_specs;
 
@@ -934,24 +1107,8 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
             continue;
         }
 
-        const auto instance_dir = mp::utils::base_dir(vm_image.image_path);
-        const auto cloud_init_iso = instance_dir.filePath("cloud-init-config.iso");
-        mp::VirtualMachineDescription vm_desc{spec.num_cores,
-                                              spec.mem_size,
-                                              spec.disk_space,
-                                              name,
-                                              spec.default_mac_address,
-                                              spec.extra_interfaces,
-                                              spec.ssh_username,
-                                              vm_image,
-                                              cloud_init_iso,
-                                              {},
-                                              {},
-                                              {},
-                                              {}};
-
         auto& instance_record = spec.deleted ? deleted_instances : vm_instances;
-        instance_record[name] = config->factory->create_virtual_machine(vm_desc, *this);
+        instance_record[name] = config->factory->create_virtual_machine(description_from(name, spec, vm_image), *this);
 
         allocated_mac_addrs = std::move(new_macs); // Add the new macs to the daemon's list only if we got this far
 
@@ -988,9 +1145,49 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
         vm_instance_specs.erase(bad_spec);
     }
 
-    if (!invalid_specs.empty())
+    std::vector<std::string> unfinished_warm_instances;
+    for (const auto& [name, spec] : warm_instance_specs)
+    {
+        // Pool instances that were still being made when the daemon went away are not worth finishing
+        auto resting = spec.state == VirtualMachine::State::stopped || spec.state == VirtualMachine::State::suspended;
+        if (!resting || !config->vault->has_record_for(name))
+        {
+            unfinished_warm_instances.push_back(name);
+            continue;
+        }
+
+        auto new_macs = mac_set_from(spec);
+        auto vm_image = fetch_image_for(name, config->factory->fetch_type(), *config->vault);
+
+        if ((!vm_image.image_path.isEmpty() && !QFile::exists(vm_image.image_path)) ||
+            new_macs.size() <= spec.extra_interfaces.size() || !merge_if_disjoint(new_macs, allocated_mac_addrs))
+        {
+            unfinished_warm_instances.push_back(name);
+            continue;
+        }
+
+        warm_instances[name] = config->factory->create_virtual_machine(description_from(name, spec, vm_image), *this);
+        allocated_mac_addrs = std::move(new_macs);
+        warm_pool.add(name);
+    }
+
+    for (const auto& name : unfinished_warm_instances)
+    {
+        mpl::log(mpl::Level::info, category, fmt::format("Removing unfinished warm pool instance: {}", name));
+        config->factory->remove_resources_for(name);
+        config->vault->remove(name);
+        warm_instance_specs.erase(name);
+    }
+
+    if (!invalid_specs.empty() || !unfinished_warm_instances.empty())
         persist_instances();
 
+    // The pool is topped up once the daemon is up and running, so that it does not hold the start back
+    QTimer::singleShot(0, this, [this] { fill_warm_pool(); });
+
+    if (!config->metrics_address.empty())
+        serve_metrics();
+
     config->vault->prune_expired_images();
 
     // Fire timer every six hours to perform maintenance on source images such as
@@ -1039,6 +1236,9 @@ mp::Daemon::Daemon(std::unique_ptr<const DaemonConfig> the_config)
 
 mp::Daemon::~Daemon()
 {
+    instance_events.close_all();
+    MP_METRICS.remove_gauge_callback(instance_state_metric);
+
     for (const auto& pair : vm_instances)
     {
         for (const auto& mount_handler : config->mount_handlers)
@@ -1057,6 +1257,7 @@ try // clang-format on
 {
     mpl::ClientLogger<CreateReply, CreateRequest> logger{mpl::level_from(request->verbosity_level()), *config->logger,
                                                          server};
+    mpl::ScopedSpanContext span_scope{DaemonRpc::span_context_for(server)};
     return create_vm(request, server, status_promise, /*start=*/false);
 }
 catch (const std::exception& e)
@@ -1071,6 +1272,7 @@ try // clang-format on
 {
     mpl::ClientLogger<LaunchReply, LaunchRequest> logger{mpl::level_from(request->verbosity_level()), *config->logger,
                                                          server};
+    mpl::ScopedSpanContext span_scope{DaemonRpc::span_context_for(server)};
 
     return create_vm(request, server, status_promise, /*start=*/true);
 }
@@ -1099,6 +1301,7 @@ try // clang-format on
     {
         release_resources(del.first);
         response.add_purged_instances(del.first);
+        instance_events.publish(make_instance_event(del.first, InstanceEvent::PURGED, InstanceStatus::DELETED));
     }
 
     deleted_instances.clear();
@@ -1351,13 +1554,19 @@ try // clang-format on
                 mpu::run_in_ssh_session(session, "cat /etc/os-release | grep 'PRETTY_NAME' | cut -d \\\" -f2");
             info->set_current_release(!current_release.empty() ? current_release : original_release);
         }
+
+        if (request->streaming())
+        {
+            server->Write(response);
+            response.clear_info();
+        }
     }
 
     if (have_mounts && !MP_SETTINGS.get_as<bool>(mp::mounts_key))
         mpl::log(mpl::Level::error, category, "Mounts have been disabled on this instance of Multipass");
 
     auto status = grpc_status_for(errors);
-    if (status.ok())
+    if (status.ok() && !request->streaming())
         server->Write(response);
 
     status_promise->set_value(status);
@@ -1418,6 +1627,12 @@ try // clang-format on
                 if (extra_ipv4 != management_ip)
                     entry->add_ipv4(extra_ipv4);
         }
+
+        if (request->streaming())
+        {
+            server->Write(response);
+            response.Clear(); // the update info only goes with the first reply
+        }
     }
 
     for (const auto& instance : deleted_instances)
@@ -1473,8 +1688,11 @@ try // clang-format on
 {
     mpl::ClientLogger<MountReply, MountRequest> logger{mpl::level_from(request->verbosity_level()), *config->logger,
                                                        server};
+    mpl::ScopedSpanContext span_scope{DaemonRpc::span_context_for(server)};
     auto mount_type = request->mount_type() == mp::MountRequest_MountType_CLASSIC ? mp::VMMount::MountType::Classic
                                                                                   : mp::VMMount::MountType::Native;
+    auto profile = request->profile() == mp::MountRequest_Profile_THROUGHPUT ? mp::VMMount::Profile::Throughput
+                                                                              : mp::VMMount::Profile::Default;
 
     if (mount_type == mp::VMMount::MountType::Native &&
         (config->mount_handlers.find(mp::VMMount::MountType::Native) == config->mount_handlers.end()))
@@ -1555,7 +1773,7 @@ try // clang-format on
 
         auto& vm = it->second;
         auto& vm_specs = vm_instance_specs[name];
-        VMMount mount{request->source_path(), gid_mappings, uid_mappings, mount_type};
+        VMMount mount{request->source_path(), gid_mappings, uid_mappings, mount_type, profile};
 
         mount_handler->init_mount(vm.get(), target_path, mount);
 
@@ -1618,6 +1836,8 @@ try // clang-format on
                 vm_instance_specs[name].deleted = false;
                 vm_instances[name] = std::move(it->second);
                 deleted_instances.erase(it);
+                instance_events.publish(make_instance_event(
+                    name, InstanceEvent::RECOVERED, grpc_instance_status_for(vm_instance_specs[name].state)));
             }
             else
             {
@@ -1636,6 +1856,108 @@ catch (const std::exception& e)
     status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
 }
 
+void mp::Daemon::clone(const CloneRequest* request,
+                       grpc::ServerReaderWriterInterface<CloneReply, CloneRequest>* server,
+                       std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    mpl::ClientLogger<CloneReply, CloneRequest> logger{mpl::level_from(request->verbosity_level()), *config->logger,
+                                                       server};
+
+    const auto& source_name = request->source_name();
+    auto source = vm_instances.find(source_name);
+    if (source == vm_instances.end())
+    {
+        auto code = deleted_instances.count(source_name) ? grpc::StatusCode::FAILED_PRECONDITION
+                                                         : grpc::StatusCode::NOT_FOUND;
+        return status_promise->set_value(
+            grpc::Status(code, fmt::format("instance \"{}\" does not exist or is deleted", source_name), ""));
+    }
+
+    auto name_in_use = [this](const std::string& name) {
+        return vm_instances.count(name) || deleted_instances.count(name) || preparing_instances.count(name) ||
+               warm_instances.count(name);
+    };
+
+    auto name = request->destination_name();
+    if (name.empty())
+    {
+        auto i = 1;
+        do
+            name = fmt::format("{}-clone{}", source_name, i++);
+        while (name_in_use(name));
+    }
+
+    if (!mp::utils::valid_hostname(name))
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, fmt::format("invalid instance name \"{}\"", name), ""));
+
+    if (name_in_use(name))
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                      fmt::format("instance \"{}\" already exists", name), ""));
+
+    // Memory state is kept inside the instance image, out of reach of the overlays that clones are made of
+    const auto source_state = source->second->current_state();
+    if (source_state != VirtualMachine::State::off && source_state != VirtualMachine::State::stopped)
+        return status_promise->set_value(
+            grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                         fmt::format("instance \"{}\" must be stopped to be cloned", source_name), ""));
+
+    const auto source_image = fetch_image_for(source_name, config->factory->fetch_type(), *config->vault);
+    auto vm_image = config->vault->clone(source_name, name);
+
+    auto spec = vm_instance_specs[source_name];
+    auto new_macs = allocated_mac_addrs;
+    spec.default_mac_address = generate_unused_mac_address(new_macs);
+    for (auto& iface : spec.extra_interfaces)
+        iface.mac_address = generate_unused_mac_address(new_macs);
+    spec.state = VirtualMachine::State::off;
+    spec.deleted = false;
+    spec.metadata = QJsonObject();
+
+    try
+    {
+        CreateRequest create_request;
+        create_request.set_time_zone(request->time_zone());
+
+        // A new instance-id has cloud-init see the clone as a machine of its own, taking on its new name and MACs
+        auto vm_desc = description_from(name, spec, vm_image);
+        vm_desc.meta_data_config = make_cloud_init_meta_config(name);
+        vm_desc.vendor_data_config =
+            make_cloud_init_vendor_config(*config->ssh_key_provider, config->ssh_username,
+                                          config->factory->get_backend_version_string().toStdString(), &create_request);
+        vm_desc.user_data_config = YAML::Node{};
+        prepare_user_data(vm_desc.user_data_config, vm_desc.vendor_data_config);
+        vm_desc.network_data_config = make_clone_network_config(spec.default_mac_address, spec.extra_interfaces);
+
+        config->factory->configure(vm_desc);
+        config->factory->clone_instance_image(source_image, vm_image);
+
+        vm_instance_specs[name] = spec;
+        vm_instances[name] = config->factory->create_virtual_machine(vm_desc, *this);
+    }
+    catch (...)
+    {
+        vm_instance_specs.erase(name);
+        config->vault->remove(name);
+        throw;
+    }
+
+    allocated_mac_addrs = std::move(new_macs);
+    persist_instances();
+    instance_events.publish(make_instance_event(name, InstanceEvent::CREATED, InstanceStatus::STOPPED));
+
+    CloneReply reply;
+    reply.set_reply_message(fmt::format("Cloned \"{}\" as \"{}\"", source_name, name));
+    server->Write(reply);
+
+    status_promise->set_value(grpc::Status::OK);
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
 void mp::Daemon::ssh_info(const SSHInfoRequest* request,
                           grpc::ServerReaderWriterInterface<SSHInfoReply, SSHInfoRequest>* server,
                           std::promise<grpc::Status>* status_promise) // clang-format off
@@ -1686,6 +2008,18 @@ try // clang-format on
         ssh_info.set_port(vm->ssh_port());
         ssh_info.set_priv_key_base64(config->ssh_key_provider->private_key_as_base64());
         ssh_info.set_username(vm->ssh_username());
+
+        // Saves exec an info request just to map the working directory
+        if (request->with_mounts() && MP_SETTINGS.get_as<bool>(mp::mounts_key))
+        {
+            for (const auto& mount : vm_instance_specs[name].mounts)
+            {
+                auto entry = ssh_info.add_mount_paths();
+                entry->set_source_path(mount.second.source_path);
+                entry->set_target_path(mount.first);
+            }
+        }
+
         (*response.mutable_ssh_info())[name] = ssh_info;
     }
 
@@ -1697,6 +2031,85 @@ catch (const std::exception& e)
     status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
 }
 
+void mp::Daemon::exec(const ExecRequest* request, grpc::ServerReaderWriterInterface<ExecReply, ExecRequest>* server,
+                      grpc::ServerContext* context, std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    const auto& name = request->instance_name();
+
+    auto it = vm_instances.find(name);
+    if (it == vm_instances.end())
+    {
+        if (deleted_instances.find(name) == deleted_instances.end())
+            return status_promise->set_value(
+                grpc::Status{grpc::StatusCode::NOT_FOUND, fmt::format("instance \"{}\" does not exist", name)});
+        else
+            return status_promise->set_value(
+                grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, fmt::format("instance \"{}\" is deleted", name)});
+    }
+
+    if (request->command().empty())
+        return status_promise->set_value(grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, "no command given"});
+
+    auto vm = it->second;
+    if (!mp::utils::is_running(vm->current_state()))
+        return status_promise->set_value(
+            grpc::Status{grpc::StatusCode::ABORTED, fmt::format("instance \"{}\" is not running", name)});
+
+    std::vector<std::string> command{request->command().begin(), request->command().end()};
+    auto cmd_line = mpu::to_cmd(command, mpu::QuoteType::quote_every_arg);
+    if (!request->working_directory().empty())
+        cmd_line = mpu::to_cmd({"cd", request->working_directory()}, mpu::QuoteType::quote_every_arg) + "&&" + cmd_line;
+
+    // Cancelling the call is the only way to stop a read that waits on a client that never closes its side
+    auto cancel_input = [context] { context->TryCancel(); };
+
+    // The command is run on the worker thread, and the status is only given once it is done. The call's span goes
+    // along, so that connecting to the guest is traced as part of it.
+    auto run_command = [this, vm, cmd_line, request, server, cancel_input, status_promise,
+                        span_context = DaemonRpc::span_context_for(server)] {
+        mpl::ScopedSpanContext span_scope{span_context};
+        return async_exec(vm, cmd_line, request->input(), request->input_closed(), server, cancel_input,
+                          status_promise);
+    };
+
+    auto future_watcher = create_future_watcher();
+    future_watcher->setFuture(QtConcurrent::run(&exec_thread_pool, run_command));
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
+void mp::Daemon::watch(const WatchRequest* request, grpc::ServerReaderWriterInterface<WatchReply, WatchRequest>* server,
+                       std::promise<grpc::Status>* status_promise) // clang-format off
+try // clang-format on
+{
+    if (instance_events.num_subscriptions() >= max_watchers)
+        return status_promise->set_value(
+            grpc::Status{grpc::StatusCode::RESOURCE_EXHAUSTED, "too many clients are watching already"});
+
+    // Addresses are looked up ahead, since backends are not to be asked anything while events are held back
+    std::unordered_map<std::string, std::string> ips;
+    for (const auto& [name, vm] : vm_instances)
+        if (mp::utils::is_running(vm_instance_specs[name].state))
+            ips[name] = vm->management_ipv4();
+
+    auto subscription = instance_events.subscribe([this, &ips] { return instance_snapshot(ips); });
+
+    // Events are passed on from the worker thread, and the status is only given once the client is gone
+    auto pass_events = [this, subscription, server, status_promise] {
+        return async_watch(subscription, server, status_promise);
+    };
+
+    auto future_watcher = create_future_watcher();
+    future_watcher->setFuture(QtConcurrent::run(&watch_thread_pool, pass_events));
+}
+catch (const std::exception& e)
+{
+    status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
+}
+
 void mp::Daemon::start(const StartRequest* request, grpc::ServerReaderWriterInterface<StartReply, StartRequest>* server,
                        std::promise<grpc::Status>* status_promise) // clang-format off
 try // clang-format on
@@ -1798,14 +2211,13 @@ try // clang-format on
 
     if (status.ok())
     {
-        std::function<grpc::Status(VirtualMachine&)> operation;
         if (request->cancel_shutdown())
-            operation = std::bind(&Daemon::cancel_vm_shutdown, this, std::placeholders::_1);
+            status = cmd_vms(instances, std::bind(&Daemon::cancel_vm_shutdown, this, std::placeholders::_1));
+        else if (request->time_minutes() > 0)
+            status = cmd_vms(instances, std::bind(&Daemon::shutdown_vm, this, std::placeholders::_1,
+                                                  std::chrono::minutes(request->time_minutes())));
         else
-            operation = std::bind(&Daemon::shutdown_vm, this, std::placeholders::_1,
-                                  std::chrono::minutes(request->time_minutes()));
-
-        status = cmd_vms(instances, operation);
+            return shutdown_vms_now(instances, status_promise);
     }
 
     status_promise->set_value(status);
@@ -1849,16 +2261,18 @@ try // clang-format on
                 instances_to_suspend.push_back(pair.first);
         }
 
-        status = cmd_vms(instances_to_suspend, [this](auto& vm) {
-            for (const auto& mount_handler : config->mount_handlers)
-            {
-                mount_handler.second->stop_all_mounts_for_instance(vm.vm_name);
-            }
+        for (const auto& name : instances_to_suspend)
+            stop_mounts(name);
 
-            vm.suspend();
+        return act_on_vms(instances_to_suspend, [](auto& vm) { vm.request_suspend(); },
+                          [status_promise](const auto& failures) {
+                              fmt::memory_buffer failed;
+                              for (const auto& [name, error] : failures)
+                                  fmt::format_to(std::back_inserter(failed), "failed to suspend \"{}\": {}\n", name,
+                                                 error);
 
-            return grpc::Status::OK;
-        });
+                              status_promise->set_value(grpc_status_for(failed));
+                          });
     }
 
     status_promise->set_value(status);
@@ -1924,44 +2338,74 @@ try // clang-format on
         {
             assert(!vm_instance_specs[name].deleted);
 
-            auto& instance = vm_instances[name];
-
-            if (instance->current_state() == VirtualMachine::State::delayed_shutdown)
+            if (vm_instances[name]->current_state() == VirtualMachine::State::delayed_shutdown)
                 delayed_shutdown_instances.erase(name);
 
-            for (const auto& mount_handler : config->mount_handlers)
+            stop_mounts(name);
+        }
+
+        // Instances are only taken away once they are off, by which time other requests may have got to them first
+        auto finish_delete = [this, purge, server, status_promise, instances = operational_instances_to_delete,
+                              trashed_instances = trashed_instances_to_delete](const auto& failures) {
+            try
             {
-                mount_handler.second->stop_all_mounts_for_instance(name);
-            }
+                DeleteReply reply;
+                fmt::memory_buffer errors;
+                for (const auto& name : instances)
+                {
+                    if (auto it = failures.find(name); it != failures.end())
+                    {
+                        fmt::format_to(std::back_inserter(errors), "failed to delete \"{}\": {}\n", name, it->second);
+                        continue;
+                    }
 
-            instance->shutdown();
+                    auto instance_it = vm_instances.find(name);
+                    if (instance_it == vm_instances.end())
+                        continue;
 
-            if (purge)
-            {
-                release_resources(name);
-                response.add_purged_instances(name);
-            }
-            else
-            {
-                deleted_instances[name] = std::move(instance);
-                vm_instance_specs[name].deleted = true;
-            }
+                    if (purge)
+                    {
+                        release_resources(name);
+                        reply.add_purged_instances(name);
+                    }
+                    else
+                    {
+                        deleted_instances[name] = std::move(instance_it->second);
+                        vm_instance_specs[name].deleted = true;
+                    }
 
-            vm_instances.erase(name);
-        }
+                    vm_instances.erase(name);
+                    instance_events.publish(make_instance_event(
+                        name, purge ? InstanceEvent::PURGED : InstanceEvent::DELETED, InstanceStatus::DELETED));
+                }
 
-        if (purge)
-        {
-            for (const auto& name : trashed_instances_to_delete)
+                if (purge)
+                {
+                    for (const auto& name : trashed_instances)
+                    {
+                        if (deleted_instances.find(name) == deleted_instances.end())
+                            continue;
+
+                        assert(vm_instance_specs[name].deleted);
+                        release_resources(name);
+                        deleted_instances.erase(name);
+                        reply.add_purged_instances(name);
+                        instance_events.publish(
+                            make_instance_event(name, InstanceEvent::PURGED, InstanceStatus::DELETED));
+                    }
+                }
+
+                persist_instances();
+                server->Write(reply);
+                status_promise->set_value(grpc_status_for(errors));
+            }
+            catch (const std::exception& e)
             {
-                assert(vm_instance_specs[name].deleted);
-                release_resources(name);
-                deleted_instances.erase(name);
-                response.add_purged_instances(name);
+                status_promise->set_value(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, e.what(), ""));
             }
-        }
+        };
 
-        persist_instances();
+        return act_on_vms(operational_instances_to_delete, [](auto& vm) { vm.request_shutdown(); }, finish_delete);
     }
 
     server->Write(response);
@@ -2193,20 +2637,32 @@ void mp::Daemon::on_restart(const std::string& name)
 
 void mp::Daemon::persist_state_for(const std::string& name, const VirtualMachine::State& state)
 {
-    vm_instance_specs[name].state = state;
+    if (!mp::utils::is_running(state))
+        guest_sessions.drop(name);
+
+    auto& specs = specs_for(name);
+    const auto changed = specs.state != state;
+
+    specs.state = state;
     persist_instances();
+
+    // States are persisted again on every update, but watchers only care about the ones that differ. Pool instances
+    // are nobody's concern until they are claimed.
+    if (changed && warm_instance_specs.find(name) == warm_instance_specs.end())
+        instance_events.publish(
+            make_instance_event(name, InstanceEvent::STATE_CHANGED, grpc_instance_status_for(state)));
 }
 
 void mp::Daemon::update_metadata_for(const std::string& name, const QJsonObject& metadata)
 {
-    vm_instance_specs[name].metadata = metadata;
+    specs_for(name).metadata = metadata;
 
     persist_instances();
 }
 
 QJsonObject mp::Daemon::retrieve_metadata_for(const std::string& name)
 {
-    return vm_instance_specs[name].metadata;
+    return specs_for(name).metadata;
 }
 
 QJsonArray to_json_array(const std::vector<mp::NetworkInterface>& extra_interfaces)
@@ -2276,21 +2732,30 @@ void mp::Daemon::persist_instances()
             entry.insert("gid_mappings", gid_mappings);
 
             entry.insert("mount_type", static_cast<int>(mount.second.mount_type));
+            entry.insert("profile", static_cast<int>(mount.second.profile));
             mounts.append(entry);
         }
 
         json.insert("mounts", mounts);
         return json;
     };
-    QJsonObject instance_records_json;
-    for (const auto& record : vm_instance_specs)
-    {
-        auto key = QString::fromStdString(record.first);
-        instance_records_json.insert(key, vm_spec_to_json(record.second));
-    }
+    auto specs_to_json = [&vm_spec_to_json](const std::unordered_map<std::string, VMSpecs>& specs) {
+        QJsonObject records_json;
+        for (const auto& record : specs)
+        {
+            auto key = QString::fromStdString(record.first);
+            records_json.insert(key, vm_spec_to_json(record.second));
+        }
+        return records_json;
+    };
+
     QDir data_dir{
         mp::utils::backend_directory_path(config->data_directory, config->factory->get_backend_directory_name())};
-    mp::write_json(instance_records_json, data_dir.filePath(instance_db_name));
+    mp::write_json(specs_to_json(vm_instance_specs), data_dir.filePath(instance_db_name));
+
+    // Pool instances are kept in a database of their own, for older daemons not to take them for ordinary ones
+    if (warm_pool.size() || !warm_instance_specs.empty() || data_dir.exists(warm_pool_db_name))
+        mp::write_json(specs_to_json(warm_instance_specs), data_dir.filePath(warm_pool_db_name));
 }
 
 void mp::Daemon::release_resources(const std::string& instance)
@@ -2298,13 +2763,16 @@ void mp::Daemon::release_resources(const std::string& instance)
     config->factory->remove_resources_for(instance);
     config->vault->remove(instance);
 
-    auto spec_it = vm_instance_specs.find(instance);
-    if (spec_it != cend(vm_instance_specs))
+    for (auto* specs : {&vm_instance_specs, &warm_instance_specs})
     {
-        for (const auto& mac : mac_set_from(spec_it->second))
-            allocated_mac_addrs.erase(mac);
+        auto spec_it = specs->find(instance);
+        if (spec_it != specs->cend())
+        {
+            for (const auto& mac : mac_set_from(spec_it->second))
+                allocated_mac_addrs.erase(mac);
 
-        vm_instance_specs.erase(spec_it);
+            specs->erase(spec_it);
+        }
     }
 }
 
@@ -2334,8 +2802,6 @@ void mp::Daemon::create_vm(const CreateRequest* request,
                            grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
                            std::promise<grpc::Status>* status_promise, bool start)
 {
-    typedef typename std::pair<VirtualMachineDescription, ClientLaunchData> VMFullDescription;
-
     auto checked_args = validate_create_arguments(request, config.get());
 
     if (!checked_args.option_errors.error_codes().empty())
@@ -2358,12 +2824,20 @@ void mp::Daemon::create_vm(const CreateRequest* request,
             grpc::Status{grpc::StatusCode::FAILED_PRECONDITION, "Missing bridges", create_error.SerializeAsString()});
     }
 
+    if (request->count() > 1)
+        return create_vm_batch(request, std::move(checked_args), server, status_promise, start);
+
+    if (start && warm_pool.fits(*request))
+        if (auto warm_name = warm_pool.claim())
+            return launch_warm_instance(*warm_name, request, server, status_promise);
+
     // TODO: We should only need to query the Blueprint Provider once for all info, so this (and timeout below) will
     //       need a refactoring to do so.
     auto name = name_from(checked_args.instance_name, config->blueprint_provider->name_from_blueprint(request->image()),
                           *config->name_generator, vm_instances);
 
-    if (vm_instances.find(name) != vm_instances.end() || deleted_instances.find(name) != deleted_instances.end())
+    if (vm_instances.find(name) != vm_instances.end() || deleted_instances.find(name) != deleted_instances.end() ||
+        warm_instances.find(name) != warm_instances.end())
     {
         CreateError create_error;
         create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
@@ -2394,10 +2868,11 @@ void mp::Daemon::create_vm(const CreateRequest* request,
 
     auto prepare_future_watcher = new QFutureWatcher<VMFullDescription>();
     auto log_level = mpl::level_from(request->verbosity_level());
+    auto timings = std::make_shared<PhaseTimings>();
 
     QObject::connect(
         prepare_future_watcher, &QFutureWatcher<VMFullDescription>::finished,
-        [this, server, status_promise, name, timeout, start, prepare_future_watcher, log_level] {
+        [this, server, status_promise, name, timeout, start, prepare_future_watcher, log_level, timings] {
             mpl::ClientLogger<CreateReply, CreateRequest> logger{log_level, *config->logger, server};
 
             try
@@ -2420,6 +2895,7 @@ void mp::Daemon::create_vm(const CreateRequest* request,
                                            QJsonObject()};
                 vm_instances[name] = config->factory->create_virtual_machine(vm_desc, *this);
                 preparing_instances.erase(name);
+                instance_events.publish(make_instance_event(name, InstanceEvent::CREATED, InstanceStatus::STOPPED));
 
                 persist_instances();
 
@@ -2431,13 +2907,36 @@ void mp::Daemon::create_vm(const CreateRequest* request,
 
                     init_mounts(name);
 
+                    {
+                        // Waiting for the instance to come up happens elsewhere, where its timings are looked up
+                        std::lock_guard<decltype(start_mutex)> lock{start_mutex};
+                        launch_timings[name] = timings;
+                    }
+
+                    PhaseTimer start_timer{"start", timings.get()};
                     vm_instances[name]->start();
+                    start_timer.stop();
 
-                    auto future_watcher = create_future_watcher([this, server, name, vm_aliases, vm_workspaces] {
+                    auto future_watcher = create_future_watcher([this, server, name, vm_aliases, vm_workspaces,
+                                                                 timings] {
                         LaunchReply reply;
                         reply.set_vm_instance_name(name);
                         config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
 
+                        {
+                            std::lock_guard<decltype(start_mutex)> lock{start_mutex};
+                            launch_timings.erase(name);
+                        }
+
+                        for (const auto& [phase, duration] : timings->phases())
+                        {
+                            auto phase_timing = reply.add_phase_timings();
+                            phase_timing->set_phase(phase);
+                            phase_timing->set_milliseconds(duration.count());
+                        }
+                        mpl::log(mpl::Level::info, category,
+                                 fmt::format("Launched \"{}\": {}", name, timings->summary()));
+
                         // Attach the aliases to be created by the CLI to the last message.
                         for (const auto& blueprint_alias : vm_aliases)
                         {
@@ -2471,6 +2970,11 @@ void mp::Daemon::create_vm(const CreateRequest* request,
             }
             catch (const std::exception& e)
             {
+                {
+                    std::lock_guard<decltype(start_mutex)> lock{start_mutex};
+                    launch_timings.erase(name);
+                }
+
                 preparing_instances.erase(name);
                 release_resources(name);
                 vm_instances.erase(name);
@@ -2481,100 +2985,124 @@ void mp::Daemon::create_vm(const CreateRequest* request,
             delete prepare_future_watcher;
         });
 
-    auto make_vm_description = [this, server, request, name, checked_args, log_level]() mutable -> VMFullDescription {
+    auto make_vm_description = [this, server, request, name, checked_args, log_level,
+                                timings]() -> VMFullDescription {
         mpl::ClientLogger<CreateReply, CreateRequest> logger{log_level, *config->logger, server};
+        PhaseTimings::Scope timing_scope{timings.get()};
+        return prepare_vm_description(request, name, checked_args, server);
+    };
 
-        try
-        {
-            CreateReply reply;
-            reply.set_create_message("Creating " + name);
-            server->Write(reply);
-
-            Query query;
-            VirtualMachineDescription vm_desc{
-                request->num_cores(),
-                MemorySize{request->mem_size().empty() ? "0b" : request->mem_size()},
-                MemorySize{request->disk_space().empty() ? "0b" : request->disk_space()},
-                name,
-                "",
-                {},
-                config->ssh_username,
-                VMImage{},
-                "",
-                YAML::Node{},
-                YAML::Node{},
-                make_cloud_init_vendor_config(*config->ssh_key_provider, config->ssh_username,
-                                              config->factory->get_backend_version_string().toStdString(), request),
-                YAML::Node{}};
-
-            ClientLaunchData client_launch_data;
+    prepare_future_watcher->setFuture(QtConcurrent::run(make_vm_description));
+}
 
-            try
-            {
-                query = config->blueprint_provider->fetch_blueprint_for(request->image(), vm_desc, client_launch_data);
-                query.name = name;
+template <typename Arguments>
+mp::Daemon::VMFullDescription
+mp::Daemon::prepare_vm_description(const CreateRequest* request, const std::string& name, Arguments checked_args,
+                                   grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
+                                   const std::vector<std::string>* batch_macs)
+{
+    try
+    {
+        CreateReply reply;
+        reply.set_create_message("Creating " + name);
+        server->Write(reply);
 
-                // Aliases and default workspace are named in function of the instance name in the Blueprint. If the
-                // user asked for a different name, it will be necessary to change the alias definitions and the
-                // workspace name to reflect it.
-                if (name != request->image())
-                {
-                    for (auto& alias_to_define : client_launch_data.aliases_to_be_created)
-                        if (alias_to_define.second.instance == request->image())
-                        {
-                            mpl::log(mpl::Level::trace, category,
-                                     fmt::format("Renaming instance on alias \"{}\" from \"{}\" to \"{}\"",
-                                                 alias_to_define.first, alias_to_define.second.instance, name));
-                            alias_to_define.second.instance = name;
-                        }
+        Query query;
+        VirtualMachineDescription vm_desc{
+            request->num_cores(),
+            MemorySize{request->mem_size().empty() ? "0b" : request->mem_size()},
+            MemorySize{request->disk_space().empty() ? "0b" : request->disk_space()},
+            name,
+            "",
+            {},
+            config->ssh_username,
+            VMImage{},
+            "",
+            YAML::Node{},
+            YAML::Node{},
+            make_cloud_init_vendor_config(*config->ssh_key_provider, config->ssh_username,
+                                          config->factory->get_backend_version_string().toStdString(), request),
+            YAML::Node{}};
+
+        ClientLaunchData client_launch_data;
 
-                    for (auto& workspace_to_create : client_launch_data.workspaces_to_be_created)
-                        if (workspace_to_create == request->image())
-                        {
-                            mpl::log(mpl::Level::trace, category,
-                                     fmt::format("Renaming workspace \"{}\" to \"{}\"", workspace_to_create, name));
-                            workspace_to_create = name;
-                        }
-                }
-            }
-            catch (const std::out_of_range&)
+        try
+        {
+            query = config->blueprint_provider->fetch_blueprint_for(request->image(), vm_desc, client_launch_data);
+            query.name = name;
+
+            // Aliases and default workspace are named in function of the instance name in the Blueprint. If the
+            // user asked for a different name, it will be necessary to change the alias definitions and the
+            // workspace name to reflect it.
+            if (name != request->image())
             {
-                // Blueprint not found, move on
-                query = query_from(request, name);
-                vm_desc.mem_size = checked_args.mem_size;
+                for (auto& alias_to_define : client_launch_data.aliases_to_be_created)
+                    if (alias_to_define.second.instance == request->image())
+                    {
+                        mpl::log(mpl::Level::trace, category,
+                                 fmt::format("Renaming instance on alias \"{}\" from \"{}\" to \"{}\"",
+                                             alias_to_define.first, alias_to_define.second.instance, name));
+                        alias_to_define.second.instance = name;
+                    }
+
+                for (auto& workspace_to_create : client_launch_data.workspaces_to_be_created)
+                    if (workspace_to_create == request->image())
+                    {
+                        mpl::log(mpl::Level::trace, category,
+                                 fmt::format("Renaming workspace \"{}\" to \"{}\"", workspace_to_create, name));
+                        workspace_to_create = name;
+                    }
             }
+        }
+        catch (const std::out_of_range&)
+        {
+            // Blueprint not found, move on
+            query = query_from(request, name);
+            vm_desc.mem_size = checked_args.mem_size;
+        }
 
-            auto progress_monitor = [server](int progress_type, int percentage) {
-                CreateReply create_reply;
-                create_reply.mutable_launch_progress()->set_percent_complete(std::to_string(percentage));
-                create_reply.mutable_launch_progress()->set_type((CreateProgress::ProgressTypes)progress_type);
-                return server->Write(create_reply);
-            };
+        auto progress_monitor = [server](int progress_type, int percentage) {
+            CreateReply create_reply;
+            create_reply.mutable_launch_progress()->set_percent_complete(std::to_string(percentage));
+            create_reply.mutable_launch_progress()->set_type((CreateProgress::ProgressTypes)progress_type);
+            return server->Write(create_reply);
+        };
 
-            auto prepare_action = [this, server, &name](const VMImage& source_image) -> VMImage {
-                CreateReply reply;
-                reply.set_create_message("Preparing image for " + name);
-                server->Write(reply);
+        auto prepare_action = [this, server, &name](const VMImage& source_image) -> VMImage {
+            CreateReply reply;
+            reply.set_create_message("Preparing image for " + name);
+            server->Write(reply);
 
-                return config->factory->prepare_source_image(source_image);
-            };
+            return config->factory->prepare_source_image(source_image);
+        };
 
-            auto fetch_type = config->factory->fetch_type();
+        auto fetch_type = config->factory->fetch_type();
 
-            auto vm_image = config->vault->fetch_image(fetch_type, query, prepare_action, progress_monitor);
+        auto vm_image = config->vault->fetch_image(fetch_type, query, prepare_action, progress_monitor);
 
-            const auto image_size = config->vault->minimum_image_size_for(vm_image.id);
-            vm_desc.disk_space = compute_final_image_size(
-                image_size, vm_desc.disk_space.in_bytes() > 0 ? vm_desc.disk_space : checked_args.disk_space,
-                config->data_directory);
+        const auto image_size = config->vault->minimum_image_size_for(vm_image.id);
+        vm_desc.disk_space = compute_final_image_size(
+            image_size, vm_desc.disk_space.in_bytes() > 0 ? vm_desc.disk_space : checked_args.disk_space,
+            config->data_directory);
 
-            reply.set_create_message("Configuring " + name);
-            server->Write(reply);
+        reply.set_create_message("Configuring " + name);
+        server->Write(reply);
+
+        config->factory->prepare_networking(checked_args.extra_interfaces);
 
-            config->factory->prepare_networking(checked_args.extra_interfaces);
+        // This set stores the MAC's which need to be in the allocated_mac_addrs if everything goes well.
+        std::unordered_set<std::string> new_macs;
 
-            // This set stores the MAC's which need to be in the allocated_mac_addrs if everything goes well.
-            auto new_macs = allocated_mac_addrs;
+        if (batch_macs)
+        {
+            // Instances launched together had their MACs picked all at once, the default one first
+            vm_desc.default_mac_address = batch_macs->front();
+            for (size_t i = 0; i < checked_args.extra_interfaces.size(); ++i)
+                checked_args.extra_interfaces[i].mac_address = batch_macs->at(i + 1);
+        }
+        else
+        {
+            new_macs = allocated_mac_addrs;
 
             // check for repetition of requested macs
             for (auto& iface : checked_args.extra_interfaces)
@@ -2587,34 +3115,480 @@ void mp::Daemon::create_vm(const CreateRequest* request,
                     iface.mac_address = generate_unused_mac_address(new_macs);
 
             vm_desc.default_mac_address = generate_unused_mac_address(new_macs);
-            vm_desc.extra_interfaces = checked_args.extra_interfaces;
+        }
+
+        vm_desc.extra_interfaces = checked_args.extra_interfaces;
 
-            vm_desc.meta_data_config = make_cloud_init_meta_config(name);
-            vm_desc.user_data_config = YAML::Load(request->cloud_init_user_data());
-            prepare_user_data(vm_desc.user_data_config, vm_desc.vendor_data_config);
+        vm_desc.meta_data_config = make_cloud_init_meta_config(name);
+        vm_desc.user_data_config = YAML::Load(request->cloud_init_user_data());
+        prepare_user_data(vm_desc.user_data_config, vm_desc.vendor_data_config);
 
-            if (vm_desc.num_cores < std::stoi(mp::min_cpu_cores))
-                vm_desc.num_cores = std::stoi(mp::default_cpu_cores);
+        if (vm_desc.num_cores < std::stoi(mp::min_cpu_cores))
+            vm_desc.num_cores = std::stoi(mp::default_cpu_cores);
 
-            vm_desc.network_data_config =
-                make_cloud_init_network_config(vm_desc.default_mac_address, checked_args.extra_interfaces);
+        vm_desc.network_data_config =
+            make_cloud_init_network_config(vm_desc.default_mac_address, checked_args.extra_interfaces);
 
-            vm_desc.image = vm_image;
+        vm_desc.image = vm_image;
+        {
+            PhaseTimer timer{"cloud-init ISO"};
             config->factory->configure(vm_desc);
+        }
+        {
+            PhaseTimer timer{"resize image"};
             config->factory->prepare_instance_image(vm_image, vm_desc);
+        }
 
-            // Everything went well, add the MAC addresses used in this instance.
+        // Everything went well, add the MAC addresses used in this instance.
+        if (!batch_macs)
             allocated_mac_addrs = std::move(new_macs);
 
-            return VMFullDescription{vm_desc, client_launch_data};
+        return VMFullDescription{vm_desc, client_launch_data};
+    }
+    catch (const std::exception& e)
+    {
+        throw CreateImageException(e.what());
+    }
+}
+
+// What instances launched together share while they are started, a few at a time
+struct mp::Daemon::BatchLaunch
+{
+    std::vector<std::string> names;
+    size_t max_parallel;
+    std::chrono::seconds timeout;
+    std::unique_ptr<grpc::ServerReaderWriterInterface<LaunchReply, LaunchRequest>> server;
+    std::promise<grpc::Status>* status_promise;
+    fmt::memory_buffer errors;
+};
+
+template <typename Arguments>
+void mp::Daemon::create_vm_batch(const CreateRequest* request, Arguments checked_args,
+                                 grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
+                                 std::promise<grpc::Status>* status_promise, bool start)
+{
+    using BatchDescriptions = std::vector<std::pair<std::optional<VMFullDescription>, std::string>>;
+
+    if (!request->instance_name().empty())
+        return status_promise->set_value(grpc::Status{
+            grpc::StatusCode::INVALID_ARGUMENT, "a name cannot be given to more than one instance, give a prefix"});
+
+    // Blueprints name their instance, aliases and workspaces, which cannot be repeated
+    if (!config->blueprint_provider->name_from_blueprint(request->image()).empty())
+        return status_promise->set_value(
+            grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, "Blueprints can only be launched one at a time"});
+
+    if (std::any_of(checked_args.extra_interfaces.cbegin(), checked_args.extra_interfaces.cend(),
+                    [](const auto& iface) { return !iface.mac_address.empty(); }))
+        return status_promise->set_value(grpc::Status{grpc::StatusCode::INVALID_ARGUMENT,
+                                                      "a MAC address cannot be given to more than one instance"});
+
+    const auto prefix = request->name_prefix().empty() ? config->name_generator->make_name() : request->name_prefix();
+
+    std::vector<std::string> names;
+    for (auto i = 1; i <= request->count(); ++i)
+        names.push_back(fmt::format("{}-{}", prefix, i));
+
+    if (!mp::utils::valid_hostname(names.back()))
+    {
+        CreateError create_error;
+        create_error.add_error_codes(CreateError::INVALID_HOSTNAME);
+
+        return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid arguments supplied",
+                                                      create_error.SerializeAsString()));
+    }
+
+    for (const auto& name : names)
+    {
+        if (vm_instances.count(name) || deleted_instances.count(name) || preparing_instances.count(name))
+        {
+            CreateError create_error;
+            create_error.add_error_codes(CreateError::INSTANCE_EXISTS);
+
+            return status_promise->set_value(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                          fmt::format("instance \"{}\" already exists", name),
+                                                          create_error.SerializeAsString()));
+        }
+    }
+
+    if (!instances_running(vm_instances))
+        config->factory->hypervisor_health_check();
+
+    // MACs are picked for all instances in one pass here, so that the ones prepared side by side cannot repeat them
+    std::vector<std::vector<std::string>> macs(names.size());
+    for (auto& instance_macs : macs)
+        for (size_t i = 0; i <= checked_args.extra_interfaces.size(); ++i)
+            instance_macs.push_back(generate_unused_mac_address(allocated_mac_addrs));
+
+    preparing_instances.insert(names.cbegin(), names.cend());
+
+    const auto max_parallel = request->max_parallel() > 0 ? static_cast<size_t>(request->max_parallel()) : names.size();
+    const auto timeout = timeout_for(request->timeout(), 0);
+    const auto log_level = mpl::level_from(request->verbosity_level());
+
+    auto prepare_future_watcher = new QFutureWatcher<BatchDescriptions>();
+
+    QObject::connect(
+        prepare_future_watcher, &QFutureWatcher<BatchDescriptions>::finished,
+        [this, server, status_promise, names, macs, max_parallel, timeout, start, prepare_future_watcher, log_level] {
+            auto batch = std::make_shared<BatchLaunch>();
+            batch->max_parallel = max_parallel;
+            batch->timeout = timeout;
+            batch->server = std::make_unique<SerializedServer<LaunchReply, LaunchRequest>>(server);
+            batch->status_promise = status_promise;
+
+            mpl::ClientLogger<CreateReply, CreateRequest> logger{log_level, *config->logger, batch->server.get()};
+
+            auto descriptions = prepare_future_watcher->future().result();
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                const auto& name = names[i];
+                auto& [vm_full_description, error] = descriptions[i];
+                preparing_instances.erase(name);
+
+                try
+                {
+                    if (!vm_full_description)
+                        throw std::runtime_error(error);
+
+                    const auto& vm_desc = vm_full_description->first;
+                    vm_instance_specs[name] = {vm_desc.num_cores,
+                                               vm_desc.mem_size,
+                                               vm_desc.disk_space,
+                                               vm_desc.default_mac_address,
+                                               vm_desc.extra_interfaces,
+                                               config->ssh_username,
+                                               VirtualMachine::State::off,
+                                               {},
+                                               false,
+                                               QJsonObject()};
+                    vm_instances[name] = config->factory->create_virtual_machine(vm_desc, *this);
+                    instance_events.publish(
+                        make_instance_event(name, InstanceEvent::CREATED, InstanceStatus::STOPPED));
+
+                    batch->names.push_back(name);
+                }
+                catch (const std::exception& e)
+                {
+                    release_resources(name);
+                    vm_instances.erase(name);
+                    for (const auto& mac : macs[i])
+                        allocated_mac_addrs.erase(mac);
+
+                    // Instances that were not even tried, after the first one failed, do not repeat its error
+                    if (!std::string{e.what()}.empty())
+                        fmt::format_to(std::back_inserter(batch->errors), "{}: {}\n", name, e.what());
+                }
+            }
+
+            // The whole batch is written down at once, rather than once per instance
+            persist_instances();
+
+            if (start && !batch->names.empty())
+            {
+                start_vm_batch(batch, 0);
+            }
+            else
+            {
+                LaunchReply reply;
+                for (const auto& name : batch->names)
+                    reply.add_vm_instance_names(name);
+                batch->server->Write(reply);
+
+                status_promise->set_value(grpc_status_for(batch->errors));
+            }
+
+            delete prepare_future_watcher;
+        });
+
+    auto prepare_all = [this, server, request, names, macs, max_parallel, checked_args, log_level] {
+        SerializedServer<CreateReply, CreateRequest> serialized_server{server};
+        mpl::ClientLogger<CreateReply, CreateRequest> logger{log_level, *config->logger, &serialized_server};
+
+        BatchDescriptions descriptions(names.size());
+        auto prepare = [&](size_t i) {
+            try
+            {
+                descriptions[i].first =
+                    prepare_vm_description(request, names[i], checked_args, &serialized_server, &macs[i]);
+            }
+            catch (const std::exception& e)
+            {
+                descriptions[i].second = e.what();
+            }
+        };
+
+        // The first instance resolves and fetches the image on its own, so that the others find it in the vault
+        prepare(0);
+        if (!descriptions[0].first)
+            return descriptions;
+
+        // Copying and resizing disks is what is left, and that goes side by side
+        QThreadPool pool;
+        pool.setMaxThreadCount(max_parallel);
+
+        QFutureSynchronizer<void> prepare_synchronizer;
+        for (size_t i = 1; i < names.size(); ++i)
+            prepare_synchronizer.addFuture(QtConcurrent::run(&pool, [&prepare, i] { prepare(i); }));
+
+        prepare_synchronizer.waitForFinished();
+
+        return descriptions;
+    };
+
+    prepare_future_watcher->setFuture(QtConcurrent::run(prepare_all));
+}
+
+void mp::Daemon::start_vm_batch(std::shared_ptr<BatchLaunch> batch, size_t first)
+{
+    const auto last = std::min(batch->names.size(), first + batch->max_parallel);
+    const auto done = last == batch->names.size();
+
+    std::vector<std::string> wave;
+    for (auto i = first; i < last; ++i)
+    {
+        const auto& name = batch->names[i];
+        try
+        {
+            LaunchReply reply;
+            reply.set_create_message("Starting " + name);
+            batch->server->Write(reply);
+
+            init_mounts(name);
+            vm_instances[name]->start();
+
+            wave.push_back(name);
         }
         catch (const std::exception& e)
         {
-            throw CreateImageException(e.what());
+            fmt::format_to(std::back_inserter(batch->errors), "{}: {}\n", name, e.what());
         }
+    }
+
+    // Each wave of instances is only started once the one before is up, so that the host is not swamped
+    auto future_watcher = create_future_watcher([this, batch, last, done] {
+        if (!done)
+            return start_vm_batch(batch, last);
+
+        LaunchReply reply;
+        for (const auto& name : batch->names)
+            reply.add_vm_instance_names(name);
+        config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
+
+        batch->server->Write(reply);
+    });
+
+    auto wait_for_wave = [this, batch, wave, done]() -> AsyncOperationStatus {
+        fmt::format_to(std::back_inserter(batch->errors), "{}",
+                       wait_for_ready<LaunchReply, LaunchRequest>(batch->server.get(), wave, batch->timeout));
+
+        if (!done)
+            return {grpc::Status::OK, nullptr};
+
+        return {grpc_status_for(batch->errors), batch->status_promise};
     };
 
-    prepare_future_watcher->setFuture(QtConcurrent::run(make_vm_description));
+    future_watcher->setFuture(QtConcurrent::run(wait_for_wave));
+}
+
+void mp::Daemon::launch_warm_instance(const std::string& name, const CreateRequest* request,
+                                      grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
+                                      std::promise<grpc::Status>* status_promise)
+{
+    mpl::log(mpl::Level::info, category, fmt::format("Launching {} from the warm pool", name));
+
+    vm_instances.insert(warm_instances.extract(name));
+    vm_instance_specs.insert(warm_instance_specs.extract(name));
+    persist_instances();
+    instance_events.publish(make_instance_event(name, InstanceEvent::CREATED,
+                                                grpc_instance_status_for(vm_instance_specs[name].state)));
+
+    // The one claimed is replaced meanwhile, so that the next launch finds the pool full again
+    fill_warm_pool();
+
+    LaunchReply reply;
+    reply.set_create_message("Starting " + name);
+    server->Write(reply);
+
+    vm_instances[name]->start();
+
+    auto future_watcher = create_future_watcher([this, server, name] {
+        LaunchReply reply;
+        reply.set_vm_instance_name(name);
+        config->update_prompt->populate_if_time_to_show(reply.mutable_update_info());
+        server->Write(reply);
+    });
+    future_watcher->setFuture(QtConcurrent::run(this, &Daemon::async_wait_for_ready_all<LaunchReply, LaunchRequest>,
+                                                server, std::vector<std::string>{name},
+                                                timeout_for(request->timeout(), 0), status_promise, std::string()));
+}
+
+void mp::Daemon::fill_warm_pool()
+{
+    // Pool instances are made one at a time, so that keeping the pool full gets in the way of clients the least
+    if (!warm_instance_in_the_making.empty() || warm_pool.num_ready() >= warm_pool.size())
+        return;
+
+    const auto& profile = warm_pool.profile();
+
+    try
+    {
+        if (!config->blueprint_provider->name_from_blueprint(profile.image()).empty())
+            throw std::runtime_error(fmt::format("\"{}\" is a blueprint, which is not supported", profile.image()));
+
+        auto checked_args = validate_create_arguments(&profile, config.get());
+        if (!checked_args.option_errors.error_codes().empty())
+            throw std::runtime_error("invalid instance profile");
+
+        std::unordered_set<std::string> used_names{preparing_instances};
+        for (const auto* instances : {&vm_instances, &deleted_instances, &warm_instances})
+            for (const auto& instance : *instances)
+                used_names.insert(instance.first);
+
+        auto name = name_from("", "", *config->name_generator, used_names);
+        warm_instance_in_the_making = name;
+        preparing_instances.insert(name);
+
+        auto prepare_future_watcher = new QFutureWatcher<VMFullDescription>();
+
+        QObject::connect(
+            prepare_future_watcher, &QFutureWatcher<VMFullDescription>::finished,
+            [this, name, prepare_future_watcher] {
+                preparing_instances.erase(name);
+
+                try
+                {
+                    const auto vm_desc = prepare_future_watcher->future().result().first;
+
+                    warm_instance_specs[name] = {vm_desc.num_cores,
+                                                 vm_desc.mem_size,
+                                                 vm_desc.disk_space,
+                                                 vm_desc.default_mac_address,
+                                                 vm_desc.extra_interfaces,
+                                                 config->ssh_username,
+                                                 VirtualMachine::State::off,
+                                                 {},
+                                                 false,
+                                                 QJsonObject()};
+                    VirtualMachine::ShPtr vm = config->factory->create_virtual_machine(vm_desc, *this);
+                    warm_instances[name] = vm;
+                    persist_instances();
+
+                    vm->start();
+
+                    // First boot is seen through here, so that the one who claims the instance need not wait for it
+                    auto boot_future_watcher = new QFutureWatcher<std::string>();
+                    QObject::connect(boot_future_watcher, &QFutureWatcher<std::string>::finished,
+                                     [this, name, boot_future_watcher] {
+                                         finish_warm_instance(name, boot_future_watcher->future().result());
+                                         delete boot_future_watcher;
+                                     });
+                    boot_future_watcher->setFuture(QtConcurrent::run([this, vm]() -> std::string {
+                        try
+                        {
+                            vm->wait_until_ssh_up(mp::default_timeout);
+                            MP_UTILS.wait_for_cloud_init(vm.get(), mp::default_timeout, *config->ssh_key_provider);
+                            return {};
+                        }
+                        catch (const std::exception& e)
+                        {
+                            return e.what();
+                        }
+                    }));
+                }
+                catch (const std::exception& e)
+                {
+                    finish_warm_instance(name, e.what());
+                }
+
+                delete prepare_future_watcher;
+            });
+
+        prepare_future_watcher->setFuture(QtConcurrent::run([this, name, checked_args]() -> VMFullDescription {
+            static DiscardingServer<CreateReply, CreateRequest> no_client;
+            return prepare_vm_description(&warm_pool.profile(), name, checked_args, &no_client);
+        }));
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot fill the warm pool: {}", e.what()));
+    }
+}
+
+void mp::Daemon::finish_warm_instance(const std::string& name, const std::string& error)
+{
+    warm_instance_in_the_making.clear();
+
+    // A pool that cannot be filled is not tried again until an instance is claimed, lest it keep failing over
+    if (!error.empty())
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Cannot make {} for the warm pool: {}", name, error));
+        return discard_warm_instance(name);
+    }
+
+    auto& vm = *warm_instances.at(name);
+
+    try
+    {
+        vm.suspend(); // the quickest to wake up from
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::debug, category, fmt::format("Stopping {} rather than suspending it: {}", name, e.what()));
+        vm.shutdown();
+    }
+
+    warm_pool.add(name);
+    mpl::log(mpl::Level::info, category, fmt::format("{} is ready in the warm pool", name));
+
+    fill_warm_pool();
+}
+
+void mp::Daemon::discard_warm_instance(const std::string& name)
+{
+    if (auto it = warm_instances.find(name); it != warm_instances.end())
+        mp::top_catch_all(name, [&vm = *it->second] { vm.shutdown(); });
+
+    release_resources(name);
+    warm_instances.erase(name);
+    warm_pool.remove(name);
+    persist_instances();
+}
+
+mp::VMSpecs& mp::Daemon::specs_for(const std::string& name)
+{
+    auto it = warm_instance_specs.find(name);
+    return it != warm_instance_specs.end() ? it->second : vm_instance_specs[name];
+}
+
+void mp::Daemon::serve_metrics()
+{
+    try
+    {
+        metrics_server = std::make_unique<MetricsServer>(QString::fromStdString(config->metrics_address));
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::error, category, fmt::format("Not serving metrics: {}", e.what()));
+        return;
+    }
+
+    // Scrapes are answered on this thread, where instances are looked after, so they can be looked at then. Each
+    // instance gets a series labelled with its state, the way Prometheus does state sets.
+    MP_METRICS.set_gauge_callback(instance_state_metric, "The state each instance is in", [this] {
+        auto state_label = [](InstanceStatus::Status status) {
+            return QString::fromStdString(InstanceStatus::Status_Name(status)).toLower().toStdString();
+        };
+
+        std::vector<std::pair<mp::metrics::Labels, double>> states;
+        for (const auto& [name, vm] : vm_instances)
+            states.push_back(
+                {{{"instance", name}, {"state", state_label(grpc_instance_status_for(vm->current_state()))}}, 1});
+        for (const auto& [name, vm] : deleted_instances)
+            states.push_back({{{"instance", name}, {"state", state_label(InstanceStatus::DELETED)}}, 1});
+
+        return states;
+    });
 }
 
 grpc::Status mp::Daemon::reboot_vm(VirtualMachine& vm)
@@ -2635,33 +3609,13 @@ grpc::Status mp::Daemon::shutdown_vm(VirtualMachine& vm, const std::chrono::mill
     const auto& name = vm.vm_name;
     const auto& state = vm.current_state();
 
-    using St = VirtualMachine::State;
-    const auto skip_states = {St::off, St::stopped, St::suspended};
-
-    if (std::none_of(cbegin(skip_states), cend(skip_states), [&state](const auto& st) { return state == st; }))
+    if (needs_shutdown(state))
     {
         delayed_shutdown_instances.erase(name);
 
-        std::optional<mp::SSHSession> session;
-        try
-        {
-            session = mp::SSHSession{vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), *config->ssh_key_provider};
-        }
-        catch (const std::exception& e)
-        {
-            mpl::log(mpl::Level::info, category,
-                     fmt::format("Cannot open ssh session on \"{}\" shutdown: {}", name, e.what()));
-        }
-
-        auto stop_all_mounts = [this](const std::string& name) {
-            for (const auto& mount_handler : config->mount_handlers)
-            {
-                mount_handler.second->stop_all_mounts_for_instance(name);
-            }
-        };
-
-        auto& shutdown_timer = delayed_shutdown_instances[name] =
-            std::make_unique<DelayedShutdownTimer>(&vm, std::move(session), stop_all_mounts);
+        auto stop_all_mounts = [this](const std::string& name) { stop_mounts(name); };
+        auto& shutdown_timer = delayed_shutdown_instances[name] = std::make_unique<DelayedShutdownTimer>(
+            &vm, shutdown_session_for(vm, *config->ssh_key_provider), stop_all_mounts);
 
         QObject::connect(shutdown_timer.get(), &DelayedShutdownTimer::finished,
                          [this, name]() { delayed_shutdown_instances.erase(name); });
@@ -2674,6 +3628,38 @@ grpc::Status mp::Daemon::shutdown_vm(VirtualMachine& vm, const std::chrono::mill
     return grpc::Status::OK;
 }
 
+void mp::Daemon::shutdown_vms_now(const std::vector<std::string>& names, std::promise<grpc::Status>* status_promise)
+{
+    std::vector<std::string> to_shut_down;
+    for (const auto& name : names)
+    {
+        if (!needs_shutdown(vm_instances.at(name)->current_state()))
+        {
+            mpl::log(mpl::Level::debug, category, fmt::format("instance \"{}\" does not need stopping", name));
+            continue;
+        }
+
+        delayed_shutdown_instances.erase(name);
+        stop_mounts(name);
+        to_shut_down.push_back(name);
+    }
+
+    act_on_vms(
+        to_shut_down,
+        [this](VirtualMachine& vm) {
+            DelayedShutdownTimer shutdown{&vm, shutdown_session_for(vm, *config->ssh_key_provider),
+                                          [](const std::string&) {}}; // mounts were stopped above
+            shutdown.start(std::chrono::milliseconds::zero());
+        },
+        [status_promise](const auto& failures) {
+            fmt::memory_buffer errors;
+            for (const auto& [name, error] : failures)
+                fmt::format_to(std::back_inserter(errors), "failed to stop \"{}\": {}\n", name, error);
+
+            status_promise->set_value(grpc_status_for(errors));
+        });
+}
+
 grpc::Status mp::Daemon::cancel_vm_shutdown(const VirtualMachine& vm)
 {
     auto it = delayed_shutdown_instances.find(vm.vm_name);
@@ -2700,6 +3686,66 @@ grpc::Status mp::Daemon::cmd_vms(const std::vector<std::string>& tgts, std::func
     return grpc::Status::OK;
 }
 
+void mp::Daemon::act_on_vms(const std::vector<std::string>& names, const std::function<void(VirtualMachine&)>& action,
+                            const std::function<void(const std::map<std::string, std::string>&)>& when_settled)
+{
+    // Backends own processes that belong to this thread, so they are only asked to act here. Guests then take their
+    // time side by side, while the event loop goes on and checks on them every so often.
+    std::map<std::string, std::string> failures;
+    std::vector<VirtualMachine::ShPtr> unsettled;
+    for (const auto& name : names)
+    {
+        auto vm = vm_instances.at(name);
+        try
+        {
+            action(*vm);
+            unsettled.push_back(std::move(vm));
+        }
+        catch (const std::exception& e)
+        {
+            failures.emplace(name, e.what());
+        }
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + lifecycle_settle_timeout;
+    auto settle = [unsettled = std::move(unsettled), failures = std::move(failures), when_settled, deadline]() mutable {
+        unsettled.erase(std::remove_if(unsettled.begin(), unsettled.end(),
+                                       [](const auto& vm) { return !is_settling(vm->current_state()); }),
+                        unsettled.end());
+
+        if (!unsettled.empty() && std::chrono::steady_clock::now() < deadline)
+            return false;
+
+        for (const auto& vm : unsettled)
+            mpl::log(mpl::Level::warning, category,
+                     fmt::format("instance \"{}\" is taking long to settle, no longer waiting for it", vm->vm_name));
+
+        when_settled(failures);
+        return true;
+    };
+
+    if (settle())
+        return;
+
+    auto poll_timer = new QTimer; // lives on this thread, like the processes it checks on
+    QObject::connect(poll_timer, &QTimer::timeout, [poll_timer, settle]() mutable {
+        if (settle())
+        {
+            poll_timer->stop();
+            poll_timer->deleteLater();
+        }
+    });
+    poll_timer->start(lifecycle_poll_interval);
+}
+
+void mp::Daemon::stop_mounts(const std::string& name)
+{
+    for (const auto& mount_handler : config->mount_handlers)
+    {
+        mount_handler.second->stop_all_mounts_for_instance(name);
+    }
+}
+
 void mp::Daemon::init_mounts(const std::string& name)
 {
     for (const auto& mount_entry : vm_instance_specs[name].mounts)
@@ -2734,10 +3780,22 @@ mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::string& name, con
     fmt::memory_buffer errors;
     try
     {
+        std::shared_ptr<PhaseTimings> timings;
+        {
+            std::lock_guard<decltype(start_mutex)> lock{start_mutex};
+            if (auto it = launch_timings.find(name); it != launch_timings.end())
+                timings = it->second;
+        }
+        PhaseTimings::Scope timing_scope{timings.get()};
+
         auto it = vm_instances.find(name);
         auto vm = it->second;
         vm->wait_until_ssh_up(timeout);
 
+        instance_events.publish(make_instance_event(name, InstanceEvent::IP_ASSIGNED,
+                                                    grpc_instance_status_for(vm->current_state()),
+                                                    vm->management_ipv4()));
+
         if (std::is_same<Reply, LaunchReply>::value)
         {
             if (server)
@@ -2747,6 +3805,7 @@ mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::string& name, con
                 server->Write(reply);
             }
 
+            PhaseTimer timer{"cloud-init"};
             MP_UTILS.wait_for_cloud_init(vm.get(), timeout, *config->ssh_key_provider);
         }
 
@@ -2755,31 +3814,50 @@ mp::Daemon::async_wait_for_ssh_and_start_mounts_for(const std::string& name, con
             std::vector<std::string> invalid_mounts;
             fmt::memory_buffer warnings;
             auto& mounts = vm_instance_specs[name].mounts;
+            PhaseTimer mounts_timer{"mounts", mounts.empty() ? nullptr : PhaseTimings::current()};
+
+            // Each handler is given all of its mounts at once, so that it can bring them up side by side
+            std::unordered_map<mp::VMMount::MountType, std::vector<std::string>> targets_by_type;
             for (const auto& mount_entry : mounts)
+                targets_by_type[mount_entry.second.mount_type].push_back(mount_entry.first);
+
+            bool sshfs_missing{false};
+            for (const auto& [mount_type, target_paths] : targets_by_type)
             {
-                auto& target_path = mount_entry.first;
+                const auto mount_errors =
+                    config->mount_handlers.at(mount_type)->start_mounts(vm.get(), server, target_paths);
 
-                try
-                {
-                    config->mount_handlers.at(mount_entry.second.mount_type)
-                        ->start_mount(vm.get(), server, target_path);
-                }
-                catch (const mp::SSHFSMissingError&)
-                {
-                    fmt::format_to(std::back_inserter(errors), sshfs_error_template + "\n", name);
-                    break;
-                }
-                catch (const std::exception& e)
+                for (const auto& target_path : target_paths)
                 {
-                    // TODO: Combine these into one warning level log once they are displayed in the cli by
-                    // default
-                    mpl::log(mpl::Level::info, category, fmt::format("Removing \"{}\": {}\n", target_path, e.what()));
-                    fmt::format_to(std::back_inserter(warnings),
-                                   fmt::format("Removing mount \"{}\" from {}: {}\n", target_path, name, e.what()));
-                    invalid_mounts.push_back(target_path);
+                    auto mount_error = mount_errors.find(target_path);
+                    if (mount_error == mount_errors.end())
+                        continue;
+
+                    try
+                    {
+                        std::rethrow_exception(mount_error->second);
+                    }
+                    catch (const mp::SSHFSMissingError&)
+                    {
+                        sshfs_missing = true;
+                    }
+                    catch (const std::exception& e)
+                    {
+                        // TODO: Combine these into one warning level log once they are displayed in the cli by
+                        // default
+                        mpl::log(mpl::Level::info, category,
+                                 fmt::format("Removing \"{}\": {}\n", target_path, e.what()));
+                        fmt::format_to(std::back_inserter(warnings),
+                                       fmt::format("Removing mount \"{}\" from {}: {}\n", target_path, name,
+                                                   e.what()));
+                        invalid_mounts.push_back(target_path);
+                    }
                 }
             }
 
+            if (sshfs_missing)
+                fmt::format_to(std::back_inserter(errors), sshfs_error_template + "\n", name);
+
             for (const auto& mount : invalid_mounts)
                 vm_instance_specs[name].mounts.erase(mount);
 
@@ -2808,7 +3886,27 @@ mp::Daemon::async_wait_for_ready_all(grpc::ServerReaderWriterInterface<Reply, Re
                                      std::promise<grpc::Status>* status_promise, const std::string& start_errors)
 {
     fmt::memory_buffer errors;
-    fmt::format_to(std::back_inserter(errors), "{}", start_errors);
+    fmt::format_to(std::back_inserter(errors), "{}{}", start_errors,
+                   wait_for_ready<Reply, Request>(server, vms, timeout));
+
+    if (server && std::is_same<Reply, StartReply>::value)
+    {
+        if (config->update_prompt->is_time_to_show())
+        {
+            Reply reply;
+            config->update_prompt->populate(reply.mutable_update_info());
+            server->Write(reply);
+        }
+    }
+
+    return {grpc_status_for(errors), status_promise};
+}
+
+template <typename Reply, typename Request>
+std::string mp::Daemon::wait_for_ready(grpc::ServerReaderWriterInterface<Reply, Request>* server,
+                                       const std::vector<std::string>& vms, const std::chrono::seconds& timeout)
+{
+    fmt::memory_buffer errors;
 
     QFutureSynchronizer<std::string> start_synchronizer;
     {
@@ -2848,17 +3946,160 @@ mp::Daemon::async_wait_for_ready_all(grpc::ServerReaderWriterInterface<Reply, Re
         }
     }
 
-    if (server && std::is_same<Reply, StartReply>::value)
+    return fmt::to_string(errors);
+}
+
+mp::Daemon::AsyncOperationStatus
+mp::Daemon::async_exec(VirtualMachine::ShPtr vm, const std::string& cmd_line, const std::string& input,
+                       bool input_closed, grpc::ServerReaderWriterInterface<ExecReply, ExecRequest>* server,
+                       const std::function<void()>& cancel_input, std::promise<grpc::Status>* status_promise)
+{
+    try
     {
-        if (config->update_prompt->is_time_to_show())
+        auto session = guest_sessions.acquire(*vm);
+        std::shared_ptr<mp::SSHStreamedProcess> process;
+        try
         {
-            Reply reply;
-            config->update_prompt->populate(reply.mutable_update_info());
-            server->Write(reply);
+            process = std::make_shared<mp::SSHStreamedProcess>(*session, cmd_line);
+        }
+        catch (const mp::SSHException&)
+        {
+            // The pooled session may have gone stale without libssh noticing, so give a new one a go
+            session = guest_sessions.acquire(*vm, /*fresh=*/true);
+            process = std::make_shared<mp::SSHStreamedProcess>(*session, cmd_line);
+        }
+
+        process->write_input(input);
+        if (input_closed)
+            process->close_input();
+
+        // Input is read on a thread of its own, so that a client that is slow to send any does not hold back output
+        std::thread input_reader;
+        std::promise<void> input_done;
+        auto input_done_future = input_done.get_future();
+        if (!input_closed)
+        {
+            input_reader = std::thread{[process, server, input_done = std::move(input_done)]() mutable {
+                ExecRequest request;
+                while (server->Read(&request))
+                {
+                    process->write_input(request.input());
+                    if (request.input_closed())
+                        break;
+                }
+
+                process->close_input();
+                input_done.set_value();
+            }};
+        }
+
+        auto send_output = [server](const std::string& output, bool is_stderr) {
+            ExecReply reply;
+            if (is_stderr)
+                reply.set_error_output(output);
+            else
+                reply.set_output(output);
+
+            return server->Write(reply);
+        };
+
+        std::optional<int> exit_status;
+        std::string error;
+        try
+        {
+            exit_status = process->run(send_output);
+            if (!exit_status)
+                error = "the client stopped taking output";
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+
+        // The last reply goes out before waiting on the reader, so that the client knows to close its side
+        ExecReply last_reply;
+        if (exit_status)
+        {
+            last_reply.set_exited(true);
+            last_reply.set_exit_status(*exit_status);
+        }
+        else
+        {
+            last_reply.set_log_line(error);
+        }
+        server->Write(last_reply);
+
+        if (input_reader.joinable())
+        {
+            // A client that keeps its side open past the end of the command would otherwise hold the reader forever
+            if (input_done_future.wait_for(exec_input_close_timeout) != std::future_status::ready)
+                cancel_input();
+            input_reader.join();
         }
+
+        if (!exit_status)
+            return {grpc::Status{grpc::StatusCode::FAILED_PRECONDITION, error}, status_promise};
+
+        process.reset();
+        guest_sessions.release(vm->vm_name, std::move(session));
+
+        return {grpc::Status::OK, status_promise};
+    }
+    catch (const std::exception& e)
+    {
+        return {grpc::Status{grpc::StatusCode::FAILED_PRECONDITION, e.what()}, status_promise};
     }
+}
 
-    return {grpc_status_for(errors), status_promise};
+mp::Daemon::AsyncOperationStatus
+mp::Daemon::async_watch(InstanceEventHub::SubscriptionPtr subscription,
+                        grpc::ServerReaderWriterInterface<WatchReply, WatchRequest>* server,
+                        std::promise<grpc::Status>* status_promise)
+{
+    WatchReply reply;
+    for (const auto& event : subscription->snapshot())
+        *reply.add_events() = event;
+
+    auto client_listening = server->Write(reply);
+    while (client_listening)
+    {
+        auto events = subscription->wait_for(watch_heartbeat);
+        if (!events)
+            break;
+
+        // An empty reply only lets the client know the daemon is still there, and this one that the client still is
+        reply.Clear();
+        for (auto& event : *events)
+            *reply.add_events() = std::move(event);
+
+        client_listening = server->Write(reply);
+    }
+
+    instance_events.unsubscribe(subscription);
+
+    if (subscription->overflowed())
+        return {grpc::Status{grpc::StatusCode::RESOURCE_EXHAUSTED, "fell too far behind on events, watch again"},
+                status_promise};
+
+    return {grpc::Status::OK, status_promise};
+}
+
+mp::InstanceEventHub::Events
+mp::Daemon::instance_snapshot(const std::unordered_map<std::string, std::string>& ips) const
+{
+    InstanceEventHub::Events events;
+
+    for (const auto& [name, specs] : vm_instance_specs)
+    {
+        std::string ipv4;
+        if (auto it = ips.find(name); it != ips.end())
+            ipv4 = it->second;
+
+        auto status = specs.deleted ? InstanceStatus::DELETED : grpc_instance_status_for(specs.state);
+        events.push_back(make_instance_event(name, InstanceEvent::SNAPSHOT, status, ipv4));
+    }
+
+    return events;
 }
 
 void mp::Daemon::finish_async_operation(QFuture<AsyncOperationStatus> async_future)
@@ -20,25 +20,37 @@
 
 #include "daemon_config.h"
 #include "daemon_rpc.h"
+#include "guest_session_pool.h"
+#include "instance_event_hub.h"
 #include "vm_specs.h"
+#include "warm_pool.h"
 
+#include <multipass/client_launch_data.h>
 #include <multipass/delayed_shutdown_timer.h>
+#include <multipass/phase_timings.h>
 #include <multipass/virtual_machine.h>
+#include <multipass/virtual_machine_description.h>
 #include <multipass/vm_status_monitor.h>
 
 #include <chrono>
+#include <functional>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <QFutureWatcher>
+#include <QThreadPool>
 
 namespace multipass
 {
 struct DaemonConfig;
+class MetricsServer;
 class SettingsHandler;
 class Daemon : public QObject, public multipass::VMStatusMonitor
 {
@@ -91,10 +103,19 @@ public slots:
                          grpc::ServerReaderWriterInterface<RecoverReply, RecoverRequest>* server,
                          std::promise<grpc::Status>* status_promise);
 
+    virtual void clone(const CloneRequest* request, grpc::ServerReaderWriterInterface<CloneReply, CloneRequest>* server,
+                       std::promise<grpc::Status>* status_promise);
+
     virtual void ssh_info(const SSHInfoRequest* request,
                           grpc::ServerReaderWriterInterface<SSHInfoReply, SSHInfoRequest>* server,
                           std::promise<grpc::Status>* status_promise);
 
+    virtual void exec(const ExecRequest* request, grpc::ServerReaderWriterInterface<ExecReply, ExecRequest>* server,
+                      grpc::ServerContext* context, std::promise<grpc::Status>* status_promise);
+
+    virtual void watch(const WatchRequest* request, grpc::ServerReaderWriterInterface<WatchReply, WatchRequest>* server,
+                       std::promise<grpc::Status>* status_promise);
+
     virtual void start(const StartRequest* request, grpc::ServerReaderWriterInterface<StartReply, StartRequest>* server,
                        std::promise<grpc::Status>* status_promise);
 
@@ -135,15 +156,40 @@ public slots:
                               std::promise<grpc::Status>* status_promise);
 
 private:
+    using VMFullDescription = std::pair<VirtualMachineDescription, ClientLaunchData>;
+    struct BatchLaunch;
+
     void release_resources(const std::string& instance);
     std::string check_instance_operational(const std::string& instance_name) const;
     std::string check_instance_exists(const std::string& instance_name) const;
     void create_vm(const CreateRequest* request, grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
                    std::promise<grpc::Status>* status_promise, bool start);
+    template <typename Arguments>
+    void create_vm_batch(const CreateRequest* request, Arguments checked_args,
+                         grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
+                         std::promise<grpc::Status>* status_promise, bool start);
+    template <typename Arguments>
+    VMFullDescription prepare_vm_description(const CreateRequest* request, const std::string& name,
+                                             Arguments checked_args,
+                                             grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
+                                             const std::vector<std::string>* batch_macs = nullptr);
+    void start_vm_batch(std::shared_ptr<BatchLaunch> batch, size_t first);
+    void launch_warm_instance(const std::string& name, const CreateRequest* request,
+                              grpc::ServerReaderWriterInterface<CreateReply, CreateRequest>* server,
+                              std::promise<grpc::Status>* status_promise);
+    void fill_warm_pool();
+    void finish_warm_instance(const std::string& name, const std::string& error);
+    void discard_warm_instance(const std::string& name);
+    VMSpecs& specs_for(const std::string& name);
+    void serve_metrics();
     grpc::Status reboot_vm(VirtualMachine& vm);
     grpc::Status shutdown_vm(VirtualMachine& vm, const std::chrono::milliseconds delay);
+    void shutdown_vms_now(const std::vector<std::string>& names, std::promise<grpc::Status>* status_promise);
     grpc::Status cancel_vm_shutdown(const VirtualMachine& vm);
     grpc::Status cmd_vms(const std::vector<std::string>& tgts, std::function<grpc::Status(VirtualMachine&)> cmd);
+    void act_on_vms(const std::vector<std::string>& names, const std::function<void(VirtualMachine&)>& action,
+                    const std::function<void(const std::map<std::string, std::string>&)>& when_settled);
+    void stop_mounts(const std::string& name);
     void init_mounts(const std::string& name);
 
     struct AsyncOperationStatus
@@ -160,11 +206,24 @@ private:
     async_wait_for_ready_all(grpc::ServerReaderWriterInterface<Reply, Request>* server,
                              const std::vector<std::string>& vms, const std::chrono::seconds& timeout,
                              std::promise<grpc::Status>* status_promise, const std::string& errors);
+    template <typename Reply, typename Request>
+    std::string wait_for_ready(grpc::ServerReaderWriterInterface<Reply, Request>* server,
+                               const std::vector<std::string>& vms, const std::chrono::seconds& timeout);
+    AsyncOperationStatus async_exec(VirtualMachine::ShPtr vm, const std::string& cmd_line, const std::string& input,
+                                    bool input_closed,
+                                    grpc::ServerReaderWriterInterface<ExecReply, ExecRequest>* server,
+                                    const std::function<void()>& cancel_input,
+                                    std::promise<grpc::Status>* status_promise);
+    AsyncOperationStatus async_watch(InstanceEventHub::SubscriptionPtr subscription,
+                                     grpc::ServerReaderWriterInterface<WatchReply, WatchRequest>* server,
+                                     std::promise<grpc::Status>* status_promise);
+    InstanceEventHub::Events instance_snapshot(const std::unordered_map<std::string, std::string>& ips) const;
     void finish_async_operation(QFuture<AsyncOperationStatus> async_future);
     QFutureWatcher<AsyncOperationStatus>* create_future_watcher(std::function<void()> const& finished_op = []() {});
 
     std::unique_ptr<const DaemonConfig> config;
     std::unordered_map<std::string, VMSpecs> vm_instance_specs;
+    std::unordered_map<std::string, VMSpecs> warm_instance_specs;
     std::unordered_map<std::string, VirtualMachine::ShPtr> vm_instances;
     std::unordered_map<std::string, VirtualMachine::ShPtr> deleted_instances;
     std::unordered_map<std::string, std::unique_ptr<DelayedShutdownTimer>> delayed_shutdown_instances;
@@ -174,9 +233,18 @@ private:
     std::vector<std::unique_ptr<QFutureWatcher<AsyncOperationStatus>>> async_future_watchers;
     std::unordered_map<std::string, QFuture<std::string>> async_running_futures;
     std::mutex start_mutex;
+    std::unordered_map<std::string, std::shared_ptr<PhaseTimings>> launch_timings; // guarded by start_mutex
     std::unordered_set<std::string> preparing_instances;
     QFuture<void> image_update_future;
     SettingsHandler* instance_mod_handler;
+    GuestSessionPool guest_sessions;
+    QThreadPool exec_thread_pool; // commands can run for long, so they are kept off the global pool
+    InstanceEventHub instance_events;
+    QThreadPool watch_thread_pool; // watchers stay for as long as their clients do
+    WarmPool warm_pool;
+    std::unordered_map<std::string, VirtualMachine::ShPtr> warm_instances; // kept apart, until they are claimed
+    std::string warm_instance_in_the_making;
+    std::unique_ptr<MetricsServer> metrics_server; // only when metrics are to be served
 };
 } // namespace multipass
 #endif // MULTIPASS_DAEMON_H
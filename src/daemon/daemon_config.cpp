@@ -24,6 +24,7 @@
 #include <multipass/constants.h>
 #include <multipass/default_vm_blueprint_provider.h>
 #include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
+#include <multipass/logging/json_lines_span_exporter.h>
 #include <multipass/logging/log.h>
 #include <multipass/logging/standard_logger.h>
 #include <multipass/name_generator.h>
@@ -34,6 +35,8 @@
 #include <multipass/standard_paths.h>
 #include <multipass/utils.h>
 
+#include <QDir>
+#include <QFileInfo>
 #include <QString>
 #include <QSysInfo>
 #include <QUrl>
@@ -95,6 +98,7 @@ std::unique_ptr<QNetworkProxy> discover_http_proxy()
 
 mp::DaemonConfig::~DaemonConfig()
 {
+    mpl::set_span_exporter(nullptr);
     mpl::set_logger(nullptr);
 }
 
@@ -126,6 +130,26 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
         else
             data_directory = MP_STDPATHS.writableLocation(StandardPaths::AppDataLocation);
     }
+    if (!trace_file.isEmpty())
+    {
+        try
+        {
+            // Older settings may still hold a path from when any was taken
+            if (QFileInfo{trace_file}.fileName() != trace_file || trace_file == "." || trace_file == "..")
+                throw std::runtime_error(fmt::format("\"{}\" is not a file name", trace_file));
+
+            const auto trace_dir = mp::utils::make_dir(data_directory, "traces",
+                                                       QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                                                           QFileDevice::ExeOwner);
+            const auto trace_path = QDir{trace_dir}.filePath(trace_file);
+            mpl::set_span_exporter(std::make_shared<mpl::JsonLinesSpanExporter>(trace_path, mp::daemon_name));
+            mpl::log(mpl::Level::info, "daemon_config", fmt::format("Writing spans to {}", trace_path));
+        }
+        catch (const std::runtime_error& e)
+        {
+            mpl::log(mpl::Level::error, "daemon_config", fmt::format("Not tracing: {}", e.what()));
+        }
+    }
     if (url_downloader == nullptr)
         url_downloader = std::make_unique<URLDownloader>(cache_directory, std::chrono::seconds{10});
     if (factory == nullptr)
@@ -188,7 +212,8 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
 
     if (mount_handlers.empty())
     {
-        mount_handlers[mp::VMMount::MountType::Classic] = std::make_unique<SSHFSMountHandler>(*ssh_key_provider);
+        mount_handlers[mp::VMMount::MountType::Classic] =
+            std::make_unique<SSHFSMountHandler>(*ssh_key_provider, cache_directory);
 
         try
         {
@@ -206,5 +231,6 @@ std::unique_ptr<const mp::DaemonConfig> mp::DaemonConfigBuilder::build()
         std::move(url_downloader), std::move(factory), std::move(image_hosts), std::move(vault),
         std::move(name_generator), std::move(ssh_key_provider), std::move(cert_provider), std::move(client_cert_store),
         std::move(update_prompt), multiplexing_logger, std::move(network_proxy), std::move(blueprint_provider),
-        std::move(mount_handlers), cache_directory, data_directory, server_address, ssh_username, image_refresh_timer});
+        std::move(mount_handlers), cache_directory, data_directory, server_address, ssh_username, image_refresh_timer,
+        warm_pool_size, warm_pool_profile, metrics_address});
 }
@@ -64,6 +64,9 @@ struct DaemonConfig
     const std::string server_address;
     const std::string ssh_username;
     const std::chrono::hours image_refresh_timer;
+    const int warm_pool_size;
+    const LaunchRequest warm_pool_profile;
+    const std::string metrics_address;
 };
 
 struct DaemonConfigBuilder
@@ -87,6 +90,10 @@ struct DaemonConfigBuilder
     std::string ssh_username;
     multipass::days days_to_expire{14};
     std::chrono::hours image_refresh_timer{6};
+    int warm_pool_size{0};
+    LaunchRequest warm_pool_profile;
+    std::string metrics_address; // metrics are not served when empty
+    multipass::Path trace_file;  // name of the file in data_directory/traces; spans are not exported when empty
     multipass::logging::Level verbosity_level{multipass::logging::Level::info};
 
     std::unique_ptr<const DaemonConfig> build();
@@ -16,8 +16,12 @@
  */
 
 #include "daemon_init_settings.h"
+#include "daemon_config.h"
+#include "metrics_server.h"
 
 #include <multipass/constants.h>
+#include <multipass/exceptions/invalid_memory_size_exception.h>
+#include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/settings/basic_setting_spec.h>
 #include <multipass/settings/bool_setting_spec.h>
@@ -27,6 +31,7 @@
 #include <multipass/utils.h>
 
 #include <QCoreApplication>
+#include <QDir>
 #include <QFileSystemWatcher>
 #include <QObject>
 
@@ -79,6 +84,95 @@ QString image_mirror_interpreter(QString val)
     return val;
 }
 
+QString native_mounts_driver_interpreter(QString val)
+{
+    if (val != "9p" && val != "virtiofs")
+        throw mp::InvalidSettingException(mp::native_mounts_driver_key, val,
+                                          "Invalid driver, try \"9p\" or \"virtiofs\"");
+
+    return val;
+}
+
+QString virtiofs_cache_interpreter(QString val)
+{
+    static const auto valid_modes = QStringList{"none", "auto", "always"};
+    if (!valid_modes.contains(val))
+        throw mp::InvalidSettingException(mp::virtiofs_cache_key, val,
+                                          QString{"Invalid cache mode, try one of: %1"}.arg(valid_modes.join(", ")));
+
+    return val;
+}
+
+QString virtiofs_threads_interpreter(QString val)
+{
+    bool ok;
+    if (auto threads = val.toInt(&ok); !ok || threads < 0)
+        throw mp::InvalidSettingException(mp::virtiofs_threads_key, val, "Need a non-negative number of threads");
+
+    return val;
+}
+
+QString warm_pool_size_interpreter(QString val)
+{
+    bool ok;
+    if (auto size = val.toInt(&ok); !ok || size < 0)
+        throw mp::InvalidSettingException(mp::warm_pool_size_key, val, "Need a non-negative number of instances");
+
+    return val;
+}
+
+QString warm_pool_cores_interpreter(QString val)
+{
+    bool ok;
+    if (auto cores = val.toInt(&ok); !ok || cores < std::stoi(mp::min_cpu_cores))
+        throw mp::InvalidSettingException(mp::warm_pool_cores_key, val, "Need a positive number of cores");
+
+    return val;
+}
+
+QString metrics_address_interpreter(QString val)
+{
+    try
+    {
+        if (!val.isEmpty())
+            mp::MetricsServer::check_address(val);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        throw mp::InvalidSettingException(mp::metrics_address_key, val, e.what());
+    }
+
+    return val;
+}
+
+// Spans go to a file of this name in the daemon's own directory, which no one else gets to choose where it is
+QString tracing_file_interpreter(QString val)
+{
+    if (!val.isEmpty() && (val.contains('/') || val.contains('\\') || val == "." || val == ".."))
+        throw mp::InvalidSettingException(mp::tracing_file_key, val, "Need a file name, without directories");
+
+    return val;
+}
+
+std::function<QString(QString)> make_size_interpreter(const char* key, const char* min_size, bool allow_empty)
+{
+    return [key, min_size, allow_empty](QString val) {
+        if (val.isEmpty() && allow_empty)
+            return val;
+
+        try
+        {
+            if (mp::MemorySize{val.toStdString()} >= mp::MemorySize{min_size})
+                return val;
+        }
+        catch (const mp::InvalidMemorySizeException&)
+        {
+        }
+
+        throw mp::InvalidSettingException(key, val, QString{"Need a size of at least %1"}.arg(min_size));
+    };
+}
+
 } // namespace
 
 void mp::daemon::monitor_and_quit_on_settings_change() // temporary
@@ -100,7 +194,46 @@ void mp::daemon::register_global_settings_handlers()
         return val.isEmpty() ? val : MP_UTILS.generate_scrypt_hash_for(val);
     }));
     settings.insert(std::make_unique<CustomSettingSpec>(mp::mirror_key, "", image_mirror_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::native_mounts_driver_key, mp::native_mounts_driver_default,
+                                                        native_mounts_driver_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::virtiofs_cache_key, mp::virtiofs_cache_default,
+                                                        virtiofs_cache_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::virtiofs_threads_key, mp::virtiofs_threads_default,
+                                                        virtiofs_threads_interpreter));
+    settings.insert(std::make_unique<BoolSettingSpec>(mp::sshfs_shared_server_key, mp::sshfs_shared_server_default));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::warm_pool_size_key, mp::warm_pool_size_default,
+                                                        warm_pool_size_interpreter));
+    settings.insert(std::make_unique<BasicSettingSpec>(mp::warm_pool_image_key, ""));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::warm_pool_cores_key, mp::default_cpu_cores,
+                                                        warm_pool_cores_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(
+        mp::warm_pool_mem_size_key, mp::default_memory_size,
+        make_size_interpreter(mp::warm_pool_mem_size_key, mp::min_memory_size, /* allow_empty = */ false)));
+    settings.insert(std::make_unique<CustomSettingSpec>(
+        mp::warm_pool_disk_size_key, "",
+        make_size_interpreter(mp::warm_pool_disk_size_key, mp::min_disk_size, /* allow_empty = */ true)));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::metrics_address_key, "", metrics_address_interpreter));
+    settings.insert(std::make_unique<CustomSettingSpec>(mp::tracing_file_key, "", tracing_file_interpreter));
 
     MP_SETTINGS.register_handler(
         std::make_unique<PersistentSettingsHandler>(persistent_settings_filename(), std::move(settings)));
 }
+
+void mp::daemon::configure_warm_pool(DaemonConfigBuilder& builder)
+{
+    builder.warm_pool_size = MP_SETTINGS.get_as<int>(warm_pool_size_key);
+
+    // The image is given the way it is to launch, optionally with its remote in front
+    const auto image = MP_SETTINGS.get(warm_pool_image_key);
+    if (const auto colon = image.indexOf(':'); colon >= 0)
+    {
+        builder.warm_pool_profile.set_remote_name(image.left(colon).toStdString());
+        builder.warm_pool_profile.set_image(image.mid(colon + 1).toStdString());
+    }
+    else
+        builder.warm_pool_profile.set_image(image.toStdString());
+
+    builder.warm_pool_profile.set_num_cores(MP_SETTINGS.get_as<int>(warm_pool_cores_key));
+    builder.warm_pool_profile.set_mem_size(MP_SETTINGS.get(warm_pool_mem_size_key).toStdString());
+    builder.warm_pool_profile.set_disk_space(MP_SETTINGS.get(warm_pool_disk_size_key).toStdString());
+}
@@ -18,10 +18,16 @@
 #ifndef MULTIPASS_DAEMON_INIT_SETTINGS_H
 #define MULTIPASS_DAEMON_INIT_SETTINGS_H
 
-namespace multipass::daemon
+namespace multipass
+{
+struct DaemonConfigBuilder;
+
+namespace daemon
 {
 void monitor_and_quit_on_settings_change(); // TODO replace with async restart in relevant settings handlers (see #2514)
 void register_global_settings_handlers();
-} // namespace multipass::daemon
+void configure_warm_pool(DaemonConfigBuilder& builder); // from settings, which are only read at startup for now
+} // namespace daemon
+} // namespace multipass
 
 #endif // MULTIPASS_DAEMON_INIT_SETTINGS_H
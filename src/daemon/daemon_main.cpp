@@ -25,6 +25,7 @@
 #include <multipass/constants.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform_unix.h>
+#include <multipass/settings/settings.h>
 #include <multipass/top_catch_all.h>
 #include <multipass/utils.h>
 #include <multipass/version.h>
@@ -79,6 +80,9 @@ int main_impl(int argc, char* argv[])
     mp::daemon::register_global_settings_handlers();
 
     auto builder = mp::cli::parse(app);
+    mp::daemon::configure_warm_pool(builder);
+    builder.metrics_address = MP_SETTINGS.get(mp::metrics_address_key).toStdString();
+    builder.trace_file = MP_SETTINGS.get(mp::tracing_file_key);
     auto config = builder.build();
     auto server_address = config->server_address;
 
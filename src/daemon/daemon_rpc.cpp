@@ -20,11 +20,15 @@
 
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
+#include <multipass/metrics.h>
 #include <multipass/platform.h>
 #include <multipass/utils.h>
 
 #include <chrono>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -123,6 +127,79 @@ void accept_cert(mp::CertStore* client_cert_store, const std::string& client_cer
 
     handle_socket_restrictions(server_address, false);
 }
+
+// What is counted of each RPC method, looked up once so that calls only update atomic counters
+struct RpcMetrics
+{
+    std::string method;
+    mp::metrics::Counter* calls;
+    mp::metrics::Counter* failures;
+    mp::metrics::Histogram* duration;
+};
+
+RpcMetrics rpc_metrics_for(const std::string& method)
+{
+    const mp::metrics::Labels labels{{"method", method}};
+    return {method, &MP_METRICS.counter("multipass_rpc_calls_total", "RPC calls handled, by method", labels),
+            &MP_METRICS.counter("multipass_rpc_failures_total", "RPC calls that did not succeed, by method", labels),
+            &MP_METRICS.histogram("multipass_rpc_duration_seconds", "How long RPC calls took, by method", labels)};
+}
+
+// The spans of the calls being served, by the server they are served through, for the daemon to carry on with
+std::mutex call_spans_mutex;
+std::unordered_map<const void*, mpl::SpanContext> call_spans;
+
+// Clients pass on the trace that a call is part of as W3C trace context, in gRPC metadata
+mpl::SpanContext caller_span_context(const grpc::ServerContext* context)
+{
+    const auto& metadata = context->client_metadata();
+    if (auto traceparent = metadata.find("traceparent"); traceparent != metadata.end())
+        return mpl::SpanContext::from_traceparent({traceparent->second.data(), traceparent->second.size()});
+
+    return {};
+}
+
+// Counts and traces a call to a method, until it finishes with the given status
+class RpcCall
+{
+public:
+    template <typename Reply, typename Request>
+    RpcCall(const RpcMetrics& metrics, const grpc::ServerContext* context,
+            grpc::ServerReaderWriterInterface<Reply, Request>* server)
+        : metrics{metrics},
+          server{server},
+          start{std::chrono::steady_clock::now()},
+          span{"rpc " + metrics.method, caller_span_context(context)}
+    {
+        std::lock_guard<std::mutex> lock{call_spans_mutex};
+        call_spans[server] = span.context();
+    }
+
+    ~RpcCall()
+    {
+        std::lock_guard<std::mutex> lock{call_spans_mutex};
+        call_spans.erase(server);
+    }
+
+    grpc::Status finish(grpc::Status status)
+    {
+        metrics.calls->increment();
+        if (!status.ok())
+        {
+            metrics.failures->increment();
+            span.set_failed();
+        }
+        metrics.duration->observe(std::chrono::steady_clock::now() - start);
+
+        return status;
+    }
+
+private:
+    const RpcMetrics& metrics;
+    const void* const server;
+    const std::chrono::steady_clock::time_point start;
+    mpl::Span span;
+};
 } // namespace
 
 mp::DaemonRpc::DaemonRpc(const std::string& server_address, const CertProvider& cert_provider,
@@ -140,167 +217,257 @@ mp::DaemonRpc::DaemonRpc(const std::string& server_address, const CertProvider&
 grpc::Status mp::DaemonRpc::create(grpc::ServerContext* context,
                                    grpc::ServerReaderWriter<CreateReply, CreateRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("create");
+    RpcCall call{metrics, context, server};
+
     CreateRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_create, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_create, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::launch(grpc::ServerContext* context,
                                    grpc::ServerReaderWriter<LaunchReply, LaunchRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("launch");
+    RpcCall call{metrics, context, server};
+
     LaunchRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_launch, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_launch, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::purge(grpc::ServerContext* context,
                                   grpc::ServerReaderWriter<PurgeReply, PurgeRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("purge");
+    RpcCall call{metrics, context, server};
+
     PurgeRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_purge, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_purge, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::find(grpc::ServerContext* context, grpc::ServerReaderWriter<FindReply, FindRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("find");
+    RpcCall call{metrics, context, server};
+
     FindRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_find, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_find, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::info(grpc::ServerContext* context, grpc::ServerReaderWriter<InfoReply, InfoRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("info");
+    RpcCall call{metrics, context, server};
+
     InfoRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_info, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_info, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::list(grpc::ServerContext* context, grpc::ServerReaderWriter<ListReply, ListRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("list");
+    RpcCall call{metrics, context, server};
+
     ListRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_list, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_list, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::networks(grpc::ServerContext* context,
                                      grpc::ServerReaderWriter<NetworksReply, NetworksRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("networks");
+    RpcCall call{metrics, context, server};
+
     NetworksRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_networks, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_networks, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::mount(grpc::ServerContext* context,
                                   grpc::ServerReaderWriter<MountReply, MountRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("mount");
+    RpcCall call{metrics, context, server};
+
     MountRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_mount, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_mount, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::recover(grpc::ServerContext* context,
                                     grpc::ServerReaderWriter<RecoverReply, RecoverRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("recover");
+    RpcCall call{metrics, context, server};
+
     RecoverRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_recover, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_recover, this, &request, server, std::placeholders::_1), client_cert_from(context)));
+}
+
+grpc::Status mp::DaemonRpc::clone(grpc::ServerContext* context,
+                                  grpc::ServerReaderWriter<CloneReply, CloneRequest>* server)
+{
+    static const auto metrics = rpc_metrics_for("clone");
+    RpcCall call{metrics, context, server};
+
+    CloneRequest request;
+    server->Read(&request);
+
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_clone, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::ssh_info(grpc::ServerContext* context,
                                      grpc::ServerReaderWriter<SSHInfoReply, SSHInfoRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("ssh_info");
+    RpcCall call{metrics, context, server};
+
     SSHInfoRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_ssh_info, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_ssh_info, this, &request, server, std::placeholders::_1), client_cert_from(context)));
+}
+
+grpc::Status mp::DaemonRpc::exec(grpc::ServerContext* context, grpc::ServerReaderWriter<ExecReply, ExecRequest>* server)
+{
+    static const auto metrics = rpc_metrics_for("exec");
+    RpcCall call{metrics, context, server};
+
+    ExecRequest request;
+    server->Read(&request);
+
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_exec, this, &request, server, context, std::placeholders::_1),
+        client_cert_from(context)));
+}
+
+grpc::Status mp::DaemonRpc::watch(grpc::ServerContext* context,
+                                  grpc::ServerReaderWriter<WatchReply, WatchRequest>* server)
+{
+    static const auto metrics = rpc_metrics_for("watch");
+    RpcCall call{metrics, context, server};
+
+    WatchRequest request;
+    server->Read(&request);
+
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_watch, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::start(grpc::ServerContext* context,
                                   grpc::ServerReaderWriter<StartReply, StartRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("start");
+    RpcCall call{metrics, context, server};
+
     StartRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_start, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_start, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::stop(grpc::ServerContext* context, grpc::ServerReaderWriter<StopReply, StopRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("stop");
+    RpcCall call{metrics, context, server};
+
     StopRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_stop, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_stop, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::suspend(grpc::ServerContext* context,
                                     grpc::ServerReaderWriter<SuspendReply, SuspendRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("suspend");
+    RpcCall call{metrics, context, server};
+
     SuspendRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_suspend, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_suspend, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::restart(grpc::ServerContext* context,
                                     grpc::ServerReaderWriter<RestartReply, RestartRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("restart");
+    RpcCall call{metrics, context, server};
+
     RestartRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_restart, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_restart, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::delet(grpc::ServerContext* context,
                                   grpc::ServerReaderWriter<DeleteReply, DeleteRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("delete");
+    RpcCall call{metrics, context, server};
+
     DeleteRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_delete, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_delete, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::umount(grpc::ServerContext* context,
                                    grpc::ServerReaderWriter<UmountReply, UmountRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("umount");
+    RpcCall call{metrics, context, server};
+
     UmountRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_umount, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_umount, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::version(grpc::ServerContext* context,
                                     grpc::ServerReaderWriter<VersionReply, VersionRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("version");
+    RpcCall call{metrics, context, server};
+
     VersionRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_version, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_version, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::ping(grpc::ServerContext* context, const PingRequest* request, PingReply* server)
@@ -317,16 +484,22 @@ grpc::Status mp::DaemonRpc::ping(grpc::ServerContext* context, const PingRequest
 
 grpc::Status mp::DaemonRpc::get(grpc::ServerContext* context, grpc::ServerReaderWriter<GetReply, GetRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("get");
+    RpcCall call{metrics, context, server};
+
     GetRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_get, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_get, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::authenticate(grpc::ServerContext* context,
                                          grpc::ServerReaderWriter<AuthenticateReply, AuthenticateRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("authenticate");
+    RpcCall call{metrics, context, server};
+
     AuthenticateRequest request;
     server->Read(&request);
 
@@ -341,29 +514,44 @@ grpc::Status mp::DaemonRpc::authenticate(grpc::ServerContext* context,
         }
         catch (const std::exception& e)
         {
-            return grpc::Status{grpc::StatusCode::INTERNAL, e.what()};
+            return call.finish(grpc::Status{grpc::StatusCode::INTERNAL, e.what()});
         }
     }
 
-    return status;
+    return call.finish(status);
 }
 
 grpc::Status mp::DaemonRpc::set(grpc::ServerContext* context, grpc::ServerReaderWriter<SetReply, SetRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("set");
+    RpcCall call{metrics, context, server};
+
     SetRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_set, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_set, this, &request, server, std::placeholders::_1), client_cert_from(context)));
 }
 
 grpc::Status mp::DaemonRpc::keys(grpc::ServerContext* context, grpc::ServerReaderWriter<KeysReply, KeysRequest>* server)
 {
+    static const auto metrics = rpc_metrics_for("keys");
+    RpcCall call{metrics, context, server};
+
     KeysRequest request;
     server->Read(&request);
 
-    return verify_client_and_dispatch_operation(
-        std::bind(&DaemonRpc::on_keys, this, &request, server, std::placeholders::_1), client_cert_from(context));
+    return call.finish(verify_client_and_dispatch_operation(
+        std::bind(&DaemonRpc::on_keys, this, &request, server, std::placeholders::_1), client_cert_from(context)));
+}
+
+mpl::SpanContext mp::DaemonRpc::span_context_for(const void* server)
+{
+    std::lock_guard<std::mutex> lock{call_spans_mutex};
+    if (auto it = call_spans.find(server); it != call_spans.end())
+        return it->second;
+
+    return {};
 }
 
 template <typename OperationSignal>
@@ -22,6 +22,7 @@
 
 #include <multipass/cert_provider.h>
 #include <multipass/disabled_copy_move.h>
+#include <multipass/logging/trace.h>
 #include <multipass/rpc/multipass.grpc.pb.h>
 
 #include <grpcpp/grpcpp.h>
@@ -54,6 +55,13 @@ class DaemonRpc : public QObject, public multipass::Rpc::Service, private Disabl
 public:
     DaemonRpc(const std::string& server_address, const CertProvider& cert_provider, CertStore* client_cert_store);
 
+    // The span of the call that is being served through the given server, if any, for the daemon to carry on with
+    template <typename Reply, typename Request>
+    static logging::SpanContext span_context_for(grpc::ServerReaderWriterInterface<Reply, Request>* server)
+    {
+        return span_context_for(static_cast<const void*>(server));
+    }
+
 signals:
     void on_create(const CreateRequest* request, grpc::ServerReaderWriter<CreateReply, CreateRequest>* server,
                    std::promise<grpc::Status>* status_promise);
@@ -73,8 +81,14 @@ signals:
                   std::promise<grpc::Status>* status_promise);
     void on_recover(const RecoverRequest* request, grpc::ServerReaderWriter<RecoverReply, RecoverRequest>* server,
                     std::promise<grpc::Status>* status_promise);
+    void on_clone(const CloneRequest* request, grpc::ServerReaderWriter<CloneReply, CloneRequest>* server,
+                  std::promise<grpc::Status>* status_promise);
     void on_ssh_info(const SSHInfoRequest* request, grpc::ServerReaderWriter<SSHInfoReply, SSHInfoRequest>* server,
                      std::promise<grpc::Status>* status_promise);
+    void on_exec(const ExecRequest* request, grpc::ServerReaderWriter<ExecReply, ExecRequest>* server,
+                 grpc::ServerContext* context, std::promise<grpc::Status>* status_promise);
+    void on_watch(const WatchRequest* request, grpc::ServerReaderWriter<WatchReply, WatchRequest>* server,
+                  std::promise<grpc::Status>* status_promise);
     void on_start(const StartRequest* request, grpc::ServerReaderWriter<StartReply, StartRequest>* server,
                   std::promise<grpc::Status>* status_promise);
     void on_stop(const StopRequest* request, grpc::ServerReaderWriter<StopReply, StopRequest>* server,
@@ -100,6 +114,8 @@ signals:
                          std::promise<grpc::Status>* status_promise);
 
 private:
+    static logging::SpanContext span_context_for(const void* server);
+
     template <typename OperationSignal>
     grpc::Status verify_client_and_dispatch_operation(OperationSignal signal, const std::string& client_cert);
 
@@ -124,8 +140,13 @@ protected:
                        grpc::ServerReaderWriter<MountReply, MountRequest>* server) override;
     grpc::Status recover(grpc::ServerContext* context,
                          grpc::ServerReaderWriter<RecoverReply, RecoverRequest>* server) override;
+    grpc::Status clone(grpc::ServerContext* context,
+                       grpc::ServerReaderWriter<CloneReply, CloneRequest>* server) override;
     grpc::Status ssh_info(grpc::ServerContext* context,
                           grpc::ServerReaderWriter<SSHInfoReply, SSHInfoRequest>* server) override;
+    grpc::Status exec(grpc::ServerContext* context, grpc::ServerReaderWriter<ExecReply, ExecRequest>* server) override;
+    grpc::Status watch(grpc::ServerContext* context,
+                       grpc::ServerReaderWriter<WatchReply, WatchRequest>* server) override;
     grpc::Status start(grpc::ServerContext* context,
                        grpc::ServerReaderWriter<StartReply, StartRequest>* server) override;
     grpc::Status stop(grpc::ServerContext* context, grpc::ServerReaderWriter<StopReply, StopRequest>* server) override;
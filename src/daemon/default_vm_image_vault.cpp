@@ -22,6 +22,8 @@
 #include <multipass/exceptions/unsupported_image_exception.h>
 #include <multipass/json_writer.h>
 #include <multipass/logging/log.h>
+#include <multipass/metrics.h>
+#include <multipass/phase_timings.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
 #include <multipass/query.h>
@@ -49,6 +51,23 @@ namespace
 constexpr auto category = "image vault";
 constexpr auto instance_db_name = "multipassd-instance-image-records.json";
 constexpr auto image_db_name = "multipassd-image-records.json";
+constexpr auto fetches_in_progress_metric = "multipass_image_fetches_in_progress";
+constexpr auto cached_images_metric = "multipass_image_cache_images";
+constexpr auto cached_image_bytes_metric = "multipass_image_cache_bytes";
+
+mp::metrics::Counter& cache_hits()
+{
+    static auto& counter =
+        MP_METRICS.counter("multipass_image_cache_hits_total", "Image fetches that found the image in the cache");
+    return counter;
+}
+
+mp::metrics::Counter& cache_misses()
+{
+    static auto& counter =
+        MP_METRICS.counter("multipass_image_cache_misses_total", "Image fetches that had to download the image");
+    return counter;
+}
 
 auto query_to_json(const mp::Query& query)
 {
@@ -239,10 +258,32 @@ mp::DefaultVMImageVault::DefaultVMImageVault(std::vector<VMImageHost*> image_hos
       prepared_image_records{load_db(cache_dir.filePath(image_db_name))},
       instance_image_records{load_db(data_dir.filePath(instance_db_name))}
 {
+    MP_METRICS.set_gauge_callback(fetches_in_progress_metric, "Images being downloaded and prepared", [this] {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        return std::vector<std::pair<mp::metrics::Labels, double>>{
+            {{}, static_cast<double>(in_progress_image_fetches.size())}};
+    });
+    MP_METRICS.set_gauge_callback(cached_images_metric, "Images kept in the cache", [this] {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+        return std::vector<std::pair<mp::metrics::Labels, double>>{
+            {{}, static_cast<double>(prepared_image_records.size())}};
+    });
+    MP_METRICS.set_gauge_callback(cached_image_bytes_metric, "Disk space taken by cached images", [this] {
+        std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
+
+        qint64 bytes{0};
+        for (const auto& record : prepared_image_records)
+            bytes += QFileInfo{record.second.image.image_path}.size();
+
+        return std::vector<std::pair<mp::metrics::Labels, double>>{{{}, static_cast<double>(bytes)}};
+    });
 }
 
 mp::DefaultVMImageVault::~DefaultVMImageVault()
 {
+    for (const auto metric : {fetches_in_progress_metric, cached_images_metric, cached_image_bytes_metric})
+        MP_METRICS.remove_gauge_callback(metric);
+
     url_downloader->abort_all_downloads();
 }
 
@@ -275,10 +316,12 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
         if (source_image.image_path.endsWith(".xz"))
         {
+            PhaseTimer timer{"extract"};
             source_image.image_path = extract_image_from(query.name, source_image, monitor);
         }
         else
         {
+            PhaseTimer timer{"copy image"};
             source_image = image_instance_from(query.name, source_image);
         }
 
@@ -290,7 +333,10 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
                 fetch_kernel_and_initrd(info, source_image, QFileInfo(source_image.image_path).absoluteDir(), monitor);
         }
 
+        PhaseTimer prepare_timer{"prepare image"};
         vm_image = prepare(source_image);
+        prepare_timer.stop();
+
         vm_image.id = mp::vault::compute_image_hash(vm_image.image_path).toStdString();
 
         remove_source_images(source_image, vm_image);
@@ -308,6 +354,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
         std::string id;
         std::optional<VMImage> source_image{std::nullopt};
         QFuture<VMImage> future;
+        bool waiting_for_other_fetch{false};
 
         if (query.query_type == Query::Type::HttpDownload)
         {
@@ -315,7 +362,9 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
             // Generate a sha256 hash based on the URL and use that for the id
             id = QCryptographicHash::hash(query.release.c_str(), QCryptographicHash::Sha256).toHex().toStdString();
+            PhaseTimer resolve_timer{"resolve image"};
             auto last_modified = url_downloader->last_modified(image_url);
+            resolve_timer.stop();
 
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
             auto entry = prepared_image_records.find(id);
@@ -325,6 +374,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
 
                 if (last_modified.isValid() && (last_modified.toString().toStdString() == record.image.release_date))
                 {
+                    cache_hits().increment();
                     return finalize_image_records(query, record.image, id);
                 }
             }
@@ -334,6 +384,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
             {
                 monitor(LaunchProgress::WAITING, -1);
                 future = *running_future;
+                waiting_for_other_fetch = true;
             }
             else
             {
@@ -362,14 +413,18 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
                 // Had to use std::bind here to workaround the 5 allowable function arguments constraint of
                 // QtConcurrent::run()
                 future = QtConcurrent::run(std::bind(&DefaultVMImageVault::download_and_prepare_source_image, this,
-                                                     info, source_image, image_dir, fetch_type, prepare, monitor));
+                                                     info, source_image, image_dir, fetch_type, prepare, monitor,
+                                                     PhaseTimings::current()));
 
                 in_progress_image_fetches[id] = future;
+                cache_misses().increment();
             }
         }
         else
         {
+            PhaseTimer resolve_timer{"resolve image"};
             const auto info = info_for(query);
+            resolve_timer.stop();
 
             id = info.id.toStdString();
 
@@ -388,7 +443,10 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
                         const auto prepared_image = record.second.image;
                         try
                         {
-                            return finalize_image_records(query, prepared_image, record.first);
+                            auto vm_image = finalize_image_records(query, prepared_image, record.first);
+                            cache_hits().increment();
+
+                            return vm_image;
                         }
                         catch (const std::exception& e)
                         {
@@ -406,6 +464,7 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
             {
                 monitor(LaunchProgress::WAITING, -1);
                 future = *running_future;
+                waiting_for_other_fetch = true;
             }
             else
             {
@@ -415,15 +474,21 @@ mp::VMImage mp::DefaultVMImageVault::fetch_image(const FetchType& fetch_type, co
                 // Had to use std::bind here to workaround the 5 allowable function arguments constraint of
                 // QtConcurrent::run()
                 future = QtConcurrent::run(std::bind(&DefaultVMImageVault::download_and_prepare_source_image, this,
-                                                     info, source_image, image_dir, fetch_type, prepare, monitor));
+                                                     info, source_image, image_dir, fetch_type, prepare, monitor,
+                                                     PhaseTimings::current()));
 
                 in_progress_image_fetches[id] = future;
+                cache_misses().increment();
             }
         }
 
         try
         {
+            // The fetch's own phases are timed as they happen, but one that another launch started is only waited on
+            PhaseTimer wait_timer{"wait for image", waiting_for_other_fetch ? PhaseTimings::current() : nullptr};
             auto prepared_image = future.result();
+            wait_timer.stop();
+
             std::lock_guard<decltype(fetch_mutex)> lock{fetch_mutex};
             in_progress_image_fetches.erase(id);
             return finalize_image_records(query, prepared_image, id);
@@ -451,6 +516,30 @@ void mp::DefaultVMImageVault::remove(const std::string& name)
     persist_instance_records();
 }
 
+mp::VMImage mp::DefaultVMImageVault::clone(const std::string& source_name, const std::string& destination_name)
+{
+    const auto source_entry = instance_image_records.find(source_name);
+    if (source_entry == instance_image_records.end())
+        throw std::runtime_error(fmt::format("No image recorded for instance \"{}\"", source_name));
+
+    if (has_record_for(destination_name))
+        throw std::runtime_error(fmt::format("An image is already recorded for instance \"{}\"", destination_name));
+
+    const auto output_dir = mp::utils::make_dir(instances_dir, QString::fromStdString(destination_name));
+
+    auto record = source_entry->second;
+    record.image.image_path = output_dir.filePath(mp::vault::filename_for(record.image.image_path));
+    record.image.kernel_path = mp::vault::copy(record.image.kernel_path, output_dir);
+    record.image.initrd_path = mp::vault::copy(record.image.initrd_path, output_dir);
+    record.query.name = destination_name;
+    record.last_accessed = std::chrono::system_clock::now();
+
+    instance_image_records[destination_name] = record;
+    persist_instance_records();
+
+    return record.image;
+}
+
 bool mp::DefaultVMImageVault::has_record_for(const std::string& name)
 {
     return instance_image_records.find(name) != instance_image_records.end();
@@ -569,8 +658,10 @@ mp::MemorySize mp::DefaultVMImageVault::minimum_image_size_for(const std::string
 
 mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
     const VMImageInfo& info, std::optional<VMImage>& existing_source_image, const QDir& image_dir,
-    const FetchType& fetch_type, const PrepareAction& prepare, const ProgressMonitor& monitor)
+    const FetchType& fetch_type, const PrepareAction& prepare, const ProgressMonitor& monitor, PhaseTimings* timings)
 {
+    PhaseTimings::Scope timing_scope{timings};
+
     VMImage source_image;
     auto id = info.id;
 
@@ -595,26 +686,34 @@ mp::VMImage mp::DefaultVMImageVault::download_and_prepare_source_image(
 
     try
     {
+        PhaseTimer download_timer{"download"};
         url_downloader->download_to(info.image_location, source_image.image_path, info.size, LaunchProgress::IMAGE,
                                     monitor);
+        download_timer.stop();
 
         if (info.verify)
         {
+            PhaseTimer timer{"verify"};
             monitor(LaunchProgress::VERIFY, -1);
             mp::vault::verify_image_download(source_image.image_path, id);
         }
 
         if (fetch_type == FetchType::ImageKernelAndInitrd)
         {
+            PhaseTimer timer{"download kernel"};
             source_image = fetch_kernel_and_initrd(info, source_image, image_dir, monitor);
         }
 
         if (source_image.image_path.endsWith(".xz"))
         {
+            PhaseTimer timer{"extract"};
             source_image.image_path = mp::vault::extract_image(source_image.image_path, monitor, true);
         }
 
+        PhaseTimer prepare_timer{"prepare image"};
         auto prepared_image = prepare(source_image);
+        prepare_timer.stop();
+
         remove_source_images(source_image, prepared_image);
 
         return prepared_image;
@@ -690,6 +789,7 @@ mp::VMImage mp::DefaultVMImageVault::finalize_image_records(const Query& query,
 
     if (!query.name.empty())
     {
+        PhaseTimer timer{"copy image"};
         vm_image = image_instance_from(query.name, prepared_image);
         instance_image_records[query.name] = {vm_image, query, std::chrono::system_clock::now()};
     }
@@ -32,6 +32,7 @@
 
 namespace multipass
 {
+class PhaseTimings;
 class URLDownloader;
 class VMImageHost;
 class VaultRecord
@@ -56,12 +57,14 @@ public:
     void update_images(const FetchType& fetch_type, const PrepareAction& prepare,
                        const ProgressMonitor& monitor) override;
     MemorySize minimum_image_size_for(const std::string& id) override;
+    VMImage clone(const std::string& source_name, const std::string& destination_name) override;
 
 private:
     VMImage image_instance_from(const std::string& name, const VMImage& prepared_image);
     VMImage download_and_prepare_source_image(const VMImageInfo& info, std::optional<VMImage>& existing_source_image,
                                               const QDir& image_dir, const FetchType& fetch_type,
-                                              const PrepareAction& prepare, const ProgressMonitor& monitor);
+                                              const PrepareAction& prepare, const ProgressMonitor& monitor,
+                                              PhaseTimings* timings);
     QString extract_image_from(const std::string& instance_name, const VMImage& source_image,
                                const ProgressMonitor& monitor);
     VMImage fetch_kernel_and_initrd(const VMImageInfo& info, const VMImage& source_image, const QDir& image_dir,
@@ -131,6 +131,6 @@ std::chrono::seconds mp::DelayedShutdownTimer::get_time_remaining()
 void mp::DelayedShutdownTimer::shutdown_instance()
 {
     stop_mounts(virtual_machine->vm_name);
-    virtual_machine->shutdown();
+    virtual_machine->request_shutdown();
     emit finished();
 }
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "guest_session_pool.h"
+
+#include <multipass/virtual_machine.h>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto max_idle_sessions = 4u; // per instance
+} // namespace
+
+mp::GuestSessionPool::GuestSessionPool(const SSHKeyProvider& key_provider) : key_provider{key_provider}
+{
+}
+
+mp::GuestSessionPool::SessionUPtr mp::GuestSessionPool::acquire(VirtualMachine& vm, bool fresh)
+{
+    if (!fresh)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto& sessions = idle_sessions[vm.vm_name];
+
+        while (!sessions.empty())
+        {
+            auto session = std::move(sessions.back());
+            sessions.pop_back();
+
+            if (ssh_is_connected(*session))
+                return session;
+        }
+    }
+
+    return std::make_unique<SSHSession>(vm.ssh_hostname(), vm.ssh_port(), vm.ssh_username(), key_provider);
+}
+
+void mp::GuestSessionPool::release(const std::string& instance_name, SessionUPtr session)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& sessions = idle_sessions[instance_name];
+
+    if (sessions.size() < max_idle_sessions)
+        sessions.push_back(std::move(session));
+}
+
+void mp::GuestSessionPool::drop(const std::string& instance_name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    idle_sessions.erase(instance_name);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_GUEST_SESSION_POOL_H
+#define MULTIPASS_GUEST_SESSION_POOL_H
+
+#include <multipass/ssh/ssh_session.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace multipass
+{
+class SSHKeyProvider;
+class VirtualMachine;
+
+// Keeps the daemon's SSH sessions to instances around between commands, so that each one does not pay for a new
+// handshake. A session is only ever handed to one user at a time, since libssh sessions are not to be shared
+// between threads.
+class GuestSessionPool
+{
+public:
+    using SessionUPtr = std::unique_ptr<SSHSession>;
+
+    explicit GuestSessionPool(const SSHKeyProvider& key_provider);
+
+    // Hands out an idle session to the instance, or a new one when there is none or a fresh one is asked for
+    SessionUPtr acquire(VirtualMachine& vm, bool fresh = false);
+
+    // Takes a session back once its user is done with it
+    void release(const std::string& instance_name, SessionUPtr session);
+
+    // Forgets the sessions to an instance that is no longer running
+    void drop(const std::string& instance_name);
+
+private:
+    const SSHKeyProvider& key_provider;
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<SessionUPtr>> idle_sessions;
+};
+} // namespace multipass
+#endif // MULTIPASS_GUEST_SESSION_POOL_H
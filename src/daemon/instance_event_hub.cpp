@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "instance_event_hub.h"
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto max_pending_events = 1024u; // per subscription, past which the watcher is deemed gone astray
+} // namespace
+
+const mp::InstanceEventHub::Events& mp::InstanceEventHub::Subscription::snapshot() const
+{
+    return snapshot_events;
+}
+
+std::optional<mp::InstanceEventHub::Events> mp::InstanceEventHub::Subscription::wait_for(
+    std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    events_came.wait_for(lock, timeout, [this] { return closed || !pending_events.empty(); });
+
+    // Whatever was queued before closing is still handed out, unless the subscriber fell behind
+    if (closed && (fell_behind || pending_events.empty()))
+        return std::nullopt;
+
+    Events events{std::make_move_iterator(pending_events.begin()), std::make_move_iterator(pending_events.end())};
+    pending_events.clear();
+
+    return events;
+}
+
+bool mp::InstanceEventHub::Subscription::overflowed() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return fell_behind;
+}
+
+void mp::InstanceEventHub::Subscription::push(const InstanceEvent& event)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (closed)
+            return;
+
+        if (pending_events.size() >= max_pending_events)
+        {
+            // Events cannot be dropped without the subscriber losing track, so it is told to start over instead
+            closed = fell_behind = true;
+            pending_events.clear();
+        }
+        else
+            pending_events.push_back(event);
+    }
+    events_came.notify_all();
+}
+
+void mp::InstanceEventHub::Subscription::close(bool overflow)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        closed = true;
+        fell_behind = fell_behind || overflow;
+    }
+    events_came.notify_all();
+}
+
+void mp::InstanceEventHub::publish(InstanceEvent event)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    event.set_sequence(++last_sequence);
+
+    for (const auto& subscription : subscriptions)
+        subscription->push(event);
+}
+
+mp::InstanceEventHub::SubscriptionPtr mp::InstanceEventHub::subscribe(const SnapshotMaker& make_snapshot)
+{
+    auto subscription = std::make_shared<Subscription>();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    subscription->snapshot_events = make_snapshot();
+    for (auto& event : subscription->snapshot_events)
+    {
+        event.set_sequence(last_sequence);
+        event.set_kind(InstanceEvent::SNAPSHOT);
+    }
+
+    subscriptions.insert(subscription);
+
+    return subscription;
+}
+
+void mp::InstanceEventHub::unsubscribe(const SubscriptionPtr& subscription)
+{
+    subscription->close();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    subscriptions.erase(subscription);
+}
+
+void mp::InstanceEventHub::close_all()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const auto& subscription : subscriptions)
+        subscription->close();
+
+    subscriptions.clear();
+}
+
+size_t mp::InstanceEventHub::num_subscriptions() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return subscriptions.size();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INSTANCE_EVENT_HUB_H
+#define MULTIPASS_INSTANCE_EVENT_HUB_H
+
+#include <multipass/rpc/multipass.grpc.pb.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace multipass
+{
+// Passes instance lifecycle events on to whoever is watching, numbering them in the order they are published.
+// Events may be published from any thread.
+class InstanceEventHub
+{
+public:
+    using Events = std::vector<InstanceEvent>;
+    using SnapshotMaker = std::function<Events()>;
+
+    class Subscription
+    {
+    public:
+        // Events describing every instance as of when the subscription was made
+        const Events& snapshot() const;
+
+        // Waits for events that came after the snapshot, returning none when there were none in time, or nothing
+        // once the subscription is closed
+        std::optional<Events> wait_for(std::chrono::milliseconds timeout);
+
+        // Whether the subscription was closed for falling too far behind
+        bool overflowed() const;
+
+    private:
+        friend class InstanceEventHub;
+
+        void push(const InstanceEvent& event);
+        void close(bool overflow = false);
+
+        Events snapshot_events;
+        mutable std::mutex mutex;
+        std::condition_variable events_came;
+        std::deque<InstanceEvent> pending_events;
+        bool closed{false};
+        bool fell_behind{false};
+    };
+
+    using SubscriptionPtr = std::shared_ptr<Subscription>;
+
+    // Numbers the event and queues it for every subscription
+    void publish(InstanceEvent event);
+
+    // Makes the snapshot while no event can be published, so that subscribers see each change exactly once:
+    // either in the snapshot or as an event after it
+    SubscriptionPtr subscribe(const SnapshotMaker& make_snapshot);
+    void unsubscribe(const SubscriptionPtr& subscription);
+
+    // Ends every subscription, for the daemon is going away
+    void close_all();
+
+    size_t num_subscriptions() const;
+
+private:
+    mutable std::mutex mutex;
+    uint64_t last_sequence{0};
+    std::unordered_set<SubscriptionPtr> subscriptions;
+};
+} // namespace multipass
+#endif // MULTIPASS_INSTANCE_EVENT_HUB_H
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "metrics_server.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+#include <multipass/metrics.h>
+
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <stdexcept>
+#include <utility>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "metrics";
+constexpr auto unix_prefix = "unix:";
+constexpr auto max_request_size = 8192; // scrapers send a handful of headers, anything longer is not one of them
+
+std::pair<QHostAddress, quint16> tcp_address_from(const QString& address)
+{
+    const auto colon = address.lastIndexOf(':');
+
+    bool ok{false};
+    const auto port = colon > 0 ? address.mid(colon + 1).toUShort(&ok) : 0;
+    if (!ok || port == 0)
+        throw std::invalid_argument{"Need a port, e.g. \"localhost:9090\""};
+
+    auto host = address.left(colon);
+    if (host == "localhost")
+        return {QHostAddress{QHostAddress::LocalHost}, port};
+
+    QHostAddress host_address{host.remove('[').remove(']')}; // IPv6 addresses come in brackets, e.g. "[::1]:9090"
+    if (!host_address.isLoopback())
+        throw std::invalid_argument{"Metrics can only be served on a loopback address"};
+
+    return {host_address, port};
+}
+
+QByteArray response_to(const QByteArray& request)
+{
+    const auto request_line = request.left(request.indexOf("\r\n")).split(' ');
+
+    QByteArray status{"200 OK"}, body;
+    if (request_line.size() < 2 || request_line[0] != "GET")
+        status = "405 Method Not Allowed";
+    else if (request_line[1] != "/metrics" && request_line[1] != "/")
+        status = "404 Not Found";
+    else
+        body = QByteArray::fromStdString(MP_METRICS.exposition());
+
+    return QByteArray::fromStdString(fmt::format("HTTP/1.1 {}\r\n"
+                                                  "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                                  "Content-Length: {}\r\n"
+                                                  "Connection: close\r\n\r\n",
+                                                  status.toStdString(), body.size())) +
+           body;
+}
+
+void disconnect_from_peer(QLocalSocket* socket)
+{
+    socket->disconnectFromServer();
+}
+
+void disconnect_from_peer(QTcpSocket* socket)
+{
+    socket->disconnectFromHost();
+}
+
+// Answers one request per connection, once its headers are in
+template <typename Socket>
+void serve(Socket* socket)
+{
+    auto request = std::make_shared<QByteArray>();
+
+    QObject::connect(socket, &Socket::disconnected, socket, &QObject::deleteLater);
+    QObject::connect(socket, &QIODevice::readyRead, socket, [socket, request] {
+        *request += socket->readAll();
+        if (request->contains("\r\n\r\n"))
+        {
+            socket->write(response_to(*request));
+            disconnect_from_peer(socket);
+        }
+        else if (request->size() > max_request_size)
+        {
+            socket->abort();
+        }
+    });
+}
+} // namespace
+
+mp::MetricsServer::MetricsServer(const QString& address)
+{
+    check_address(address);
+
+    if (address.startsWith(unix_prefix))
+    {
+        const auto path = address.mid(QString{unix_prefix}.size());
+
+        local_server = std::make_unique<QLocalServer>();
+        QLocalServer::removeServer(path); // left over from a daemon that did not get to clean up
+        if (!local_server->listen(path))
+            throw std::runtime_error{fmt::format("Cannot serve metrics on {}: {}", address.toStdString(),
+                                                 local_server->errorString().toStdString())};
+
+        QObject::connect(local_server.get(), &QLocalServer::newConnection, this, [this] {
+            while (auto socket = local_server->nextPendingConnection())
+                serve(socket);
+        });
+    }
+    else
+    {
+        const auto [host, port] = tcp_address_from(address);
+
+        tcp_server = std::make_unique<QTcpServer>();
+        if (!tcp_server->listen(host, port))
+            throw std::runtime_error{fmt::format("Cannot serve metrics on {}: {}", address.toStdString(),
+                                                 tcp_server->errorString().toStdString())};
+
+        QObject::connect(tcp_server.get(), &QTcpServer::newConnection, this, [this] {
+            while (auto socket = tcp_server->nextPendingConnection())
+                serve(socket);
+        });
+    }
+
+    MP_METRICS.set_served(true);
+    mpl::log(mpl::Level::info, category, fmt::format("Serving metrics on {}", address.toStdString()));
+}
+
+mp::MetricsServer::~MetricsServer()
+{
+    MP_METRICS.set_served(false);
+}
+
+void mp::MetricsServer::check_address(const QString& address)
+{
+    if (address.startsWith(unix_prefix))
+    {
+        if (address.size() == QString{unix_prefix}.size())
+            throw std::invalid_argument{"Need the path of a socket, e.g. \"unix:/run/multipass_metrics.socket\""};
+    }
+    else
+    {
+        tcp_address_from(address);
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_METRICS_SERVER_H
+#define MULTIPASS_METRICS_SERVER_H
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+class QLocalServer;
+class QTcpServer;
+
+namespace multipass
+{
+// Serves the metrics over HTTP, for Prometheus to scrape. It only listens locally: on a unix socket, given as
+// "unix:<path>", or on a loopback address and port, e.g. "localhost:9090".
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(const QString& address); // throws when it cannot listen there
+    ~MetricsServer();
+
+    // Throws std::invalid_argument when the address is not one that metrics can be served on
+    static void check_address(const QString& address);
+
+private:
+    std::unique_ptr<QLocalServer> local_server;
+    std::unique_ptr<QTcpServer> tcp_server;
+};
+} // namespace multipass
+#endif // MULTIPASS_METRICS_SERVER_H
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "warm_pool.h"
+
+#include <multipass/constants.h>
+#include <multipass/exceptions/invalid_memory_size_exception.h>
+#include <multipass/memory_size.h>
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+namespace
+{
+int cores_from(int requested)
+{
+    return requested < std::stoi(mp::min_cpu_cores) ? std::stoi(mp::default_cpu_cores) : requested;
+}
+
+// Sizes are compared for what they amount to, so that "1G" and "1024M" are the same. An empty one stands for the
+// default, which is only ever the same as another empty one when there is no default given.
+bool same_size(const std::string& a, const std::string& b, const char* default_size)
+{
+    if (a.empty() || b.empty())
+    {
+        if (!default_size)
+            return a.empty() && b.empty();
+
+        return same_size(a.empty() ? default_size : a, b.empty() ? default_size : b, nullptr);
+    }
+
+    try
+    {
+        return mp::MemorySize{a} == mp::MemorySize{b};
+    }
+    catch (const mp::InvalidMemorySizeException&)
+    {
+        return false;
+    }
+}
+} // namespace
+
+mp::WarmPool::WarmPool(int size, const LaunchRequest& profile) : target_size{std::max(size, 0)}, launch_profile{profile}
+{
+}
+
+int mp::WarmPool::size() const
+{
+    return target_size;
+}
+
+const mp::LaunchRequest& mp::WarmPool::profile() const
+{
+    return launch_profile;
+}
+
+bool mp::WarmPool::fits(const LaunchRequest& request) const
+{
+    if (!target_size || request.count() > 1 || !request.instance_name().empty() ||
+        !request.cloud_init_user_data().empty() || request.network_options_size())
+        return false;
+
+    return request.image() == launch_profile.image() && request.remote_name() == launch_profile.remote_name() &&
+           cores_from(request.num_cores()) == cores_from(launch_profile.num_cores()) &&
+           same_size(request.mem_size(), launch_profile.mem_size(), mp::default_memory_size) &&
+           same_size(request.disk_space(), launch_profile.disk_space(), nullptr);
+}
+
+void mp::WarmPool::add(const std::string& name)
+{
+    if (!contains(name))
+        ready_instances.push_back(name);
+}
+
+bool mp::WarmPool::remove(const std::string& name)
+{
+    auto it = std::find(ready_instances.begin(), ready_instances.end(), name);
+    if (it == ready_instances.end())
+        return false;
+
+    ready_instances.erase(it);
+    return true;
+}
+
+bool mp::WarmPool::contains(const std::string& name) const
+{
+    return std::find(ready_instances.cbegin(), ready_instances.cend(), name) != ready_instances.cend();
+}
+
+std::optional<std::string> mp::WarmPool::claim()
+{
+    if (ready_instances.empty())
+        return std::nullopt;
+
+    auto name = ready_instances.front();
+    ready_instances.pop_front();
+
+    return name;
+}
+
+int mp::WarmPool::num_ready() const
+{
+    return static_cast<int>(ready_instances.size());
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_WARM_POOL_H
+#define MULTIPASS_WARM_POOL_H
+
+#include <multipass/rpc/multipass.grpc.pb.h>
+
+#include <deque>
+#include <optional>
+#include <string>
+
+namespace multipass
+{
+// Keeps track of instances that were made ahead of the launches that are to claim them. Those are all made alike,
+// from the pool's profile, booted once and then put to rest, so that launching one only takes waking it up.
+class WarmPool
+{
+public:
+    WarmPool(int size, const LaunchRequest& profile);
+
+    // How many instances are to be kept ready; none when the pool is disabled
+    int size() const;
+
+    // What pool instances are launched with
+    const LaunchRequest& profile() const;
+
+    // Whether an instance from the pool is what the launch asks for, i.e. it asks for nothing that would only be
+    // applied on first boot, nor for anything other than the profile
+    bool fits(const LaunchRequest& request) const;
+
+    void add(const std::string& name);
+    bool remove(const std::string& name);
+    bool contains(const std::string& name) const;
+
+    // Hands out the instance that has been waiting longest, if any
+    std::optional<std::string> claim();
+    int num_ready() const;
+
+private:
+    int target_size;
+    LaunchRequest launch_profile;
+    std::deque<std::string> ready_instances;
+};
+} // namespace multipass
+#endif // MULTIPASS_WARM_POOL_H
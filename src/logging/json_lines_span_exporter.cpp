@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/logging/json_lines_span_exporter.h>
+
+#include <multipass/format.h>
+
+#include <stdexcept>
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mpl = multipass::logging;
+
+mpl::JsonLinesSpanExporter::JsonLinesSpanExporter(const QString& path, std::string service_name)
+    : service_name{std::move(service_name)}, file{path}
+{
+    // Spans tell of hosts and paths, so only the owner gets to read them, and a link is never followed to elsewhere
+    const auto mode = QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text;
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+    const auto fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                           0600);
+    if (fd < 0)
+        throw std::runtime_error(
+            fmt::format("cannot open \"{}\" to write spans to: {}", path.toStdString(), std::strerror(errno)));
+
+    const auto opened = file.open(fd, mode, QFileDevice::AutoCloseHandle);
+    if (!opened)
+        ::close(fd);
+#else
+    const auto opened = file.open(mode) && file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+#endif
+
+    if (!opened)
+        throw std::runtime_error(fmt::format("cannot open \"{}\" to write spans to: {}", path.toStdString(),
+                                             file.errorString().toStdString()));
+}
+
+void mpl::JsonLinesSpanExporter::export_span(const SpanData& span)
+{
+    // The same as an OTLP/JSON export request, with the one span in it
+    const auto line = fmt::format(R"({{"resourceSpans":[{{"resource":{{"attributes":[{{"key":"service.name","value":)"
+                                  R"({{"stringValue":"{}"}}}}]}},"scopeSpans":[{{"scope":{{"name":"multipass"}},)"
+                                  R"("spans":[{}]}}]}}]}})"
+                                  "\n",
+                                  service_name, span.to_json());
+
+    std::lock_guard<std::mutex> lock{mutex};
+    file.write(line.data(), line.size());
+    file.flush();
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/logging/trace.h>
+
+#include <multipass/format.h>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <random>
+#include <shared_mutex>
+
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto trace_id_length = 32;
+constexpr auto span_id_length = 16;
+
+std::shared_timed_mutex exporter_mutex;
+std::shared_ptr<mpl::SpanExporter> global_exporter;
+
+thread_local mpl::SpanContext current_context;
+
+bool is_hex_id(const std::string& id, size_t length)
+{
+    auto is_hex_digit = [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); };
+    return id.size() == length && std::all_of(id.cbegin(), id.cend(), is_hex_digit) &&
+           id.find_first_not_of('0') != std::string::npos; // all zeros is not a valid id
+}
+
+std::string make_id(size_t length)
+{
+    thread_local std::mt19937_64 engine{std::random_device{}()};
+
+    std::string id;
+    while (!is_hex_id(id, length))
+    {
+        id.clear();
+        while (id.size() < length)
+            id += fmt::format("{:016x}", engine());
+        id.resize(length);
+    }
+
+    return id;
+}
+
+QString unix_nanos(std::chrono::system_clock::time_point time)
+{
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch());
+    return QString::number(nanos.count());
+}
+
+std::chrono::system_clock::time_point from_unix_nanos(const QJsonValue& value)
+{
+    const std::chrono::nanoseconds nanos{value.toString().toLongLong()};
+    return std::chrono::system_clock::time_point{
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(nanos)};
+}
+} // namespace
+
+bool mpl::SpanContext::is_valid() const
+{
+    return is_hex_id(trace_id, trace_id_length) && is_hex_id(span_id, span_id_length);
+}
+
+std::string mpl::SpanContext::to_traceparent() const
+{
+    return fmt::format("00-{}-{}-01", trace_id, span_id);
+}
+
+mpl::SpanContext mpl::SpanContext::from_traceparent(const std::string& traceparent)
+{
+    // version-trace_id-span_id-flags, of which only version 00 is known
+    constexpr auto length = 2 + 1 + trace_id_length + 1 + span_id_length + 1 + 2;
+    if (traceparent.size() != length || traceparent.compare(0, 3, "00-") != 0 ||
+        traceparent[3 + trace_id_length] != '-' || traceparent[length - 3] != '-')
+        return {};
+
+    SpanContext context{traceparent.substr(3, trace_id_length),
+                        traceparent.substr(4 + trace_id_length, span_id_length)};
+    return context.is_valid() ? context : SpanContext{};
+}
+
+mpl::SpanContext mpl::current_span_context()
+{
+    return current_context;
+}
+
+mpl::ScopedSpanContext::ScopedSpanContext(SpanContext context) : previous{current_context}
+{
+    current_context = std::move(context);
+}
+
+mpl::ScopedSpanContext::~ScopedSpanContext()
+{
+    current_context = previous;
+}
+
+std::string mpl::SpanData::to_json() const
+{
+    QJsonArray json_attributes;
+    for (const auto& [key, value] : attributes)
+        json_attributes.append(QJsonObject{{"key", QString::fromStdString(key)},
+                                           {"value", QJsonObject{{"stringValue", QString::fromStdString(value)}}}});
+
+    QJsonObject span{{"traceId", QString::fromStdString(context.trace_id)},
+                     {"spanId", QString::fromStdString(context.span_id)},
+                     {"name", QString::fromStdString(name)},
+                     {"kind", 1}, // internal
+                     {"startTimeUnixNano", unix_nanos(start)},
+                     {"endTimeUnixNano", unix_nanos(end)},
+                     {"attributes", json_attributes}};
+    if (!parent_span_id.empty())
+        span.insert("parentSpanId", QString::fromStdString(parent_span_id));
+    if (failed)
+        span.insert("status", QJsonObject{{"code", 2}}); // error
+
+    return QJsonDocument{span}.toJson(QJsonDocument::Compact).toStdString();
+}
+
+std::optional<mpl::SpanData> mpl::SpanData::from_json(const std::string& json)
+{
+    const auto span = QJsonDocument::fromJson(QByteArray::fromStdString(json)).object();
+
+    SpanData data;
+    data.name = span["name"].toString().toStdString();
+    data.context = {span["traceId"].toString().toStdString(), span["spanId"].toString().toStdString()};
+    data.parent_span_id = span["parentSpanId"].toString().toStdString();
+    data.start = from_unix_nanos(span["startTimeUnixNano"]);
+    data.end = from_unix_nanos(span["endTimeUnixNano"]);
+    data.failed = span["status"].toObject()["code"].toInt() == 2;
+
+    for (const auto& attribute : span["attributes"].toArray())
+        data.attributes.emplace_back(attribute.toObject()["key"].toString().toStdString(),
+                                     attribute.toObject()["value"].toObject()["stringValue"].toString().toStdString());
+
+    if (data.name.empty() || !data.context.is_valid())
+        return std::nullopt;
+
+    return data;
+}
+
+void mpl::set_span_exporter(std::shared_ptr<SpanExporter> exporter)
+{
+    std::lock_guard<decltype(exporter_mutex)> lock{exporter_mutex};
+    global_exporter = std::move(exporter);
+}
+
+bool mpl::is_tracing()
+{
+    std::shared_lock<decltype(exporter_mutex)> lock{exporter_mutex};
+    return global_exporter != nullptr;
+}
+
+void mpl::export_span(const SpanData& span)
+{
+    std::shared_lock<decltype(exporter_mutex)> lock{exporter_mutex};
+    if (global_exporter)
+        global_exporter->export_span(span);
+}
+
+mpl::Span::Span(std::string name, const SpanContext& parent) : previous{current_context}
+{
+    data.name = std::move(name);
+    if (parent.is_valid())
+    {
+        data.context.trace_id = parent.trace_id;
+        data.parent_span_id = parent.span_id;
+    }
+    else
+    {
+        data.context.trace_id = make_id(trace_id_length);
+    }
+    data.context.span_id = make_id(span_id_length);
+    data.start = std::chrono::system_clock::now();
+
+    current_context = data.context;
+}
+
+mpl::Span::~Span()
+{
+    data.end = std::chrono::system_clock::now();
+
+    // Spans that end out of order leave alone whatever became current after them
+    if (current_context.span_id == data.context.span_id)
+        current_context = previous;
+
+    export_span(data);
+}
+
+const mpl::SpanContext& mpl::Span::context() const
+{
+    return data.context;
+}
+
+void mpl::Span::set_attribute(std::string key, std::string value)
+{
+    data.attributes.emplace_back(std::move(key), std::move(value));
+}
+
+void mpl::Span::set_failed()
+{
+    data.failed = true;
+}
@@ -22,6 +22,7 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/metrics.h>
 
 #include <QDir>
 #include <QEventLoop>
@@ -31,6 +32,7 @@
 #include <QTimer>
 #include <QUrl>
 
+#include <chrono>
 #include <memory>
 
 namespace mp = multipass;
@@ -124,6 +126,38 @@ QByteArray download(QNetworkAccessManager* manager, const Time& timeout, QUrl co
     return reply->readAll();
 }
 
+// Counts a download for the metrics: whether it went through, how much came in and how fast
+template <typename DownloadAction>
+void record_download(DownloadAction&& download_action)
+{
+    static auto& downloads = MP_METRICS.counter("multipass_downloads_total", "Downloads started");
+    static auto& failures = MP_METRICS.counter("multipass_download_failures_total", "Downloads that did not finish");
+    static auto& bytes = MP_METRICS.counter("multipass_download_bytes_total", "Bytes downloaded");
+    static auto& duration = MP_METRICS.histogram("multipass_download_duration_seconds", "How long downloads took");
+    static auto& throughput =
+        MP_METRICS.gauge("multipass_download_throughput_bytes_per_second", "How fast the last download went");
+
+    downloads.increment();
+    const auto start = std::chrono::steady_clock::now();
+
+    qint64 bytes_downloaded{0};
+    try
+    {
+        bytes_downloaded = download_action();
+    }
+    catch (...)
+    {
+        failures.increment();
+        throw;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    bytes.increment(bytes_downloaded);
+    duration.observe(elapsed);
+    if (const auto seconds = std::chrono::duration<double>(elapsed).count(); seconds > 0)
+        throughput.set(static_cast<std::int64_t>(bytes_downloaded / seconds));
+}
+
 template <typename Time>
 auto get_header(QNetworkAccessManager* manager, const QUrl& url, const QNetworkRequest::KnownHeaders header,
                 const Time& timeout)
@@ -176,6 +210,7 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
 {
     std::atomic_bool abort_download{false};
     auto manager{MP_NETMGRFACTORY.make_network_manager(cache_dir_path)};
+    qint64 bytes_downloaded{0};
 
     QFile file{file_name};
     file.open(QIODevice::ReadWrite | QIODevice::Truncate);
@@ -198,7 +233,8 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
         }
     };
 
-    auto on_download = [this, &abort_download, &file](QNetworkReply* reply, QTimer& download_timeout) {
+    auto on_download = [this, &abort_download, &file, &bytes_downloaded](QNetworkReply* reply,
+                                                                         QTimer& download_timeout) {
         abort_download = abort_download || abort_downloads;
 
         if (abort_download)
@@ -212,18 +248,26 @@ void mp::URLDownloader::download_to(const QUrl& url, const QString& file_name, i
         else
             return;
 
-        if (MP_FILEOPS.write(file, reply->readAll()) < 0)
+        const auto written = MP_FILEOPS.write(file, reply->readAll());
+        if (written < 0)
         {
             mpl::log(mpl::Level::error, category, fmt::format("error writing image: {}", file.errorString()));
             abort_download = true;
             reply->abort();
         }
+        else
+        {
+            bytes_downloaded += written;
+        }
         download_timeout.start();
     };
 
     auto on_error = [&file]() { file.remove(); };
 
-    ::download(manager.get(), timeout, url, progress_monitor, on_download, on_error, abort_download);
+    record_download([&] {
+        ::download(manager.get(), timeout, url, progress_monitor, on_download, on_error, abort_download);
+        return bytes_downloaded;
+    });
 }
 
 QByteArray mp::URLDownloader::download(const QUrl& url)
@@ -242,8 +286,14 @@ QByteArray mp::URLDownloader::download(const QUrl& url)
         download_timeout.start();
     };
 
-    return ::download(
-        manager.get(), timeout, url, [](QNetworkReply*, qint64, qint64) {}, on_download, [] {}, abort_downloads);
+    QByteArray data;
+    record_download([&] {
+        data = ::download(
+            manager.get(), timeout, url, [](QNetworkReply*, qint64, qint64) {}, on_download, [] {}, abort_downloads);
+        return data.size();
+    });
+
+    return data;
 }
 
 QDateTime mp::URLDownloader::last_modified(const QUrl& url)
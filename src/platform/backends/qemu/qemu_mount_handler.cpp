@@ -38,7 +38,8 @@ namespace
 constexpr auto category = "qemu-mount-handler";
 } // namespace
 
-mp::QemuMountHandler::QemuMountHandler(const SSHKeyProvider& ssh_key_provider) : MountHandler(ssh_key_provider)
+mp::QemuMountHandler::QemuMountHandler(const SSHKeyProvider& ssh_key_provider, Driver driver)
+    : MountHandler(ssh_key_provider), driver{driver}
 {
 }
 
@@ -62,6 +63,19 @@ void mp::QemuMountHandler::init_mount(VirtualMachine* vm, const std::string& tar
         throw std::runtime_error("Only one mapping per native mount allowed.");
     }
 
+    // virtiofsd serves files with their host ownership, it cannot translate ids like our patched 9p does
+    auto is_identity = [](const auto& mappings) {
+        return std::all_of(mappings.cbegin(), mappings.cend(), [](const auto& mapping) {
+            return mapping.first == (mapping.second == -1 ? 1000 : mapping.second);
+        });
+    };
+    if (driver == Driver::virtiofs && !(is_identity(vm_mount.uid_mappings) && is_identity(vm_mount.gid_mappings)))
+    {
+        mpl::log(mpl::Level::warning, category,
+                 fmt::format("virtiofs mounts do not support id mappings, files in '{}' will keep their host ownership",
+                             target_path));
+    }
+
     mpl::log(mpl::Level::info, category,
              fmt::format("Initializing native mount {} => {} in {}", vm_mount.source_path, target_path, vm->vm_name));
 
@@ -101,9 +115,12 @@ void mp::QemuMountHandler::start_mount(VirtualMachine* vm, ServerVariant server,
                          .replace("-", "");
     mount_tag.truncate(30);
 
-    mpu::run_in_ssh_session(session,
-                            fmt::format("sudo mount -t 9p m{} {} -o trans=virtio,version=9p2000.L,msize=536870912",
-                                        mount_tag, target_path));
+    if (driver == Driver::virtiofs)
+        mpu::run_in_ssh_session(session, fmt::format("sudo mount -t virtiofs m{} {}", mount_tag, target_path));
+    else
+        mpu::run_in_ssh_session(session,
+                                fmt::format("sudo mount -t 9p m{} {} -o trans=virtio,version=9p2000.L,msize=536870912",
+                                            mount_tag, target_path));
 }
 
 void mp::QemuMountHandler::stop_mount(const std::string& instance, const std::string& path)
@@ -27,7 +27,13 @@ class VirtualMachine;
 class QemuMountHandler : public MountHandler
 {
 public:
-    explicit QemuMountHandler(const SSHKeyProvider& ssh_key_provider);
+    enum class Driver
+    {
+        nine_p,
+        virtiofs
+    };
+
+    explicit QemuMountHandler(const SSHKeyProvider& ssh_key_provider, Driver driver = Driver::nine_p);
 
     void init_mount(VirtualMachine* vm, const std::string& target_path, const VMMount& vm_mount) override;
     void start_mount(VirtualMachine* vm, ServerVariant server, const std::string& target_path,
@@ -37,6 +43,7 @@ public:
     bool has_instance_already_mounted(const std::string& instance, const std::string& path) const override;
 
 private:
+    const Driver driver;
     std::unordered_map<std::string, std::unordered_map<std::string, VirtualMachine*>> mounts;
 };
 
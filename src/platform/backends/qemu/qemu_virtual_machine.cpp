@@ -18,19 +18,24 @@
 #include "qemu_virtual_machine.h"
 #include "qemu_vm_process_spec.h"
 #include "qemu_vmstate_process_spec.h"
+#include "virtiofsd_process_spec.h"
 
 #include <shared/qemu_img_utils/qemu_img_utils.h>
 #include <shared/shared_backend_utils.h>
 
+#include <multipass/constants.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/process/simple_process_spec.h>
+#include <multipass/settings/settings.h>
 #include <multipass/utils.h>
 #include <multipass/vm_mount.h>
 #include <multipass/vm_status_monitor.h>
 
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
@@ -42,6 +47,7 @@
 #include <QUuid>
 
 #include <cassert>
+#include <thread>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -184,6 +190,41 @@ auto generate_metadata(const QStringList& platform_args, const QStringList& proc
     metadata[arguments_key] = QJsonArray::fromStringList(proc_args);
     return metadata;
 }
+
+QString make_mount_tag(const std::string& target_path)
+{
+    // Create a reproducible unique mount tag for each mount. The cmd arg can only be 31 bytes long so part of the uuid
+    // must be truncated. First character of mount_tag must also be alpabetical.
+    auto mount_tag = QUuid::createUuidV3(QUuid(), QString::fromStdString(target_path))
+                         .toString(QUuid::WithoutBraces)
+                         .replace("-", "");
+    mount_tag.truncate(30);
+
+    return mount_tag;
+}
+
+QString virtiofsd_socket_path(const std::string& vm_name, const std::string& target_path)
+{
+    // Unix socket paths are limited to 108 bytes, so derive a short unique name from the instance and target
+    const auto hash = QCryptographicHash::hash(QByteArray::fromStdString(vm_name + ":" + target_path),
+                                               QCryptographicHash::Sha256)
+                          .toHex()
+                          .left(16);
+
+    return QDir{QDir::tempPath()}.filePath(QString("multipass-virtiofs-%1.sock").arg(QString{hash}));
+}
+
+void wait_for_virtiofsd_socket(const mp::Process& process, const QString& socket_path)
+{
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!QFile::exists(socket_path))
+    {
+        if (!process.running() || std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error(fmt::format("virtiofsd failed to set up '{}'", socket_path));
+
+        std::this_thread::sleep_for(10ms);
+    }
+}
 } // namespace
 
 mp::QemuVirtualMachine::QemuVirtualMachine(const VirtualMachineDescription& desc, QemuPlatform* qemu_platform,
@@ -234,7 +275,8 @@ mp::QemuVirtualMachine::~QemuVirtualMachine()
     {
         update_shutdown_status = false;
 
-        if (state == State::running)
+        // vhost-user-fs devices cannot be migrated, so instances with virtiofs mounts cannot be suspended
+        if (state == State::running && virtiofsd_specs.empty())
         {
             suspend();
         }
@@ -261,6 +303,7 @@ void mp::QemuVirtualMachine::start()
     {
         monitor->update_metadata_for(
             vm_name, generate_metadata(qemu_platform->vmstate_platform_args(), vm_process->arguments()));
+        start_virtiofsd_processes();
     }
 
     vm_process->start();
@@ -294,48 +337,28 @@ void mp::QemuVirtualMachine::stop()
 
 void mp::QemuVirtualMachine::shutdown()
 {
-    if (state == State::suspended)
-    {
-        mpl::log(mpl::Level::info, vm_name, fmt::format("Ignoring shutdown issued while suspended"));
-    }
-    else if ((state == State::running || state == State::delayed_shutdown || state == State::unknown) &&
-             vm_process->running())
-    {
-        vm_process->write(qmp_execute_json("system_powerdown"));
+    if (send_powerdown())
         vm_process->wait_for_finished();
-    }
-    else
-    {
-        if (state == State::starting)
-            update_shutdown_status = false;
-
-        if (vm_process)
-        {
-            vm_process->kill();
-        }
-    }
 }
 
 void mp::QemuVirtualMachine::suspend()
 {
-    if ((state == State::running || state == State::delayed_shutdown) && vm_process->running())
+    if (send_savevm())
     {
-        if (update_shutdown_status)
-        {
-            state = State::suspending;
-            update_state();
-            update_shutdown_status = false;
-        }
-
-        vm_process->write(hmc_to_qmp_json("savevm " + QString::fromStdString(suspend_tag)));
         vm_process->wait_for_finished();
         vm_process.reset(nullptr);
     }
-    else if (state == State::off || state == State::suspended)
-    {
-        mpl::log(mpl::Level::info, vm_name, fmt::format("Ignoring suspend issued while stopped/suspended"));
-        monitor->on_suspend();
-    }
+}
+
+void mp::QemuVirtualMachine::request_shutdown()
+{
+    send_powerdown();
+}
+
+void mp::QemuVirtualMachine::request_suspend()
+{
+    // The process is killed once the state is saved, and replaced on the next start
+    send_savevm();
 }
 
 mp::VirtualMachine::State mp::QemuVirtualMachine::current_state()
@@ -383,6 +406,7 @@ void mp::QemuVirtualMachine::on_shutdown()
     management_ip = std::nullopt;
     update_state();
     vm_process.reset(nullptr);
+    virtiofsd_processes.clear();
     lock.unlock();
     monitor->on_shutdown();
 }
@@ -405,6 +429,60 @@ void mp::QemuVirtualMachine::on_restart()
     monitor->on_restart(vm_name);
 }
 
+// Returns whether the guest was asked to power off, which is done when the process finishes
+bool mp::QemuVirtualMachine::send_powerdown()
+{
+    if (state == State::suspended)
+    {
+        mpl::log(mpl::Level::info, vm_name, fmt::format("Ignoring shutdown issued while suspended"));
+    }
+    else if ((state == State::running || state == State::delayed_shutdown || state == State::unknown) &&
+             vm_process->running())
+    {
+        vm_process->write(qmp_execute_json("system_powerdown"));
+        return true;
+    }
+    else
+    {
+        if (state == State::starting)
+            update_shutdown_status = false;
+
+        if (vm_process)
+        {
+            vm_process->kill();
+        }
+    }
+
+    return false;
+}
+
+// Returns whether QEMU was asked to save the state, which is done when the process finishes
+bool mp::QemuVirtualMachine::send_savevm()
+{
+    if ((state == State::running || state == State::delayed_shutdown) && vm_process->running())
+    {
+        if (!virtiofsd_specs.empty())
+            throw std::runtime_error("Cannot suspend an instance with virtiofs mounts, please stop it instead.");
+
+        if (update_shutdown_status)
+        {
+            state = State::suspending;
+            update_state();
+            update_shutdown_status = false;
+        }
+
+        vm_process->write(hmc_to_qmp_json("savevm " + QString::fromStdString(suspend_tag)));
+        return true;
+    }
+    else if (state == State::off || state == State::suspended)
+    {
+        mpl::log(mpl::Level::info, vm_name, fmt::format("Ignoring suspend issued while stopped/suspended"));
+        monitor->on_suspend();
+    }
+
+    return false;
+}
+
 void mp::QemuVirtualMachine::ensure_vm_is_running()
 {
     if (is_starting_from_suspend)
@@ -565,6 +643,28 @@ void mp::QemuVirtualMachine::initialize_vm_process()
     });
 }
 
+void mp::QemuVirtualMachine::start_virtiofsd_processes()
+{
+    virtiofsd_processes.clear();
+
+    for (const auto& [target_path, spec] : virtiofsd_specs)
+    {
+        QFile::remove(spec.socket_path()); // in case a previous virtiofsd did not clean up after itself
+
+        auto process = mp::platform::make_process(std::make_unique<VirtiofsdProcessSpec>(spec));
+        mpl::log(mpl::Level::debug, vm_name,
+                 fmt::format("Starting virtiofsd for '{}': {}", target_path, process->arguments().join(" ")));
+
+        process->start();
+        if (!process->wait_for_started())
+            throw std::runtime_error(fmt::format("failed to start virtiofsd for '{}': {}", target_path,
+                                                 process->process_state().failure_message()));
+
+        wait_for_virtiofsd_socket(*process, spec.socket_path());
+        virtiofsd_processes.push_back(std::move(process));
+    }
+}
+
 void mp::QemuVirtualMachine::update_cpus(int num_cores)
 {
     assert(num_cores > 0);
@@ -586,12 +686,23 @@ void mp::QemuVirtualMachine::resize_disk(const MemorySize& new_size)
 
 void mp::QemuVirtualMachine::add_vm_mount(const std::string& target_path, const VMMount& vm_mount)
 {
-    // Create a reproducible unique mount tag for each mount. The cmd arg can only be 31 bytes long so part of the uuid
-    // must be truncated. First character of mount_tag must also be alpabetical.
-    auto mount_tag = QUuid::createUuidV3(QUuid(), QString::fromStdString(target_path))
-                         .toString(QUuid::WithoutBraces)
-                         .replace("-", "");
-    mount_tag.truncate(30);
+    const auto mount_tag = make_mount_tag(target_path);
+    virtiofsd_specs.erase(target_path);
+
+    if (MP_SETTINGS.get(mp::native_mounts_driver_key) == "virtiofs")
+    {
+        const auto socket_path = virtiofsd_socket_path(vm_name, target_path);
+        const VirtiofsdProcessSpec::Options options{MP_SETTINGS.get(mp::virtiofs_cache_key),
+                                                    MP_SETTINGS.get_as<int>(mp::virtiofs_threads_key)};
+
+        virtiofsd_specs.emplace(target_path,
+                                VirtiofsdProcessSpec{vm_name, mount_tag, socket_path, vm_mount.source_path, options});
+        mount_args[target_path] = std::make_pair(
+            vm_mount.source_path,
+            QStringList{{"-chardev", QString("socket,id=vfs%1,path=%2").arg(mount_tag, socket_path), "-device",
+                         QString("vhost-user-fs-pci,queue-size=1024,chardev=vfs%1,tag=m%1").arg(mount_tag)}});
+        return;
+    }
 
     mount_args[target_path] = std::make_pair(
         vm_mount.source_path,
@@ -616,4 +727,5 @@ void mp::QemuVirtualMachine::add_vm_mount(const std::string& target_path, const
 void mp::QemuVirtualMachine::delete_vm_mount(const std::string& target_path)
 {
     mount_args.erase(target_path);
+    virtiofsd_specs.erase(target_path);
 }
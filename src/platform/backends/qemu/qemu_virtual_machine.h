@@ -19,6 +19,7 @@
 #define MULTIPASS_QEMU_VIRTUAL_MACHINE_H
 
 #include "qemu_platform.h"
+#include "virtiofsd_process_spec.h"
 
 #include <shared/base_virtual_machine.h>
 
@@ -29,6 +30,7 @@
 #include <QStringList>
 
 #include <unordered_map>
+#include <vector>
 
 namespace multipass
 {
@@ -46,6 +48,8 @@ public:
     void stop() override;
     void shutdown() override;
     void suspend() override;
+    void request_shutdown() override;
+    void request_suspend() override;
     State current_state() override;
     int ssh_port() override;
     std::string ssh_hostname(std::chrono::milliseconds timeout) override;
@@ -71,11 +75,16 @@ private:
     void on_shutdown();
     void on_suspend();
     void on_restart();
+    bool send_powerdown();
+    bool send_savevm();
     void initialize_vm_process();
+    void start_virtiofsd_processes();
 
     VirtualMachineDescription desc;
     std::unique_ptr<Process> vm_process{nullptr};
     std::unordered_map<std::string, std::pair<std::string, QStringList>> mount_args;
+    std::unordered_map<std::string, VirtiofsdProcessSpec> virtiofsd_specs;
+    std::vector<std::unique_ptr<Process>> virtiofsd_processes;
     const std::string mac_addr;
     const std::string username;
     QemuPlatform* qemu_platform;
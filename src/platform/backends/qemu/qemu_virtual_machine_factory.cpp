@@ -19,10 +19,12 @@
 #include "qemu_mount_handler.h"
 #include "qemu_virtual_machine.h"
 
+#include <multipass/constants.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
 #include <multipass/platform.h>
 #include <multipass/process/simple_process_spec.h>
+#include <multipass/settings/settings.h>
 #include <multipass/virtual_machine_description.h>
 
 #include <shared/qemu_img_utils/qemu_img_utils.h>
@@ -66,6 +68,11 @@ void mp::QemuVirtualMachineFactory::prepare_instance_image(const mp::VMImage& in
     mp::backend::resize_instance_image(desc.disk_space, instance_image.image_path);
 }
 
+void mp::QemuVirtualMachineFactory::clone_instance_image(const VMImage& source_image, const VMImage& destination_image)
+{
+    mp::backend::link_clone_instance_image(source_image.image_path, destination_image.image_path);
+}
+
 void mp::QemuVirtualMachineFactory::hypervisor_health_check()
 {
     qemu_platform->platform_health_check();
@@ -123,5 +130,8 @@ auto mp::QemuVirtualMachineFactory::networks() const -> std::vector<NetworkInter
 std::unique_ptr<mp::MountHandler>
 mp::QemuVirtualMachineFactory::create_performance_mount_handler(const SSHKeyProvider& ssh_key_provider)
 {
-    return std::make_unique<QemuMountHandler>(ssh_key_provider);
+    const auto driver = MP_SETTINGS.get(mp::native_mounts_driver_key) == "virtiofs" ? QemuMountHandler::Driver::virtiofs
+                                                                                     : QemuMountHandler::Driver::nine_p;
+
+    return std::make_unique<QemuMountHandler>(ssh_key_provider, driver);
 }
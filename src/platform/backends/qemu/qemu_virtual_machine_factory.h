@@ -38,6 +38,7 @@ public:
     void remove_resources_for(const std::string& name) override;
     VMImage prepare_source_image(const VMImage& source_image) override;
     void prepare_instance_image(const VMImage& instance_image, const VirtualMachineDescription& desc) override;
+    void clone_instance_image(const VMImage& source_image, const VMImage& destination_image) override;
     void hypervisor_health_check() override;
     QString get_backend_version_string() override;
     QString get_backend_directory_name() override;
@@ -23,10 +23,27 @@
 #include <multipass/snap_utils.h>
 #include <shared/linux/backend_utils.h>
 
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mu = multipass::utils;
 
+namespace
+{
+using MountArgs = std::unordered_map<std::string, std::pair<std::string, QStringList>>;
+
+bool needs_shared_memory(const MountArgs& mount_args)
+{
+    // vhost-user backends like virtiofsd map the guest RAM, so it has to be backed by shareable memory
+    return std::any_of(mount_args.cbegin(), mount_args.cend(),
+                       [](const auto& it) { return !it.second.second.filter("vhost-user-fs-pci").isEmpty(); });
+}
+} // namespace
+
 mp::QemuVMProcessSpec::QemuVMProcessSpec(
     const mp::VirtualMachineDescription& desc, const QStringList& platform_args,
     const std::unordered_map<std::string, std::pair<std::string, QStringList>>& mount_args,
@@ -93,6 +110,12 @@ QStringList mp::QemuVMProcessSpec::arguments() const
 
         for (auto& it : mount_args)
             args << it.second.second;
+
+        if (needs_shared_memory(mount_args))
+        {
+            args << "-object" << QString("memory-backend-memfd,id=mem,size=%1,share=on").arg(mem_size) << "-numa"
+                 << "node,memdev=mem";
+        }
     }
 
     return args;
@@ -173,6 +196,7 @@ profile %1 flags=(attach_disconnected) {
   # Disk images
   %6 rwk,  # QCow2 filesystem image
   %7 rk,   # cloud-init ISO
+  %9 rk,   # backing images, shared with linked clones
 
   # allow full access just to user-specified mount directories on the host
   %8
@@ -189,6 +213,13 @@ profile %1 flags=(attach_disconnected) {
     {
         mount_dirs += QString::fromStdString(it.second.first) + "/ rw,\n  ";
         mount_dirs += QString::fromStdString(it.second.first) + "/** rwlk,\n  ";
+
+        // virtiofs mounts are served by virtiofsd, qemu only needs to reach its vhost-user socket
+        for (const auto& arg : it.second.second)
+        {
+            if (arg.startsWith("socket,"))
+                mount_dirs += arg.section("path=", 1) + " rw,\n  ";
+        }
     }
 
     try
@@ -203,8 +234,10 @@ profile %1 flags=(attach_disconnected) {
         firmware = "/usr/share/{seabios,ovmf,qemu-efi}/*";
     }
 
+    const auto backing_images = QFileInfo{desc.image.image_path}.absoluteDir().filePath("backing-*.qcow2");
+
     return profile_template.arg(apparmor_profile_name(), signal_peer, firmware, root_dir, program(),
-                                desc.image.image_path, desc.cloud_init_iso, mount_dirs);
+                                desc.image.image_path, desc.cloud_init_iso, mount_dirs, backing_images);
 }
 
 QString mp::QemuVMProcessSpec::identifier() const
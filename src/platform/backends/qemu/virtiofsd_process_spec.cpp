@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "virtiofsd_process_spec.h"
+
+#include <multipass/exceptions/snap_environment_exception.h>
+#include <multipass/snap_utils.h>
+
+namespace mp = multipass;
+namespace mu = multipass::utils;
+
+namespace
+{
+QString root_dir()
+{
+    try
+    {
+        return mu::snap_dir();
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        return QString();
+    }
+}
+} // namespace
+
+mp::VirtiofsdProcessSpec::VirtiofsdProcessSpec(const std::string& instance, const QString& mount_tag,
+                                               const QString& socket_path, const std::string& source_path,
+                                               const Options& options)
+    : instance{instance}, mount_tag{mount_tag}, socket{socket_path}, source_path{source_path}, options{options}
+{
+}
+
+QString mp::VirtiofsdProcessSpec::program() const
+{
+    // virtiofsd is built alongside qemu and installed in its libexec directory, both in the snap and in distro packages
+    return root_dir() + "/usr/lib/qemu/virtiofsd";
+}
+
+QStringList mp::VirtiofsdProcessSpec::arguments() const
+{
+    // fuse options are comma separated, so any comma in the path needs escaping
+    auto source = QString::fromStdString(source_path).replace(",", "\\,");
+
+    QStringList args;
+    args << QString("--socket-path=%1").arg(socket) << "-o" << QString("source=%1").arg(source) << "-o"
+         << QString("cache=%1").arg(options.cache_mode)
+         // We are already confined by AppArmor and run as root, chroot is enough and works inside the snap
+         << "-o"
+         << "sandbox=chroot";
+
+    if (options.thread_pool_size > 0)
+        args << QString("--thread-pool-size=%1").arg(options.thread_pool_size);
+
+    return args;
+}
+
+mp::logging::Level mp::VirtiofsdProcessSpec::error_log_level() const
+{
+    return mp::logging::Level::debug;
+}
+
+QString mp::VirtiofsdProcessSpec::apparmor_profile() const
+{
+    QString profile_template(R"END(
+#include <tunables/global>
+profile %1 flags=(attach_disconnected) {
+  #include <abstractions/base>
+  #include <abstractions/nameservice>
+
+  # virtiofsd serves the guest with the permissions of the host files, so it needs to be able to
+  # act on behalf of any user, but only inside the host directory the user has chosen to share.
+  capability chown,
+  capability dac_override,
+  capability dac_read_search,
+  capability fowner,
+  capability fsetid,
+  capability mknod,
+  capability setfcap,
+  capability setgid,
+  capability setuid,
+  capability sys_chroot,
+  capability sys_resource,
+
+  # vhost-user socket shared with qemu
+  unix (create, bind, listen, accept, send, receive, getattr, setopt),
+  %3 rw,
+
+  # Allow multipassd send virtiofsd signals
+  signal (receive) peer=%2,
+
+  @{PROC}/sys/fs/file-max r,
+  @{PROC}/@{pid}/fd/ r,
+  owner @{PROC}/@{pid}/mountinfo r,
+
+  # binary and its libs
+  %4 ixr,
+  %5/{,usr/}lib/{,@{multiarch}/}{,**/}*.so* rm,
+
+  # CLASSIC ONLY: need to specify required libs from core snap
+  /{,var/lib/snapd/}snap/core18/*/{,usr/}lib/@{multiarch}/{,**/}*.so* rm,
+
+  # allow full access just to this user-specified source directory on the host
+  %6/ rw,
+  %6/** rwlk,
+}
+    )END");
+
+    QString signal_peer; // if snap confined, specify only multipassd can kill virtiofsd
+
+    try
+    {
+        mu::snap_dir();
+        signal_peer = "snap.multipass.multipassd";
+    }
+    catch (const mp::SnapEnvironmentException&)
+    {
+        signal_peer = "unconfined";
+    }
+
+    return profile_template.arg(apparmor_profile_name(), signal_peer, socket, program(), root_dir(),
+                                QString::fromStdString(source_path));
+}
+
+QString mp::VirtiofsdProcessSpec::identifier() const
+{
+    return QString::fromStdString(instance) + "." + mount_tag;
+}
+
+const QString& mp::VirtiofsdProcessSpec::socket_path() const
+{
+    return socket;
+}
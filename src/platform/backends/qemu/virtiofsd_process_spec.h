@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_VIRTIOFSD_PROCESS_SPEC_H
+#define MULTIPASS_VIRTIOFSD_PROCESS_SPEC_H
+
+#include <multipass/process/process_spec.h>
+
+#include <string>
+
+namespace multipass
+{
+
+class VirtiofsdProcessSpec : public ProcessSpec
+{
+public:
+    struct Options
+    {
+        QString cache_mode;   // one of none, auto or always
+        int thread_pool_size; // 0 leaves the decision to virtiofsd
+    };
+
+    VirtiofsdProcessSpec(const std::string& instance, const QString& mount_tag, const QString& socket_path,
+                         const std::string& source_path, const Options& options);
+
+    QString program() const override;
+    QStringList arguments() const override;
+    logging::Level error_log_level() const override;
+
+    QString apparmor_profile() const override;
+    QString identifier() const override;
+
+    const QString& socket_path() const;
+
+private:
+    const std::string instance;
+    const QString mount_tag;
+    const QString socket;
+    const std::string source_path;
+    const Options options;
+};
+
+} // namespace multipass
+
+#endif // MULTIPASS_VIRTIOFSD_PROCESS_SPEC_H
@@ -60,6 +60,11 @@ public:
 
     void configure(VirtualMachineDescription& vm_desc) override;
 
+    void clone_instance_image(const VMImage& /*source_image*/, const VMImage& /*destination_image*/) override
+    {
+        throw NotImplementedOnThisBackendException{"clone"};
+    }
+
     std::vector<NetworkInterfaceInfo> networks() const override
     {
         throw NotImplementedOnThisBackendException("networks");
@@ -19,6 +19,7 @@
 #define MULTIPASS_BASE_VM_IMAGE_VAULT_H
 
 #include <multipass/exceptions/image_vault_exceptions.h>
+#include <multipass/exceptions/not_implemented_on_this_backend_exception.h>
 #include <multipass/format.h>
 #include <multipass/query.h>
 #include <multipass/vm_image.h>
@@ -69,6 +70,11 @@ public:
         return images_info;
     };
 
+    VMImage clone(const std::string& /*source_name*/, const std::string& /*destination_name*/) override
+    {
+        throw NotImplementedOnThisBackendException{"clone"};
+    }
+
 protected:
     virtual VMImageInfo info_for(const Query& query) const
     {
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "inotify_path_watcher.h"
+
+#include <multipass/format.h>
+#include <multipass/logging/log.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "path watcher";
+constexpr auto watched_events = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF |
+                                IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+// Every mount has a watcher of its own, all of them under the same user as the daemon's, so each keeps to a share
+constexpr auto max_watches_per_watcher = 8192u;
+constexpr auto share_of_user_watches = 16u;
+constexpr auto user_watches_file = "/proc/sys/fs/inotify/max_user_watches";
+
+int make_inotify_fd()
+{
+    auto fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error(fmt::format("Could not initialize inotify: {}", strerror(errno)));
+
+    return fd;
+}
+
+std::size_t default_max_watches()
+{
+    std::size_t user_watches{max_watches_per_watcher};
+    if (std::ifstream file{user_watches_file}; !(file >> user_watches))
+        user_watches = max_watches_per_watcher;
+
+    return std::min<std::size_t>(max_watches_per_watcher, user_watches / share_of_user_watches);
+}
+} // namespace
+
+mp::InotifyPathWatcher::InotifyPathWatcher() : InotifyPathWatcher(default_max_watches())
+{
+}
+
+mp::InotifyPathWatcher::InotifyPathWatcher(std::size_t max_watches)
+    : inotify_fd{make_inotify_fd()}, max_watches{max_watches}
+{
+}
+
+mp::InotifyPathWatcher::~InotifyPathWatcher()
+{
+    close(inotify_fd);
+}
+
+bool mp::InotifyPathWatcher::watch(const std::string& dir)
+{
+    if (descriptors_by_dir.find(dir) != descriptors_by_dir.end())
+        return true;
+
+    if (descriptors_by_dir.size() >= max_watches)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("Cannot watch '{}': {} watched already", dir, max_watches));
+        return false;
+    }
+
+    auto wd = inotify_add_watch(inotify_fd, dir.c_str(), watched_events);
+    if (wd < 0)
+    {
+        // Most likely out of watches (see fs.inotify.max_user_watches), or the directory is gone
+        mpl::log(mpl::Level::trace, category, fmt::format("Cannot watch '{}': {}", dir, strerror(errno)));
+        return false;
+    }
+
+    // Already watched under another name, changes can only be reported with that one
+    if (dirs_by_descriptor.find(wd) != dirs_by_descriptor.end())
+        return false;
+
+    dirs_by_descriptor[wd] = dir;
+    descriptors_by_dir[dir] = wd;
+
+    return true;
+}
+
+void mp::InotifyPathWatcher::unwatch(const std::string& dir)
+{
+    auto it = descriptors_by_dir.find(dir);
+    if (it == descriptors_by_dir.end())
+        return;
+
+    inotify_rm_watch(inotify_fd, it->second);
+    dirs_by_descriptor.erase(it->second);
+    descriptors_by_dir.erase(it);
+}
+
+void mp::InotifyPathWatcher::clear()
+{
+    for (const auto& [wd, dir] : dirs_by_descriptor)
+        inotify_rm_watch(inotify_fd, wd);
+
+    dirs_by_descriptor.clear();
+    descriptors_by_dir.clear();
+}
+
+std::optional<std::vector<std::string>> mp::InotifyPathWatcher::changed_paths()
+{
+    std::vector<std::string> paths;
+    bool lost_track{false};
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (auto ptr = buffer; ptr < buffer + length;)
+        {
+            const auto event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            // When directories move, the watches below them keep reporting their old paths
+            if (event->mask & IN_Q_OVERFLOW || event->mask & IN_MOVE_SELF ||
+                (event->mask & IN_ISDIR && event->mask & (IN_MOVED_FROM | IN_MOVED_TO)))
+            {
+                lost_track = true;
+                continue;
+            }
+
+            auto it = dirs_by_descriptor.find(event->wd);
+            if (it == dirs_by_descriptor.end())
+                continue;
+
+            paths.push_back(event->len ? fmt::format("{}/{}", it->second, event->name) : it->second);
+
+            if (event->mask & IN_IGNORED) // the watch is gone, e.g. the directory was removed
+            {
+                descriptors_by_dir.erase(it->second);
+                dirs_by_descriptor.erase(it);
+            }
+        }
+    }
+
+    if (lost_track)
+    {
+        clear();
+        return std::nullopt;
+    }
+
+    return paths;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_INOTIFY_PATH_WATCHER_H
+#define MULTIPASS_INOTIFY_PATH_WATCHER_H
+
+#include <multipass/path_watcher.h>
+
+#include <cstddef>
+#include <unordered_map>
+
+namespace multipass
+{
+class InotifyPathWatcher : public PathWatcher
+{
+public:
+    InotifyPathWatcher(); // throws std::runtime_error if inotify is not available
+    explicit InotifyPathWatcher(std::size_t max_watches);
+    ~InotifyPathWatcher() override;
+
+    bool watch(const std::string& dir) override;
+    void unwatch(const std::string& dir) override;
+    void clear() override;
+    std::optional<std::vector<std::string>> changed_paths() override;
+
+private:
+    const int inotify_fd;
+    const std::size_t max_watches; // watches count against the user's limit, which others need too
+    std::unordered_map<int, std::string> dirs_by_descriptor;
+    std::unordered_map<std::string, int> descriptors_by_dir;
+};
+} // namespace multipass
+
+#endif // MULTIPASS_INOTIFY_PATH_WATCHER_H
@@ -127,6 +127,24 @@ std::unique_ptr<mp::Process> mp::ProcessFactory::create_process(std::unique_ptr<
     }
 }
 
+bool mp::ProcessFactory::update_confinement(const ProcessSpec& process_spec) const
+{
+    if (!apparmor || process_spec.apparmor_profile().isNull())
+        return true;
+
+    try
+    {
+        // Loading a policy under the name of one in use replaces it for the processes confined by it
+        apparmor->load_policy(process_spec.apparmor_profile().toLatin1());
+        return true;
+    }
+    catch (const mp::AppArmorException& e)
+    {
+        mpl::log(mpl::Level::warning, "apparmor", e.what());
+        return false;
+    }
+}
+
 std::unique_ptr<mp::Process> mp::ProcessFactory::create_process(const QString& command,
                                                                 const QStringList& arguments) const
 {
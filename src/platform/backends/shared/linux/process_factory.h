@@ -38,6 +38,8 @@ public:
 
     virtual std::unique_ptr<Process> create_process(std::unique_ptr<ProcessSpec>&& process_spec) const;
     std::unique_ptr<Process> create_process(const QString& command, const QStringList& args = QStringList()) const;
+    // Reloads the confinement of the running processes of process_spec's profile; returns whether it is in place
+    bool update_confinement(const ProcessSpec& process_spec) const;
 
 private:
     const std::optional<AppArmor> apparmor;
@@ -18,18 +18,44 @@
 #include "qemu_img_utils.h"
 
 #include <multipass/constants.h>
+#include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/memory_size.h>
 #include <multipass/platform.h>
 #include <multipass/process/qemuimg_process_spec.h>
 
+#include <QDir>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QString>
 #include <QStringList>
+#include <QUuid>
 
 namespace mp = multipass;
 
+namespace
+{
+constexpr auto backing_image_pattern = "backing-*.qcow2";
+
+void create_overlay(const QString& backing_image_name, const mp::Path& overlay_path)
+{
+    // The backing image is named relative to the overlay, which finds it among its own links
+    const auto overlay_dir = QFileInfo{overlay_path}.absoluteDir();
+    QStringList qemuimg_parameters{{"create", "-f", "qcow2", "-F", "qcow2", "-b", backing_image_name, overlay_path}};
+    auto qemuimg_process = mp::platform::make_process(std::make_unique<mp::QemuImgProcessSpec>(
+        qemuimg_parameters, overlay_dir.filePath(backing_image_pattern), overlay_path));
+
+    auto process_state = qemuimg_process->execute();
+    if (!process_state.completed_successfully())
+    {
+        throw std::runtime_error(fmt::format("Cannot create overlay image: qemu-img failed ({}) with output:\n{}",
+                                             process_state.failure_message(),
+                                             qemuimg_process->read_all_standard_error()));
+    }
+}
+} // namespace
+
 void mp::backend::resize_instance_image(const MemorySize& disk_space, const mp::Path& image_path)
 {
     auto disk_size = QString::number(disk_space.in_bytes()); // format documented in `man qemu-img` (look for "size")
@@ -87,3 +113,43 @@ mp::Path mp::backend::convert_to_qcow_if_necessary(const mp::Path& image_path)
         return image_path;
     }
 }
+
+void mp::backend::link_clone_instance_image(const Path& source_image_path, const Path& destination_image_path)
+{
+    const auto source_dir = QFileInfo{source_image_path}.absoluteDir();
+    const auto destination_dir = QFileInfo{destination_image_path}.absoluteDir();
+    const auto backing_image_name =
+        QString{backing_image_pattern}.replace("*", QUuid::createUuid().toString(QUuid::WithoutBraces));
+    const auto backing_image_path = source_dir.filePath(backing_image_name);
+
+    QFile source_image{source_image_path};
+    if (!MP_FILEOPS.rename(source_image, backing_image_path))
+        throw std::runtime_error(fmt::format("Cannot turn {} into a backing image: {}", source_image_path,
+                                             source_image.errorString()));
+
+    try
+    {
+        create_overlay(backing_image_name, source_image_path);
+    }
+    catch (...)
+    {
+        QFile backing_image{backing_image_path};
+        MP_FILEOPS.rename(backing_image, source_image_path);
+        throw;
+    }
+
+    QFile backing_image{backing_image_path};
+    MP_FILEOPS.setPermissions(backing_image, QFileDevice::ReadOwner | QFileDevice::ReadGroup);
+
+    // The source may itself be a clone, so the whole chain of backing images goes along
+    for (const auto& name : source_dir.entryList({backing_image_pattern}, QDir::Files))
+    {
+        std::error_code err;
+        const auto link_path = destination_dir.filePath(name);
+        MP_FILEOPS.create_hard_link(source_dir.filePath(name).toStdString(), link_path.toStdString(), err);
+        if (err)
+            throw std::runtime_error(fmt::format("Cannot link backing image {}: {}", name, err.message()));
+    }
+
+    create_overlay(backing_image_name, destination_image_path);
+}
@@ -28,6 +28,11 @@ namespace backend
 {
 void resize_instance_image(const MemorySize& disk_space, const multipass::Path& image_path);
 Path convert_to_qcow_if_necessary(const Path& image_path);
+
+// Turns the source image into a read-only backing image and gives the source and destination a qcow2 overlay each, at
+// their own paths. The backing image is hard-linked next to every overlay that needs it, so it lives for as long as one
+// of them does.
+void link_clone_instance_image(const Path& source_image_path, const Path& destination_image_path);
 } // namespace backend
 } // namespace multipass
 #endif // MULTIPASS_QEMU_IMG_UTILS_H
@@ -41,6 +41,15 @@ QString serialise_id_mappings(const mp::id_mappings& xid_mappings)
     return out;
 }
 
+QStringList source_paths_of(const mp::SSHFSServerConfig& config)
+{
+    QStringList paths{QString::fromStdString(config.source_path)};
+    for (const auto& mount : config.additional_mounts)
+        paths << QString::fromStdString(mount.source_path);
+
+    return paths;
+}
+
 QByteArray gen_hash(const std::string& path)
 {
     // need to return unique name for each mount.  The target directory string will be unique,
@@ -61,17 +70,33 @@ QString mp::SSHFSServerProcessSpec::program() const
 
 QStringList mp::SSHFSServerProcessSpec::arguments() const
 {
-    return QStringList() << QString::fromStdString(config.host) << QString::number(config.port)
+    auto arguments = QStringList() << QString::fromStdString(config.host) << QString::number(config.port)
                          << QString::fromStdString(config.username) << QString::fromStdString(config.source_path)
                          << QString::fromStdString(config.target_path) << serialise_id_mappings(config.uid_mappings)
                          << serialise_id_mappings(config.gid_mappings)
                          << QString::number(static_cast<int>(mp::logging::get_logging_level()));
+
+    for (const auto& mount : config.additional_mounts)
+        arguments << QString::fromStdString(mount.source_path) << QString::fromStdString(mount.target_path)
+                  << serialise_id_mappings(mount.uid_mappings) << serialise_id_mappings(mount.gid_mappings);
+
+    return arguments;
 }
 
 QProcessEnvironment mp::SSHFSServerProcessSpec::environment() const
 {
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert("KEY", QString::fromStdString(config.private_key));
+    if (!config.sshfs_exec_line.empty())
+        env.insert("SSHFS_EXEC_LINE", QString::fromStdString(config.sshfs_exec_line));
+    if (config.profile == mp::VMMount::Profile::Throughput)
+        env.insert("SSHFS_PROFILE", "throughput");
+    if (config.report_sftp_stats)
+        env.insert("SSHFS_REPORT_STATS", "1");
+    if (!config.trace_parent.empty())
+        env.insert("SSHFS_TRACE_PARENT", QString::fromStdString(config.trace_parent));
+    if (config.shared_server)
+        env.insert("SSHFS_SHARED_SERVER", "1");
     return env;
 }
 
@@ -116,10 +141,8 @@ profile %1 flags=(attach_disconnected) {
     # CLASSIC ONLY: need to specify required libs from core snap
     /{,var/lib/snapd/}snap/core18/*/{,usr/}lib/@{multiarch}/{,**/}*.so* rm,
 
-    # allow full access just to this user-specified source directory on the host
-    %4/ rw,
-    %4/** rwlk,
-}
+    # allow full access just to the user-specified source directories on the host
+%4}
     )END");
 
     /* Customisations depending on if running inside snap or not */
@@ -140,8 +163,11 @@ profile %1 flags=(attach_disconnected) {
         signal_peer = "unconfined";
     }
 
-    return profile_template.arg(apparmor_profile_name(), signal_peer, root_dir,
-                                QString::fromStdString(config.source_path));
+    QString source_rules;
+    for (const auto& source_path : source_paths_of(config))
+        source_rules += QString("    %1/ rw,\n    %1/** rwlk,\n").arg(source_path);
+
+    return profile_template.arg(apparmor_profile_name(), signal_peer, root_dir, source_rules);
 }
 
 QString mp::SSHFSServerProcessSpec::identifier() const
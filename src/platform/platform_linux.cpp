@@ -42,6 +42,7 @@
 #include "logger/journald_logger.h"
 #include "platform_linux_detail.h"
 #include "platform_shared.h"
+#include "shared/linux/inotify_path_watcher.h"
 #include "shared/linux/process_factory.h"
 #include "shared/sshfs_server_process_spec.h"
 #include <disabled_update_prompt.h>
@@ -60,6 +61,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 namespace mu = multipass::utils;
@@ -269,6 +272,53 @@ bool mp::platform::Platform::link(const char* target, const char* link) const
     return ::link(target, link) == 0;
 }
 
+bool mp::platform::Platform::copy_file_data(int from_fd, qint64 from_offset, int to_fd, qint64 to_offset,
+                                            qint64 length) const
+{
+    loff_t in_offset = from_offset, out_offset = to_offset;
+    while (length > 0)
+    {
+        const auto copied = ::copy_file_range(from_fd, &in_offset, to_fd, &out_offset, length, 0);
+        if (copied > 0)
+        {
+            length -= copied;
+            continue;
+        }
+
+        if (copied == 0) // end of the source file
+            return true;
+
+        // Older kernels do not copy across filesystems, and some filesystems do not support it at all
+        if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP)
+            return false;
+
+        break;
+    }
+
+    std::vector<char> buffer(std::min<qint64>(length, 1048576));
+    while (length > 0)
+    {
+        const auto read = ::pread(from_fd, buffer.data(), std::min<qint64>(length, buffer.size()), in_offset);
+        if (read <= 0)
+            return read == 0;
+
+        for (ssize_t written = 0; written < read;)
+        {
+            const auto r = ::pwrite(to_fd, buffer.data() + written, read - written, out_offset);
+            if (r < 0)
+                return false;
+
+            written += r;
+            out_offset += r;
+        }
+
+        in_offset += read;
+        length -= read;
+    }
+
+    return true;
+}
+
 QDir mp::platform::Platform::get_alias_scripts_folder() const
 {
     QDir aliases_folder;
@@ -429,11 +479,29 @@ std::unique_ptr<mp::Process> mp::platform::make_sshfs_server_process(const mp::S
     return MP_PROCFACTORY.create_process(std::make_unique<mp::SSHFSServerProcessSpec>(config));
 }
 
+bool mp::platform::update_sshfs_server_confinement(const mp::SSHFSServerConfig& config)
+{
+    return MP_PROCFACTORY.update_confinement(mp::SSHFSServerProcessSpec{config});
+}
+
 std::unique_ptr<mp::Process> mp::platform::make_process(std::unique_ptr<mp::ProcessSpec>&& process_spec)
 {
     return MP_PROCFACTORY.create_process(std::move(process_spec));
 }
 
+mp::PathWatcher::UPtr mp::platform::make_path_watcher()
+{
+    try
+    {
+        return std::make_unique<InotifyPathWatcher>();
+    }
+    catch (const std::runtime_error& e)
+    {
+        mpl::log(mpl::Level::warning, category, e.what());
+        return nullptr;
+    }
+}
+
 mp::UpdatePrompt::UPtr mp::platform::make_update_prompt()
 {
     return std::make_unique<DisabledUpdatePrompt>();
@@ -79,10 +79,24 @@ void checked_set(mp::WrappedQSettings& qsettings, const QString& key, const QStr
 } // namespace
 
 mp::PersistentSettingsHandler::PersistentSettingsHandler(QString filename, SettingSpec::Set settings)
-    : filename{std::move(filename)}, settings{convert(std::move(settings))}
+    : PersistentSettingsHandler{std::move(filename), std::move(settings), nullptr}
 {
 }
 
+mp::PersistentSettingsHandler::PersistentSettingsHandler(QString filename, SettingSpec::Set settings,
+                                                         SettingsMaker make_settings)
+    : filename{std::move(filename)}, make_settings{std::move(make_settings)}, settings{convert(std::move(settings))}
+{
+}
+
+auto mp::PersistentSettingsHandler::deferred(QString filename, SettingsMaker make_settings)
+    -> std::unique_ptr<PersistentSettingsHandler>
+{
+    assert(make_settings && "can't have null settings maker");
+    return std::unique_ptr<PersistentSettingsHandler>{
+        new PersistentSettingsHandler{std::move(filename), {}, std::move(make_settings)}}; // private ctor
+}
+
 // TODO try installing yaml backend
 QString mp::PersistentSettingsHandler::get(const QString& key) const
 {
@@ -95,8 +109,9 @@ auto mp::PersistentSettingsHandler::get_setting(const QString& key) const -> con
 {
     try
     {
-        assert(settings.at(key) && "can't have null setting spec"); // TODO use a `not_null` type (e.g. gsl::not_null)
-        return *settings.at(key);
+        const auto& spec = get_settings().at(key);
+        assert(spec && "can't have null setting spec"); // TODO use a `not_null` type (e.g. gsl::not_null)
+        return *spec;
     }
     catch (const std::out_of_range&)
     {
@@ -114,8 +129,10 @@ void mp::PersistentSettingsHandler::set(const QString& key, const QString& val)
 
 std::set<QString> mp::PersistentSettingsHandler::keys() const
 {
+    const auto& specs = get_settings();
+
     std::set<QString> ret{};
-    std::transform(cbegin(settings), cend(settings), std::inserter(ret, begin(ret)),
+    std::transform(cbegin(specs), cend(specs), std::inserter(ret, begin(ret)),
                    [](const auto& elem) { return elem.first; }); // I wish get<0> worked here... maybe in C++20
 
     return ret;
@@ -136,3 +153,16 @@ auto mp::PersistentSettingsHandler::convert(SettingSpec::Set settings) -> Settin
 
     return ret;
 }
+
+auto mp::PersistentSettingsHandler::get_settings() const -> const SettingMap&
+{
+    std::call_once(settings_made, [this] {
+        if (make_settings)
+        {
+            settings = convert(make_settings());
+            make_settings = nullptr; // release whatever the maker holds on to
+        }
+    });
+
+    return settings;
+}
@@ -17,6 +17,7 @@
 
 #include <multipass/ssh/sftp_client.h>
 
+#include "sftp_sync.h"
 #include "ssh_client_key_provider.h"
 #include <multipass/file_ops.h>
 #include <multipass/logging/log.h>
@@ -24,15 +25,79 @@
 #include <multipass/ssh/throw_on_error.h>
 #include <multipass/utils.h>
 
+#include <QCryptographicHash>
+
+#include <scope_guard.hpp>
+
 #include <array>
 #include <fcntl.h>
 #include <fmt/std.h>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
 
 constexpr int file_mode = 0664;
 constexpr auto max_transfer = 65536u;
 const std::string stream_file_name{"stream_output.dat"};
 const char* log_category = "sftp";
 
+// Files smaller than this are sent whole when syncing, as the checksums would not save much
+constexpr auto min_sync_delta_size = 65536u;
+constexpr auto sync_read_size = 1048576u;
+const std::string sync_delta_suffix{".mp-sync-delta"};
+
+// Run in the instance with python3, to list the checksums of the blocks of a file, or to rebuild the file from
+// those blocks and the changes sent over. Single quotes are left out, as the script is passed in them.
+const std::string sync_helper{R"(
+import hashlib, os, struct, sys, zlib
+
+def sums(path, block_size):
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(block_size), b""):
+            print("%08x %s" % (zlib.adler32(block) & 0xffffffff, hashlib.sha256(block).hexdigest()))
+
+def patch(path, block_size, delta_path):
+    tmp_path = path + ".mp-sync"
+    with open(path, "rb") as old, open(delta_path, "rb") as delta, open(tmp_path, "wb") as new:
+        while True:
+            op = delta.read(1)
+            if not op:
+                break
+            if op == b"C":
+                (index,) = struct.unpack(">Q", delta.read(8))
+                old.seek(index * block_size)
+                new.write(old.read(block_size))
+            else:
+                (size,) = struct.unpack(">I", delta.read(4))
+                new.write(delta.read(size))
+    os.chmod(tmp_path, os.stat(path).st_mode & 0o7777)
+    os.replace(tmp_path, path)
+    os.unlink(delta_path)
+
+if sys.argv[1] == "sums":
+    sums(sys.argv[2], int(sys.argv[3]))
+else:
+    patch(sys.argv[2], int(sys.argv[3]), sys.argv[4])
+)"};
+
+namespace
+{
+template <typename T>
+void append_big_endian(std::string& buffer, T value)
+{
+    for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8)
+        buffer.push_back(static_cast<char>((value >> shift) & 0xff));
+}
+
+std::time_t to_time_t(multipass::fs::file_time_type time)
+{
+    // There is no conversion between the filesystem and system clocks before C++20, so go through their current times
+    const auto system_time = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        time - multipass::fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+    return std::chrono::system_clock::to_time_t(system_time);
+}
+} // namespace
+
 namespace multipass
 {
 namespace mpl = logging;
@@ -77,14 +142,14 @@ try
 
         auto full_target_path = MP_SFTPUTILS.get_remote_dir_target(sftp.get(), source, target_path,
                                                                    flags.testFlag(SFTPClient::Flag::MakeParent));
-        return push_dir(source, full_target_path);
+        return push_dir(source, full_target_path, flags);
     }
     else if (err)
         throw SFTPError{"cannot access {}: {}", source_path, err.message()};
 
     auto full_target_path = MP_SFTPUTILS.get_remote_file_target(sftp.get(), source, target_path,
                                                                 flags.testFlag(SFTPClient::Flag::MakeParent));
-    push_file(source, full_target_path);
+    push_file(source, full_target_path, flags);
     return true;
 }
 catch (const SFTPError& e)
@@ -120,8 +185,12 @@ catch (const SFTPError& e)
     return false;
 }
 
-void SFTPClient::push_file(const fs::path& source_path, const fs::path& target_path)
+void SFTPClient::push_file(const fs::path& source_path, const fs::path& target_path, const Flags flags)
 {
+    const auto sync = flags.testFlag(Flag::Sync);
+    if (sync && sync_file(source_path, target_path))
+        return;
+
     auto local_file = MP_FILEOPS.open_read(source_path);
     if (local_file->fail())
         throw SFTPError{"cannot open local file {}: {}", source_path, strerror(errno)};
@@ -135,6 +204,9 @@ void SFTPClient::push_file(const fs::path& source_path, const fs::path& target_p
 
     if (local_file->fail() && !local_file->eof())
         throw SFTPError{"cannot read from local file {}: {}", source_path, strerror(errno)};
+
+    if (sync)
+        set_remote_times(source_path, target_path);
 }
 
 void SFTPClient::pull_file(const fs::path& source_path, const fs::path& target_path)
@@ -154,7 +226,7 @@ void SFTPClient::pull_file(const fs::path& source_path, const fs::path& target_p
         throw SFTPError{"cannot write to local file {}: {}", target_path, strerror(errno)};
 }
 
-bool SFTPClient::push_dir(const fs::path& source_path, const fs::path& target_path)
+bool SFTPClient::push_dir(const fs::path& source_path, const fs::path& target_path, const Flags flags)
 {
     auto success = true;
     std::error_code err;
@@ -181,7 +253,7 @@ bool SFTPClient::push_dir(const fs::path& source_path, const fs::path& target_pa
             {
             case fs::file_type::regular:
             {
-                push_file(entry.path(), remote_file_path);
+                push_file(entry.path(), remote_file_path, flags);
                 break;
             }
             case fs::file_type::directory:
@@ -351,4 +423,236 @@ void SFTPClient::do_pull_file(const fs::path& source_path, std::ostream& target)
     }
 }
 
+// Brings the remote file up to date with the local one, sending only the blocks that changed. Returns false when
+// the file has to be sent whole instead.
+bool SFTPClient::sync_file(const fs::path& source_path, const fs::path& target_path)
+try
+{
+    const auto target = target_path.u8string();
+    auto remote_attr = mp_sftp_stat(sftp.get(), target.c_str());
+    if (!remote_attr || remote_attr->type != SSH_FILEXFER_TYPE_REGULAR)
+        return false;
+
+    std::error_code err;
+    const auto size = MP_FILEOPS.file_size(source_path, err);
+    const auto mtime = err ? 0 : to_time_t(MP_FILEOPS.last_write_time(source_path, err));
+    const auto perms = err ? fs::perms::none : MP_FILEOPS.status(source_path, err).permissions();
+    if (err)
+        return false;
+
+    if (remote_attr->size == size && remote_attr->mtime == static_cast<uint32_t>(mtime))
+    {
+        mpl::log(mpl::Level::debug, log_category, fmt::format("{} is unchanged, skipping", source_path));
+        if ((remote_attr->permissions & 07777) != static_cast<mode_t>(perms) &&
+            sftp_chmod(sftp.get(), target.c_str(), static_cast<mode_t>(perms)) != SSH_FX_OK)
+            throw SFTPError{"cannot set permissions for remote file {}: {}", target_path,
+                            ssh_get_error(sftp->session)};
+        return true;
+    }
+
+    if (remote_attr->size < min_sync_delta_size || size < min_sync_delta_size)
+        return false;
+
+    const auto remote_size = remote_attr->size;
+    const auto block_size = sftp_sync::block_size_for(remote_size);
+    auto sums_process = ssh_session->exec(fmt::format("python3 -c '{}' sums {} {}", sync_helper,
+                                                      utils::escape_for_shell(target), block_size));
+    const auto sums = sums_process.read_std_output();
+    if (sums_process.exit_code() != 0)
+    {
+        mpl::log(mpl::Level::debug, log_category,
+                 fmt::format("cannot get the checksums of remote file {}, sending it whole", target_path));
+        return false;
+    }
+
+    // The blocks of the remote file, by their weak checksums
+    std::unordered_multimap<uint32_t, std::pair<uint64_t, std::string>> remote_blocks;
+    std::istringstream sum_lines{sums};
+    std::string weak, strong;
+    uint64_t num_blocks = 0;
+    while (sum_lines >> weak >> strong)
+        remote_blocks.emplace(std::stoul(weak, nullptr, 16), std::make_pair(num_blocks++, strong));
+    if (num_blocks == 0)
+        return false;
+
+    const auto last_block_size = remote_size - (num_blocks - 1) * block_size;
+    auto matching_block = [&](uint32_t weak_sum, const char* data, uint64_t length) -> std::optional<uint64_t> {
+        auto [first, last] = remote_blocks.equal_range(weak_sum);
+        if (first == last)
+            return std::nullopt;
+
+        const auto strong_sum =
+            QCryptographicHash::hash(QByteArray::fromRawData(data, length), QCryptographicHash::Sha256).toHex();
+        for (auto it = first; it != last; ++it)
+        {
+            const auto& [index, block_sum] = it->second;
+            const auto expected_length = index == num_blocks - 1 ? last_block_size : block_size;
+            if (expected_length == length && block_sum == strong_sum.toStdString())
+                return index;
+        }
+
+        return std::nullopt;
+    };
+
+    auto local_file = MP_FILEOPS.open_read(source_path);
+    if (local_file->fail())
+        return false;
+
+    const auto delta_path = target + sync_delta_suffix;
+    auto remote_delta = mp_sftp_open(sftp.get(), delta_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (!remote_delta)
+        return false;
+
+    // Whether the transfer fails or the changes cannot be applied, the file is sent whole and the delta is of no use
+    auto remove_delta =
+        sg::make_scope_guard([this, &delta_path]() noexcept { sftp_unlink(sftp.get(), delta_path.c_str()); });
+
+    // The changes are a series of blocks to take from the remote file ('C') and of data to put in between ('L')
+    std::string delta;
+    uint64_t literal_bytes = 0;
+    auto flush_delta = [&](bool all) {
+        while (delta.size() >= max_transfer || (all && !delta.empty()))
+        {
+            const auto length = std::min<size_t>(delta.size(), max_transfer);
+            if (sftp_write(remote_delta.get(), delta.data(), length) < 0)
+                throw SFTPError{"cannot write to remote file {}: {}", delta_path, ssh_get_error(sftp->session)};
+            delta.erase(0, length);
+        }
+    };
+    auto put_literal = [&](const char* data, size_t length) {
+        literal_bytes += length;
+        while (length > 0)
+        {
+            const auto chunk = std::min<size_t>(length, max_transfer);
+            delta.push_back('L');
+            append_big_endian(delta, static_cast<uint32_t>(chunk));
+            delta.append(data, chunk);
+            flush_delta(false);
+            data += chunk;
+            length -= chunk;
+        }
+    };
+    auto put_copy = [&](uint64_t index) {
+        delta.push_back('C');
+        append_big_endian(delta, index);
+        flush_delta(false);
+    };
+
+    std::vector<char> data;
+    size_t pos = 0, literal_start = 0;
+    auto eof = false;
+    auto fill = [&] {
+        if (eof || data.size() - pos > block_size)
+            return;
+
+        put_literal(data.data() + literal_start, pos - literal_start);
+        data.erase(data.begin(), data.begin() + pos);
+        pos = literal_start = 0;
+
+        const auto kept = data.size();
+        data.resize(kept + sync_read_size);
+        local_file->read(data.data() + kept, sync_read_size);
+        data.resize(kept + local_file->gcount());
+        if (local_file->bad() || (local_file->fail() && !local_file->eof()))
+            throw SFTPError{"cannot read from local file {}: {}", source_path, strerror(errno)};
+        eof = local_file->eof();
+    };
+
+    std::optional<sftp_sync::RollingChecksum> checksum;
+    for (;;)
+    {
+        fill();
+        const auto available = data.size() - pos;
+        if (available == 0)
+            break;
+
+        // Towards the end, only the last block of the remote file, which may be shorter, can still match
+        if (available < block_size)
+        {
+            const auto tail_sum = sftp_sync::RollingChecksum{data.data() + pos, available}.value();
+            if (auto block = matching_block(tail_sum, data.data() + pos, available))
+            {
+                put_literal(data.data() + literal_start, pos - literal_start);
+                put_copy(*block);
+                literal_start = data.size();
+            }
+
+            pos = data.size();
+            break;
+        }
+
+        if (!checksum)
+            checksum.emplace(data.data() + pos, block_size);
+
+        if (auto block = matching_block(checksum->value(), data.data() + pos, block_size))
+        {
+            put_literal(data.data() + literal_start, pos - literal_start);
+            put_copy(*block);
+            pos += block_size;
+            literal_start = pos;
+            checksum.reset();
+            continue;
+        }
+
+        if (available > block_size)
+            checksum->roll(data[pos], data[pos + block_size]);
+        else
+            checksum.reset();
+        ++pos;
+    }
+
+    put_literal(data.data() + literal_start, pos - literal_start);
+    flush_delta(true);
+    remote_delta.reset();
+
+    auto patch_process = ssh_session->exec(fmt::format("python3 -c '{}' patch {} {} {}", sync_helper,
+                                                       utils::escape_for_shell(target), block_size,
+                                                       utils::escape_for_shell(delta_path)));
+    if (patch_process.exit_code() != 0)
+    {
+        mpl::log(mpl::Level::debug, log_category,
+                 fmt::format("cannot apply changes to remote file {}, sending it whole: {}", target_path,
+                             patch_process.read_std_error()));
+        return false;
+    }
+
+    remove_delta.dismiss(); // the helper removes it once applied
+
+    mpl::log(mpl::Level::debug, log_category,
+             fmt::format("synced {} by sending {} of its {} bytes", source_path, literal_bytes, size));
+
+    if (sftp_chmod(sftp.get(), target.c_str(), static_cast<mode_t>(perms)) != SSH_FX_OK)
+        throw SFTPError{"cannot set permissions for remote file {}: {}", target_path, ssh_get_error(sftp->session)};
+
+    set_remote_times(source_path, target_path);
+    return true;
+}
+catch (const SSHException& e)
+{
+    mpl::log(mpl::Level::debug, log_category,
+             fmt::format("cannot sync {}, sending it whole: {}", source_path, e.what()));
+    return false;
+}
+catch (const SFTPError& e)
+{
+    mpl::log(mpl::Level::debug, log_category,
+             fmt::format("cannot sync {}, sending it whole: {}", source_path, e.what()));
+    return false;
+}
+
+void SFTPClient::set_remote_times(const fs::path& source_path, const fs::path& target_path)
+{
+    // With the times kept, the next sync can tell the file has not changed
+    std::error_code err;
+    const auto mtime = to_time_t(MP_FILEOPS.last_write_time(source_path, err));
+    if (err)
+        return;
+
+    timeval times[2]{};
+    times[0].tv_sec = times[1].tv_sec = mtime;
+    if (sftp_utimes(sftp.get(), target_path.u8string().c_str(), times) != SSH_FX_OK)
+        mpl::log(mpl::Level::warning, log_category,
+                 fmt::format("cannot set times for remote file {}: {}", target_path, ssh_get_error(sftp->session)));
+}
+
 } // namespace multipass
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MULTIPASS_SFTP_SYNC_H
+#define MULTIPASS_SFTP_SYNC_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace multipass
+{
+namespace sftp_sync
+{
+constexpr auto min_block_size = 4096u;
+constexpr auto max_block_size = 131072u;
+
+// zlib's adler32, as computed in the instance for each block, moved along the local file a byte at a time
+class RollingChecksum
+{
+public:
+    RollingChecksum(const char* data, size_t size) : size{size}
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            a = (a + byte(data[i])) % mod;
+            b = (b + a) % mod;
+        }
+    }
+
+    void roll(char out, char in)
+    {
+        a = (a + mod - byte(out) + byte(in)) % mod;
+        b = (b + mod - (size % mod) * byte(out) % mod + a + mod - 1) % mod;
+    }
+
+    uint32_t value() const
+    {
+        return (b << 16) | a;
+    }
+
+private:
+    static uint32_t byte(char c)
+    {
+        return static_cast<unsigned char>(c);
+    }
+
+    static constexpr uint32_t mod = 65521u;
+    uint32_t a{1}, b{0};
+    size_t size;
+};
+
+inline uint32_t block_size_for(uint64_t size)
+{
+    // As with rsync, blocks grow with the square root of the size, to keep their number in check
+    const auto block_size = static_cast<uint32_t>(std::sqrt(static_cast<double>(size))) & ~1023u;
+    return std::clamp(block_size, min_block_size, max_block_size);
+}
+} // namespace sftp_sync
+} // namespace multipass
+#endif // MULTIPASS_SFTP_SYNC_H
@@ -60,6 +60,11 @@ int mp::SSHClient::exec(const std::vector<std::string>& args)
 }
 
 int mp::SSHClient::exec(const std::vector<std::vector<std::string>>& args_list)
+{
+    return exec_string(cmd_line_for(args_list));
+}
+
+std::string mp::SSHClient::cmd_line_for(const std::vector<std::vector<std::string>>& args_list)
 {
     std::string cmd_line;
 
@@ -71,7 +76,7 @@ int mp::SSHClient::exec(const std::vector<std::vector<std::string>>& args_list)
             cmd_line += "&&" + utils::to_cmd(*args_it, mp::utils::QuoteType::quote_every_arg);
     }
 
-    return exec_string(cmd_line);
+    return cmd_line;
 }
 
 void mp::SSHClient::handle_ssh_events()
@@ -0,0 +1,583 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/logging/log.h>
+#include <multipass/ssh/ssh_client.h>
+#include <multipass/ssh/ssh_multiplexer.h>
+#include <multipass/ssh/throw_on_error.h>
+#include <multipass/standard_paths.h>
+#include <multipass/terminal.h>
+
+#include "ssh_client_key_provider.h"
+
+#include <fmt/format.h>
+#include <scope_guard.hpp>
+
+#include <QCryptographicHash>
+#include <QDir>
+
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+namespace mpl = multipass::logging;
+
+namespace
+{
+constexpr auto category = "ssh multiplexer";
+constexpr auto exec_request = 'X';
+constexpr auto stop_request = 'Q';
+constexpr auto resize_request = 'R';
+constexpr auto lost_connection_status = 255; // as OpenSSH reports it
+constexpr auto poll_timeout = 1000;
+constexpr auto handshake_timeout = 5000;
+constexpr auto max_string_size = 1048576u;
+
+using ConnectorUPtr = std::unique_ptr<ssh_connector_struct, void (*)(ssh_connector)>;
+
+volatile std::sig_atomic_t window_changed{0};
+
+void sigwinch_handler(int)
+{
+    window_changed = 1;
+}
+
+QString base_socket_dir()
+{
+    return QDir{MP_STDPATHS.writableLocation(mp::StandardPaths::RuntimeLocation)}.filePath("multipass-ssh");
+}
+
+// Clients of different daemons may have instances of the same name, so each daemon gets a directory of its own. A short
+// hash keeps socket paths within the length unix sockets allow.
+QString socket_dir(const std::string& server_address)
+{
+    const auto hash = QCryptographicHash::hash(QByteArray::fromStdString(server_address), QCryptographicHash::Sha256);
+    return QDir{base_socket_dir()}.filePath(QString::fromLatin1(hash.toHex().left(16)));
+}
+
+std::string socket_path_for(const std::string& server_address, const std::string& instance_name)
+{
+    return QDir{socket_dir(server_address)}.filePath(QString::fromStdString(instance_name) + ".sock").toStdString();
+}
+
+sockaddr_un address_for(const std::string& socket_path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error{fmt::format("socket path {} is too long", socket_path)};
+
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+// Returns -1 when nothing listens on the socket
+int connect_to(const std::string& socket_path)
+{
+    sockaddr_un address;
+    try
+    {
+        address = address_for(socket_path);
+    }
+    catch (const std::runtime_error&)
+    {
+        return -1;
+    }
+
+    const auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool write_all(int fd, const std::string& data)
+{
+    for (size_t written = 0; written < data.size();)
+    {
+        const auto ret = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        written += ret;
+    }
+
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size)
+{
+    for (size_t read = 0; read < size;)
+    {
+        const auto ret = ::recv(fd, static_cast<char*>(data) + read, size - read, 0);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        read += ret;
+    }
+
+    return true;
+}
+
+bool wait_readable(int fd, int timeout)
+{
+    pollfd poll_fd{fd, POLLIN, 0};
+    return ::poll(&poll_fd, 1, timeout) > 0;
+}
+
+void put_u32(std::string& buffer, uint32_t value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string(std::string& buffer, const std::string& value)
+{
+    put_u32(buffer, value.size());
+    buffer.append(value);
+}
+
+bool read_u32(int fd, uint32_t& value)
+{
+    return read_all(fd, &value, sizeof(value));
+}
+
+bool read_string(int fd, std::string& value)
+{
+    uint32_t size;
+    if (!read_u32(fd, size) || size > max_string_size)
+        return false;
+
+    value.resize(size);
+    return read_all(fd, value.data(), size);
+}
+
+// The request type goes with the standard streams of the client, if any
+bool send_request(int fd, char type, const std::vector<int>& stream_fds)
+{
+    iovec data{&type, 1};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+
+    std::array<char, CMSG_SPACE(3 * sizeof(int))> control{};
+    if (!stream_fds.empty())
+    {
+        message.msg_control = control.data();
+        message.msg_controllen = CMSG_SPACE(stream_fds.size() * sizeof(int));
+
+        auto header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(stream_fds.size() * sizeof(int));
+        std::memcpy(CMSG_DATA(header), stream_fds.data(), stream_fds.size() * sizeof(int));
+    }
+
+    ssize_t ret;
+    while ((ret = ::sendmsg(fd, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+        ;
+    return ret == 1;
+}
+
+bool receive_request(int fd, char& type, std::array<int, 3>& stream_fds)
+{
+    iovec data{&type, 1};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+
+    std::array<char, CMSG_SPACE(3 * sizeof(int))> control{};
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    ssize_t ret;
+    while ((ret = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+    if (ret != 1)
+        return false;
+
+    for (auto header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+        {
+            const auto count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            std::memcpy(stream_fds.data(), CMSG_DATA(header), std::min(count, stream_fds.size()) * sizeof(int));
+        }
+    }
+
+    return !(message.msg_flags & MSG_CTRUNC);
+}
+
+std::pair<int, int> terminal_size()
+{
+    winsize size{};
+    ::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
+    return {size.ws_col, size.ws_row};
+}
+} // namespace
+
+struct mp::SSHMultiplexer::Client
+{
+    explicit Client(int control_fd) : control_fd{control_fd}
+    {
+    }
+
+    ~Client()
+    {
+        ::close(control_fd);
+        for (auto fd : stream_fds)
+            if (fd >= 0)
+                ::close(fd);
+    }
+
+    const int control_fd;
+    std::array<int, 3> stream_fds{-1, -1, -1};
+    SSHClient::ChannelUPtr channel{nullptr, ssh_channel_free};
+    std::vector<ConnectorUPtr> connectors;
+    std::optional<std::pair<int, int>> new_size;
+    bool gone{false}; // the client went away before its command ended
+};
+
+mp::SSHMultiplexer::SSHMultiplexer(const std::string& server_address, const std::string& instance_name,
+                                   const std::string& host, int port, const std::string& username,
+                                   const std::string& priv_key_blob)
+    : socket_path{socket_path_for(server_address, instance_name)}, event{ssh_event_new(), ssh_event_free}
+{
+    for (const auto& dir : {base_socket_dir(), socket_dir(server_address)})
+    {
+        QDir{}.mkpath(dir);
+        ::chmod(dir.toStdString().c_str(), 0700);
+    }
+
+    if (const auto fd = connect_to(socket_path); fd >= 0)
+    {
+        ::close(fd);
+        throw std::runtime_error{fmt::format("{} already has an SSH multiplexer", instance_name)};
+    }
+
+    // Left behind by a master that did not stop cleanly
+    ::unlink(socket_path.c_str());
+
+    const auto address = address_for(socket_path);
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listen_fd, SOMAXCONN) < 0)
+        throw std::runtime_error{fmt::format("cannot listen on {}: {}", socket_path, std::strerror(errno))};
+
+    ssh_session = std::make_unique<SSHSession>(host, port, username, SSHClientKeyProvider(priv_key_blob));
+}
+
+mp::SSHMultiplexer::~SSHMultiplexer()
+{
+    if (listen_fd >= 0)
+    {
+        ::close(listen_fd);
+        ::unlink(socket_path.c_str());
+    }
+
+    for (auto fd : pending_clients)
+        ::close(fd);
+}
+
+void mp::SSHMultiplexer::serve(std::chrono::milliseconds idle_timeout)
+{
+    // Keep serving after the terminal that started the master goes away, and after clients close their streams
+    ::setsid();
+    std::signal(SIGPIPE, SIG_IGN);
+
+    ssh_event_add_fd(event.get(), listen_fd, POLLIN, on_new_client, this);
+    ssh_event_add_session(event.get(), *ssh_session);
+
+    auto last_active = std::chrono::steady_clock::now();
+    while (!stop_requested && ssh_is_connected(*ssh_session))
+    {
+        ssh_event_dopoll(event.get(), poll_timeout);
+
+        // The callbacks above only take note of what to do, so that no blocking session calls are made from them
+        for (auto fd : pending_clients)
+            accept_client(fd);
+        pending_clients.clear();
+        finish_commands();
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!clients.empty())
+            last_active = now;
+        else if (now - last_active >= idle_timeout)
+        {
+            mpl::log(mpl::Level::debug, category, fmt::format("stopping {}: idle", socket_path));
+            break;
+        }
+    }
+
+    for (auto& client : clients)
+        end_command(*client, lost_connection_status);
+    clients.clear();
+
+    ssh_event_remove_fd(event.get(), listen_fd);
+}
+
+int mp::SSHMultiplexer::on_new_client(socket_t fd, int revents, void* userdata)
+{
+    auto multiplexer = static_cast<SSHMultiplexer*>(userdata);
+    if (const auto control_fd = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC); control_fd >= 0)
+        multiplexer->pending_clients.push_back(control_fd);
+
+    return 0;
+}
+
+int mp::SSHMultiplexer::on_client_message(socket_t fd, int revents, void* userdata)
+{
+    auto client = static_cast<Client*>(userdata);
+
+    char type;
+    uint32_t columns, rows;
+    if (client->gone || !read_all(fd, &type, 1) || type != resize_request || !read_u32(fd, columns) ||
+        !read_u32(fd, rows))
+        client->gone = true;
+    else
+        client->new_size = std::make_pair(columns, rows);
+
+    return 0;
+}
+
+void mp::SSHMultiplexer::accept_client(int control_fd)
+{
+    auto client = std::make_unique<Client>(control_fd);
+
+    char type;
+    if (!wait_readable(control_fd, handshake_timeout) || !receive_request(control_fd, type, client->stream_fds))
+        return;
+
+    if (type == stop_request)
+    {
+        mpl::log(mpl::Level::debug, category, fmt::format("stopping {}: asked to", socket_path));
+        stop_requested = true;
+        return;
+    }
+
+    std::string cmd_line, term_type;
+    uint32_t pty, columns, rows;
+    if (type != exec_request ||
+        std::find(client->stream_fds.begin(), client->stream_fds.end(), -1) != client->stream_fds.end() ||
+        !read_string(control_fd, cmd_line) || !read_u32(control_fd, pty) || !read_u32(control_fd, columns) ||
+        !read_u32(control_fd, rows) || !read_string(control_fd, term_type))
+        return;
+
+    try
+    {
+        start_command(*client, cmd_line, pty, columns, rows, term_type);
+    }
+    catch (const SSHException& e)
+    {
+        mpl::log(mpl::Level::warning, category, e.what());
+        end_command(*client, lost_connection_status);
+        return;
+    }
+
+    ssh_event_add_fd(event.get(), control_fd, POLLIN, on_client_message, client.get());
+    clients.push_back(std::move(client));
+}
+
+void mp::SSHMultiplexer::start_command(Client& client, const std::string& cmd_line, bool pty, int columns, int rows,
+                                       const std::string& term_type)
+{
+    client.channel.reset(ssh_channel_new(*ssh_session));
+    SSH::throw_on_error(client.channel, *ssh_session, "[ssh multiplexer] channel creation failed",
+                        ssh_channel_open_session);
+
+    if (pty)
+        SSH::throw_on_error(client.channel, *ssh_session, "[ssh multiplexer] pty request failed",
+                            ssh_channel_request_pty_size, term_type.c_str(), columns, rows);
+
+    if (cmd_line.empty())
+        SSH::throw_on_error(client.channel, *ssh_session, "[ssh multiplexer] shell request failed",
+                            ssh_channel_request_shell);
+    else
+        SSH::throw_on_error(client.channel, *ssh_session, "[ssh multiplexer] exec request failed",
+                            ssh_channel_request_exec, cmd_line.c_str());
+
+    // Connected the same way as the streams of SSHClient, only with those of the client
+    ConnectorUPtr connector_in{ssh_connector_new(*ssh_session), ssh_connector_free};
+    ssh_connector_set_out_channel(connector_in.get(), client.channel.get(), SSH_CONNECTOR_STDOUT);
+    ssh_connector_set_in_fd(connector_in.get(), client.stream_fds[0]);
+
+    ConnectorUPtr connector_out{ssh_connector_new(*ssh_session), ssh_connector_free};
+    ssh_connector_set_out_fd(connector_out.get(), client.stream_fds[1]);
+    ssh_connector_set_in_channel(connector_out.get(), client.channel.get(), SSH_CONNECTOR_STDOUT);
+
+    ConnectorUPtr connector_err{ssh_connector_new(*ssh_session), ssh_connector_free};
+    ssh_connector_set_out_fd(connector_err.get(), client.stream_fds[2]);
+    ssh_connector_set_in_channel(connector_err.get(), client.channel.get(), SSH_CONNECTOR_STDERR);
+
+    for (auto* connector : {&connector_in, &connector_out, &connector_err})
+    {
+        ssh_event_add_connector(event.get(), connector->get());
+        client.connectors.push_back(std::move(*connector));
+    }
+}
+
+void mp::SSHMultiplexer::finish_commands()
+{
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+        auto& client = **it;
+        auto channel = client.channel.get();
+
+        if (client.new_size)
+        {
+            ssh_channel_change_pty_size(channel, client.new_size->first, client.new_size->second);
+            client.new_size.reset();
+        }
+
+        if (!client.gone && ssh_channel_is_open(channel) && !ssh_channel_is_eof(channel))
+        {
+            ++it;
+            continue;
+        }
+
+        end_command(client, client.gone ? lost_connection_status : ssh_channel_get_exit_status(channel));
+        it = clients.erase(it);
+    }
+}
+
+void mp::SSHMultiplexer::end_command(Client& client, int exit_status)
+{
+    ssh_event_remove_fd(event.get(), client.control_fd);
+    for (auto& connector : client.connectors)
+        ssh_event_remove_connector(event.get(), connector.get());
+    client.connectors.clear();
+
+    // Removing the connectors takes the session out of the event as well
+    ssh_event_add_session(event.get(), *ssh_session);
+
+    if (!client.gone)
+    {
+        std::string status;
+        put_u32(status, static_cast<uint32_t>(exit_status));
+        write_all(client.control_fd, status);
+    }
+}
+
+std::optional<int> mp::SSHMultiplexer::exec(const std::string& server_address, const std::string& instance_name,
+                                            const std::string& cmd_line, Terminal* term)
+{
+    const auto control_fd = connect_to(socket_path_for(server_address, instance_name));
+    if (control_fd < 0)
+        return std::nullopt;
+
+    auto close_control = sg::make_scope_guard([control_fd]() noexcept { ::close(control_fd); });
+
+    const auto pty = term->is_live();
+    const auto [columns, rows] = terminal_size();
+    const char* term_type = std::getenv("TERM");
+
+    std::string request;
+    put_string(request, cmd_line);
+    put_u32(request, pty);
+    put_u32(request, columns);
+    put_u32(request, rows);
+    put_string(request, term_type ? term_type : "xterm");
+
+    if (!send_request(control_fd, exec_request, {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}) ||
+        !write_all(control_fd, request))
+        return std::nullopt;
+
+    // As with the console of SSHClient, the remote end handles the terminal from now on
+    termios saved_terminal{};
+    if (pty)
+    {
+        termios raw_terminal;
+        ::tcgetattr(STDIN_FILENO, &saved_terminal);
+        raw_terminal = saved_terminal;
+        ::cfmakeraw(&raw_terminal);
+        ::tcsetattr(STDIN_FILENO, TCSANOW, &raw_terminal);
+    }
+    auto restore_terminal = sg::make_scope_guard([pty, &saved_terminal]() noexcept {
+        if (pty)
+            ::tcsetattr(STDIN_FILENO, TCSANOW, &saved_terminal);
+    });
+
+    struct sigaction winch_action{};
+    winch_action.sa_handler = sigwinch_handler;
+    sigemptyset(&winch_action.sa_mask);
+    ::sigaction(SIGWINCH, &winch_action, nullptr);
+
+    for (;;)
+    {
+        pollfd poll_fd{control_fd, POLLIN, 0};
+        if (::poll(&poll_fd, 1, -1) < 0)
+        {
+            if (errno == EINTR && window_changed && pty)
+            {
+                window_changed = 0;
+                const auto [new_columns, new_rows] = terminal_size();
+
+                std::string resize{resize_request};
+                put_u32(resize, new_columns);
+                put_u32(resize, new_rows);
+                write_all(control_fd, resize);
+            }
+            continue;
+        }
+
+        uint32_t exit_status;
+        if (read_u32(control_fd, exit_status))
+            return static_cast<int>(exit_status);
+
+        return lost_connection_status;
+    }
+}
+
+void mp::SSHMultiplexer::stop_masters(const std::string& server_address,
+                                      const std::vector<std::string>& instance_names)
+{
+    std::vector<std::string> socket_paths;
+    if (instance_names.empty())
+    {
+        for (const auto& entry : QDir{socket_dir(server_address)}.entryInfoList({"*.sock"}, QDir::System))
+            socket_paths.push_back(entry.filePath().toStdString());
+    }
+    else
+    {
+        for (const auto& instance_name : instance_names)
+            socket_paths.push_back(socket_path_for(server_address, instance_name));
+    }
+
+    for (const auto& socket_path : socket_paths)
+    {
+        if (const auto fd = connect_to(socket_path); fd >= 0)
+        {
+            send_request(fd, stop_request, {});
+            ::close(fd);
+        }
+    }
+}
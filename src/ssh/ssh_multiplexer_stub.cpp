@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/ssh/ssh_multiplexer.h>
+
+#include <stdexcept>
+
+namespace mp = multipass;
+
+// The master relies on passing file descriptors over Unix sockets. Elsewhere there is never a master, so commands
+// always go through a session of their own and `client.ssh-multiplexing` has no effect.
+struct mp::SSHMultiplexer::Client
+{
+};
+
+mp::SSHMultiplexer::SSHMultiplexer(const std::string&, const std::string&, int, const std::string&,
+                                   const std::string&, Mounts)
+    : event{nullptr, ssh_event_free}
+{
+    throw std::runtime_error{"SSH multiplexing is not supported on this platform"};
+}
+
+mp::SSHMultiplexer::~SSHMultiplexer() = default;
+
+void mp::SSHMultiplexer::serve(std::chrono::milliseconds)
+{
+}
+
+std::optional<int> mp::SSHMultiplexer::exec(const std::string&, const CommandMaker&, Terminal*)
+{
+    return std::nullopt;
+}
+
+void mp::SSHMultiplexer::stop_masters(const std::vector<std::string>&)
+{
+}
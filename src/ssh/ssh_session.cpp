@@ -18,6 +18,7 @@
 #include <multipass/exceptions/ssh_exception.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
 #include <multipass/ssh/ssh_key_provider.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/ssh/throw_on_error.h>
@@ -27,6 +28,7 @@
 
 #include <QDir>
 
+#include <optional>
 #include <string>
 
 namespace mp = multipass;
@@ -52,11 +54,28 @@ mp::SSHSession::SSHSession(const std::string& host, int port, const std::string&
     set_option(SSH_OPTIONS_CIPHERS_S_C, "chacha20-poly1305@openssh.com,aes256-ctr");
     set_option(SSH_OPTIONS_SSH_DIR, ssh_dir.c_str());
 
-    SSH::throw_on_error(session, "ssh connection failed", ssh_connect);
-    if (key_provider)
+    // Connecting is most of what guest sessions wait on, so it is traced as part of whatever is being traced
+    std::optional<mpl::Span> span;
+    if (mpl::is_tracing() && mpl::current_span_context().is_valid())
     {
-        SSH::throw_on_error(session, "ssh failed to authenticate", ssh_userauth_publickey, nullptr,
-                            key_provider->private_key());
+        span.emplace("ssh connect");
+        span->set_attribute("host", host);
+    }
+
+    try
+    {
+        SSH::throw_on_error(session, "ssh connection failed", ssh_connect);
+        if (key_provider)
+        {
+            SSH::throw_on_error(session, "ssh failed to authenticate", ssh_userauth_publickey, nullptr,
+                                key_provider->private_key());
+        }
+    }
+    catch (...)
+    {
+        if (span)
+            span->set_failed();
+        throw;
     }
 }
 
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/exceptions/ssh_exception.h>
+#include <multipass/format.h>
+#include <multipass/ssh/ssh_streamed_process.h>
+#include <multipass/ssh/throw_on_error.h>
+
+#include <algorithm>
+
+namespace mp = multipass;
+
+namespace
+{
+constexpr auto max_pending_input = 1048576u; // how much input may wait to be sent before write_input() blocks
+constexpr auto read_size = 65536u;
+constexpr auto output_wait = 10; // ms to wait for output, after which queued input is looked at again
+
+auto make_channel(ssh_session session, const std::string& cmd)
+{
+    if (!ssh_is_connected(session))
+        throw mp::SSHException(
+            fmt::format("unable to create a channel for remote process: '{}', the SSH session is not connected", cmd));
+
+    std::unique_ptr<ssh_channel_struct, void (*)(ssh_channel)> channel{ssh_channel_new(session), ssh_channel_free};
+    mp::SSH::throw_on_error(channel, session, "[ssh streamed proc] failed to open session channel",
+                            ssh_channel_open_session);
+    mp::SSH::throw_on_error(channel, session, "[ssh streamed proc] exec request failed", ssh_channel_request_exec,
+                            cmd.c_str());
+    return channel;
+}
+} // namespace
+
+mp::SSHStreamedProcess::SSHStreamedProcess(ssh_session session, const std::string& cmd)
+    : session{session}, channel{make_channel(session, cmd)}
+{
+}
+
+mp::SSHStreamedProcess::~SSHStreamedProcess()
+{
+    finish();
+}
+
+void mp::SSHStreamedProcess::write_input(const std::string& input)
+{
+    if (input.empty())
+        return;
+
+    std::unique_lock<std::mutex> lock{input_mutex};
+
+    // Holding the writer back here is what keeps a fast producer from queueing more than the command takes in
+    input_sent.wait(lock, [this] { return finished || pending_input_size < max_pending_input; });
+    if (finished || input_closed)
+        return;
+
+    pending_input.push_back(input);
+    pending_input_size += input.size();
+}
+
+void mp::SSHStreamedProcess::close_input()
+{
+    std::lock_guard<std::mutex> lock{input_mutex};
+    input_closed = true;
+}
+
+std::optional<int> mp::SSHStreamedProcess::run(const OutputHandler& handle_output)
+{
+    try
+    {
+        auto exit_status = pump(handle_output);
+        finish();
+        return exit_status;
+    }
+    catch (...)
+    {
+        // Whoever is blocked writing input must not wait for a command that is gone
+        finish();
+        throw;
+    }
+}
+
+std::optional<int> mp::SSHStreamedProcess::pump(const OutputHandler& handle_output)
+{
+    std::string buffer(read_size, '\0');
+
+    while (true)
+    {
+        const auto input_passed = pass_input();
+
+        // Waiting on standard output only briefly leaves room for input that comes in meanwhile, and for the
+        // command's window to open up again
+        const auto out_read = read_output(buffer, false, input_passed ? 0 : output_wait);
+        if (out_read > 0 && !handle_output(buffer.substr(0, out_read), false))
+            return std::nullopt;
+
+        const auto err_read = read_output(buffer, true, 0);
+        if (err_read > 0 && !handle_output(buffer.substr(0, err_read), true))
+            return std::nullopt;
+
+        if (out_read == 0 && err_read == 0 && ssh_channel_is_eof(channel.get()))
+            return ssh_channel_get_exit_status(channel.get());
+    }
+}
+
+bool mp::SSHStreamedProcess::pass_input()
+{
+    // Writing more than the command's window has room for would block until the command reads more input, which
+    // it may only do once its output is read. So only that much is written, and the rest waits for another pass.
+    auto room = ssh_channel_window_size(channel.get());
+    size_t sent{0};
+
+    std::unique_lock<std::mutex> lock{input_mutex};
+    while (room > 0 && !pending_input.empty())
+    {
+        // Only this thread takes input out, and queueing more leaves the chunks already there in place
+        auto& chunk = pending_input.front();
+        lock.unlock();
+
+        const auto length = std::min<size_t>(chunk.size(), room);
+        if (ssh_channel_write(channel.get(), chunk.data(), length) == SSH_ERROR)
+            throw SSHException(fmt::format("failed to send input: {}", ssh_get_error(session)));
+
+        room -= length;
+        sent += length;
+
+        lock.lock();
+        if (length == chunk.size())
+            pending_input.pop_front();
+        else
+            chunk.erase(0, length);
+    }
+
+    const auto close = input_closed && !eof_sent && pending_input.empty();
+    if (close)
+    {
+        ssh_channel_send_eof(channel.get());
+        eof_sent = true;
+    }
+
+    pending_input_size -= sent;
+    lock.unlock();
+
+    if (sent)
+        input_sent.notify_all();
+
+    return sent || close;
+}
+
+int mp::SSHStreamedProcess::read_output(std::string& buffer, bool is_stderr, int timeout)
+{
+    const auto num_bytes = ssh_channel_read_timeout(channel.get(), buffer.data(), buffer.size(), is_stderr, timeout);
+    if (num_bytes == SSH_ERROR)
+        throw SSHException(fmt::format("failed to read output: {}", ssh_get_error(session)));
+
+    return num_bytes == SSH_AGAIN ? 0 : num_bytes;
+}
+
+void mp::SSHStreamedProcess::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock{input_mutex};
+        finished = true;
+        pending_input.clear();
+        pending_input_size = 0;
+    }
+    input_sent.notify_all();
+}
@@ -22,15 +22,22 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/metrics.h>
 #include <multipass/platform.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/ssh/throw_on_error.h>
 #include <multipass/utils.h>
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+
 namespace mp = multipass;
 namespace mpl = multipass::logging;
 
@@ -40,6 +47,24 @@ constexpr auto category = "sftp server";
 using SftpHandleUPtr = std::unique_ptr<ssh_string_struct, void (*)(ssh_string)>;
 using namespace std::literals::chrono_literals;
 
+// Past this, the cache is started over rather than grown further
+constexpr auto max_cached_attributes = 100000u;
+// How much of a run of sequential writes can be held back
+constexpr auto max_pending_write_size = 1048576u;
+// The hashes of a check-file reply have to fit in a single packet
+constexpr auto max_check_file_hashes_size = 262144u;
+constexpr auto min_check_file_block_size = 256u;
+constexpr uint8_t SFTP_EXTENDED_REPLY{201u};
+// The client's INIT holds little more than its version, anything this big is not an INIT
+constexpr auto max_init_packet_size = 65536u;
+
+// The extended requests that handle_extended() serves, with their versions (check-file lists its algorithms)
+const std::vector<std::pair<QByteArray, QByteArray>> advertised_extensions{
+    {"posix-rename@openssh.com", "1"},
+    {"hardlink@openssh.com", "1"},
+    {"copy-data", "1"},
+    {"check-file", "md5,sha1,sha224,sha256,sha384,sha512"}};
+
 enum Permissions
 {
     read_user = 0400,
@@ -53,13 +78,6 @@ enum Permissions
     exec_other = 01
 };
 
-auto make_sftp_session(ssh_session session, ssh_channel channel)
-{
-    mp::SftpServer::SftpSessionUptr sftp_server_session{sftp_server_new(session, channel), sftp_free};
-    mp::SSH::throw_on_error(sftp_server_session, session, "[sftp] server init failed", sftp_server_init);
-    return sftp_server_session;
-}
-
 int reply_ok(sftp_client_message msg)
 {
     return sftp_reply_status(msg, SSH_FX_OK, nullptr);
@@ -85,6 +103,186 @@ int reply_unsupported(sftp_client_message msg)
     return sftp_reply_status(msg, SSH_FX_OP_UNSUPPORTED, "Unsupported message");
 }
 
+// Reads the fields of the extended requests that libssh leaves unparsed, past the request id and name
+class ExtendedRequest
+{
+public:
+    explicit ExtendedRequest(sftp_client_message msg)
+    {
+        if (msg->complete_message != nullptr)
+        {
+            data = static_cast<const char*>(ssh_buffer_get(msg->complete_message));
+            size = ssh_buffer_get_len(msg->complete_message);
+        }
+
+        read_u32();
+        read_string();
+    }
+
+    uint32_t read_u32()
+    {
+        return read_number<uint32_t>();
+    }
+
+    uint64_t read_u64()
+    {
+        return read_number<uint64_t>();
+    }
+
+    std::string read_string()
+    {
+        const auto length = read_u32();
+        if (!ok || size - position < length)
+        {
+            ok = false;
+            return {};
+        }
+
+        std::string value(data + position, length);
+        position += length;
+        return value;
+    }
+
+    bool valid() const
+    {
+        return ok;
+    }
+
+private:
+    template <typename T>
+    T read_number()
+    {
+        if (size - position < sizeof(T))
+        {
+            ok = false;
+            return 0;
+        }
+
+        T value{0};
+        for (auto i = 0u; i < sizeof(T); ++i)
+            value = (value << 8) | static_cast<uint8_t>(data[position++]);
+
+        return value;
+    }
+
+    const char* data{nullptr};
+    size_t size{0};
+    size_t position{0};
+    bool ok{true};
+};
+
+void append_u32(QByteArray& buffer, uint32_t value)
+{
+    for (auto shift = 24; shift >= 0; shift -= 8)
+        buffer.append(static_cast<char>((value >> shift) & 0xff));
+}
+
+void append_string(QByteArray& buffer, const QByteArray& value)
+{
+    append_u32(buffer, value.size());
+    buffer.append(value);
+}
+
+uint32_t u32_from(const char* data)
+{
+    uint32_t value{0};
+    for (auto i = 0; i < 4; ++i)
+        value = (value << 8) | static_cast<uint8_t>(data[i]);
+
+    return value;
+}
+
+int write_packet(ssh_channel channel, uint8_t type, const QByteArray& payload)
+{
+    QByteArray packet;
+    append_u32(packet, 1 + payload.size());
+    packet.append(static_cast<char>(type));
+    packet.append(payload);
+
+    return ssh_channel_write(channel, packet.constData(), packet.size()) == packet.size() ? SSH_OK : SSH_ERROR;
+}
+
+bool read_exactly(ssh_channel channel, char* data, uint32_t size)
+{
+    while (size > 0)
+    {
+        const auto num_bytes = ssh_channel_read_timeout(channel, data, size, 0, -1);
+        if (num_bytes <= 0)
+            return false;
+
+        data += num_bytes;
+        size -= num_bytes;
+    }
+
+    return true;
+}
+
+// libssh has no call for extended replies, so the packet is put together here
+int reply_extended(ssh_channel channel, sftp_client_message msg, const QByteArray& payload)
+{
+    QByteArray reply;
+    append_u32(reply, msg->id);
+    reply.append(payload);
+
+    return write_packet(channel, SFTP_EXTENDED_REPLY, reply);
+}
+
+// libssh's sftp_server_init() advertises a fixed list of extensions, which leaves out some that handle_extended()
+// serves, and lists statvfs, which it does not. Clients only send the extended requests they see advertised, so the
+// version exchange is done here instead.
+int init_sftp_server(sftp_session sftp)
+{
+    char length_field[4];
+    if (!read_exactly(sftp->channel, length_field, sizeof(length_field)))
+        return SSH_ERROR;
+
+    // The INIT packet is the client's version, followed by the extensions it knows of, which are not used
+    const auto length = u32_from(length_field);
+    if (length < 5 || length > max_init_packet_size)
+        return SSH_ERROR;
+
+    std::string packet(length, '\0');
+    if (!read_exactly(sftp->channel, packet.data(), length) || packet[0] != SSH_FXP_INIT)
+        return SSH_ERROR;
+
+    sftp->client_version = static_cast<int>(u32_from(packet.data() + 1));
+
+    QByteArray version;
+    append_u32(version, LIBSFTP_VERSION);
+    for (const auto& [name, data] : advertised_extensions)
+    {
+        append_string(version, name);
+        append_string(version, data);
+    }
+
+    return write_packet(sftp->channel, SSH_FXP_VERSION, version);
+}
+
+auto make_sftp_session(ssh_session session, ssh_channel channel)
+{
+    mp::SftpServer::SftpSessionUptr sftp_server_session{sftp_server_new(session, channel), sftp_free};
+    mp::SSH::throw_on_error(sftp_server_session, session, "[sftp] server init failed", init_sftp_server);
+    return sftp_server_session;
+}
+
+std::optional<std::pair<QByteArray, QCryptographicHash::Algorithm>> hash_algorithm_from(const std::string& names)
+{
+    static const std::unordered_map<std::string, QCryptographicHash::Algorithm> algorithms{
+        {"md5", QCryptographicHash::Md5},       {"sha1", QCryptographicHash::Sha1},
+        {"sha224", QCryptographicHash::Sha224}, {"sha256", QCryptographicHash::Sha256},
+        {"sha384", QCryptographicHash::Sha384}, {"sha512", QCryptographicHash::Sha512}};
+
+    // The client lists the algorithms in order of preference
+    for (const auto& name : QByteArray::fromStdString(names).split(','))
+    {
+        auto it = algorithms.find(name.trimmed().toStdString());
+        if (it != algorithms.end())
+            return std::make_pair(name.trimmed(), it->second);
+    }
+
+    return std::nullopt;
+}
+
 fmt::memory_buffer& operator<<(fmt::memory_buffer& buf, const char* v)
 {
     fmt::format_to(std::back_inserter(buf), v);
@@ -229,6 +427,22 @@ auto handle_from(sftp_client_message msg, const std::unordered_map<void*, std::u
     return nullptr;
 }
 
+// For handles that come in the fields of extended requests
+template <typename T>
+auto handle_from(sftp_client_message msg, const std::string& handle,
+                 const std::unordered_map<void*, std::unique_ptr<T>>& handles) -> T*
+{
+    SftpHandleUPtr handle_string{ssh_string_new(handle.size()), ssh_string_free};
+    if (!handle_string || ssh_string_fill(handle_string.get(), handle.data(), handle.size()) != 0)
+        return nullptr;
+
+    const auto id = sftp_handle(msg->sftp, handle_string.get());
+    auto entry = handles.find(id);
+    if (entry != handles.end())
+        return entry->second.get();
+    return nullptr;
+}
+
 void check_sshfs_status(mp::SSHSession& session, mp::SSHProcess& sshfs_process)
 {
     try
@@ -252,14 +466,33 @@ auto create_sshfs_process(mp::SSHSession& session, const std::string& sshfs_exec
     return std::make_unique<mp::SSHProcess>(std::move(sshfs_process));
 }
 
-int mapped_id_for(const mp::id_mappings& id_maps, const int id, const int id_if_not_found)
+// The first mapping for an id wins, as emplace leaves existing entries alone
+mp::SftpServer::IdMap forward_map_of(const mp::id_mappings& id_maps)
+{
+    mp::SftpServer::IdMap map;
+    for (const auto& [from, to] : id_maps)
+        map.emplace(from, to);
+
+    return map;
+}
+
+mp::SftpServer::IdMap reverse_map_of(const mp::id_mappings& id_maps)
+{
+    mp::SftpServer::IdMap map;
+    for (const auto& [from, to] : id_maps)
+        map.emplace(to, from);
+
+    return map;
+}
+
+int mapped_id_for(const mp::SftpServer::IdMap& id_map, const int id, const int id_if_not_found)
 {
     if (id == mp::no_id_info_available)
         return id_if_not_found;
 
-    auto map = std::find_if(id_maps.cbegin(), id_maps.cend(), [id](std::pair<int, int> p) { return id == p.first; });
+    auto map = id_map.find(id);
 
-    if (map != id_maps.end())
+    if (map != id_map.end())
     {
         if (map->second == mp::default_id)
             return id_if_not_found;
@@ -270,28 +503,131 @@ int mapped_id_for(const mp::id_mappings& id_maps, const int id, const int id_if_
     return id;
 }
 
-int reverse_id_for(const mp::id_mappings& id_maps, const int id, const int rev_id_if_not_found)
+int reverse_id_for(const mp::SftpServer::IdMap& reverse_id_map, const int id, const int rev_id_if_not_found)
+{
+    auto found = reverse_id_map.find(id);
+
+    return found == reverse_id_map.cend() ? rev_id_if_not_found : found->second;
+}
+
+std::string parent_of(const std::string& path)
+{
+    auto pos = path.find_last_of('/');
+    if (pos == std::string::npos)
+        return ".";
+
+    return pos == 0 ? "/" : path.substr(0, pos);
+}
+
+// The directories to watch for changes to a cached entry: its parent, which has the entry itself, and a directory's
+// own entries, which make for its times and link count
+std::vector<std::string> watched_dirs_for(const std::string& path, const std::optional<sftp_attributes_struct>& attr)
 {
-    auto found = std::find_if(id_maps.cbegin(), id_maps.cend(), [id](std::pair<int, int> p) { return id == p.second; });
+    std::vector<std::string> dirs{parent_of(path)};
+    if (attr && (attr->permissions & SSH_S_IFMT) == SSH_S_IFDIR)
+        dirs.push_back(path);
 
-    return found == id_maps.cend() ? rev_id_if_not_found : found->first;
+    return dirs;
+}
+
+const char* sftp_op_name(uint8_t type)
+{
+    switch (type)
+    {
+    case SFTP_REALPATH:
+        return "realpath";
+    case SFTP_OPENDIR:
+        return "opendir";
+    case SFTP_MKDIR:
+        return "mkdir";
+    case SFTP_RMDIR:
+        return "rmdir";
+    case SFTP_LSTAT:
+        return "lstat";
+    case SFTP_STAT:
+        return "stat";
+    case SFTP_FSTAT:
+        return "fstat";
+    case SFTP_READDIR:
+        return "readdir";
+    case SFTP_CLOSE:
+        return "close";
+    case SFTP_OPEN:
+        return "open";
+    case SFTP_READ:
+        return "read";
+    case SFTP_WRITE:
+        return "write";
+    case SFTP_RENAME:
+        return "rename";
+    case SFTP_REMOVE:
+        return "remove";
+    case SFTP_SETSTAT:
+        return "setstat";
+    case SFTP_FSETSTAT:
+        return "fsetstat";
+    case SFTP_READLINK:
+        return "readlink";
+    case SFTP_SYMLINK:
+        return "symlink";
+    case SFTP_EXTENDED:
+        return "extended";
+    default:
+        return "other";
+    }
+}
+
+// Looked up once for every message type, so that timing a request does not go through the registry
+mp::metrics::Histogram& request_duration_for(uint8_t type)
+{
+    static const auto histograms = [] {
+        std::array<mp::metrics::Histogram*, 256> ret{};
+        for (auto i = 0u; i < ret.size(); ++i)
+            ret[i] = &MP_METRICS.histogram(mp::sftp_request_duration_metric, mp::sftp_request_duration_help,
+                                           {{"op", sftp_op_name(static_cast<uint8_t>(i))}});
+        return ret;
+    }();
+
+    return *histograms[type];
 }
 } // namespace
 
 mp::SftpServer::SftpServer(SSHSession&& session, const std::string& source, const std::string& target,
                            const id_mappings& gid_mappings, const id_mappings& uid_mappings, int default_uid,
-                           int default_gid, const std::string& sshfs_exec_line)
-    : ssh_session{std::move(session)},
+                           int default_gid, const std::string& sshfs_exec_line, uint32_t max_read_size)
+    : SftpServer{std::make_unique<SSHSession>(std::move(session)), nullptr, source, target, gid_mappings,
+                 uid_mappings, default_uid, default_gid, sshfs_exec_line, max_read_size}
+{
+}
+
+mp::SftpServer::SftpServer(SSHSession& shared_session, const std::string& source, const std::string& target,
+                           const id_mappings& gid_mappings, const id_mappings& uid_mappings, int default_uid,
+                           int default_gid, const std::string& sshfs_exec_line, uint32_t max_read_size)
+    : SftpServer{nullptr, &shared_session, source, target, gid_mappings, uid_mappings, default_uid, default_gid,
+                 sshfs_exec_line, max_read_size}
+{
+}
+
+mp::SftpServer::SftpServer(std::unique_ptr<SSHSession> owned_session, SSHSession* shared_session,
+                           const std::string& source, const std::string& target, const id_mappings& gid_mappings,
+                           const id_mappings& uid_mappings, int default_uid, int default_gid,
+                           const std::string& sshfs_exec_line, uint32_t max_read_size)
+    : owned_session{std::move(owned_session)},
+      ssh_session{this->owned_session ? *this->owned_session : *shared_session},
       sshfs_process{create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source, '"'),
                                          mp::utils::escape_char(target, '"'))},
       sftp_server_session{make_sftp_session(ssh_session, sshfs_process->release_channel())},
       source_path{source},
       target_path{target},
-      gid_mappings{gid_mappings},
-      uid_mappings{uid_mappings},
+      gid_map{forward_map_of(gid_mappings)},
+      uid_map{forward_map_of(uid_mappings)},
+      reverse_gid_map{reverse_map_of(gid_mappings)},
+      reverse_uid_map{reverse_map_of(uid_mappings)},
       default_uid{default_uid},
       default_gid{default_gid},
-      sshfs_exec_line{sshfs_exec_line}
+      sshfs_exec_line{sshfs_exec_line},
+      max_read_size{max_read_size},
+      path_watcher{mp::platform::make_path_watcher()}
 {
 }
 
@@ -327,28 +663,128 @@ sftp_attributes_struct mp::SftpServer::attr_from(const QFileInfo& file_info)
 
 inline int mp::SftpServer::mapped_uid_for(const int uid)
 {
-    return mapped_id_for(uid_mappings, uid, default_uid);
+    return mapped_id_for(uid_map, uid, default_uid);
 }
 
 inline int mp::SftpServer::mapped_gid_for(const int gid)
 {
-    return mapped_id_for(gid_mappings, gid, default_gid);
+    return mapped_id_for(gid_map, gid, default_gid);
 }
 
 inline int mp::SftpServer::reverse_uid_for(const int uid, const int rev_uid_if_not_found)
 {
-    return reverse_id_for(uid_mappings, uid, rev_uid_if_not_found);
+    return reverse_id_for(reverse_uid_map, uid, rev_uid_if_not_found);
 }
 
 inline int mp::SftpServer::reverse_gid_for(const int gid, const int rev_gid_if_not_found)
 {
-    return reverse_id_for(gid_mappings, gid, rev_gid_if_not_found);
+    return reverse_id_for(reverse_gid_map, gid, rev_gid_if_not_found);
+}
+
+const std::optional<sftp_attributes_struct>* mp::SftpServer::cached_attributes_for(const std::string& path,
+                                                                                 const bool follow)
+{
+    const auto& cache = follow ? stat_cache : lstat_cache;
+    auto it = cache.find(path);
+
+    return it == cache.end() ? nullptr : &it->second;
+}
+
+void mp::SftpServer::cache_attributes(const std::string& path, const bool follow,
+                                      const std::optional<sftp_attributes_struct>& attr)
+{
+    // Only what will be heard of when it changes can be kept
+    if (!path_watcher)
+        return;
+
+    auto& cache = follow ? stat_cache : lstat_cache;
+    forget_attributes(cache, path);
+
+    const auto dirs = watched_dirs_for(path, attr);
+    for (auto dir = dirs.cbegin(); dir != dirs.cend(); ++dir)
+    {
+        if (!hold_watch(*dir))
+        {
+            std::for_each(dirs.cbegin(), dir, [this](const auto& held) { release_watch(held); });
+            return;
+        }
+    }
+
+    cache[path] = attr;
+}
+
+void mp::SftpServer::forget_attributes(CachedAttributes& cache, const std::string& path)
+{
+    auto it = cache.find(path);
+    if (it == cache.end())
+        return;
+
+    for (const auto& dir : watched_dirs_for(path, it->second))
+        release_watch(dir);
+
+    cache.erase(it);
+}
+
+void mp::SftpServer::forget_all_attributes()
+{
+    stat_cache.clear();
+    lstat_cache.clear();
+    watch_users.clear();
+    path_watcher->clear();
+}
+
+bool mp::SftpServer::hold_watch(const std::string& dir)
+{
+    auto [it, first] = watch_users.try_emplace(dir, 0u);
+    if (first && !path_watcher->watch(dir))
+    {
+        watch_users.erase(it);
+        return false;
+    }
+
+    ++it->second;
+    return true;
+}
+
+void mp::SftpServer::release_watch(const std::string& dir)
+{
+    auto it = watch_users.find(dir);
+    if (it == watch_users.end() || --it->second > 0)
+        return;
+
+    path_watcher->unwatch(dir);
+    watch_users.erase(it);
+}
+
+void mp::SftpServer::drop_changed_attributes()
+{
+    if (!path_watcher)
+        return;
+
+    auto changed_paths = path_watcher->changed_paths();
+    if (!changed_paths || stat_cache.size() + lstat_cache.size() > max_cached_attributes)
+        return forget_all_attributes();
+
+    for (const auto& path : *changed_paths)
+    {
+        for (auto cache : {&stat_cache, &lstat_cache})
+        {
+            forget_attributes(*cache, path);
+            forget_attributes(*cache, parent_of(path));
+        }
+    }
 }
 
 void mp::SftpServer::process_message(sftp_client_message msg)
 {
     int ret = 0;
     const auto type = sftp_client_message_get_type(msg);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Anything else may depend on what was written
+    if (type != SFTP_WRITE)
+        flush_pending_writes();
+
     switch (type)
     {
     case SFTP_REALPATH:
@@ -410,69 +846,86 @@ void mp::SftpServer::process_message(sftp_client_message msg)
     }
     if (ret != 0)
         mpl::log(mpl::Level::error, category, fmt::format("error occurred when replying to client: {}", ret));
+
+    request_duration_for(type).observe(std::chrono::steady_clock::now() - start);
 }
 
 void mp::SftpServer::run()
+{
+    while (handle_next_message())
+        ;
+}
+
+bool mp::SftpServer::has_pending_message()
+{
+    return ssh_channel_poll(sftp_server_session->channel, 0) != 0;
+}
+
+bool mp::SftpServer::handle_next_message()
 {
     using MsgUPtr = std::unique_ptr<sftp_client_message_struct, decltype(sftp_client_message_free)*>;
 
-    while (true)
+    MsgUPtr client_msg{sftp_get_client_message(sftp_server_session.get()), sftp_client_message_free};
+    if (auto msg = client_msg.get())
+    {
+        process_message(msg);
+        return true;
+    }
+
+    if (!stop_invoked)
     {
-        MsgUPtr client_msg{sftp_get_client_message(sftp_server_session.get()), sftp_client_message_free};
-        auto msg = client_msg.get();
-        if (msg == nullptr)
+        int status{0};
+        try
+        {
+            status = sshfs_process->exit_code(250ms);
+        }
+        catch (const mp::ExitlessSSHProcessException&)
         {
-            if (stop_invoked)
-                break;
+            status = 1;
+        }
 
-            int status{0};
-            try
-            {
-                status = sshfs_process->exit_code(250ms);
-            }
-            catch (const mp::ExitlessSSHProcessException&)
+        if (status != 0)
+        {
+            mpl::log(mpl::Level::error, category,
+                     "sshfs in the instance appears to have exited unexpectedly.  Trying to recover.");
+            auto proc = ssh_session.exec(fmt::format("findmnt --source :{}  -o TARGET -n", source_path));
+            auto mount_path = proc.read_std_output();
+            if (!mount_path.empty())
             {
-                status = 1;
+                ssh_session.exec(fmt::format("sudo umount {}", mount_path));
             }
 
-            if (status != 0)
-            {
-                mpl::log(mpl::Level::error, category,
-                         "sshfs in the instance appears to have exited unexpectedly.  Trying to recover.");
-                auto proc = ssh_session.exec(fmt::format("findmnt --source :{}  -o TARGET -n", source_path));
-                auto mount_path = proc.read_std_output();
-                if (!mount_path.empty())
-                {
-                    ssh_session.exec(fmt::format("sudo umount {}", mount_path));
-                }
-
-                sshfs_process =
-                    create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source_path, '"'),
-                                         mp::utils::escape_char(target_path, '"'));
-                sftp_server_session = make_sftp_session(ssh_session, sshfs_process->release_channel());
-
-                continue;
-            }
-            else
-            {
-                break;
-            }
-        }
+            sshfs_process = create_sshfs_process(ssh_session, sshfs_exec_line, mp::utils::escape_char(source_path, '"'),
+                                                 mp::utils::escape_char(target_path, '"'));
+            sftp_server_session = make_sftp_session(ssh_session, sshfs_process->release_channel());
 
-        process_message(msg);
+            return true;
+        }
     }
+
+    flush_pending_writes();
+    return false;
 }
 
 void mp::SftpServer::stop()
 {
     stop_invoked = true;
-    ssh_session.force_shutdown();
+
+    // A shared session still serves other mounts, and stop() is called from the thread that serves them all, so
+    // there is no handle_next_message() to wake up
+    if (owned_session)
+        owned_session->force_shutdown();
+    else
+        flush_pending_writes();
 }
 
 int mp::SftpServer::handle_close(sftp_client_message msg)
 {
     const auto id = sftp_handle(sftp_server_session.get(), msg->handle);
 
+    const auto write_failed = take_pending_write_failure(static_cast<QFile*>(id));
+    pending_writes.erase(static_cast<QFile*>(id));
+
     auto erased = open_file_handles.erase(id);
     erased += open_dir_handles.erase(id);
     if (erased == 0)
@@ -482,6 +935,10 @@ int mp::SftpServer::handle_close(sftp_client_message msg)
     }
 
     sftp_handle_remove(sftp_server_session.get(), id);
+
+    if (write_failed)
+        return reply_failure(msg);
+
     return reply_ok(msg);
 }
 
@@ -494,6 +951,9 @@ int mp::SftpServer::handle_fstat(sftp_client_message msg)
         return reply_bad_handle(msg, "fstat");
     }
 
+    if (take_pending_write_failure(file))
+        return reply_failure(msg);
+
     QFileInfo file_info(*file);
 
     if (file_info.isSymLink())
@@ -693,8 +1153,10 @@ int mp::SftpServer::handle_read(sftp_client_message msg)
         return reply_bad_handle(msg, "read");
     }
 
-    const auto max_packet_size = 65536u;
-    const auto len = std::min(msg->len, max_packet_size);
+    if (take_pending_write_failure(file))
+        return reply_failure(msg);
+
+    const auto len = std::min(msg->len, max_read_size);
 
     std::vector<char> data;
     data.reserve(len);
@@ -877,6 +1339,9 @@ int mp::SftpServer::handle_setstat(sftp_client_message msg)
             return reply_bad_handle(msg, "setstat");
         }
 
+        if (take_pending_write_failure(handle))
+            return reply_failure(msg);
+
         filename = handle->fileName();
     }
     else
@@ -952,31 +1417,49 @@ int mp::SftpServer::handle_stat(sftp_client_message msg, const bool follow)
         return reply_perm_denied(msg);
     }
 
-    QFileInfo file_info(filename);
-    if (!file_info.isSymLink() && !file_info.exists())
-    {
-        mpl::log(mpl::Level::trace, category,
-                 fmt::format("{}: cannot stat  \'{}\': no such file", __FUNCTION__, filename));
-        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
-    }
-
-    sftp_attributes_struct attr{};
+    drop_changed_attributes();
 
-    if (!follow && file_info.isSymLink())
+    std::optional<sftp_attributes_struct> attr;
+    if (auto cached = cached_attributes_for(filename, follow))
     {
-        mp::platform::symlink_attr_from(filename, &attr);
-        attr.uid = mapped_uid_for(attr.uid);
-        attr.gid = mapped_gid_for(attr.gid);
+        attr = *cached;
     }
     else
     {
-        if (file_info.isSymLink())
-            file_info = QFileInfo(file_info.symLinkTarget());
+        QFileInfo file_info(filename);
+        const auto is_symlink = file_info.isSymLink();
+        if (is_symlink || file_info.exists())
+        {
+            attr = sftp_attributes_struct{};
+
+            if (!follow && is_symlink)
+            {
+                mp::platform::symlink_attr_from(filename, &*attr);
+                attr->uid = mapped_uid_for(attr->uid);
+                attr->gid = mapped_gid_for(attr->gid);
+            }
+            else
+            {
+                if (is_symlink)
+                    file_info = QFileInfo(file_info.symLinkTarget());
 
-        attr = attr_from(file_info);
+                attr = attr_from(file_info);
+            }
+        }
+
+        // Link targets can change anywhere, without notice here
+        if (!(follow && is_symlink))
+            cache_attributes(filename, follow, attr);
     }
 
-    return sftp_reply_attr(msg, &attr);
+    if (!attr)
+    {
+        mpl::log(mpl::Level::trace, category,
+                 fmt::format("{}: cannot stat  \'{}\': no such file", __FUNCTION__, filename));
+        return sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, "no such file");
+    }
+
+    return sftp_reply_attr(msg, &*attr);
 }
 
 int mp::SftpServer::handle_symlink(sftp_client_message msg)
@@ -1013,6 +1496,36 @@ int mp::SftpServer::handle_write(sftp_client_message msg)
 
     auto len = ssh_string_len(msg->data);
     auto data_ptr = ssh_string_get_char(msg->data);
+    auto& pending = pending_writes[file];
+    const auto sequential = static_cast<qint64>(msg->offset) == pending.end_offset;
+    const auto flush_first = !sequential || pending.data.size() + len > max_pending_write_size;
+
+    if (pending.failed || (flush_first && !flush_pending_write(*file, pending)))
+    {
+        pending.failed = false;
+        pending.end_offset = -1;
+        return reply_failure(msg);
+    }
+
+    // sshfs sends sequential writes in small pieces, without waiting for replies. While more of them are queued,
+    // collect them and write them all at once. The first write of a run still goes to the file right away, so that
+    // e.g. bad offsets or a full disk show on the request that caused them.
+    if (sequential && len <= max_pending_write_size)
+    {
+        if (pending.data.empty())
+            pending.offset = msg->offset;
+        pending.data.insert(pending.data.end(), data_ptr, data_ptr + len);
+        pending.end_offset = msg->offset + len;
+
+        if (ssh_channel_poll(sftp_server_session->channel, 0) <= 0 && !flush_pending_write(*file, pending))
+        {
+            pending.end_offset = -1;
+            return reply_failure(msg);
+        }
+
+        return reply_ok(msg);
+    }
+
     if (!MP_FILEOPS.seek(*file, msg->offset))
     {
         mpl::log(mpl::Level::trace, category,
@@ -1037,9 +1550,64 @@ int mp::SftpServer::handle_write(sftp_client_message msg)
         len -= r;
     } while (len > 0);
 
+    pending.end_offset = msg->offset + ssh_string_len(msg->data);
     return reply_ok(msg);
 }
 
+bool mp::SftpServer::flush_pending_write(QFile& file, PendingWrite& pending)
+{
+    if (pending.data.empty())
+        return true;
+
+    std::vector<char> data;
+    data.swap(pending.data);
+
+    if (!MP_FILEOPS.seek(file, pending.offset))
+    {
+        mpl::log(mpl::Level::trace, category,
+                 fmt::format("{}: cannot seek to position {} in \'{}\'", __FUNCTION__, pending.offset, file.fileName()));
+        return false;
+    }
+
+    for (auto data_ptr = data.data(), end = data.data() + data.size(); data_ptr < end;)
+    {
+        auto r = MP_FILEOPS.write(file, data_ptr, end - data_ptr);
+        if (r < 0)
+        {
+            mpl::log(mpl::Level::trace, category,
+                     fmt::format("{}: write failed for \'{}\': {}", __FUNCTION__, file.fileName(), file.errorString()));
+            return false;
+        }
+
+        data_ptr += r;
+    }
+
+    file.flush();
+    return true;
+}
+
+void mp::SftpServer::flush_pending_writes()
+{
+    for (auto& [file, pending] : pending_writes)
+    {
+        if (!flush_pending_write(*file, pending))
+            pending.failed = true;
+    }
+}
+
+bool mp::SftpServer::take_pending_write_failure(QFile* file)
+{
+    auto it = pending_writes.find(file);
+    if (it == pending_writes.end())
+        return false;
+
+    auto& pending = it->second;
+    const auto failed = !flush_pending_write(*file, pending) || pending.failed;
+    pending.failed = false;
+
+    return failed;
+}
+
 int mp::SftpServer::handle_extended(sftp_client_message msg)
 {
     const auto submessage = sftp_client_message_get_submessage(msg);
@@ -1074,6 +1642,14 @@ int mp::SftpServer::handle_extended(sftp_client_message msg)
     {
         return handle_rename(msg);
     }
+    else if (method == "copy-data")
+    {
+        return handle_copy_data(msg);
+    }
+    else if (method == "check-file-handle")
+    {
+        return handle_check_file(msg);
+    }
     else
     {
         mpl::log(mpl::Level::trace, category, fmt::format("Unhandled extended method requested: {}", method));
@@ -1082,3 +1658,156 @@ int mp::SftpServer::handle_extended(sftp_client_message msg)
 
     return reply_ok(msg);
 }
+
+int mp::SftpServer::handle_copy_data(sftp_client_message msg)
+{
+    ExtendedRequest request{msg};
+    const auto read_handle = request.read_string();
+    const qint64 read_offset = request.read_u64();
+    qint64 length = request.read_u64();
+    const auto write_handle = request.read_string();
+    const qint64 write_offset = request.read_u64();
+    if (!request.valid() || read_offset < 0 || length < 0 || write_offset < 0)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("{}: malformed request", __FUNCTION__));
+        return sftp_reply_status(msg, SSH_FX_BAD_MESSAGE, "malformed copy-data request");
+    }
+
+    auto from = handle_from(msg, read_handle, open_file_handles);
+    auto to = handle_from(msg, write_handle, open_file_handles);
+    if (from == nullptr || to == nullptr)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+        return reply_bad_handle(msg, "copy-data");
+    }
+
+    if (!from->isReadable() || !to->isWritable())
+        return reply_perm_denied(msg);
+
+    // The data is written at the given offset, which appending would not honour
+    if (to->openMode() & QIODevice::Append)
+        return sftp_reply_status(msg, SSH_FX_OP_UNSUPPORTED, "copy-data to a file opened for appending");
+
+    const auto from_failed = take_pending_write_failure(from);
+    const auto to_failed = take_pending_write_failure(to);
+    if (from_failed || to_failed || !from->flush() || !to->flush())
+        return reply_failure(msg);
+
+    // A length of 0 means up to the end of the source
+    if (length == 0)
+        length = std::max(from->size() - read_offset, qint64{0});
+
+    if (from == to && read_offset < write_offset + length && write_offset < read_offset + length)
+    {
+        mpl::log(mpl::Level::trace, category,
+                 fmt::format("{}: overlapping ranges in \'{}\'", __FUNCTION__, from->fileName()));
+        return reply_failure(msg);
+    }
+
+    if (!MP_PLATFORM.copy_file_data(from->handle(), read_offset, to->handle(), write_offset, length))
+    {
+        mpl::log(mpl::Level::trace, category,
+                 fmt::format("{}: failed copying from \'{}\' to \'{}\': {}", __FUNCTION__, from->fileName(),
+                             to->fileName(), std::strerror(errno)));
+        return reply_failure(msg);
+    }
+
+    return reply_ok(msg);
+}
+
+int mp::SftpServer::handle_check_file(sftp_client_message msg)
+{
+    ExtendedRequest request{msg};
+    const auto handle = request.read_string();
+    const auto algorithm_names = request.read_string();
+    const qint64 offset = request.read_u64();
+    qint64 length = request.read_u64();
+    const auto block_size = request.read_u32();
+    if (!request.valid() || offset < 0 || length < 0)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("{}: malformed request", __FUNCTION__));
+        return sftp_reply_status(msg, SSH_FX_BAD_MESSAGE, "malformed check-file-handle request");
+    }
+
+    auto file = handle_from(msg, handle, open_file_handles);
+    if (file == nullptr)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("{}: bad handle requested", __FUNCTION__));
+        return reply_bad_handle(msg, "check-file-handle");
+    }
+
+    if (!file->isReadable())
+        return reply_perm_denied(msg);
+
+    const auto algorithm = hash_algorithm_from(algorithm_names);
+    if (!algorithm)
+    {
+        mpl::log(mpl::Level::trace, category,
+                 fmt::format("{}: no supported hash algorithm in \'{}\'", __FUNCTION__, algorithm_names));
+        return sftp_reply_status(msg, SSH_FX_OP_UNSUPPORTED, "no supported hash algorithm");
+    }
+
+    if (take_pending_write_failure(file) || !file->flush())
+        return reply_failure(msg);
+
+    // A length of 0 means up to the end of the file
+    const auto available = std::max(file->size() - offset, qint64{0});
+    if (length == 0 || length > available)
+        length = available;
+
+    // A block size of 0 means a single hash for the whole range
+    const auto blocks = block_size == 0 ? 1 : (length + block_size - 1) / block_size;
+    if ((block_size != 0 && block_size < min_check_file_block_size) ||
+        blocks * QCryptographicHash::hashLength(algorithm->second) > max_check_file_hashes_size)
+    {
+        mpl::log(mpl::Level::trace, category, fmt::format("{}: unsuitable block size {}", __FUNCTION__, block_size));
+        return reply_failure(msg);
+    }
+
+    if (!MP_FILEOPS.seek(*file, offset))
+    {
+        mpl::log(mpl::Level::trace, category,
+                 fmt::format("{}: cannot seek to position {} in \'{}\'", __FUNCTION__, offset, file->fileName()));
+        return reply_failure(msg);
+    }
+
+    QByteArray hashes;
+    QCryptographicHash hash{algorithm->second};
+    std::vector<char> data(max_read_size);
+    qint64 in_block{0};
+    for (auto remaining = length; remaining > 0;)
+    {
+        auto chunk = std::min(remaining, static_cast<qint64>(data.size()));
+        if (block_size != 0)
+            chunk = std::min(chunk, block_size - in_block);
+
+        const auto r = MP_FILEOPS.read(*file, data.data(), chunk);
+        if (r <= 0)
+        {
+            mpl::log(mpl::Level::trace, category,
+                     fmt::format("{}: read failed for {}: {}", __FUNCTION__, file->fileName(), file->errorString()));
+            return reply_failure(msg);
+        }
+
+        hash.addData(data.data(), r);
+        remaining -= r;
+        in_block += r;
+
+        if (block_size != 0 && (in_block == block_size || remaining == 0))
+        {
+            hashes += hash.result();
+            hash.reset();
+            in_block = 0;
+        }
+    }
+
+    if (block_size == 0)
+        hashes = hash.result();
+
+    QByteArray payload;
+    append_string(payload, "check-file");
+    append_string(payload, algorithm->first);
+    payload.append(hashes);
+
+    return reply_extended(sftp_server_session->channel, msg, payload);
+}
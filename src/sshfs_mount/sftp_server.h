@@ -19,18 +19,26 @@
 #define MULTIPASS_SFTP_SERVER_H
 
 #include <multipass/id_mappings.h>
+#include <multipass/path_watcher.h>
 #include <multipass/ssh/ssh_session.h>
 
 #include <libssh/sftp.h>
 
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <vector>
 
 #include <QFile>
 #include <QFileInfo>
 
 namespace multipass
 {
+constexpr auto sftp_request_duration_metric = "multipass_sftp_request_duration_seconds";
+constexpr auto sftp_request_duration_help = "How long SFTP requests took to handle";
+constexpr auto sftp_stats_marker = "sftp stats: "; // prefixes the request timings that sshfs_server reports
+constexpr auto span_marker = "trace span: ";       // prefixes the spans that sshfs_server passes on, when tracing
+
 class SSHSession;
 class SSHProcess;
 
@@ -39,18 +47,33 @@ class SftpServer
 public:
     SftpServer(SSHSession&& ssh_session, const std::string& source, const std::string& target,
                const id_mappings& gid_mappings, const id_mappings& uid_mappings, int default_uid, int default_gid,
-               const std::string& sshfs_exec_line);
+               const std::string& sshfs_exec_line, uint32_t max_read_size = 65536u);
+    // Serves on a channel of a session that other servers use too. libssh sessions are not to be used from several
+    // threads at once, so all of those servers are to be served, and stopped, from the same thread.
+    SftpServer(SSHSession& shared_session, const std::string& source, const std::string& target,
+               const id_mappings& gid_mappings, const id_mappings& uid_mappings, int default_uid, int default_gid,
+               const std::string& sshfs_exec_line, uint32_t max_read_size = 65536u);
     SftpServer(SftpServer&& other);
     ~SftpServer();
 
     void run();
     void stop();
 
+    // run() one request at a time, for serving along with other servers: whether a request (or the end of the
+    // channel) is waiting, and handling the next request, which is false once there are none left to handle
+    bool has_pending_message();
+    bool handle_next_message();
+
     using SSHSessionUptr = std::unique_ptr<ssh_session_struct, decltype(ssh_free)*>;
     using SftpSessionUptr = std::unique_ptr<sftp_session_struct, decltype(sftp_free)*>;
     using SSHFSProcUptr = std::unique_ptr<SSHProcess>;
+    using IdMap = std::unordered_map<int, int>;
 
 private:
+    SftpServer(std::unique_ptr<SSHSession> owned_session, SSHSession* shared_session, const std::string& source,
+               const std::string& target, const id_mappings& gid_mappings, const id_mappings& uid_mappings,
+               int default_uid, int default_gid, const std::string& sshfs_exec_line, uint32_t max_read_size);
+
     void process_message(sftp_client_message msg);
     sftp_attributes_struct attr_from(const QFileInfo& file_info);
     int mapped_uid_for(const int uid);
@@ -58,6 +81,28 @@ private:
     int reverse_uid_for(const int uid, const int rev_uid_if_not_found);
     int reverse_gid_for(const int gid, const int rev_gid_if_not_found);
 
+    // Cached results of stat requests, with no attributes for files that do not exist
+    using CachedAttributes = std::unordered_map<std::string, std::optional<sftp_attributes_struct>>;
+    const std::optional<sftp_attributes_struct>* cached_attributes_for(const std::string& path, bool follow);
+    void cache_attributes(const std::string& path, bool follow, const std::optional<sftp_attributes_struct>& attr);
+    void forget_attributes(CachedAttributes& cache, const std::string& path);
+    void forget_all_attributes();
+    bool hold_watch(const std::string& dir);
+    void release_watch(const std::string& dir);
+    void drop_changed_attributes();
+
+    // Sequential writes to a file, held back while more requests are already waiting, to be written at once
+    struct PendingWrite
+    {
+        qint64 offset{0};
+        std::vector<char> data;
+        qint64 end_offset{-1}; // where the last write to the file ended
+        bool failed{false};    // a held back write failed, to be reported on the next request for the file
+    };
+    bool flush_pending_write(QFile& file, PendingWrite& pending);
+    void flush_pending_writes();
+    bool take_pending_write_failure(QFile* file);
+
     int handle_close(sftp_client_message msg);
     int handle_fstat(sftp_client_message msg);
     int handle_mkdir(sftp_client_message msg);
@@ -75,19 +120,31 @@ private:
     int handle_symlink(sftp_client_message msg);
     int handle_write(sftp_client_message msg);
     int handle_extended(sftp_client_message msg);
+    int handle_copy_data(sftp_client_message msg);
+    int handle_check_file(sftp_client_message msg);
 
-    SSHSession ssh_session;
+    const std::unique_ptr<SSHSession> owned_session; // unless the session is shared
+    SSHSession& ssh_session;
     SSHFSProcUptr sshfs_process;
     SftpSessionUptr sftp_server_session;
     const std::string source_path;
     const std::string target_path;
     std::unordered_map<void*, std::unique_ptr<QFileInfoList>> open_dir_handles;
     std::unordered_map<void*, std::unique_ptr<QFile>> open_file_handles;
-    const id_mappings gid_mappings;
-    const id_mappings uid_mappings;
+    std::unordered_map<QFile*, PendingWrite> pending_writes;
+    // Looked up for every attribute sent or set, so kept as maps from either side
+    const IdMap gid_map;
+    const IdMap uid_map;
+    const IdMap reverse_gid_map;
+    const IdMap reverse_uid_map;
     const int default_uid;
     const int default_gid;
     const std::string sshfs_exec_line;
+    const uint32_t max_read_size;
+    PathWatcher::UPtr path_watcher;
+    CachedAttributes stat_cache;
+    CachedAttributes lstat_cache;
+    std::unordered_map<std::string, unsigned> watch_users; // how many cached entries each watched directory serves
     bool stop_invoked{false};
 };
 } // namespace multipass
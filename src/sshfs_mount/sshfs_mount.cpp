@@ -22,6 +22,7 @@
 #include <multipass/format.h>
 #include <multipass/id_mappings.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/top_catch_all.h>
 #include <multipass/utils.h>
@@ -30,7 +31,13 @@
 
 #include <QDir>
 #include <QString>
+
+#include <chrono>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -42,6 +49,50 @@ constexpr auto category = "sshfs mount";
 const std::string fuse_version_string{"FUSE library version"};
 const std::string ld_library_path_key{"LD_LIBRARY_PATH="};
 const std::string snap_path_key{"SNAP="};
+// What sshfs asks for at once with the throughput profile, up from its 32KiB default. OpenSSH's sftp-server
+// serves reads of up to this size too.
+constexpr auto throughput_request_size = 262144u;
+constexpr auto default_max_read_size = 65536u;
+// How long a group's serving thread waits for requests before looking for new tasks
+constexpr auto group_poll_timeout = std::chrono::milliseconds{100};
+
+std::string sshfs_exec_line_for(std::string sshfs_exec, const std::string& version_info)
+{
+    sshfs_exec += " -o slave -o transform_symlinks -o allow_other -o Compression=no";
+
+    auto fuse_version_line = mp::utils::match_line_for(version_info, fuse_version_string);
+    if (!fuse_version_line.empty())
+    {
+        std::string fuse_version;
+
+        // split on the fuse_version_string along with 0 or 1 colon(s)
+        auto tokens = mp::utils::split(fuse_version_line, fmt::format("{}:? ", fuse_version_string));
+        if (tokens.size() == 2)
+            fuse_version = tokens[1];
+
+        if (fuse_version.empty())
+        {
+            mpl::log(mpl::Level::warning, category, fmt::format("Unable to parse the {}", fuse_version_string));
+            mpl::log(mpl::Level::debug, category,
+                     fmt::format("Unable to parse the {}: {}", fuse_version_string, fuse_version_line));
+        }
+        // The option was made the default in libfuse 3.0
+        else if (version::Semver200_version(fuse_version) < version::Semver200_version("3.0.0"))
+        {
+            sshfs_exec += " -o nonempty -o cache_timeout=3";
+        }
+        else
+        {
+            sshfs_exec += " -o dcache_timeout=3";
+        }
+    }
+    else
+    {
+        mpl::log(mpl::Level::warning, category, fmt::format("Unable to retrieve \'{}\'", fuse_version_string));
+    }
+
+    return sshfs_exec;
+}
 
 auto get_sshfs_exec_and_options(mp::SSHSession& session)
 {
@@ -80,49 +131,191 @@ auto get_sshfs_exec_and_options(mp::SSHSession& session)
 
     auto version_info{mpu::run_in_ssh_session(session, fmt::format("sudo {} -V", sshfs_exec))};
 
-    sshfs_exec += " -o slave -o transform_symlinks -o allow_other -o Compression=no";
+    return sshfs_exec_line_for(sshfs_exec, version_info);
+}
 
-    auto fuse_version_line = mp::utils::match_line_for(version_info, fuse_version_string);
-    if (!fuse_version_line.empty())
+// The discovered command line is the same for all mounts, profiles add their options on top of it
+std::string sshfs_exec_line_with(std::string sshfs_exec_line, mp::VMMount::Profile profile, bool writeback_supported)
+{
+    if (profile != mp::VMMount::Profile::Throughput)
+        return sshfs_exec_line;
+
+    // Writes go past 4KiB by default from FUSE 3 on, and only lines for older versions carry nonempty
+    if (sshfs_exec_line.find(" -o nonempty") != std::string::npos)
+        sshfs_exec_line += " -o big_writes";
+
+    sshfs_exec_line += fmt::format(" -o max_read={0} -o max_write={0}", throughput_request_size);
+
+    if (writeback_supported)
+        sshfs_exec_line += " -o writeback_cache=yes";
+
+    return sshfs_exec_line;
+}
+
+// The binary is the last word before the options, e.g. "env LD_LIBRARY_PATH=... /snap/.../bin/sshfs -o slave ..."
+std::string sshfs_binary_from(const std::string& sshfs_exec_line)
+{
+    const auto sshfs_exec = sshfs_exec_line.substr(0, sshfs_exec_line.find(" -o "));
+    return sshfs_exec.substr(sshfs_exec.find_last_of(' ') + 1);
+}
+
+struct GuestMountInfo
+{
+    std::string sshfs_exec_line;
+    std::string leading;
+    std::string missing;
+    int default_uid;
+    int default_gid;
+    bool writeback_supported;
+};
+
+// Probe and prepare the guest in a single round trip: resolve the target, create the missing part of it with the
+// right ownership, and discover sshfs, unless a previously discovered exec line is still valid. The result is
+// reported as "key=value" lines. For the throughput profile, it also finds whether sshfs can cache writes.
+std::string bootstrap_command_for(const std::string& target, const std::string& cached_sshfs_exec_line,
+                                  mp::VMMount::Profile profile)
+{
+    std::string absolute;
+    switch (target[0])
     {
-        std::string fuse_version;
+    case '~':
+        absolute = fmt::format("$(echo ~{})", mpu::escape_for_shell(target.substr(1, target.size() - 1)));
+        break;
+    case '/':
+        absolute = mpu::escape_for_shell(target);
+        break;
+    default:
+        absolute = fmt::format("$PWD/{}", mpu::escape_for_shell(target));
+        break;
+    }
 
-        // split on the fuse_version_string along with 0 or 1 colon(s)
-        auto tokens = mp::utils::split(fuse_version_line, fmt::format("{}:? ", fuse_version_string));
-        if (tokens.size() == 2)
-            fuse_version = tokens[1];
+    const auto cached_binary =
+        cached_sshfs_exec_line.empty() ? std::string{} : sshfs_binary_from(cached_sshfs_exec_line);
+    const auto cached_exec = cached_sshfs_exec_line.substr(0, cached_sshfs_exec_line.find(" -o "));
+    const auto writeback_probe =
+        profile == mp::VMMount::Profile::Throughput
+            ? R"([ -n "$X" ] && sudo $X -h 2>&1 | grep -q writeback_cache && echo "sshfs_writeback=yes")"
+            : "";
 
-        if (fuse_version.empty())
-        {
-            mpl::log(mpl::Level::warning, category, fmt::format("Unable to parse the {}", fuse_version_string));
-            mpl::log(mpl::Level::debug, category,
-                     fmt::format("Unable to parse the {}: {}", fuse_version_string, fuse_version_line));
-        }
-        // The option was made the default in libfuse 3.0
-        else if (version::Semver200_version(fuse_version) < version::Semver200_version("3.0.0"))
-        {
-            sshfs_exec += " -o nonempty -o cache_timeout=3";
-        }
-        else
-        {
-            sshfs_exec += " -o dcache_timeout=3";
-        }
+    return fmt::format(R"END(/bin/bash -s <<'MULTIPASS_BOOTSTRAP'
+T={}
+U=$(id -u)
+G=$(id -g)
+P="$T"; while ! sudo test -d "$P/"; do P="${{P%/*}}"; done
+if [ "$P" != "$T" ]; then
+  M="${{T#"$P"/}}"
+  sudo mkdir -p "$T" && sudo chown -R "$U:$G" "$P/${{M%%/*}}" || exit 1
+fi
+echo "absolute=$T"
+echo "existing=$P/"
+echo "uid=$U"
+echo "gid=$G"
+B={}
+if [ -n "$B" ] && sudo test -x "$B"; then
+  echo "sshfs_cached=yes"
+  X={}
+else
+  if E=$(snap run multipass-sshfs.env 2>/dev/null); then
+    X="env $(echo "$E" | grep '^{}') $(echo "$E" | grep '^{}' | cut -d= -f2-)/bin/sshfs"
+  else
+    X=$(sudo which sshfs)
+  fi
+  echo "sshfs_exec=$X"
+  [ -n "$X" ] && echo "sshfs_version=$(sudo $X -V 2>&1 | grep '{}')"
+fi
+{}
+echo "bootstrap=done"
+MULTIPASS_BOOTSTRAP)END",
+                       absolute, mpu::escape_for_shell(cached_binary), mpu::escape_for_shell(cached_exec),
+                       ld_library_path_key, snap_path_key, fuse_version_string, writeback_probe);
+}
+
+std::optional<GuestMountInfo> bootstrap_mount(mp::SSHSession& session, const std::string& target,
+                                              const std::string& cached_sshfs_exec_line, mp::VMMount::Profile profile)
+{
+    std::string output;
+    try
+    {
+        output = mpu::run_in_ssh_session(session, bootstrap_command_for(target, cached_sshfs_exec_line, profile));
+    }
+    catch (const std::exception& e)
+    {
+        mpl::log(mpl::Level::debug, category, fmt::format("Mount bootstrap script failed: {}", e.what()));
+        return std::nullopt;
+    }
+
+    std::unordered_map<std::string, std::string> values;
+    for (const auto& line : mpu::split(output, "\n"))
+    {
+        if (auto pos = line.find('='); pos != std::string::npos)
+            values[line.substr(0, pos)] = line.substr(pos + 1);
+    }
+
+    if (values["bootstrap"] != "done")
+    {
+        mpl::log(mpl::Level::debug, category, "Unexpected output from the mount bootstrap script");
+        return std::nullopt;
+    }
+
+    GuestMountInfo info;
+    info.leading = values["existing"];
+    info.missing =
+        QDir(QString::fromStdString(info.leading)).relativeFilePath(QString::fromStdString(values["absolute"])).toStdString();
+    info.default_uid = std::stoi(values["uid"]);
+    info.default_gid = std::stoi(values["gid"]);
+    info.writeback_supported = values["sshfs_writeback"] == "yes";
+
+    if (values["sshfs_cached"] == "yes")
+    {
+        info.sshfs_exec_line = cached_sshfs_exec_line;
     }
     else
     {
-        mpl::log(mpl::Level::warning, category, fmt::format("Unable to retrieve \'{}\'", fuse_version_string));
+        const auto sshfs_exec = mpu::trim_end(values["sshfs_exec"]);
+        if (sshfs_exec.empty())
+        {
+            mpl::log(mpl::Level::warning, category, "Unable to determine if 'sshfs' is installed");
+            throw mp::SSHFSMissingError();
+        }
+
+        info.sshfs_exec_line = sshfs_exec_line_for(sshfs_exec, values["sshfs_version"]);
     }
 
-    return sshfs_exec;
+    return info;
+}
+
+// Let the daemon know what was discovered, so that it can skip the discovery next time
+void report_sshfs_exec_line(const std::string& sshfs_exec_line)
+{
+    std::cout << "sshfs exec line: " << sshfs_exec_line << std::endl;
 }
 
-auto make_sftp_server(mp::SSHSession&& session, const std::string& source, const std::string& target,
-                      const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings)
+// The server takes the session when given an rvalue, and shares it otherwise
+template <typename Session>
+std::unique_ptr<mp::SftpServer> make_sftp_server(Session&& session, const std::string& source,
+                                                 const std::string& target, const mp::id_mappings& gid_mappings,
+                                                 const mp::id_mappings& uid_mappings,
+                                                 const std::string& cached_sshfs_exec_line,
+                                                 mp::VMMount::Profile profile)
 {
     mpl::log(mpl::Level::debug, category,
              fmt::format("{}:{} {}(source = {}, target = {}, …): ", __FILE__, __LINE__, __FUNCTION__, source, target));
 
+    const auto max_read_size =
+        profile == mp::VMMount::Profile::Throughput ? throughput_request_size : default_max_read_size;
+
+    if (auto info = bootstrap_mount(session, target, cached_sshfs_exec_line, profile))
+    {
+        report_sshfs_exec_line(info->sshfs_exec_line);
+        return std::make_unique<mp::SftpServer>(
+            std::forward<Session>(session), source, info->leading + info->missing, gid_mappings, uid_mappings,
+            info->default_uid, info->default_gid,
+            sshfs_exec_line_with(info->sshfs_exec_line, profile, info->writeback_supported), max_read_size);
+    }
+
+    // Fall back to probing the guest step by step
     auto sshfs_exec_line = get_sshfs_exec_and_options(session);
+    report_sshfs_exec_line(sshfs_exec_line);
 
     // Split the path in existing and missing parts.
     const auto& [leading, missing] = mpu::get_path_split(session, target);
@@ -145,18 +338,21 @@ auto make_sftp_server(mp::SSHSession&& session, const std::string& source, const
         mpu::set_owner_for(session, leading, missing, default_uid, default_gid);
     }
 
-    return std::make_unique<mp::SftpServer>(std::move(session), source, leading + missing, gid_mappings, uid_mappings,
-                                            default_uid, default_gid, sshfs_exec_line);
+    // Whether writes can be cached is only probed along with the rest, go without it here
+    return std::make_unique<mp::SftpServer>(std::forward<Session>(session), source, leading + missing, gid_mappings,
+                                            uid_mappings, default_uid, default_gid,
+                                            sshfs_exec_line_with(sshfs_exec_line, profile, false), max_read_size);
 }
 
 } // namespace
 
 mp::SshfsMount::SshfsMount(SSHSession&& session, const std::string& source, const std::string& target,
-                           const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings)
-    : sftp_server{make_sftp_server(std::move(session), source, target, gid_mappings, uid_mappings)},
+                           const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings,
+                           const std::string& cached_sshfs_exec_line, mp::VMMount::Profile profile)
+    : sftp_server{make_sftp_server(std::move(session), source, target, gid_mappings, uid_mappings,
+                                   cached_sshfs_exec_line, profile)},
       sftp_thread{[this]() {
           mp::top_catch_all(category, [this] {
-              std::cout << "Connected" << std::endl;
               sftp_server->run();
               std::cout << "Stopped" << std::endl;
           });
@@ -175,3 +371,128 @@ void mp::SshfsMount::stop()
     if (sftp_thread.joinable())
         sftp_thread.join();
 }
+
+mp::SshfsMountGroup::SshfsMountGroup(SSHSession&& session, const std::string& cached_sshfs_exec_line,
+                                     VMMount::Profile profile)
+    : session{std::move(session)},
+      cached_sshfs_exec_line{cached_sshfs_exec_line},
+      profile{profile},
+      serving_thread{[this] { serve(); }}
+{
+}
+
+mp::SshfsMountGroup::~SshfsMountGroup()
+{
+    stop();
+}
+
+void mp::SshfsMountGroup::add(const std::string& source, const std::string& target,
+                              const mp::id_mappings& gid_mappings, const mp::id_mappings& uid_mappings)
+{
+    run_on_serving_thread([this, &source, &target, &gid_mappings, &uid_mappings] {
+        if (sftp_servers.find(target) != sftp_servers.end())
+            throw std::runtime_error{fmt::format("\"{}\" is mounted already", target)};
+
+        sftp_servers[target] =
+            make_sftp_server(session, source, target, gid_mappings, uid_mappings, cached_sshfs_exec_line, profile);
+    });
+}
+
+bool mp::SshfsMountGroup::remove(const std::string& target)
+{
+    bool removed{false};
+    run_on_serving_thread([this, &target, &removed] {
+        if (auto it = sftp_servers.find(target); it != sftp_servers.end())
+        {
+            it->second->stop();
+            sftp_servers.erase(it);
+            removed = true;
+        }
+    });
+
+    return removed;
+}
+
+void mp::SshfsMountGroup::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{tasks_mutex};
+        if (stopping)
+            return;
+        stopping = true;
+    }
+
+    serving_thread.join();
+}
+
+void mp::SshfsMountGroup::run_on_serving_thread(const std::function<void()>& task)
+{
+    // The task goes on in the trace of the caller
+    std::packaged_task<void()> packaged_task{[&task, span_context = mpl::current_span_context()] {
+        mpl::ScopedSpanContext span_scope{span_context};
+        task();
+    }};
+    auto done = packaged_task.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock{tasks_mutex};
+        if (stopping)
+            throw std::runtime_error{"The mounts are stopping"};
+        tasks.push_back(std::move(packaged_task));
+    }
+
+    done.get(); // rethrows what the task threw
+}
+
+void mp::SshfsMountGroup::serve()
+{
+    std::unique_ptr<ssh_event_struct, void (*)(ssh_event)> event{ssh_event_new(), ssh_event_free};
+    ssh_event_add_session(event.get(), session);
+
+    while (true)
+    {
+        decltype(tasks) pending_tasks;
+        bool stop_serving;
+        {
+            std::lock_guard<std::mutex> lock{tasks_mutex};
+            pending_tasks.swap(tasks);
+            stop_serving = stopping;
+        }
+
+        for (auto& task : pending_tasks)
+            task();
+
+        if (stop_serving)
+            break;
+
+        // One request per mount at a time, so that a busy mount does not hold the others up
+        auto served = false;
+        for (auto it = sftp_servers.begin(); it != sftp_servers.end();)
+        {
+            auto& sftp_server = *it->second;
+            if (!sftp_server.has_pending_message())
+            {
+                ++it;
+                continue;
+            }
+
+            served = true;
+            if (mp::top_catch_all(category, false, [&sftp_server] { return sftp_server.handle_next_message(); }))
+            {
+                ++it;
+                continue;
+            }
+
+            mpl::log(mpl::Level::info, category, fmt::format("Stopped serving \"{}\"", it->first));
+            it = sftp_servers.erase(it);
+        }
+
+        // Let requests come in on the session, unless there are more waiting already
+        if (!served && ssh_event_dopoll(event.get(), group_poll_timeout.count()) == SSH_ERROR)
+            std::this_thread::sleep_for(group_poll_timeout); // the session is gone, and the mounts with it
+    }
+
+    for (auto& [target, sftp_server] : sftp_servers)
+        sftp_server->stop();
+    sftp_servers.clear();
+}
@@ -19,20 +19,28 @@
 #define MULTIPASS_SSHFS_MOUNT
 
 #include <multipass/id_mappings.h>
+#include <multipass/ssh/ssh_session.h>
+#include <multipass/vm_mount.h>
 
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 
 namespace multipass
 {
-class SSHSession;
 class SftpServer;
 class SshfsMount
 {
 public:
     SshfsMount(SSHSession&& session, const std::string& source, const std::string& target,
-               const id_mappings& gid_mappings, const id_mappings& uid_mappings);
+               const id_mappings& gid_mappings, const id_mappings& uid_mappings,
+               const std::string& cached_sshfs_exec_line = {},
+               VMMount::Profile profile = VMMount::Profile::Default);
     SshfsMount(SshfsMount&& other);
     ~SshfsMount();
 
@@ -44,5 +52,35 @@ private:
     std::unique_ptr<SftpServer> sftp_server;
     std::thread sftp_thread;
 };
+
+// Serves several mounts over one SSH session, with an SFTP channel each. A libssh session is not to be used from
+// several threads at once, so a single thread sets the mounts up, serves them all, and stops them.
+class SshfsMountGroup
+{
+public:
+    SshfsMountGroup(SSHSession&& session, const std::string& cached_sshfs_exec_line = {},
+                    VMMount::Profile profile = VMMount::Profile::Default);
+    ~SshfsMountGroup();
+
+    // Throws as SshfsMount does when the mount cannot be set up
+    void add(const std::string& source, const std::string& target, const id_mappings& gid_mappings,
+             const id_mappings& uid_mappings);
+    // Returns whether there was a mount at target
+    bool remove(const std::string& target);
+    void stop();
+
+private:
+    void run_on_serving_thread(const std::function<void()>& task);
+    void serve();
+
+    SSHSession session;
+    const std::string cached_sshfs_exec_line;
+    const VMMount::Profile profile;
+    std::unordered_map<std::string, std::unique_ptr<SftpServer>> sftp_servers; // by target, for the serving thread
+    std::mutex tasks_mutex;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stopping{false}; // guarded by tasks_mutex too
+    std::thread serving_thread;
+};
 } // namespace multipass
 #endif // MULTIPASS_SSHFS_MOUNT
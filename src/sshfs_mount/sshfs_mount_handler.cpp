@@ -15,12 +15,19 @@
  *
  */
 
+#include "sftp_server.h"
+
+#include <multipass/constants.h>
 #include <multipass/exceptions/exitless_sshprocess_exception.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
+#include <multipass/json_writer.h>
 #include <multipass/logging/log.h>
+#include <multipass/logging/trace.h>
+#include <multipass/metrics.h>
 #include <multipass/platform.h>
+#include <multipass/settings/settings.h>
 #include <multipass/ssh/ssh_key_provider.h>
 #include <multipass/sshfs_mount/sshfs_mount_handler.h>
 #include <multipass/utils.h>
@@ -29,6 +36,18 @@
 
 #include <QDir>
 #include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <optional>
+#include <sstream>
+#include <unordered_set>
 
 namespace mp = multipass;
 namespace mpl = multipass::logging;
@@ -36,6 +55,62 @@ namespace mpl = multipass::logging;
 namespace
 {
 constexpr auto category = "sshfs-mount-handler";
+constexpr auto sshfs_exec_lines_file_name = "sshfs-exec-lines.json";
+const std::string sshfs_exec_line_marker{"sshfs exec line: "}; // Magic string printed by sshfs_server
+constexpr auto max_parallel_mount_starts = 4u; // per instance
+
+std::unordered_map<std::string, std::string> load_sshfs_exec_lines(const QString& path)
+{
+    std::unordered_map<std::string, std::string> sshfs_exec_lines;
+    if (path.isEmpty())
+        return sshfs_exec_lines;
+
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly))
+        return sshfs_exec_lines;
+
+    const auto records = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = records.constBegin(); it != records.constEnd(); ++it)
+        sshfs_exec_lines[it.key().toStdString()] = it.value().toString().toStdString();
+
+    return sshfs_exec_lines;
+}
+
+std::string serialise_id_mappings(const mp::id_mappings& xid_mappings)
+{
+    std::string out;
+    for (const auto& [from, to] : xid_mappings)
+        out += fmt::format("{}:{},", from, to);
+
+    return out;
+}
+
+bool starts_with(const std::string& line, const char* marker)
+{
+    return line.compare(0, std::strlen(marker), marker) == 0;
+}
+
+// sshfs_server reports what its SFTP requests took since the last report, for us to serve along with our own
+// metrics, and passes on its spans, for us to export along with our own
+void take_report(const std::string& line)
+{
+    if (starts_with(line, mp::sftp_stats_marker))
+    {
+        std::istringstream report{line.substr(std::strlen(mp::sftp_stats_marker))};
+        std::string op, serialised;
+        if (report >> op && std::getline(report >> std::ws, serialised))
+        {
+            if (auto delta = mp::metrics::Histogram::Snapshot::deserialise(serialised))
+                MP_METRICS.histogram(mp::sftp_request_duration_metric, mp::sftp_request_duration_help, {{"op", op}})
+                    .add(*delta);
+        }
+    }
+    else if (starts_with(line, mp::span_marker))
+    {
+        if (auto span = mpl::SpanData::from_json(line.substr(std::strlen(mp::span_marker))))
+            mpl::export_span(*span);
+    }
+}
 
 template <typename Signal>
 void start_and_block_until(mp::Process* process, Signal signal, std::function<bool(mp::Process* process)> ready_decider)
@@ -120,9 +195,24 @@ void install_sshfs_for(const std::string& name, mp::SSHSession& session, std::fu
         throw mp::SSHFSMissingError();
     }
 }
+void terminate_process(mp::Process& process, const std::string& instance, const std::string& description)
+{
+    mpl::log(mpl::Level::info, category, fmt::format("Stopping {} in instance \"{}\"", description, instance));
+    process.terminate();
+
+    if (!process.wait_for_finished(1000))
+    {
+        mpl::log(mpl::Level::info, category,
+                 fmt::format("Failed to terminate {} in instance \"{}\", killing", description, instance));
+        process.kill();
+    }
+}
 } // namespace
 
-mp::SSHFSMountHandler::SSHFSMountHandler(const SSHKeyProvider& key_provider) : MountHandler(key_provider)
+mp::SSHFSMountHandler::SSHFSMountHandler(const SSHKeyProvider& key_provider, const QString& cache_dir)
+    : MountHandler(key_provider),
+      sshfs_exec_lines_path{cache_dir.isEmpty() ? QString{} : QDir{cache_dir}.filePath(sshfs_exec_lines_file_name)},
+      sshfs_exec_lines{load_sshfs_exec_lines(sshfs_exec_lines_path)}
 {
 }
 
@@ -147,14 +237,199 @@ void mp::SSHFSMountHandler::init_mount(VirtualMachine* vm, const std::string& ta
     config.source_path = vm_mount.source_path;
     config.uid_mappings = vm_mount.uid_mappings;
     config.gid_mappings = vm_mount.gid_mappings;
+    config.profile = vm_mount.profile;
     config.private_key = ssh_key_provider->private_key_as_base64();
 
     sshfs_server_configs[vm->vm_name][target_path] = config;
+    failed_mounts[vm->vm_name].erase(target_path);
 }
 
 void mp::SSHFSMountHandler::start_mount(VirtualMachine* vm, ServerVariant server, const std::string& target_path,
                                         const std::chrono::milliseconds& timeout)
 {
+    if (already_started(vm->vm_name, target_path))
+        return;
+
+    try
+    {
+        start_mount_process(vm, server, target_path, timeout);
+    }
+    catch (const mp::SSHFSMissingError&)
+    {
+        if (!drop_sshfs_exec_line(vm->vm_name))
+            throw;
+
+        start_mount_process(vm, server, target_path, timeout);
+    }
+}
+
+std::unordered_map<std::string, std::exception_ptr>
+mp::SSHFSMountHandler::start_mounts(VirtualMachine* vm, ServerVariant server,
+                                    const std::vector<std::string>& target_paths,
+                                    const std::chrono::milliseconds& timeout)
+{
+    // A shared sshfs_server brings all the pending mounts up at once already
+    if (target_paths.size() < 2 || MP_SETTINGS.get_as<bool>(mp::sshfs_shared_server_key))
+        return MountHandler::start_mounts(vm, server, target_paths, timeout);
+
+    std::unordered_map<std::string, std::exception_ptr> errors;
+    std::deque<std::string> queued_targets;
+    for (const auto& target_path : target_paths)
+    {
+        try
+        {
+            if (!already_started(vm->vm_name, target_path))
+                queued_targets.push_back(target_path);
+        }
+        catch (...)
+        {
+            errors[target_path] = std::current_exception();
+        }
+    }
+
+    if (queued_targets.empty())
+        return errors;
+
+    const auto had_sshfs_exec_line = sshfs_exec_lines.count(vm->vm_name) > 0;
+    try
+    {
+        install_sshfs_if_needed(vm, server, timeout);
+    }
+    catch (...)
+    {
+        for (const auto& target_path : queued_targets)
+            errors[target_path] = std::current_exception();
+
+        return errors;
+    }
+
+    // Each sshfs_server spends most of its start waiting on the instance, so several of them are started at
+    // once, and the event loop is woken up whenever one of them is either serving its mount or gone
+    struct StartingMount
+    {
+        MountProcess mount;
+        QByteArray output;
+        bool done{false};
+        std::vector<QMetaObject::Connection> connections;
+    };
+    std::list<StartingMount> starting_mounts;
+    std::vector<std::string> sshfs_missing_targets;
+    QEventLoop event_loop;
+
+    auto start_queued_mounts = [&] {
+        while (!queued_targets.empty() && starting_mounts.size() < max_parallel_mount_starts)
+        {
+            const auto target_path = queued_targets.front();
+            queued_targets.pop_front();
+
+            try
+            {
+                auto& starting = starting_mounts.emplace_back(StartingMount{make_mount_process(vm, target_path)});
+                auto process = starting.mount.process.get();
+
+                starting.connections.push_back(
+                    QObject::connect(process, &mp::Process::finished, [&starting, &event_loop](mp::ProcessState) {
+                        starting.done = true;
+                        event_loop.quit();
+                    }));
+                starting.connections.push_back(QObject::connect(
+                    process, &mp::Process::ready_read_standard_output, [&starting, process, &event_loop]() {
+                        starting.output += process->read_all_standard_output();
+                        if (starting.output.contains("Connected")) // Magic string printed by sshfs_server
+                        {
+                            starting.done = true;
+                            event_loop.quit();
+                        }
+                    }));
+
+                process->start();
+            }
+            catch (...)
+            {
+                errors[target_path] = std::current_exception();
+            }
+        }
+    };
+
+    start_queued_mounts();
+    while (!starting_mounts.empty())
+    {
+        auto is_done = [](const StartingMount& starting) { return starting.done; };
+        if (std::none_of(starting_mounts.cbegin(), starting_mounts.cend(), is_done))
+            event_loop.exec();
+
+        for (auto it = starting_mounts.begin(); it != starting_mounts.end();)
+        {
+            if (!it->done)
+            {
+                ++it;
+                continue;
+            }
+
+            for (const auto& connection : it->connections)
+                QObject::disconnect(connection);
+
+            try
+            {
+                register_mount_process(vm, it->mount, it->output);
+            }
+            catch (const mp::SSHFSMissingError&)
+            {
+                sshfs_missing_targets.push_back(it->mount.target_path);
+            }
+            catch (...)
+            {
+                errors[it->mount.target_path] = std::current_exception();
+            }
+
+            it = starting_mounts.erase(it);
+        }
+
+        start_queued_mounts();
+    }
+
+    // The sshfs found earlier may be gone from the instance, in which case the installation is gone through again
+    const auto retry = had_sshfs_exec_line && !sshfs_missing_targets.empty() && drop_sshfs_exec_line(vm->vm_name);
+    for (const auto& target_path : sshfs_missing_targets)
+    {
+        try
+        {
+            if (!retry)
+                throw mp::SSHFSMissingError();
+
+            start_mount_process(vm, server, target_path, timeout);
+        }
+        catch (...)
+        {
+            errors[target_path] = std::current_exception();
+        }
+    }
+
+    return errors;
+}
+
+bool mp::SSHFSMountHandler::already_started(const std::string& instance, const std::string& target_path)
+{
+    // The mount may have been started already, along with another one of the same instance
+    if (auto failed_mount = failed_mounts[instance].extract(target_path))
+        throw std::runtime_error(failed_mount.mapped());
+
+    if (has_instance_already_mounted(instance, target_path))
+    {
+        sshfs_server_configs[instance].erase(target_path);
+        return true;
+    }
+
+    return false;
+}
+
+void mp::SSHFSMountHandler::install_sshfs_if_needed(VirtualMachine* vm, ServerVariant server,
+                                                    const std::chrono::milliseconds& timeout)
+{
+    // Once sshfs was found in the instance, there is no need to check its installation anymore
+    if (sshfs_exec_lines.find(vm->vm_name) != sshfs_exec_lines.end())
+        return;
+
     SSHSession session{vm->ssh_hostname(), vm->ssh_port(), vm->ssh_username(), *ssh_key_provider};
     std::visit(
         [this, vm, &session, &timeout](auto&& server) {
@@ -170,34 +445,217 @@ void mp::SSHFSMountHandler::start_mount(VirtualMachine* vm, ServerVariant server
             install_sshfs_for(vm->vm_name, session, on_install, timeout);
         },
         server);
+}
+
+bool mp::SSHFSMountHandler::drop_sshfs_exec_line(const std::string& instance)
+{
+    if (sshfs_exec_lines.erase(instance) == 0)
+        return false;
+
+    mpl::log(mpl::Level::debug, category,
+             fmt::format("Cached sshfs command line for \"{}\" is no longer valid", instance));
+    persist_sshfs_exec_lines();
+
+    return true;
+}
+
+void mp::SSHFSMountHandler::start_mount_process(VirtualMachine* vm, ServerVariant server,
+                                                const std::string& target_path,
+                                                const std::chrono::milliseconds& timeout)
+{
+    install_sshfs_if_needed(vm, server, timeout);
+
+    if (join_shared_server(vm, target_path, timeout))
+        return;
+
+    auto mount = make_mount_process(vm, target_path);
+
+    QByteArray output;
+    start_and_block_until(mount.process.get(), &mp::Process::ready_read_standard_output,
+                          [&output](mp::Process* process) {
+                              output += process->read_all_standard_output();
+                              return output.contains("Connected"); // Magic string printed by sshfs_server
+                          });
+
+    register_mount_process(vm, mount, output);
+}
+
+bool mp::SSHFSMountHandler::join_shared_server(VirtualMachine* vm, const std::string& target_path,
+                                               const std::chrono::milliseconds& timeout)
+{
+    if (!MP_SETTINGS.get_as<bool>(mp::sshfs_shared_server_key))
+        return false;
+
+    // Mount requests are lines of tab-separated fields
+    const auto config = sshfs_server_configs[vm->vm_name][target_path];
+    const auto fits_request = [](const std::string& path) { return path.find_first_of("\t\n") == std::string::npos; };
+    if (!fits_request(config.source_path) || !fits_request(target_path))
+        return false;
+
+    // The profile is one for the whole process
+    std::shared_ptr<Process> process;
+    for (const auto& [other_target, other_process] : mount_processes[vm->vm_name])
+    {
+        auto it = shared_servers.find(other_process.get());
+        if (it != shared_servers.end() && it->second.config.profile == config.profile)
+        {
+            process = other_process;
+            break;
+        }
+    }
+
+    if (!process)
+        return false;
+
+    // The process may only reach the paths in its confinement
+    auto& shared_config = shared_servers[process.get()].config;
+    auto& mounts = shared_config.additional_mounts;
+    mounts.erase(std::remove_if(mounts.begin(), mounts.end(),
+                                [&target_path](const auto& mount) { return mount.target_path == target_path; }),
+                 mounts.end());
+    mounts.push_back({config.source_path, target_path, config.gid_mappings, config.uid_mappings});
+    if (!mp::platform::update_sshfs_server_confinement(shared_config))
+    {
+        mounts.pop_back();
+        return false;
+    }
+
+    mpl::log(mpl::Level::info, category,
+             fmt::format("Adding mount '{}' to the sshfs_server of instance \"{}\"", target_path, vm->vm_name));
+    process->write(QByteArray::fromStdString(fmt::format("mount {}\t{}\t{}\t{}\n", config.source_path, target_path,
+                                                         serialise_id_mappings(config.uid_mappings),
+                                                         serialise_id_mappings(config.gid_mappings))));
+
+    // sshfs_server reports on the mount in a line of its own, which the output reader sets aside for us
+    const auto mounted = fmt::format("Mounted \"{}\"", target_path);
+    const auto failed = fmt::format("Failed to mount \"{}\": ", target_path);
+    auto take_reply = [this, process = process.get(), &mounted, &failed]() -> std::optional<std::string> {
+        auto it = shared_servers.find(process);
+        if (it == shared_servers.end())
+            return std::nullopt;
+
+        auto& replies = it->second.replies;
+        auto reply = std::find_if(replies.begin(), replies.end(), [&mounted, &failed](const std::string& line) {
+            return line == mounted || line.compare(0, failed.size(), failed) == 0;
+        });
+        if (reply == replies.end())
+            return std::nullopt;
+
+        auto ret = *reply;
+        replies.erase(reply);
+        return ret;
+    };
+
+    QEventLoop event_loop;
+    QTimer timer;
+    timer.setSingleShot(true);
+    auto finished = false;
+    QObject::connect(&timer, &QTimer::timeout, &event_loop, &QEventLoop::quit);
+    QObject::connect(process.get(), &mp::Process::finished, &event_loop, [&event_loop, &finished](mp::ProcessState) {
+        finished = true;
+        event_loop.quit();
+    });
+    QObject::connect(process.get(), &mp::Process::ready_read_standard_output, &event_loop, &QEventLoop::quit);
+
+    std::optional<std::string> reply;
+    timer.start(timeout);
+    while (!(reply = take_reply()) && !finished && timer.isActive())
+        event_loop.exec();
+
+    if (reply == mounted)
+    {
+        sshfs_server_configs[vm->vm_name].erase(target_path);
+        mount_processes[vm->vm_name][target_path] = process;
+        return true;
+    }
 
-    auto config = sshfs_server_configs[vm->vm_name][target_path];
+    // The confinement is narrowed again along with the next mount
+    if (auto it = shared_servers.find(process.get()); it != shared_servers.end())
+    {
+        auto& mounts = it->second.config.additional_mounts;
+        mounts.erase(std::remove_if(mounts.begin(), mounts.end(),
+                                    [&target_path](const auto& mount) { return mount.target_path == target_path; }),
+                     mounts.end());
+    }
+
+    if (!reply && !finished)
+        process->write(QByteArray::fromStdString(fmt::format("stop {}\n", target_path))); // in case it comes up late
+
+    throw std::runtime_error(reply ? reply->substr(failed.size()) : "sshfs_server did not report on the mount");
+}
+
+mp::SSHFSMountHandler::MountProcess mp::SSHFSMountHandler::make_mount_process(VirtualMachine* vm,
+                                                                             const std::string& target_path)
+{
+    auto& pending_configs = sshfs_server_configs[vm->vm_name];
+    auto config = pending_configs[target_path];
     // Can't obtain hostname/IP address until instance is running
     config.host = vm->ssh_hostname();
+    config.report_sftp_stats = MP_METRICS.is_served();
+    if (const auto span_context = mpl::current_span_context(); mpl::is_tracing() && span_context.is_valid())
+        config.trace_parent = span_context.to_traceparent();
+    const auto cached_sshfs_exec_line = sshfs_exec_lines.find(vm->vm_name);
+    if (cached_sshfs_exec_line != sshfs_exec_lines.end())
+        config.sshfs_exec_line = cached_sshfs_exec_line->second;
+
+    // Serve the other mounts waiting to start in this instance from the same process, if so configured, and let
+    // later ones join it
+    std::vector<std::string> targets{target_path};
+    config.shared_server = MP_SETTINGS.get_as<bool>(mp::sshfs_shared_server_key);
+    if (pending_configs.size() > 1 && config.shared_server)
+    {
+        for (const auto& [other_target, other_config] : pending_configs)
+        {
+            // The profile is one for the whole process
+            if (other_target == target_path || other_config.profile != config.profile ||
+                has_instance_already_mounted(vm->vm_name, other_target))
+                continue;
+
+            config.additional_mounts.push_back(
+                {other_config.source_path, other_target, other_config.gid_mappings, other_config.uid_mappings});
+            targets.push_back(other_target);
+        }
+    }
 
     auto sshfs_server_process_t = mp::platform::make_sshfs_server_process(config);
     // FIXME: ProcessFactory really should return qt_delete_later_unique_ptr<Process> as Process emits signals
     // and the respective slots may be called on the event loop, but unique_ptr can delete the Process before
-    // the slots are fired, causing a crash.
-    mp::qt_delete_later_unique_ptr<mp::Process> sshfs_server_process(sshfs_server_process_t.release());
+    // the slots are fired, causing a crash. The same process may serve several mounts, hence the shared_ptr.
+    std::shared_ptr<mp::Process> sshfs_server_process(sshfs_server_process_t.release(), mp::QtDeleteLater{});
+    if (config.shared_server)
+        shared_servers[sshfs_server_process.get()] = {config, {}};
 
     QObject::connect(
         sshfs_server_process.get(), &mp::Process::finished, this,
-        [this, instance = vm->vm_name, target_path](mp::ProcessState exit_state) {
-            if (exit_state.completed_successfully())
-            {
-                mpl::log(mpl::Level::info, category,
-                         fmt::format("Mount '{}' in instance \"{}\" has stopped", target_path, instance));
-            }
-            else
+        [this, instance = vm->vm_name, process = sshfs_server_process.get()](mp::ProcessState exit_state) {
+            shared_servers.erase(process);
+
+            // Mounts may have joined the process after it started, so go by the process rather than its targets
+            auto& instance_mounts = mount_processes[instance];
+            for (auto it = instance_mounts.begin(); it != instance_mounts.end();)
             {
-                mpl::log(mpl::Level::warning, // not error as it failing can indicate we need to install sshfs in the VM
-                         category,
-                         fmt::format("Mount '{}' in instance \"{}\" has stopped unexpectedly: {}", target_path,
-                                     instance, exit_state.failure_message()));
-            }
+                if (it->second.get() != process)
+                {
+                    ++it;
+                    continue;
+                }
 
-            mount_processes[instance].erase(target_path);
+                const auto& target_path = it->first;
+                if (exit_state.completed_successfully())
+                {
+                    mpl::log(mpl::Level::info, category,
+                             fmt::format("Mount '{}' in instance \"{}\" has stopped", target_path, instance));
+                }
+                else
+                {
+                    mpl::log(mpl::Level::warning, // not error as it failing can indicate we need to install sshfs
+                             category,
+                             fmt::format("Mount '{}' in instance \"{}\" has stopped unexpectedly: {}", target_path,
+                                         instance, exit_state.failure_message()));
+                }
+
+                it = instance_mounts.erase(it);
+            }
         });
 
     QObject::connect(
@@ -214,10 +672,13 @@ void mp::SSHFSMountHandler::start_mount(VirtualMachine* vm, ServerVariant server
     mpl::log(mpl::Level::info, category,
              fmt::format("process arguments '{}'", sshfs_server_process->arguments().join(", ").toStdString()));
 
-    start_and_block_until(
-        sshfs_server_process.get(), &mp::Process::ready_read_standard_output, [](mp::Process* process) {
-            return process->read_all_standard_output().contains("Connected"); // Magic string printed by sshfs_server
-        });
+    return {target_path, targets, sshfs_server_process};
+}
+
+void mp::SSHFSMountHandler::register_mount_process(VirtualMachine* vm, const MountProcess& mount, QByteArray output)
+{
+    const auto& [target_path, targets, sshfs_server_process] = mount;
+    output += sshfs_server_process->read_all_standard_output();
 
     // Check in case sshfs_server stopped, usually due to an error
     auto process_state = sshfs_server_process->process_state();
@@ -225,18 +686,110 @@ void mp::SSHFSMountHandler::start_mount(VirtualMachine* vm, ServerVariant server
     {
         throw mp::SSHFSMissingError();
     }
-    else if (process_state.exit_code || process_state.error)
+
+    std::vector<std::string> started_targets{target_path};
+    std::optional<std::string> mount_error;
+    const auto shared = shared_servers.find(sshfs_server_process.get()) != shared_servers.end();
+    if (shared)
+    {
+        // The mount that was asked for is reported right away, the others when they are asked for
+        started_targets = sort_out_group_mounts(vm->vm_name, targets, output.toStdString());
+        if (auto failed_mount = failed_mounts[vm->vm_name].extract(target_path))
+            mount_error = failed_mount.mapped();
+    }
+
+    if (!mount_error && (process_state.exit_code || process_state.error))
     {
         throw std::runtime_error(
             fmt::format("{}: {}", process_state.failure_message(), sshfs_server_process->read_all_standard_error()));
     }
 
-    sshfs_server_configs[vm->vm_name].erase(target_path);
-    mount_processes[vm->vm_name][target_path] = std::move(sshfs_server_process);
+    auto sshfs_exec_line = mp::utils::match_line_for(output.toStdString(), sshfs_exec_line_marker);
+    if (!sshfs_exec_line.empty())
+    {
+        sshfs_exec_line = sshfs_exec_line.substr(sshfs_exec_line.find(sshfs_exec_line_marker) +
+                                                 sshfs_exec_line_marker.size());
+        mp::utils::trim_end(sshfs_exec_line);
+        auto& cached = sshfs_exec_lines[vm->vm_name];
+        if (cached != sshfs_exec_line)
+        {
+            cached = sshfs_exec_line;
+            persist_sshfs_exec_lines();
+        }
+    }
+
+    for (const auto& started_target : started_targets)
+    {
+        sshfs_server_configs[vm->vm_name].erase(started_target);
+        mount_processes[vm->vm_name][started_target] = sshfs_server_process;
+    }
+
+    if (MP_METRICS.is_served() || mpl::is_tracing() || shared)
+    {
+        // Spans may come before the process is ready already
+        std::istringstream startup_output{output.toStdString()};
+        for (std::string line; std::getline(startup_output, line);)
+            take_report(line);
+
+        // Reports come in lines of their own, which may arrive in pieces; those on mounts that were asked for later
+        // are set aside for join_shared_server()
+        auto process = sshfs_server_process.get();
+        QObject::connect(process, &mp::Process::ready_read_standard_output, process,
+                         [this, process, pending = std::string{}]() mutable {
+                             pending += process->read_all_standard_output().toStdString();
+                             for (auto end = pending.find('\n'); end != std::string::npos; end = pending.find('\n'))
+                             {
+                                 auto line = pending.substr(0, end);
+                                 pending.erase(0, end + 1);
+
+                                 take_report(line);
+                                 auto it = shared_servers.find(process);
+                                 if (it != shared_servers.end() &&
+                                     (starts_with(line, "Mounted \"") || starts_with(line, "Failed to mount \"")))
+                                     it->second.replies.push_back(std::move(line));
+                             }
+                         });
+    }
+
+    if (mount_error)
+        throw std::runtime_error(*mount_error);
+}
+
+std::vector<std::string> mp::SSHFSMountHandler::sort_out_group_mounts(const std::string& instance,
+                                                                      const std::vector<std::string>& targets,
+                                                                      const std::string& output)
+{
+    // sshfs_server reports on each mount with one of these lines
+    auto report_for = [&output](const std::string& prefix) -> std::optional<std::string> {
+        auto line = mp::utils::match_line_for(output, prefix);
+        if (line.empty())
+            return std::nullopt;
+
+        line = line.substr(line.find(prefix) + prefix.size());
+        return mp::utils::trim_end(line);
+    };
+
+    std::vector<std::string> started_targets;
+    for (const auto& target : targets)
+    {
+        if (report_for(fmt::format("Mounted \"{}\"", target)))
+        {
+            started_targets.push_back(target);
+            continue;
+        }
+
+        auto error = report_for(fmt::format("Failed to mount \"{}\": ", target));
+        failed_mounts[instance][target] = error ? *error : "sshfs_server did not report on the mount";
+    }
+
+    return started_targets;
 }
 
 void mp::SSHFSMountHandler::stop_mount(const std::string& instance, const std::string& path)
 {
+    sshfs_server_configs[instance].erase(path);
+    failed_mounts[instance].erase(path);
+
     auto sshfs_mount_it = mount_processes.find(instance);
     if (sshfs_mount_it == mount_processes.end())
     {
@@ -249,21 +802,32 @@ void mp::SSHFSMountHandler::stop_mount(const std::string& instance, const std::s
     auto map_entry = sshfs_mount_map.find(path);
     if (map_entry != sshfs_mount_map.end())
     {
-        auto& sshfs_mount = map_entry->second;
-        mpl::log(mpl::Level::info, category, fmt::format("Stopping mount '{}' in instance \"{}\"", path, instance));
-        sshfs_mount->terminate();
+        auto sshfs_mount = map_entry->second;
+        auto shared =
+            std::any_of(sshfs_mount_map.cbegin(), sshfs_mount_map.cend(), [&path, &sshfs_mount](const auto& entry) {
+                return entry.first != path && entry.second == sshfs_mount;
+            });
 
-        if (!sshfs_mount->wait_for_finished(1000))
+        if (shared)
         {
+            // Other mounts are still being served by this process, so only ask it to drop this one
             mpl::log(mpl::Level::info, category,
-                     fmt::format("Failed to terminate mount '{}' in instance \"{}\", killing", path, instance));
-            sshfs_mount->kill();
+                     fmt::format("Stopping mount '{}' in instance \"{}\"", path, instance));
+            sshfs_mount->write(QByteArray::fromStdString(fmt::format("stop {}\n", path)));
+            sshfs_mount_map.erase(map_entry);
+        }
+        else
+        {
+            terminate_process(*sshfs_mount, instance, fmt::format("mount '{}'", path));
         }
     }
 }
 
 void mp::SSHFSMountHandler::stop_all_mounts_for_instance(const std::string& instance)
 {
+    sshfs_server_configs.erase(instance);
+    failed_mounts.erase(instance);
+
     auto mounts_it = mount_processes.find(instance);
     if (mounts_it == mount_processes.end() || mounts_it->second.empty())
     {
@@ -271,12 +835,18 @@ void mp::SSHFSMountHandler::stop_all_mounts_for_instance(const std::string& inst
     }
     else
     {
-        for (auto it = mounts_it->second.cbegin(); it != mounts_it->second.cend();)
+        // Processes can serve several mounts, and the map is modified in their finished signal handlers,
+        // so gather them first
+        std::vector<std::pair<std::string, std::shared_ptr<Process>>> processes;
+        std::unordered_set<Process*> seen;
+        for (const auto& [path, process] : mounts_it->second)
         {
-            // Clever postfix increment with member access needed to prevent iterator invalidation since iterable is
-            // modified in sshfs connection signal handler
-            stop_mount(instance, it++->first);
+            if (seen.insert(process.get()).second)
+                processes.emplace_back(path, process);
         }
+
+        for (const auto& [path, process] : processes)
+            terminate_process(*process, instance, fmt::format("mount '{}'", path));
     }
     mount_processes[instance].clear();
 }
@@ -286,3 +856,15 @@ bool mp::SSHFSMountHandler::has_instance_already_mounted(const std::string& inst
     auto entry = mount_processes.find(instance);
     return entry != mount_processes.end() && entry->second.find(path) != entry->second.end();
 }
+
+void mp::SSHFSMountHandler::persist_sshfs_exec_lines() const
+{
+    if (sshfs_exec_lines_path.isEmpty())
+        return;
+
+    QJsonObject records;
+    for (const auto& [instance, sshfs_exec_line] : sshfs_exec_lines)
+        records.insert(QString::fromStdString(instance), QString::fromStdString(sshfs_exec_line));
+
+    mp::write_json(records, sshfs_exec_lines_path);
+}
@@ -15,12 +15,18 @@
  *
  */
 
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <QStringList>
 
+#include "sftp_server.h"
 #include "sshfs_mount.h"
 
 #include <multipass/exceptions/sshfs_missing_error.h>
@@ -28,6 +34,8 @@
 #include <multipass/logging/log.h>
 #include <multipass/logging/multiplexing_logger.h>
 #include <multipass/logging/standard_logger.h>
+#include <multipass/logging/trace.h>
+#include <multipass/metrics.h>
 #include <multipass/platform.h>
 #include <multipass/ssh/ssh_session.h>
 
@@ -69,11 +77,137 @@ mp::id_mappings convert_id_mappings(const char* in)
 
     return ret_map;
 }
+
+struct MountArgs
+{
+    string source_path;
+    string target_path;
+    mp::id_mappings uid_mappings;
+    mp::id_mappings gid_mappings;
+};
+
+// The daemon exports our spans along with its own
+class StdoutSpanExporter : public mpl::SpanExporter
+{
+public:
+    void export_span(const mpl::SpanData& span) override
+    {
+        const auto line = mp::span_marker + span.to_json() + "\n";
+
+        lock_guard<mutex> lock{stdout_mutex};
+        cout << line << flush;
+    }
+
+private:
+    mutex stdout_mutex;
+};
+
+// Reports on each mount, for the daemon to tell which of them are served
+bool add_mount(mp::SshfsMountGroup& sshfs_mounts, const MountArgs& args)
+{
+    mpl::Span span{"sshfs_server mount"};
+    span.set_attribute("process", "sshfs_server");
+    span.set_attribute("target", args.target_path);
+
+    try
+    {
+        sshfs_mounts.add(args.source_path, args.target_path, args.gid_mappings, args.uid_mappings);
+    }
+    catch (const mp::SSHFSMissingError& e)
+    {
+        span.set_failed();
+        cout << "Failed to mount \"" << args.target_path << "\": " << e.what() << endl;
+        throw; // no mount of the instance can be served
+    }
+    catch (const exception& e)
+    {
+        span.set_failed();
+        cout << "Failed to mount \"" << args.target_path << "\": " << e.what() << endl;
+        return false;
+    }
+
+    cout << "Mounted \"" << args.target_path << "\"" << endl;
+    return true;
+}
+
+// The daemon asks for more mounts, as "mount <source>\t<target>\t<uid mappings>\t<gid mappings>", and for single ones
+// to be stopped, as "stop <target>", through our stdin
+void listen_for_mount_requests(mp::SshfsMountGroup& sshfs_mounts)
+{
+    thread{[&sshfs_mounts, span_context = mpl::current_span_context()] {
+        mpl::ScopedSpanContext span_scope{span_context};
+
+        const string mount_request{"mount "}, stop_request{"stop "};
+        string line;
+        while (getline(cin, line))
+        {
+            try
+            {
+                if (line.compare(0, mount_request.size(), mount_request) == 0)
+                {
+                    const auto fields = QString::fromStdString(line.substr(mount_request.size())).split('\t');
+                    if (fields.size() != 4)
+                    {
+                        cerr << "Incorrect mount request" << endl;
+                        continue;
+                    }
+
+                    add_mount(sshfs_mounts, {fields[0].toStdString(), fields[1].toStdString(),
+                                             convert_id_mappings(qUtf8Printable(fields[2])),
+                                             convert_id_mappings(qUtf8Printable(fields[3]))});
+                }
+                else if (line.compare(0, stop_request.size(), stop_request) == 0)
+                {
+                    const auto target = line.substr(stop_request.size());
+                    if (sshfs_mounts.remove(target))
+                        cout << "Unmounted \"" << target << "\"" << endl;
+                }
+            }
+            catch (const mp::SSHFSMissingError&)
+            {
+                continue; // reported already
+            }
+            catch (const exception&)
+            {
+                return; // the mounts are stopping
+            }
+        }
+    }}.detach();
+}
+
+// The daemon serves our SFTP request timings along with its own metrics, so we pass on what changed every so often
+void report_sftp_stats()
+{
+    thread{[] {
+        map<string, mp::metrics::Histogram::Snapshot> reported;
+        while (true)
+        {
+            this_thread::sleep_for(chrono::seconds{10});
+
+            string report;
+            for (const auto& [labels, snapshot] : MP_METRICS.histogram_snapshots(mp::sftp_request_duration_metric))
+            {
+                const auto& op = labels.front().second;
+                const auto delta = snapshot - reported[op];
+                if (delta.count() == 0)
+                    continue;
+
+                report += mp::sftp_stats_marker + op + " " + delta.serialise() + "\n";
+                reported[op] = snapshot;
+            }
+
+            if (!report.empty())
+                cout << report << flush; // all at once, so that it does not mix with other lines
+        }
+    }}.detach();
+}
 } // namespace
 
 int main(int argc, char* argv[])
 {
-    if (argc != 9)
+    // The arguments for one mount, optionally followed by groups of <source> <target> <uid mappings> <gid mappings>
+    // for more mounts to serve from this same process
+    if (argc < 9 || (argc - 9) % 4 != 0)
     {
         cerr << "Incorrect arguments" << endl;
         exit(2);
@@ -86,15 +220,26 @@ int main(int argc, char* argv[])
         exit(2);
     }
     const auto priv_key_blob = string(key);
+    // Optional: a previously discovered sshfs command line, lets the mount skip probing the instance for sshfs
+    const auto cached_sshfs_exec_line = qEnvironmentVariable("SSHFS_EXEC_LINE").toStdString();
+    const auto report_stats = qEnvironmentVariableIsSet("SSHFS_REPORT_STATS");
+    // Optional: the span that the daemon starts the mounts in, to trace them as part of it
+    const auto trace_parent =
+        mpl::SpanContext::from_traceparent(qEnvironmentVariable("SSHFS_TRACE_PARENT").toStdString());
+    const auto profile = qEnvironmentVariable("SSHFS_PROFILE") == "throughput" ? mp::VMMount::Profile::Throughput
+                                                                                : mp::VMMount::Profile::Default;
+    // Optional: serve more mounts of the instance over the same session, as the daemon asks for them
+    const auto shared_server = qEnvironmentVariableIsSet("SSHFS_SHARED_SERVER");
     const auto host = string(argv[1]);
     const int port = atoi(argv[2]);
     const auto username = string(argv[3]);
-    const auto source_path = string(argv[4]);
-    const auto target_path = string(argv[5]);
-    const mp::id_mappings uid_mappings = convert_id_mappings(argv[6]);
-    const mp::id_mappings gid_mappings = convert_id_mappings(argv[7]);
     const mpl::Level log_level = static_cast<mpl::Level>(atoi(argv[8]));
 
+    vector<MountArgs> mount_args{{argv[4], argv[5], convert_id_mappings(argv[6]), convert_id_mappings(argv[7])}};
+    for (int i = 9; i < argc; i += 4)
+        mount_args.push_back(
+            {argv[i], argv[i + 1], convert_id_mappings(argv[i + 2]), convert_id_mappings(argv[i + 3])});
+
     auto logger = mpp::make_logger(log_level);
     if (!logger)
         logger = std::make_unique<mpl::StandardLogger>(log_level);
@@ -103,18 +248,71 @@ int main(int argc, char* argv[])
     auto standard_logger = std::make_shared<mpl::MultiplexingLogger>(std::move(logger));
     mpl::set_logger(standard_logger);
 
+    if (trace_parent.is_valid())
+        mpl::set_span_exporter(std::make_shared<StdoutSpanExporter>());
+    mpl::ScopedSpanContext trace_scope{trace_parent};
+
     try
     {
         auto watchdog = mpp::make_quit_watchdog(); // called while there is only one thread
 
         mp::SSHSession session{host, port, username, mp::SSHClientKeyProvider{priv_key_blob}};
-        mp::SshfsMount sshfs_mount(move(session), source_path, target_path, gid_mappings, uid_mappings);
+        if (!shared_server && mount_args.size() == 1)
+        {
+            unique_ptr<mp::SshfsMount> sshfs_mount;
+            {
+                const auto& args = mount_args.front();
+                mpl::Span span{"sshfs_server mount"};
+                span.set_attribute("process", "sshfs_server");
+                span.set_attribute("target", args.target_path);
+
+                try
+                {
+                    sshfs_mount = make_unique<mp::SshfsMount>(move(session), args.source_path, args.target_path,
+                                                              args.gid_mappings, args.uid_mappings,
+                                                              cached_sshfs_exec_line, profile);
+                }
+                catch (const exception&)
+                {
+                    span.set_failed();
+                    throw;
+                }
+            }
+
+            cout << "Connected" << endl;
+
+            if (report_stats)
+                report_sftp_stats();
+
+            // ssh lives on its own thread, use this thread to listen for quit signal
+            if (int sig = watchdog())
+                cout << "Received signal " << sig << ". Stopping" << endl;
+
+            sshfs_mount->stop();
+            exit(0);
+        }
+
+        // All the mounts share the session, with a channel each
+        mp::SshfsMountGroup sshfs_mounts{move(session), cached_sshfs_exec_line, profile};
+        auto mounted = false;
+        for (const auto& args : mount_args)
+            mounted = add_mount(sshfs_mounts, args) || mounted;
+
+        if (!mounted)
+            exit(1);
+
+        cout << "Connected" << endl;
+
+        listen_for_mount_requests(sshfs_mounts);
+
+        if (report_stats)
+            report_sftp_stats();
 
         // ssh lives on its own thread, use this thread to listen for quit signal
         if (int sig = watchdog())
             cout << "Received signal " << sig << ". Stopping" << endl;
 
-        sshfs_mount.stop();
+        sshfs_mounts.stop();
         exit(0);
     }
     catch (const mp::SSHFSMissingError&)
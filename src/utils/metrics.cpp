@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/metrics.h>
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace mp = multipass;
+namespace mpm = multipass::metrics;
+
+namespace
+{
+std::string escape(const std::string& label_value)
+{
+    std::string escaped;
+    for (const auto c : label_value)
+    {
+        if (c == '\\' || c == '"')
+            escaped += '\\';
+
+        if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+
+    return escaped;
+}
+
+std::string format_labels(const mpm::Labels& labels)
+{
+    if (labels.empty())
+        return {};
+
+    fmt::memory_buffer formatted;
+    for (const auto& [name, value] : labels)
+        fmt::format_to(std::back_inserter(formatted), "{}{}=\"{}\"", formatted.size() ? "," : "{", name, escape(value));
+
+    return fmt::to_string(formatted) + "}";
+}
+
+void format_header(fmt::memory_buffer& out, const std::string& name, const std::string& help, const char* type)
+{
+    fmt::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+double seconds_from(std::uint64_t micros)
+{
+    return micros / 1e6;
+}
+} // namespace
+
+std::uint64_t mpm::Histogram::Snapshot::count() const
+{
+    std::uint64_t total{0};
+    for (const auto bucket_count : counts)
+        total += bucket_count;
+
+    return total;
+}
+
+mpm::Histogram::Snapshot mpm::Histogram::Snapshot::operator-(const Snapshot& earlier) const
+{
+    Snapshot difference;
+    for (size_t i = 0; i < counts.size(); ++i)
+        difference.counts[i] = counts[i] - earlier.counts[i];
+    difference.sum_micros = sum_micros - earlier.sum_micros;
+
+    return difference;
+}
+
+std::string mpm::Histogram::Snapshot::serialise() const
+{
+    return fmt::format("{} {}", sum_micros, fmt::join(counts.cbegin(), counts.cend(), " "));
+}
+
+std::optional<mpm::Histogram::Snapshot> mpm::Histogram::Snapshot::deserialise(const std::string& serialised)
+{
+    std::istringstream stream{serialised};
+    Snapshot snapshot;
+
+    stream >> snapshot.sum_micros;
+    for (auto& bucket_count : snapshot.counts)
+        stream >> bucket_count;
+
+    if (stream.fail())
+        return std::nullopt;
+
+    return snapshot;
+}
+
+void mpm::Histogram::observe(std::chrono::nanoseconds duration) noexcept
+{
+    const auto micros = std::max(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+                                 std::chrono::microseconds::rep{0});
+    const auto bucket = std::lower_bound(bucket_bounds.cbegin(), bucket_bounds.cend(), micros) - bucket_bounds.cbegin();
+
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_micros.fetch_add(micros, std::memory_order_relaxed);
+}
+
+void mpm::Histogram::add(const Snapshot& snapshot) noexcept
+{
+    for (size_t i = 0; i < counts.size(); ++i)
+        counts[i].fetch_add(snapshot.counts[i], std::memory_order_relaxed);
+    sum_micros.fetch_add(snapshot.sum_micros, std::memory_order_relaxed);
+}
+
+mpm::Histogram::Snapshot mpm::Histogram::snapshot() const noexcept
+{
+    Snapshot snapshot;
+    for (size_t i = 0; i < counts.size(); ++i)
+        snapshot.counts[i] = counts[i].load(std::memory_order_relaxed);
+    snapshot.sum_micros = sum_micros.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+mpm::Registry::Registry(const Singleton<Registry>::PrivatePass& pass) noexcept : Singleton<Registry>::Singleton{pass}
+{
+}
+
+template <typename Metric>
+Metric& mpm::Registry::find_or_create(std::map<std::string, Family<Metric>>& families, const std::string& name,
+                                      const std::string& help, const Labels& labels)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto& family = families[name];
+    if (family.help.empty())
+        family.help = help;
+
+    auto& metric = family.metrics[labels];
+    if (!metric)
+        metric = std::make_unique<Metric>();
+
+    return *metric;
+}
+
+mpm::Counter& mpm::Registry::counter(const std::string& name, const std::string& help, const Labels& labels)
+{
+    return find_or_create(counters, name, help, labels);
+}
+
+mpm::Gauge& mpm::Registry::gauge(const std::string& name, const std::string& help, const Labels& labels)
+{
+    return find_or_create(gauges, name, help, labels);
+}
+
+mpm::Histogram& mpm::Registry::histogram(const std::string& name, const std::string& help, const Labels& labels)
+{
+    return find_or_create(histograms, name, help, labels);
+}
+
+void mpm::Registry::set_gauge_callback(const std::string& name, const std::string& help, GaugeCallback callback)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    gauge_callbacks[name] = {help, std::move(callback)};
+}
+
+void mpm::Registry::remove_gauge_callback(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    gauge_callbacks.erase(name);
+}
+
+std::vector<std::pair<mpm::Labels, mpm::Histogram::Snapshot>>
+mpm::Registry::histogram_snapshots(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    std::vector<std::pair<Labels, Histogram::Snapshot>> snapshots;
+    if (auto family = histograms.find(name); family != histograms.end())
+        for (const auto& [labels, histogram] : family->second.metrics)
+            snapshots.emplace_back(labels, histogram->snapshot());
+
+    return snapshots;
+}
+
+void mpm::Registry::set_served(bool value) noexcept
+{
+    served = value;
+}
+
+bool mpm::Registry::is_served() const noexcept
+{
+    return served;
+}
+
+std::string mpm::Registry::exposition() const
+{
+    fmt::memory_buffer out;
+    std::map<std::string, std::pair<std::string, GaugeCallback>> callbacks;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        for (const auto& [name, family] : counters)
+        {
+            format_header(out, name, family.help, "counter");
+            for (const auto& [labels, counter] : family.metrics)
+                fmt::format_to(std::back_inserter(out), "{}{} {}\n", name, format_labels(labels), counter->get());
+        }
+
+        for (const auto& [name, family] : gauges)
+        {
+            format_header(out, name, family.help, "gauge");
+            for (const auto& [labels, gauge] : family.metrics)
+                fmt::format_to(std::back_inserter(out), "{}{} {}\n", name, format_labels(labels), gauge->get());
+        }
+
+        for (const auto& [name, family] : histograms)
+        {
+            format_header(out, name, family.help, "histogram");
+            for (const auto& [labels, histogram] : family.metrics)
+            {
+                const auto snapshot = histogram->snapshot();
+
+                std::uint64_t cumulative_count{0};
+                for (size_t i = 0; i < snapshot.counts.size(); ++i)
+                {
+                    cumulative_count += snapshot.counts[i];
+
+                    auto bucket_labels = labels;
+                    bucket_labels.emplace_back("le", i < Histogram::bucket_bounds.size()
+                                                         ? fmt::format("{}", seconds_from(Histogram::bucket_bounds[i]))
+                                                         : "+Inf");
+                    fmt::format_to(std::back_inserter(out), "{}_bucket{} {}\n", name, format_labels(bucket_labels),
+                                   cumulative_count);
+                }
+
+                fmt::format_to(std::back_inserter(out), "{}_sum{} {}\n", name, format_labels(labels),
+                               seconds_from(snapshot.sum_micros));
+                fmt::format_to(std::back_inserter(out), "{}_count{} {}\n", name, format_labels(labels),
+                               cumulative_count);
+            }
+        }
+
+        callbacks = gauge_callbacks;
+    }
+
+    // Callbacks may take locks of their own, so they are called without holding ours
+    for (const auto& [name, callback] : callbacks)
+    {
+        format_header(out, name, callback.first, "gauge");
+        for (const auto& [labels, value] : callback.second())
+            fmt::format_to(std::back_inserter(out), "{}{} {}\n", name, format_labels(labels), value);
+    }
+
+    return fmt::to_string(out);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/format.h>
+#include <multipass/phase_timings.h>
+
+namespace mp = multipass;
+
+namespace
+{
+thread_local mp::PhaseTimings* current_timings{nullptr};
+} // namespace
+
+mp::PhaseTimings::PhaseTimings(logging::SpanContext span_context) : span_context{std::move(span_context)}
+{
+}
+
+void mp::PhaseTimings::add(const std::string& phase, Clock::duration duration)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    phase_list.emplace_back(phase, std::chrono::duration_cast<std::chrono::milliseconds>(duration));
+}
+
+std::vector<mp::PhaseTimings::Phase> mp::PhaseTimings::phases() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return phase_list;
+}
+
+std::string mp::PhaseTimings::summary() const
+{
+    fmt::memory_buffer summary;
+    for (const auto& [phase, duration] : phases())
+        fmt::format_to(std::back_inserter(summary), "{}{} {:.1f}s", summary.size() ? ", " : "", phase,
+                       duration.count() / 1000.0);
+
+    return fmt::to_string(summary);
+}
+
+mp::PhaseTimings* mp::PhaseTimings::current()
+{
+    return current_timings;
+}
+
+mp::PhaseTimings::Scope::Scope(PhaseTimings* timings) : previous{current_timings}
+{
+    current_timings = timings;
+    if (timings)
+        span_scope.emplace(timings->span_context);
+}
+
+mp::PhaseTimings::Scope::~Scope()
+{
+    current_timings = previous;
+}
+
+mp::PhaseTimer::PhaseTimer(std::string phase, PhaseTimings* timings)
+    : phase{std::move(phase)}, timings{timings}, start{PhaseTimings::Clock::now()}
+{
+    // Phases nest in whatever span is current, which is the operation's own unless they are nested in others
+    if (timings && logging::is_tracing())
+    {
+        const auto current = logging::current_span_context();
+        if (const auto& parent = current.is_valid() ? current : timings->span_context; parent.is_valid())
+            span.emplace(this->phase, parent);
+    }
+}
+
+mp::PhaseTimer::~PhaseTimer()
+{
+    stop();
+}
+
+void mp::PhaseTimer::stop()
+{
+    if (!stopped && timings)
+        timings->add(phase, PhaseTimings::Clock::now() - start);
+
+    span.reset();
+    stopped = true;
+}
@@ -22,6 +22,7 @@
 #include <multipass/file_ops.h>
 #include <multipass/format.h>
 #include <multipass/logging/log.h>
+#include <multipass/phase_timings.h>
 #include <multipass/ssh/ssh_session.h>
 #include <multipass/standard_paths.h>
 #include <multipass/utils.h>
@@ -40,6 +41,7 @@
 #include <cassert>
 #include <cctype>
 #include <fstream>
+#include <optional>
 #include <random>
 #include <regex>
 #include <sstream>
@@ -299,11 +301,23 @@ void mp::utils::wait_until_ssh_up(VirtualMachine* virtual_machine, std::chrono::
                                   std::function<void()> const& ensure_vm_is_running)
 {
     mpl::log(mpl::Level::debug, virtual_machine->vm_name, "Waiting for SSH to be up");
-    auto action = [virtual_machine, &ensure_vm_is_running] {
+
+    // The address is there once the instance got its DHCP lease, and SSH is timed from then on
+    PhaseTimer address_timer{"IP address"};
+    std::optional<PhaseTimer> ssh_timer;
+
+    auto action = [virtual_machine, &ensure_vm_is_running, &address_timer, &ssh_timer] {
         ensure_vm_is_running();
         try
         {
-            mp::SSHSession session{virtual_machine->ssh_hostname(1ms), virtual_machine->ssh_port()};
+            auto hostname = virtual_machine->ssh_hostname(1ms);
+            if (!ssh_timer)
+            {
+                address_timer.stop();
+                ssh_timer.emplace("SSH");
+            }
+
+            mp::SSHSession session{hostname, virtual_machine->ssh_port()};
 
             std::lock_guard<decltype(virtual_machine->state_mutex)> lock{virtual_machine->state_mutex};
             virtual_machine->state = VirtualMachine::State::running;
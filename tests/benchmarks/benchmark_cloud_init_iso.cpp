@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/temp_dir.h"
+
+#include <multipass/cloud_init_iso.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+
+#include <string>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+namespace
+{
+void cloud_init_iso_write_to(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    const auto iso_path = QDir{temp_dir.path()}.filePath("cloud-init-config.iso");
+
+    // Roughly the sizes of what the daemon writes, with user data as large as asked
+    mp::CloudInitIso iso;
+    iso.add_file("meta-data", std::string(100, 'm'));
+    iso.add_file("vendor-data", std::string(2048, 'v'));
+    iso.add_file("user-data", std::string(state.range(0), 'u'));
+    iso.add_file("network-config", std::string(300, 'n'));
+
+    for (auto _ : state)
+        iso.write_to(iso_path);
+}
+} // namespace
+
+BENCHMARK(cloud_init_iso_write_to)->Arg(1024)->Arg(1024 * 1024);
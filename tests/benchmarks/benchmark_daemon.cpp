@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/file_operations.h"
+#include "tests/mock_cert_provider.h"
+#include "tests/mock_settings.h"
+#include "tests/mock_vm_image_vault.h"
+#include "tests/stub_cert_store.h"
+#include "tests/stub_image_host.h"
+#include "tests/stub_logger.h"
+#include "tests/stub_mount_handler.h"
+#include "tests/stub_ssh_key_provider.h"
+#include "tests/stub_virtual_machine_factory.h"
+#include "tests/stub_vm_blueprint_provider.h"
+#include "tests/temp_dir.h"
+
+#include <src/daemon/daemon.h>
+#include <src/daemon/daemon_config.h>
+#include <src/platform/update/disabled_update_prompt.h>
+
+#include <multipass/constants.h>
+#include <multipass/format.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+// A database of stopped instances, each with a mount and some metadata, as the daemon would have written it
+std::string instance_db(int num_instances)
+{
+    fmt::memory_buffer db;
+    fmt::format_to(std::back_inserter(db), "{{");
+    for (auto i = 0; i < num_instances; ++i)
+        fmt::format_to(std::back_inserter(db),
+                       R"({}"instance-{}": {{"deleted": false, "disk_space": "5368709120", "extra_interfaces": [],
+                           "mac_addr": "52:54:00:{:02x}:{:02x}:{:02x}", "mem_size": "1073741824",
+                           "metadata": {{"arguments": ["-enable-kvm"]}}, "num_cores": 1, "ssh_username": "ubuntu",
+                           "state": 0, "mounts": [{{"source_path": "/home/user/src", "target_path": "src",
+                           "uid_mappings": [{{"host_uid": 1000, "instance_uid": -1}}],
+                           "gid_mappings": [{{"host_gid": 1000, "instance_gid": -1}}], "mount_type": 0}}]}})",
+                       i ? "," : "", i, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+    fmt::format_to(std::back_inserter(db), "}}");
+
+    return fmt::to_string(db);
+}
+
+void daemon_persist_instances(benchmark::State& state)
+{
+    auto [mock_settings, guard] = mpt::MockSettings::inject<NiceMock>();
+    ON_CALL(*mock_settings, get(Eq(mp::mounts_key))).WillByDefault(Return("true"));
+
+    mpt::TempDir cache_dir, data_dir;
+    mpt::make_file_with_content(QDir{data_dir.path()}.filePath("multipassd-vm-instances.json"),
+                                instance_db(state.range(0)));
+
+    mp::DaemonConfigBuilder config_builder;
+    config_builder.server_address = fmt::format("unix:{}/multipassd.socket", data_dir.path());
+    config_builder.cache_directory = cache_dir.path();
+    config_builder.data_directory = data_dir.path();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    config_builder.factory = std::make_unique<mpt::StubVirtualMachineFactory>();
+    config_builder.image_hosts.push_back(std::make_unique<mpt::StubVMImageHost>());
+    config_builder.ssh_key_provider = std::make_unique<mpt::StubSSHKeyProvider>();
+    config_builder.cert_provider = std::make_unique<mpt::MockCertProvider>();
+    config_builder.client_cert_store = std::make_unique<mpt::StubCertStore>();
+    config_builder.logger = std::make_unique<mpt::StubLogger>();
+    config_builder.update_prompt = std::make_unique<mp::DisabledUpdatePrompt>();
+    config_builder.blueprint_provider = std::make_unique<mpt::StubVMBlueprintProvider>();
+    config_builder.mount_handlers[mp::VMMount::MountType::Classic] = std::make_unique<mpt::StubMountHandler>();
+
+    mp::Daemon daemon{config_builder.build()};
+
+    for (auto _ : state)
+        daemon.persist_instances();
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+} // namespace
+
+BENCHMARK(daemon_persist_instances)->Arg(1)->Arg(100)->Arg(1000);
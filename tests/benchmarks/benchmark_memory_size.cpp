@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/memory_size.h>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <string>
+
+namespace mp = multipass;
+
+namespace
+{
+void memory_size_parsing(benchmark::State& state)
+{
+    const std::array<std::string, 6> sizes{"1073741824", "512M", "1.5GiB", "5G", "128KB", "10.25gb"};
+
+    for (auto _ : state)
+        for (const auto& size : sizes)
+            benchmark::DoNotOptimize(mp::MemorySize{size});
+
+    state.SetItemsProcessed(state.iterations() * sizes.size());
+}
+} // namespace
+
+BENCHMARK(memory_size_parsing);
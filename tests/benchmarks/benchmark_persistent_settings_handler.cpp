@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/temp_dir.h"
+
+#include <multipass/settings/basic_setting_spec.h>
+#include <multipass/settings/persistent_settings_handler.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+namespace
+{
+void persistent_settings_handler_get(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+
+    mp::SettingSpec::Set specs;
+    for (auto i = 0; i < 16; ++i)
+        specs.insert(std::make_unique<mp::BasicSettingSpec>(QString{"bench.key%1"}.arg(i), "default"));
+
+    mp::PersistentSettingsHandler handler{QDir{temp_dir.path()}.filePath("multipassd.conf"), std::move(specs)};
+
+    // Half the keys come from the file and half fall back to their defaults
+    for (auto i = 0; i < 16; i += 2)
+        handler.set(QString{"bench.key%1"}.arg(i), "value");
+
+    for (auto _ : state)
+        for (auto i = 0; i < 16; ++i)
+            benchmark::DoNotOptimize(handler.get(QString{"bench.key%1"}.arg(i)));
+
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+} // namespace
+
+BENCHMARK(persistent_settings_handler_get);
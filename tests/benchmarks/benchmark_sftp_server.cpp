@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/file_operations.h"
+#include "tests/mock_sftp.h"
+#include "tests/mock_sftpserver.h"
+#include "tests/mock_ssh_process_exit_status.h"
+#include "tests/mock_ssh_test_fixture.h"
+#include "tests/temp_dir.h"
+
+#include <src/sshfs_mount/sftp_server.h>
+
+#include <multipass/ssh/ssh_session.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+namespace
+{
+using StringUPtr = std::unique_ptr<ssh_string_struct, void (*)(ssh_string)>;
+
+// Stands in for libssh, the way the SftpServer tests do, so that only the server's own work is measured. Messages are
+// handed out from a list, one run() at a time, and replies go nowhere.
+struct BenchmarkedSftpServer
+{
+    explicit BenchmarkedSftpServer(const QString& path, const mp::id_mappings& mappings = {})
+        : server{mp::SSHSession{"a", 42}, path.toStdString(), path.toStdString(), mappings, mappings, 1000, 1000,
+                 "sshfs"}
+    {
+    }
+
+    // Has the server handle the given messages, as if they came in one go
+    void handle(const std::vector<sftp_client_message>& msgs)
+    {
+        messages = msgs;
+        next = 0;
+        server.run();
+    }
+
+    std::vector<sftp_client_message> messages;
+    size_t next{0};
+    void* handle_id{nullptr};
+
+    mpt::MockSSHTestFixture mock_ssh_test_fixture;
+    mpt::ExitStatusMock exit_status_mock;
+    // The session starts with sshfs's INIT, the only thing the server reads off the channel itself
+    MockScope<decltype(mock_ssh_channel_read_timeout)> read_init{
+        mock_ssh_channel_read_timeout, [init = std::string{"\0\0\0\5\1\0\0\0\3", 9}](
+                                           ssh_channel, void* dest, uint32_t count, int is_stderr, int) mutable {
+            const auto num_bytes = is_stderr ? 0 : std::min<size_t>(count, init.size());
+            std::copy_n(init.begin(), num_bytes, static_cast<char*>(dest));
+            init.erase(0, num_bytes);
+            return static_cast<int>(num_bytes);
+        }};
+    MockScope<decltype(mock_ssh_channel_write)> write_channel{
+        mock_ssh_channel_write, [](ssh_channel, const void*, uint32_t len) { return static_cast<int>(len); }};
+    MockScope<decltype(mock_sftp_free)> free_sftp{mock_sftp_free, [](sftp_session sftp) {
+                                                      std::free(sftp->handles);
+                                                      std::free(sftp);
+                                                  }};
+    MockScope<decltype(mock_sftp_get_client_message)> get_client_msg{
+        mock_sftp_get_client_message,
+        [this](auto...) -> sftp_client_message { return next < messages.size() ? messages[next++] : nullptr; }};
+    MockScope<decltype(mock_sftp_client_message_free)> msg_free{mock_sftp_client_message_free, [](auto...) {}};
+    MockScope<decltype(mock_sftp_handle_alloc)> handle_alloc{mock_sftp_handle_alloc, [this](sftp_session, void* info) {
+                                                                 handle_id = info;
+                                                                 return ssh_string_new(4);
+                                                             }};
+    MockScope<decltype(mock_sftp_handle)> handle_sftp{mock_sftp_handle, [this](auto...) { return handle_id; }};
+    MockScope<decltype(mock_sftp_handle_remove)> handle_remove{mock_sftp_handle_remove, [](auto...) {}};
+    MockScope<decltype(mock_sftp_reply_handle)> reply_handle{mock_sftp_reply_handle, [](auto...) { return SSH_OK; }};
+    MockScope<decltype(mock_sftp_reply_status)> reply_status{mock_sftp_reply_status, [](auto...) { return SSH_OK; }};
+    MockScope<decltype(mock_sftp_reply_data)> reply_data{mock_sftp_reply_data, [](auto...) { return SSH_OK; }};
+    MockScope<decltype(mock_sftp_reply_attr)> reply_attr{mock_sftp_reply_attr, [](auto...) { return SSH_OK; }};
+    MockScope<decltype(mock_sftp_reply_names_add)> reply_names_add{mock_sftp_reply_names_add,
+                                                                   [](auto...) { return SSH_OK; }};
+    MockScope<decltype(mock_sftp_reply_names)> reply_names{mock_sftp_reply_names, [](auto...) { return SSH_OK; }};
+
+    mp::SftpServer server; // last, so that libssh is stood in for by the time it is made
+};
+
+auto make_msg(uint8_t type, const std::string& filename = {})
+{
+    auto msg = std::make_unique<sftp_client_message_struct>();
+    msg->type = type;
+    if (!filename.empty())
+        msg->filename = strdup(filename.c_str());
+    return std::shared_ptr<sftp_client_message_struct>{msg.release(), [](sftp_client_message msg) {
+                                                           std::free(msg->filename);
+                                                           delete msg;
+                                                       }};
+}
+
+void sftp_server_read(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    const auto file_name = QDir{temp_dir.path()}.filePath("test-file");
+    const auto file_size = 64 * 1024 * 1024;
+    mpt::make_file_with_content(file_name, std::string(file_size, 'r'));
+
+    BenchmarkedSftpServer sftp{temp_dir.path()};
+
+    auto open_msg = make_msg(SFTP_OPEN, file_name.toStdString());
+    open_msg->flags |= SSH_FXF_READ;
+    sftp.handle({open_msg.get()});
+
+    auto read_msg = make_msg(SFTP_READ);
+    read_msg->len = state.range(0);
+
+    for (auto _ : state)
+    {
+        sftp.handle({read_msg.get()});
+        read_msg->offset = (read_msg->offset + read_msg->len) % file_size;
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void sftp_server_write(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    const auto file_name = QDir{temp_dir.path()}.filePath("test-file");
+
+    BenchmarkedSftpServer sftp{temp_dir.path()};
+
+    sftp_attributes_struct attr{};
+    attr.permissions = 0644;
+    auto open_msg = make_msg(SFTP_OPEN, file_name.toStdString());
+    open_msg->attr = &attr;
+    open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+    sftp.handle({open_msg.get()});
+
+    StringUPtr data{ssh_string_new(state.range(0)), ssh_string_free};
+    ssh_string_fill(data.get(), std::string(state.range(0), 'w').data(), state.range(0));
+
+    // A handful of writes arrive back to back, as they do when the client pipelines them
+    constexpr auto writes_per_batch = 8;
+    std::vector<std::shared_ptr<sftp_client_message_struct>> write_msgs;
+    std::vector<sftp_client_message> batch;
+    for (auto i = 0; i < writes_per_batch; ++i)
+    {
+        write_msgs.push_back(make_msg(SFTP_WRITE));
+        write_msgs.back()->data = data.get();
+        write_msgs.back()->offset = i * state.range(0);
+        batch.push_back(write_msgs.back().get());
+    }
+
+    for (auto _ : state)
+        sftp.handle(batch);
+
+    state.SetBytesProcessed(state.iterations() * writes_per_batch * state.range(0));
+}
+
+void sftp_server_readdir(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    for (auto i = 0; i < state.range(0); ++i)
+        mpt::make_file_with_content(QDir{temp_dir.path()}.filePath(QString{"file-%1"}.arg(i)));
+
+    BenchmarkedSftpServer sftp{temp_dir.path()};
+
+    // Opening, listing to the end (50 entries at a time) and closing, like a client's ls
+    auto opendir_msg = make_msg(SFTP_OPENDIR, temp_dir.path().toStdString());
+    auto readdir_msg = make_msg(SFTP_READDIR);
+    auto close_msg = make_msg(SFTP_CLOSE);
+
+    std::vector<sftp_client_message> listing{opendir_msg.get()};
+    listing.insert(listing.end(), (state.range(0) + 2) / 50 + 2, readdir_msg.get());
+    listing.push_back(close_msg.get());
+
+    for (auto _ : state)
+        sftp.handle(listing);
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// A handful of mappings, like mounts usually have, so that every entry described goes through the id lookups
+const mp::id_mappings usual_mappings{{0, 0}, {1000, 1000}, {1001, 1001}, {1002, 1002}};
+
+void sftp_server_readdir_mapped(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    for (auto i = 0; i < state.range(0); ++i)
+        mpt::make_file_with_content(QDir{temp_dir.path()}.filePath(QString{"file-%1"}.arg(i)));
+
+    BenchmarkedSftpServer sftp{temp_dir.path(), usual_mappings};
+
+    auto opendir_msg = make_msg(SFTP_OPENDIR, temp_dir.path().toStdString());
+    auto readdir_msg = make_msg(SFTP_READDIR);
+    auto close_msg = make_msg(SFTP_CLOSE);
+
+    std::vector<sftp_client_message> listing{opendir_msg.get()};
+    listing.insert(listing.end(), (state.range(0) + 2) / 50 + 2, readdir_msg.get());
+    listing.push_back(close_msg.get());
+
+    for (auto _ : state)
+        sftp.handle(listing);
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void sftp_server_lstat_mapped(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    std::vector<std::shared_ptr<sftp_client_message_struct>> lstat_msgs;
+    std::vector<sftp_client_message> lstats;
+    for (auto i = 0; i < state.range(0); ++i)
+    {
+        const auto file_name = QDir{temp_dir.path()}.filePath(QString{"file-%1"}.arg(i));
+        mpt::make_file_with_content(file_name);
+        lstat_msgs.push_back(make_msg(SFTP_LSTAT, file_name.toStdString()));
+        lstats.push_back(lstat_msgs.back().get());
+    }
+
+    BenchmarkedSftpServer sftp{temp_dir.path(), usual_mappings};
+
+    for (auto _ : state)
+        sftp.handle(lstats);
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void sftp_server_stat(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    const auto file_name = QDir{temp_dir.path()}.filePath("test-file");
+    mpt::make_file_with_content(file_name);
+
+    BenchmarkedSftpServer sftp{temp_dir.path()};
+    auto stat_msg = make_msg(SFTP_STAT, file_name.toStdString());
+
+    for (auto _ : state)
+        sftp.handle({stat_msg.get()});
+}
+} // namespace
+
+BENCHMARK(sftp_server_read)->Arg(4 * 1024)->Arg(64 * 1024);
+BENCHMARK(sftp_server_write)->Arg(4 * 1024)->Arg(32 * 1024);
+BENCHMARK(sftp_server_readdir)->Arg(10)->Arg(1000);
+BENCHMARK(sftp_server_readdir_mapped)->Arg(5000);
+BENCHMARK(sftp_server_lstat_mapped)->Arg(5000);
+BENCHMARK(sftp_server_stat);
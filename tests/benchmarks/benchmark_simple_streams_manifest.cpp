@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/file_operations.h"
+#include "tests/mock_settings.h"
+
+#include <multipass/constants.h>
+#include <multipass/simple_streams_manifest.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <optional>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+// The recorded manifest, with each product carrying as many versions as asked, like the daily streams do
+QByteArray manifest_with_versions(int num_versions)
+{
+    auto manifest = QJsonDocument::fromJson(mpt::load_test_file("good_manifest.json")).object();
+    auto products = manifest["products"].toObject();
+
+    for (auto product = products.begin(); product != products.end(); ++product)
+    {
+        auto product_object = product.value().toObject();
+        const auto versions = product_object["versions"].toObject();
+
+        QJsonObject many_versions;
+        for (auto i = 0; i < num_versions; ++i)
+            for (auto version = versions.begin(); version != versions.end(); ++version)
+                many_versions.insert(QString{"%1.%2"}.arg(version.key()).arg(i), version.value());
+
+        product_object["versions"] = many_versions;
+        product.value() = product_object;
+    }
+
+    manifest["products"] = products;
+    return QJsonDocument{manifest}.toJson(QJsonDocument::Compact);
+}
+
+void simple_streams_manifest_from_json(benchmark::State& state)
+{
+    auto [mock_settings, guard] = mpt::MockSettings::inject<NiceMock>();
+    ON_CALL(*mock_settings, get(Eq(mp::driver_key))).WillByDefault(Return("qemu"));
+
+    const auto json = manifest_with_versions(state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mp::SimpleStreamsManifest::fromJson(json, std::nullopt, ""));
+
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+} // namespace
+
+BENCHMARK(simple_streams_manifest_from_json)->Arg(1)->Arg(100);
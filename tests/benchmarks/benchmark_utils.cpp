@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <multipass/utils.h>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace mp = multipass;
+
+namespace
+{
+void split(benchmark::State& state)
+{
+    std::string line;
+    for (auto i = 0; i < state.range(0); ++i)
+        line += "field" + std::to_string(i) + ",";
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mp::utils::split(line, ","));
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+} // namespace
+
+BENCHMARK(split)->Arg(8)->Arg(512);
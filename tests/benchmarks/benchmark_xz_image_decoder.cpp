@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/temp_dir.h"
+
+#include <multipass/xz_image_decoder.h>
+
+#include <benchmark/benchmark.h>
+
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+namespace
+{
+// Compressed with the xz tool, as there is no encoder among our dependencies. Returns whether that worked.
+bool make_xz_image(const QString& image_path, qint64 size)
+{
+    QFile image{image_path};
+    if (!image.open(QIODevice::WriteOnly))
+        return false;
+
+    // Half zeros and half a repeating pattern, so that it compresses about as well as disk images do
+    QByteArray block(4096, '\0');
+    for (auto i = block.size() / 2; i < block.size(); ++i)
+        block[i] = static_cast<char>(i * 31);
+
+    for (qint64 written = 0; written < size; written += block.size())
+        image.write(block);
+    image.close();
+
+    QProcess xz;
+    xz.start("xz", {"--check=crc32", "--keep", "--force", image_path});
+    return xz.waitForFinished(-1) && xz.exitStatus() == QProcess::NormalExit && xz.exitCode() == 0;
+}
+
+void xz_image_decoder_decode_to(benchmark::State& state)
+{
+    mpt::TempDir temp_dir;
+    const auto image_path = QDir{temp_dir.path()}.filePath("image.img");
+    const auto decoded_path = QDir{temp_dir.path()}.filePath("decoded.img");
+
+    if (!make_xz_image(image_path, state.range(0)))
+    {
+        state.SkipWithError("could not compress the image, is xz installed?");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        mp::XzImageDecoder decoder{image_path + ".xz"};
+        decoder.decode_to(decoded_path, [](auto...) { return true; });
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+} // namespace
+
+BENCHMARK(xz_image_decoder_decode_to)->Arg(64 * 1024 * 1024)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/mock_cert_provider.h"
+#include "tests/mock_settings.h"
+#include "tests/mock_ssh_test_fixture.h"
+#include "tests/stub_cert_store.h"
+#include "tests/stub_image_host.h"
+#include "tests/stub_logger.h"
+#include "tests/stub_mount_handler.h"
+#include "tests/stub_ssh_key_provider.h"
+#include "tests/stub_virtual_machine_factory.h"
+#include "tests/stub_vm_blueprint_provider.h"
+#include "tests/stub_vm_image_vault.h"
+#include "tests/temp_dir.h"
+
+#include <src/daemon/daemon.h>
+#include <src/daemon/daemon_config.h>
+#include <src/platform/update/disabled_update_prompt.h>
+
+#include <multipass/constants.h>
+#include <multipass/format.h>
+#include <multipass/rpc/multipass.grpc.pb.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+// Drives a real daemon with concurrent clients, each of which goes through the life of its own instances
+// (launch, list, info, exec, mount, delete) round after round. The backend, image host and vault are in-process fakes
+// that answer right away, and libssh is stubbed out so that the instances' SSH server always succeeds. What is left is
+// the daemon's own cost, so the latency and throughput of each RPC can be compared across changes to it, e.g.:
+//
+//   multipass_daemon_load --clients 16 --rounds 20 --json daemon_load.json
+namespace
+{
+// An instance that is up as soon as it is started, without anything to boot
+class FakeVirtualMachine final : public mp::VirtualMachine
+{
+public:
+    explicit FakeVirtualMachine(const std::string& name) : VirtualMachine{name}
+    {
+    }
+
+    void start() override
+    {
+        fake_state = State::running;
+    }
+
+    void stop() override
+    {
+        fake_state = State::stopped;
+    }
+
+    void shutdown() override
+    {
+        fake_state = State::stopped;
+    }
+
+    void suspend() override
+    {
+        fake_state = State::suspended;
+    }
+
+    State current_state() override
+    {
+        return fake_state;
+    }
+
+    int ssh_port() override
+    {
+        return 22;
+    }
+
+    std::string ssh_hostname(std::chrono::milliseconds) override
+    {
+        return "localhost";
+    }
+
+    std::string ssh_username() override
+    {
+        return "ubuntu";
+    }
+
+    std::string management_ipv4() override
+    {
+        return "192.168.2.123";
+    }
+
+    std::vector<std::string> get_all_ipv4(const mp::SSHKeyProvider&) override
+    {
+        return {management_ipv4()};
+    }
+
+    std::string ipv6() override
+    {
+        return {};
+    }
+
+    void wait_until_ssh_up(std::chrono::milliseconds) override
+    {
+    }
+
+    void ensure_vm_is_running() override
+    {
+        if (fake_state != State::running)
+            throw std::runtime_error("Not running");
+    }
+
+    void update_state() override
+    {
+    }
+
+    void update_cpus(int) override
+    {
+    }
+
+    void resize_memory(const mp::MemorySize&) override
+    {
+    }
+
+    void resize_disk(const mp::MemorySize&) override
+    {
+    }
+
+    void add_vm_mount(const std::string&, const mp::VMMount&) override
+    {
+    }
+
+    void delete_vm_mount(const std::string&) override
+    {
+    }
+
+private:
+    std::atomic<State> fake_state{State::off};
+};
+
+struct FakeVirtualMachineFactory : public mpt::StubVirtualMachineFactory
+{
+    mp::VirtualMachine::UPtr create_virtual_machine(const mp::VirtualMachineDescription& desc,
+                                                    mp::VMStatusMonitor&) override
+    {
+        return std::make_unique<FakeVirtualMachine>(desc.vm_name);
+    }
+};
+
+// How long each call to an RPC took, in milliseconds, and how many of them failed
+struct RpcTimings
+{
+    std::vector<double> latencies;
+    int failures{0};
+};
+
+using LoadTimings = std::map<std::string, RpcTimings>;
+
+// The order in which each round calls the RPCs, which the report follows too
+const std::vector<std::string> rpc_names{"launch", "list", "info", "exec", "mount", "delete"};
+
+template <typename Request, typename Reply>
+grpc::Status call(mp::Rpc::Stub& stub,
+                  std::unique_ptr<grpc::ClientReaderWriter<Request, Reply>> (mp::Rpc::Stub::*rpc)(grpc::ClientContext*),
+                  const Request& request)
+{
+    grpc::ClientContext context;
+    auto client = (stub.*rpc)(&context);
+    client->Write(request);
+
+    Reply reply;
+    while (client->Read(&reply))
+        ;
+
+    return client->Finish();
+}
+
+template <typename Call>
+void time_call(LoadTimings& timings, const std::string& rpc_name, Call&& call)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto status = call();
+    const std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - start;
+
+    auto& rpc_timings = timings[rpc_name];
+    if (status.ok())
+        return rpc_timings.latencies.push_back(latency.count());
+
+    // Only the first failure of each client is shown, the rest are counted
+    if (rpc_timings.failures++ == 0)
+        fmt::print(stderr, "{} failed: {}\n", rpc_name, status.error_message());
+}
+
+LoadTimings run_client(const std::string& server_address, int client_id, int rounds, const std::string& mount_source)
+{
+    grpc::SslCredentialsOptions opts;
+    opts.server_certificate_request = GRPC_SSL_REQUEST_SERVER_CERTIFICATE_BUT_DONT_VERIFY;
+    opts.pem_cert_chain = mpt::client_cert;
+    opts.pem_private_key = mpt::client_key;
+
+    // A connection of its own, like separate client processes would have, rather than one shared by all channels
+    grpc::ChannelArguments args;
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    mp::Rpc::Stub stub{grpc::CreateCustomChannel(server_address, grpc::SslCredentials(opts), args)};
+
+    LoadTimings timings;
+    for (auto round = 0; round < rounds; ++round)
+    {
+        const auto name = fmt::format("load-{}-{}", client_id, round);
+
+        time_call(timings, "launch", [&] {
+            mp::LaunchRequest request;
+            request.set_instance_name(name);
+            return call(stub, &mp::Rpc::Stub::launch, request);
+        });
+
+        time_call(timings, "list", [&] { return call(stub, &mp::Rpc::Stub::list, mp::ListRequest{}); });
+
+        time_call(timings, "info", [&] {
+            mp::InfoRequest request;
+            request.mutable_instance_names()->add_instance_name(name);
+            return call(stub, &mp::Rpc::Stub::info, request);
+        });
+
+        time_call(timings, "exec", [&] {
+            mp::ExecRequest request;
+            request.set_instance_name(name);
+            request.add_command("true");
+            request.set_input_closed(true);
+            return call(stub, &mp::Rpc::Stub::exec, request);
+        });
+
+        time_call(timings, "mount", [&] {
+            mp::MountRequest request;
+            request.set_source_path(mount_source);
+            auto target = request.add_target_paths();
+            target->set_instance_name(name);
+            target->set_target_path("/mnt/load");
+            return call(stub, &mp::Rpc::Stub::mount, request);
+        });
+
+        time_call(timings, "delete", [&] {
+            mp::DeleteRequest request;
+            request.mutable_instance_names()->add_instance_name(name);
+            request.set_purge(true);
+            return call(stub, &mp::Rpc::Stub::delet, request);
+        });
+    }
+
+    return timings;
+}
+
+LoadTimings run_clients(const std::string& server_address, int num_clients, int rounds,
+                        const std::string& mount_source)
+{
+    std::vector<LoadTimings> client_timings(num_clients);
+    std::vector<std::thread> clients;
+    for (auto i = 0; i < num_clients; ++i)
+        clients.emplace_back([&, i] { client_timings[i] = run_client(server_address, i, rounds, mount_source); });
+
+    for (auto& client : clients)
+        client.join();
+
+    LoadTimings timings;
+    for (auto& client : client_timings)
+        for (auto& [rpc_name, rpc_timings] : client)
+        {
+            auto& merged = timings[rpc_name];
+            merged.latencies.insert(merged.latencies.end(), rpc_timings.latencies.begin(), rpc_timings.latencies.end());
+            merged.failures += rpc_timings.failures;
+        }
+
+    for (auto& [rpc_name, rpc_timings] : timings)
+        std::sort(rpc_timings.latencies.begin(), rpc_timings.latencies.end());
+
+    return timings;
+}
+
+// Nearest-rank percentile of sorted latencies
+double percentile(const std::vector<double>& latencies, double fraction)
+{
+    if (latencies.empty())
+        return 0.0;
+
+    const auto rank = static_cast<size_t>(std::ceil(fraction * latencies.size()));
+    return latencies[std::max<size_t>(rank, 1) - 1];
+}
+
+QJsonObject report(const LoadTimings& timings, int num_clients, int rounds, double seconds)
+{
+    QJsonObject rpcs;
+    auto total_calls = 0;
+
+    fmt::print("{:<10}{:>8}{:>10}{:>12}{:>12}{:>12}\n", "rpc", "calls", "failures", "calls/s", "p50 (ms)", "p99 (ms)");
+    for (const auto& rpc_name : rpc_names)
+    {
+        const auto& rpc_timings = timings.at(rpc_name); // every client calls every RPC at least once
+        const auto calls = static_cast<int>(rpc_timings.latencies.size());
+        const auto throughput = calls / seconds;
+        const auto p50 = percentile(rpc_timings.latencies, 0.5);
+        const auto p99 = percentile(rpc_timings.latencies, 0.99);
+
+        fmt::print("{:<10}{:>8}{:>10}{:>12.1f}{:>12.2f}{:>12.2f}\n", rpc_name, calls, rpc_timings.failures, throughput,
+                   p50, p99);
+
+        rpcs.insert(QString::fromStdString(rpc_name), QJsonObject{{"calls", calls},
+                                                                  {"failures", rpc_timings.failures},
+                                                                  {"calls_per_second", throughput},
+                                                                  {"p50_ms", p50},
+                                                                  {"p99_ms", p99}});
+        total_calls += calls;
+    }
+
+    fmt::print("{} clients, {} rounds each: {} calls in {:.2f}s ({:.1f} calls/s)\n", num_clients, rounds, total_calls,
+               seconds, total_calls / seconds);
+
+    return QJsonObject{{"clients", num_clients}, {"rounds", rounds}, {"seconds", seconds}, {"rpcs", rpcs}};
+}
+
+int positive_value(const QCommandLineParser& parser, const QCommandLineOption& option)
+{
+    auto ok = false;
+    const auto value = parser.value(option).toInt(&ok);
+    if (!ok || value < 1)
+        throw std::runtime_error(fmt::format("--{} needs a positive number", option.names().first()));
+
+    return value;
+}
+} // namespace
+
+int main(int argc, char* argv[]) // clang-format off
+try // clang-format on
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("multipass_daemon_load");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("load benchmark for multipassd, against a fake backend");
+    parser.addHelpOption();
+
+    QCommandLineOption clients_option{"clients", "how many clients call the daemon at once", "N", "8"};
+    QCommandLineOption rounds_option{"rounds", "how many instances each client goes through", "N", "10"};
+    QCommandLineOption json_option{"json", "also writes the results to the given file, as JSON", "file"};
+
+    parser.addOption(clients_option);
+    parser.addOption(rounds_option);
+    parser.addOption(json_option);
+
+    parser.process(app);
+
+    const auto num_clients = positive_value(parser, clients_option);
+    const auto rounds = positive_value(parser, rounds_option);
+
+    auto [mock_settings, guard] = mpt::MockSettings::inject<NiceMock>();
+    ON_CALL(*mock_settings, get(Eq(mp::mounts_key))).WillByDefault(Return("true"));
+
+    // Stands in for the instances' SSH servers, which run every command successfully and without output
+    mpt::MockSSHTestFixture mock_ssh;
+
+    mpt::TempDir cache_dir, data_dir, mount_source;
+
+    mp::DaemonConfigBuilder config_builder;
+    config_builder.server_address = fmt::format("unix:{}/multipassd.socket", data_dir.path());
+    config_builder.cache_directory = cache_dir.path();
+    config_builder.data_directory = data_dir.path();
+    config_builder.vault = std::make_unique<mpt::StubVMImageVault>();
+    config_builder.factory = std::make_unique<FakeVirtualMachineFactory>();
+    config_builder.image_hosts.push_back(std::make_unique<mpt::StubVMImageHost>());
+    config_builder.ssh_key_provider = std::make_unique<mpt::StubSSHKeyProvider>();
+    config_builder.cert_provider = std::make_unique<mpt::MockCertProvider>();
+    config_builder.client_cert_store = std::make_unique<mpt::StubCertStore>();
+    config_builder.logger = std::make_unique<mpt::StubLogger>();
+    config_builder.update_prompt = std::make_unique<mp::DisabledUpdatePrompt>();
+    config_builder.blueprint_provider = std::make_unique<mpt::StubVMBlueprintProvider>();
+    config_builder.mount_handlers[mp::VMMount::MountType::Classic] = std::make_unique<mpt::StubMountHandler>();
+
+    const auto server_address = config_builder.server_address;
+    mp::Daemon daemon{config_builder.build()};
+
+    // The daemon answers on the event loop, so the clients are driven from another thread
+    LoadTimings timings;
+    std::chrono::duration<double> elapsed{};
+    std::thread driver{[&] {
+        const auto start = std::chrono::steady_clock::now();
+        timings = run_clients(server_address, num_clients, rounds, mount_source.path().toStdString());
+        elapsed = std::chrono::steady_clock::now() - start;
+
+        QMetaObject::invokeMethod(&app, &QCoreApplication::quit, Qt::QueuedConnection);
+    }};
+
+    app.exec();
+    driver.join();
+
+    const auto results = report(timings, num_clients, rounds, elapsed.count());
+
+    if (parser.isSet(json_option))
+    {
+        QFile json_file{parser.value(json_option)};
+        if (!json_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            throw std::runtime_error(
+                fmt::format("cannot write to {}: {}", json_file.fileName(), json_file.errorString()));
+
+        json_file.write(QJsonDocument{results}.toJson());
+    }
+
+    const auto failed = std::any_of(timings.begin(), timings.end(), [](const auto& entry) {
+        return entry.second.failures > 0;
+    });
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+    fmt::print(stderr, "error: {}\n", e.what());
+    return EXIT_FAILURE;
+}
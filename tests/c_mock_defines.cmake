@@ -42,13 +42,22 @@ add_c_mocks(
   ssh_channel_request_shell
   ssh_channel_request_pty
   ssh_channel_change_pty_size
+  ssh_channel_request_pty_size
   ssh_channel_read_timeout
+  ssh_channel_poll
+  ssh_channel_write
+  ssh_channel_window_size
+  ssh_channel_send_eof
   ssh_channel_get_exit_status
   ssh_event_dopoll
+  ssh_event_add_fd
+  ssh_event_remove_fd
+  ssh_event_add_session
+  ssh_event_add_connector
+  ssh_event_remove_connector
   ssh_add_channel_callbacks
   sftp_server_new
   sftp_free
-  sftp_server_init
   sftp_reply_status
   sftp_reply_attr
   sftp_reply_data
@@ -82,5 +91,6 @@ add_c_mocks(
   sftp_setstat
   sftp_dir_eof
   sftp_chmod
+  sftp_utimes
   ssh_get_error
 )
@@ -636,3 +636,38 @@ template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
     void (mp::Daemon::*)(const mp::StartRequest*, grpc::ServerReaderWriterInterface<mp::StartReply, mp::StartRequest>*,
                          std::promise<grpc::Status>*),
     const mp::StartRequest&, StrictMock<mpt::MockServerReaderWriter<mp::StartReply, mp::StartRequest>>&&);
+template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
+    mp::Daemon&,
+    void (mp::Daemon::*)(mp::LaunchRequest const*,
+                         grpc::ServerReaderWriterInterface<mp::LaunchReply, mp::LaunchRequest>*,
+                         std::promise<grpc::Status>*),
+    mp::LaunchRequest const&, StrictMock<mpt::MockServerReaderWriter<mp::LaunchReply, mp::LaunchRequest>>&&);
+template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
+    mp::Daemon&,
+    void (mp::Daemon::*)(mp::LaunchRequest const*,
+                         grpc::ServerReaderWriterInterface<mp::LaunchReply, mp::LaunchRequest>*,
+                         std::promise<grpc::Status>*),
+    mp::LaunchRequest const&, NiceMock<mpt::MockServerReaderWriter<mp::LaunchReply, mp::LaunchRequest>>&);
+template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
+    mp::Daemon&,
+    void (mp::Daemon::*)(const mp::WatchRequest*, grpc::ServerReaderWriterInterface<mp::WatchReply, mp::WatchRequest>*,
+                         std::promise<grpc::Status>*),
+    const mp::WatchRequest&, StrictMock<mpt::MockServerReaderWriter<mp::WatchReply, mp::WatchRequest>>&);
+template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
+    mp::Daemon&,
+    void (mp::Daemon::*)(const mp::DeleteRequest*,
+                         grpc::ServerReaderWriterInterface<mp::DeleteReply, mp::DeleteRequest>*,
+                         std::promise<grpc::Status>*),
+    const mp::DeleteRequest&, NiceMock<mpt::MockServerReaderWriter<mp::DeleteReply, mp::DeleteRequest>>&&);
+template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
+    mp::Daemon&,
+    void (mp::Daemon::*)(const mp::SuspendRequest*,
+                         grpc::ServerReaderWriterInterface<mp::SuspendReply, mp::SuspendRequest>*,
+                         std::promise<grpc::Status>*),
+    const mp::SuspendRequest&, StrictMock<mpt::MockServerReaderWriter<mp::SuspendReply, mp::SuspendRequest>>&&);
+template grpc::Status mpt::DaemonTestFixture::call_daemon_slot(
+    mp::Daemon&,
+    void (mp::Daemon::*)(const mp::CloneRequest*,
+                         grpc::ServerReaderWriterInterface<mp::CloneReply, mp::CloneRequest>*,
+                         std::promise<grpc::Status>*),
+    const mp::CloneRequest&, NiceMock<mpt::MockServerReaderWriter<mp::CloneReply, mp::CloneRequest>>&&);
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019-2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/file_operations.h"
+#include "tests/temp_dir.h"
+
+#include <src/platform/backends/shared/linux/inotify_path_watcher.h>
+
+#include <QDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct InotifyPathWatcher : public Test
+{
+    mpt::TempDir temp_dir;
+    std::string dir = temp_dir.path().toStdString();
+    mp::InotifyPathWatcher watcher;
+};
+} // namespace
+
+TEST_F(InotifyPathWatcher, reports_nothing_when_nothing_changed)
+{
+    ASSERT_TRUE(watcher.watch(dir));
+
+    EXPECT_THAT(watcher.changed_paths(), Optional(IsEmpty()));
+}
+
+TEST_F(InotifyPathWatcher, reports_created_files)
+{
+    ASSERT_TRUE(watcher.watch(dir));
+    mpt::make_file_with_content(temp_dir.path() + "/foo");
+
+    EXPECT_THAT(watcher.changed_paths(), Optional(Contains(dir + "/foo")));
+}
+
+TEST_F(InotifyPathWatcher, does_not_report_unwatched_dirs)
+{
+    mpt::make_file_with_content(temp_dir.path() + "/foo");
+
+    EXPECT_THAT(watcher.changed_paths(), Optional(IsEmpty()));
+}
+
+TEST_F(InotifyPathWatcher, cannot_watch_missing_dirs)
+{
+    EXPECT_FALSE(watcher.watch(dir + "/missing"));
+}
+
+TEST_F(InotifyPathWatcher, loses_track_when_directories_move)
+{
+    ASSERT_TRUE(QDir{temp_dir.path()}.mkdir("foo"));
+    ASSERT_TRUE(watcher.watch(dir));
+    ASSERT_TRUE(watcher.watch(dir + "/foo"));
+    ASSERT_TRUE(QDir{temp_dir.path()}.rename("foo", "bar"));
+
+    EXPECT_EQ(watcher.changed_paths(), std::nullopt);
+
+    mpt::make_file_with_content(temp_dir.path() + "/baz");
+    EXPECT_THAT(watcher.changed_paths(), Optional(IsEmpty())); // watches were dropped
+}
+
+TEST_F(InotifyPathWatcher, does_not_report_dirs_no_longer_watched)
+{
+    ASSERT_TRUE(watcher.watch(dir));
+    watcher.unwatch(dir);
+    mpt::make_file_with_content(temp_dir.path() + "/foo");
+
+    EXPECT_THAT(watcher.changed_paths(), Optional(IsEmpty()));
+}
+
+TEST_F(InotifyPathWatcher, does_not_report_anything_once_cleared)
+{
+    ASSERT_TRUE(QDir{temp_dir.path()}.mkdir("foo"));
+    ASSERT_TRUE(watcher.watch(dir));
+    ASSERT_TRUE(watcher.watch(dir + "/foo"));
+    watcher.clear();
+    mpt::make_file_with_content(temp_dir.path() + "/bar");
+    mpt::make_file_with_content(temp_dir.path() + "/foo/baz");
+
+    EXPECT_THAT(watcher.changed_paths(), Optional(IsEmpty()));
+}
+
+TEST_F(InotifyPathWatcher, watches_no_more_dirs_than_allowed)
+{
+    ASSERT_TRUE(QDir{temp_dir.path()}.mkdir("foo"));
+    mp::InotifyPathWatcher limited_watcher{1};
+
+    EXPECT_TRUE(limited_watcher.watch(dir));
+    EXPECT_TRUE(limited_watcher.watch(dir)); // already watched
+    EXPECT_FALSE(limited_watcher.watch(dir + "/foo"));
+
+    limited_watcher.unwatch(dir);
+    EXPECT_TRUE(limited_watcher.watch(dir + "/foo"));
+}
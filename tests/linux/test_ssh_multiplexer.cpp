@@ -0,0 +1,543 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/fake_key_data.h"
+#include "tests/mock_ssh_client.h"
+#include "tests/mock_ssh_test_fixture.h"
+#include "tests/mock_standard_paths.h"
+#include "tests/stub_terminal.h"
+#include "tests/temp_dir.h"
+#include "tests/unix/mock_libc_functions.h"
+
+#include <multipass/ssh/ssh_multiplexer.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+const std::string server_address{"unix:/run/multipass_socket"};
+
+// Stands in for a master, speaking its side of the socket protocol
+struct FakeMaster
+{
+    explicit FakeMaster(const QString& socket_path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_path.toStdString().c_str(), sizeof(address.sun_path) - 1);
+
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        EXPECT_EQ(::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        EXPECT_EQ(::listen(listen_fd, 1), 0);
+    }
+
+    ~FakeMaster()
+    {
+        if (server.joinable())
+            server.join();
+        ::close(listen_fd);
+    }
+
+    void serve(const std::function<void(int)>& handle_client)
+    {
+        server = std::thread{[this, handle_client] {
+            const auto fd = ::accept(listen_fd, nullptr, nullptr);
+            handle_client(fd);
+            ::close(fd);
+        }};
+    }
+
+    int listen_fd;
+    std::thread server;
+};
+
+void write_u32(int fd, uint32_t value)
+{
+    ASSERT_EQ(::write(fd, &value, sizeof(value)), static_cast<ssize_t>(sizeof(value)));
+}
+
+void write_string(int fd, const std::string& value)
+{
+    write_u32(fd, value.size());
+    ASSERT_EQ(::write(fd, value.data(), value.size()), static_cast<ssize_t>(value.size()));
+}
+
+uint32_t read_u32(int fd)
+{
+    uint32_t value{0};
+    EXPECT_EQ(::recv(fd, &value, sizeof(value), MSG_WAITALL), static_cast<ssize_t>(sizeof(value)));
+    return value;
+}
+
+std::string read_string(int fd)
+{
+    std::string value(read_u32(fd), '\0');
+    EXPECT_EQ(::recv(fd, value.data(), value.size(), MSG_WAITALL), static_cast<ssize_t>(value.size()));
+    return value;
+}
+
+// Returns the request type, and how many file descriptors came with it
+std::pair<char, size_t> read_request(int fd)
+{
+    char type{0};
+    iovec data{&type, 1};
+    std::array<char, CMSG_SPACE(3 * sizeof(int))> control{};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    EXPECT_EQ(::recvmsg(fd, &message, 0), 1);
+
+    size_t num_fds{0};
+    for (auto header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        num_fds = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        std::array<int, 3> fds;
+        std::memcpy(fds.data(), CMSG_DATA(header), std::min(num_fds, fds.size()) * sizeof(int));
+        for (size_t i = 0; i < std::min(num_fds, fds.size()); ++i)
+            ::close(fds[i]);
+    }
+
+    return {type, num_fds};
+}
+
+int connect_to(const QString& socket_path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.toStdString().c_str(), sizeof(address.sun_path) - 1);
+
+    const auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    return fd;
+}
+
+void send_request(int fd, char type, const std::vector<int>& stream_fds)
+{
+    iovec data{&type, 1};
+    std::array<char, CMSG_SPACE(3 * sizeof(int))> control{};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    if (!stream_fds.empty())
+    {
+        message.msg_control = control.data();
+        message.msg_controllen = CMSG_SPACE(stream_fds.size() * sizeof(int));
+
+        auto header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(stream_fds.size() * sizeof(int));
+        std::memcpy(CMSG_DATA(header), stream_fds.data(), stream_fds.size() * sizeof(int));
+    }
+
+    ASSERT_EQ(::sendmsg(fd, &message, 0), 1);
+}
+
+bool wait_readable(int fd)
+{
+    pollfd poll_fd{fd, POLLIN, 0};
+    return ::poll(&poll_fd, 1, 5000) > 0;
+}
+
+// True when the other end of the socket is closed, in every process
+bool at_eof(int fd)
+{
+    char byte;
+    return wait_readable(fd) && ::recv(fd, &byte, 1, 0) == 0;
+}
+
+bool wait_for(const std::function<bool()>& condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    return true;
+}
+
+struct SSHMultiplexer : public Test
+{
+    SSHMultiplexer()
+    {
+        EXPECT_CALL(mpt::MockStandardPaths::mock_instance(), writableLocation(mp::StandardPaths::RuntimeLocation))
+            .WillRepeatedly(Return(runtime_dir.path()));
+        QDir{runtime_dir.path()}.mkpath(socket_dir_for(server_address));
+    }
+
+    QString socket_dir_for(const std::string& address)
+    {
+        const auto hash = QCryptographicHash::hash(QByteArray::fromStdString(address), QCryptographicHash::Sha256);
+        return QDir{runtime_dir.path()}.filePath("multipass-ssh/" + QString::fromLatin1(hash.toHex().left(16)));
+    }
+
+    QString socket_path_for(const QString& instance_name, const std::string& address = server_address)
+    {
+        return QDir{socket_dir_for(address)}.filePath(instance_name + ".sock");
+    }
+
+    mpt::TempDir runtime_dir;
+    std::stringstream trash_stream;
+    mpt::StubTerminal term{trash_stream, trash_stream, trash_stream};
+};
+
+// Runs a real master, with libssh mocked and its event standing in for by a poll on the watched file descriptors
+struct SSHMultiplexerMaster : public SSHMultiplexer
+{
+    SSHMultiplexerMaster()
+    {
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, streams.data());
+    }
+
+    ~SSHMultiplexerMaster()
+    {
+        for (auto fd : streams)
+            if (fd >= 0)
+                ::close(fd);
+        if (control_fd >= 0)
+            ::close(control_fd);
+        if (server.joinable())
+        {
+            mp::SSHMultiplexer::stop_masters(server_address, {"foo"});
+            server.join();
+        }
+    }
+
+    void start_master(std::chrono::milliseconds idle_timeout = std::chrono::seconds{10})
+    {
+        master = std::make_unique<mp::SSHMultiplexer>(server_address, "foo", "host", 42, "ubuntu", mpt::fake_key_data);
+        server = std::thread{[this, idle_timeout] { master->serve(idle_timeout); }};
+    }
+
+    // Hands over one end of the socket pair as all three streams of the command
+    void run(const std::string& cmd_line, uint32_t pty = 0, uint32_t columns = 80, uint32_t rows = 24,
+             const std::string& term_type = "xterm")
+    {
+        control_fd = connect_to(socket_path_for("foo"));
+        send_request(control_fd, 'X', {streams[1], streams[1], streams[1]});
+        ::close(std::exchange(streams[1], -1));
+
+        write_string(control_fd, cmd_line);
+        write_u32(control_fd, pty);
+        write_u32(control_fd, columns);
+        write_u32(control_fd, rows);
+        write_string(control_fd, term_type);
+    }
+
+    int poll_watched_fds(int timeout)
+    {
+        std::vector<pollfd> poll_fds;
+        for (const auto& watched : watched_fds)
+            poll_fds.push_back({watched.first, POLLIN, 0});
+
+        if (::poll(poll_fds.data(), poll_fds.size(), std::min(timeout, 10)) > 0)
+        {
+            for (const auto& poll_fd : poll_fds)
+            {
+                if (auto it = watched_fds.find(poll_fd.fd); poll_fd.revents && it != watched_fds.end())
+                    it->second.first(poll_fd.fd, poll_fd.revents, it->second.second);
+            }
+        }
+
+        return SSH_OK;
+    }
+
+    mpt::MockSSHTestFixture mock_ssh_test_fixture;
+    std::map<int, std::pair<ssh_event_callback, void*>> watched_fds; // only touched by the master
+    std::atomic<int> connectors{0};
+    std::atomic<bool> command_started{false}, command_done{false};
+    std::string received_cmd_line;
+
+    MockScope<decltype(mock_ssh_event_add_fd)> add_fd{
+        mock_ssh_event_add_fd, [this](ssh_event, socket_t fd, short, ssh_event_callback callback, void* userdata) {
+            watched_fds[fd] = {callback, userdata};
+            return SSH_OK;
+        }};
+    MockScope<decltype(mock_ssh_event_remove_fd)> remove_fd{mock_ssh_event_remove_fd, [this](ssh_event, socket_t fd) {
+                                                                watched_fds.erase(fd);
+                                                                return SSH_OK;
+                                                            }};
+    MockScope<decltype(mock_ssh_event_dopoll)> dopoll{
+        mock_ssh_event_dopoll, [this](ssh_event, int timeout) { return poll_watched_fds(timeout); }};
+    MockScope<decltype(mock_ssh_event_add_session)> add_session{mock_ssh_event_add_session,
+                                                                [](auto...) { return SSH_OK; }};
+    MockScope<decltype(mock_ssh_event_add_connector)> add_connector{mock_ssh_event_add_connector, [this](auto...) {
+                                                                        ++connectors;
+                                                                        return SSH_OK;
+                                                                    }};
+    MockScope<decltype(mock_ssh_event_remove_connector)> remove_connector{mock_ssh_event_remove_connector,
+                                                                          [this](auto...) {
+                                                                              --connectors;
+                                                                              return SSH_OK;
+                                                                          }};
+    MockScope<decltype(mock_ssh_channel_request_exec)> request_exec{mock_ssh_channel_request_exec,
+                                                                    [this](ssh_channel, const char* cmd_line) {
+                                                                        received_cmd_line = cmd_line;
+                                                                        command_started = true;
+                                                                        return SSH_OK;
+                                                                    }};
+    MockScope<decltype(mock_ssh_channel_is_eof)> is_eof{mock_ssh_channel_is_eof,
+                                                        [this](auto...) { return command_done.load(); }};
+    MockScope<decltype(mock_setsid)> no_new_session{mock_setsid, [] { return 0; }};
+
+    std::array<int, 2> streams{-1, -1};
+    int control_fd{-1};
+    std::unique_ptr<mp::SSHMultiplexer> master;
+    std::thread server;
+};
+} // namespace
+
+TEST_F(SSHMultiplexer, execWithoutMasterReturnsNothing)
+{
+    EXPECT_EQ(mp::SSHMultiplexer::exec(server_address, "foo", "ls", &term), std::nullopt);
+}
+
+TEST_F(SSHMultiplexer, execDoesNotUseMasterOfOtherDaemon)
+{
+    const std::string other_address{"localhost:50051"};
+    QDir{}.mkpath(socket_dir_for(other_address));
+    FakeMaster master{socket_path_for("foo", other_address)};
+
+    EXPECT_NE(socket_path_for("foo"), socket_path_for("foo", other_address));
+    EXPECT_EQ(mp::SSHMultiplexer::exec(server_address, "foo", "ls", &term), std::nullopt);
+}
+
+TEST_F(SSHMultiplexer, execRunsCommandThroughMaster)
+{
+    FakeMaster master{socket_path_for("foo")};
+
+    std::string received_cmd_line;
+    std::pair<char, size_t> received_request;
+    master.serve([&](int fd) {
+        received_request = read_request(fd);
+        received_cmd_line = read_string(fd);
+        EXPECT_EQ(read_u32(fd), 0u); // no pty
+        read_u32(fd);
+        read_u32(fd);
+        read_string(fd);
+
+        write_u32(fd, 42);
+    });
+
+    EXPECT_EQ(mp::SSHMultiplexer::exec(server_address, "foo", "ls", &term), 42);
+    master.server.join();
+
+    EXPECT_EQ(received_request, std::make_pair('X', size_t{3}));
+    EXPECT_EQ(received_cmd_line, "ls");
+}
+
+TEST_F(SSHMultiplexer, stopMastersAsksMasterToStop)
+{
+    FakeMaster master{socket_path_for("foo")};
+
+    std::pair<char, size_t> received_request;
+    master.serve([&](int fd) { received_request = read_request(fd); });
+
+    mp::SSHMultiplexer::stop_masters(server_address, {"foo"});
+    master.server.join();
+
+    EXPECT_EQ(received_request, std::make_pair('Q', size_t{0}));
+}
+
+TEST_F(SSHMultiplexerMaster, runsCommandOnNewChannelWithStreamsOfClient)
+{
+    REPLACE(ssh_channel_get_exit_status, [](auto...) { return 42; });
+    start_master();
+
+    run("ls");
+    ASSERT_TRUE(wait_for([this] { return command_started.load(); }));
+
+    EXPECT_EQ(received_cmd_line, "ls");
+    EXPECT_TRUE(wait_for([this] { return connectors == 3; }));
+
+    pollfd poll_fd{streams[0], POLLIN, 0};
+    EXPECT_EQ(::poll(&poll_fd, 1, 0), 0) << "the master should hold on to the streams while the command runs";
+
+    command_done = true;
+    EXPECT_EQ(read_u32(control_fd), 42u);
+    EXPECT_TRUE(at_eof(streams[0]));
+    EXPECT_EQ(connectors, 0);
+}
+
+TEST_F(SSHMultiplexerMaster, requestsPtyAndPassesOnResizes)
+{
+    std::tuple<std::string, int, int> pty_request;
+    REPLACE(ssh_channel_request_pty_size, [&pty_request](auto, const char* term_type, int columns, int rows) {
+        pty_request = {term_type, columns, rows};
+        return SSH_OK;
+    });
+    std::atomic<bool> resized{false};
+    REPLACE(ssh_channel_change_pty_size, [&resized](auto, int columns, int rows) {
+        resized = columns == 100 && rows == 50;
+        return SSH_OK;
+    });
+    start_master();
+
+    run("top", 1, 80, 24, "xterm-256color");
+    ASSERT_TRUE(wait_for([this] { return command_started.load(); }));
+    EXPECT_EQ(pty_request, std::make_tuple(std::string{"xterm-256color"}, 80, 24));
+
+    ASSERT_EQ(::write(control_fd, "R", 1), 1);
+    write_u32(control_fd, 100);
+    write_u32(control_fd, 50);
+    EXPECT_TRUE(wait_for([&resized] { return resized.load(); }));
+
+    command_done = true;
+    EXPECT_EQ(read_u32(control_fd), 0u);
+}
+
+TEST_F(SSHMultiplexerMaster, requestsShellForEmptyCommandLine)
+{
+    std::atomic<bool> shell_requested{false};
+    REPLACE(ssh_channel_request_shell, [&shell_requested](auto...) {
+        shell_requested = true;
+        return SSH_OK;
+    });
+    start_master();
+
+    run("");
+    EXPECT_TRUE(wait_for([&shell_requested] { return shell_requested.load(); }));
+    EXPECT_FALSE(command_started);
+
+    command_done = true;
+    EXPECT_EQ(read_u32(control_fd), 0u);
+}
+
+TEST_F(SSHMultiplexerMaster, reportsLostConnectionWhenChannelFails)
+{
+    REPLACE(ssh_channel_open_session, [](auto...) { return SSH_ERROR; });
+    REPLACE(ssh_get_error, [](auto...) { return "no channel for you"; });
+    start_master();
+
+    run("ls");
+
+    EXPECT_EQ(read_u32(control_fd), 255u);
+    EXPECT_TRUE(at_eof(streams[0]));
+    EXPECT_FALSE(command_started);
+}
+
+TEST_F(SSHMultiplexerMaster, dropsClientThatSendsNoStreams)
+{
+    start_master();
+
+    control_fd = connect_to(socket_path_for("foo"));
+    send_request(control_fd, 'X', {});
+
+    EXPECT_TRUE(at_eof(control_fd));
+    EXPECT_FALSE(command_started);
+}
+
+TEST_F(SSHMultiplexerMaster, endsCommandOfClientThatGoesAway)
+{
+    start_master();
+
+    run("sleep infinity");
+    ASSERT_TRUE(wait_for([this] { return command_started.load(); }));
+
+    ::close(std::exchange(control_fd, -1));
+
+    EXPECT_TRUE(at_eof(streams[0]));
+    EXPECT_TRUE(wait_for([this] { return connectors == 0; }));
+}
+
+TEST_F(SSHMultiplexerMaster, endsCommandsWithLostConnectionWhenSessionDrops)
+{
+    std::atomic<bool> connected{true};
+    REPLACE(ssh_is_connected, [&connected](auto...) { return connected.load(); });
+    start_master();
+
+    run("sleep infinity");
+    ASSERT_TRUE(wait_for([this] { return command_started.load(); }));
+
+    connected = false;
+    EXPECT_EQ(read_u32(control_fd), 255u);
+    server.join();
+
+    EXPECT_TRUE(at_eof(streams[0]));
+    EXPECT_EQ(connectors, 0);
+}
+
+TEST_F(SSHMultiplexerMaster, stopsWhenIdle)
+{
+    start_master(std::chrono::milliseconds{0});
+
+    server.join();
+}
+
+TEST_F(SSHMultiplexerMaster, stopsWhenAsked)
+{
+    start_master();
+
+    mp::SSHMultiplexer::stop_masters(server_address, {"foo"});
+    server.join();
+}
+
+TEST_F(SSHMultiplexerMaster, stopsWithAllMastersOfItsDaemon)
+{
+    start_master();
+
+    mp::SSHMultiplexer::stop_masters("localhost:50051", {});
+    EXPECT_TRUE(QFile::exists(socket_path_for("foo")));
+
+    mp::SSHMultiplexer::stop_masters(server_address, {});
+    server.join();
+}
+
+TEST_F(SSHMultiplexerMaster, refusesSecondMasterForInstance)
+{
+    mp::SSHMultiplexer master{server_address, "foo", "host", 42, "ubuntu", mpt::fake_key_data};
+
+    MP_EXPECT_THROW_THAT((mp::SSHMultiplexer{server_address, "foo", "host", 42, "ubuntu", mpt::fake_key_data}),
+                         std::runtime_error, mpt::match_what(HasSubstr("already has an SSH multiplexer")));
+}
+
+TEST_F(SSHMultiplexerMaster, removesSocketWhenDestroyed)
+{
+    {
+        mp::SSHMultiplexer master{server_address, "foo", "host", 42, "ubuntu", mpt::fake_key_data};
+        EXPECT_TRUE(QFile::exists(socket_path_for("foo")));
+    }
+
+    EXPECT_FALSE(QFile::exists(socket_path_for("foo")));
+}
@@ -115,12 +115,30 @@ public:
                 AsyncrecoverRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq, void* tag), (override));
     MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::RecoverRequest, multipass::RecoverReply>*),
                 PrepareAsyncrecoverRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq), (override));
+    MOCK_METHOD((grpc::ClientReaderWriterInterface<multipass::CloneRequest, multipass::CloneReply>*), cloneRaw,
+                (grpc::ClientContext * context), (override));
+    MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::CloneRequest, multipass::CloneReply>*),
+                AsynccloneRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq, void* tag), (override));
+    MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::CloneRequest, multipass::CloneReply>*),
+                PrepareAsynccloneRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq), (override));
     MOCK_METHOD((grpc::ClientReaderWriterInterface<multipass::SSHInfoRequest, multipass::SSHInfoReply>*), ssh_infoRaw,
                 (grpc::ClientContext * context), (override));
     MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::SSHInfoRequest, multipass::SSHInfoReply>*),
                 Asyncssh_infoRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq, void* tag), (override));
     MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::SSHInfoRequest, multipass::SSHInfoReply>*),
                 PrepareAsyncssh_infoRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq), (override));
+    MOCK_METHOD((grpc::ClientReaderWriterInterface<multipass::ExecRequest, multipass::ExecReply>*), execRaw,
+                (grpc::ClientContext * context), (override));
+    MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::ExecRequest, multipass::ExecReply>*), AsyncexecRaw,
+                (grpc::ClientContext * context, grpc::CompletionQueue* cq, void* tag), (override));
+    MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::ExecRequest, multipass::ExecReply>*),
+                PrepareAsyncexecRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq), (override));
+    MOCK_METHOD((grpc::ClientReaderWriterInterface<multipass::WatchRequest, multipass::WatchReply>*), watchRaw,
+                (grpc::ClientContext * context), (override));
+    MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::WatchRequest, multipass::WatchReply>*),
+                AsyncwatchRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq, void* tag), (override));
+    MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::WatchRequest, multipass::WatchReply>*),
+                PrepareAsyncwatchRaw, (grpc::ClientContext * context, grpc::CompletionQueue* cq), (override));
     MOCK_METHOD((grpc::ClientReaderWriterInterface<multipass::StartRequest, multipass::StartReply>*), startRaw,
                 (grpc::ClientContext * context), (override));
     MOCK_METHOD((grpc::ClientAsyncReaderWriterInterface<multipass::StartRequest, multipass::StartReply>*),
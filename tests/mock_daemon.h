@@ -47,8 +47,14 @@ struct MockDaemon : public Daemon
                              std::promise<grpc::Status>*));
     MOCK_METHOD3(recover, void(const RecoverRequest*, grpc::ServerReaderWriterInterface<RecoverReply, RecoverRequest>*,
                                std::promise<grpc::Status>*));
+    MOCK_METHOD3(clone, void(const CloneRequest*, grpc::ServerReaderWriterInterface<CloneReply, CloneRequest>*,
+                             std::promise<grpc::Status>*));
     MOCK_METHOD3(ssh_info, void(const SSHInfoRequest*, grpc::ServerReaderWriterInterface<SSHInfoReply, SSHInfoRequest>*,
                                 std::promise<grpc::Status>*));
+    MOCK_METHOD4(exec, void(const ExecRequest*, grpc::ServerReaderWriterInterface<ExecReply, ExecRequest>*,
+                            grpc::ServerContext*, std::promise<grpc::Status>*));
+    MOCK_METHOD3(watch, void(const WatchRequest*, grpc::ServerReaderWriterInterface<WatchReply, WatchRequest>*,
+                             std::promise<grpc::Status>*));
     MOCK_METHOD3(start, void(const StartRequest*, grpc::ServerReaderWriterInterface<StartReply, StartRequest>*,
                              std::promise<grpc::Status>*));
     MOCK_METHOD3(stop, void(const StopRequest*, grpc::ServerReaderWriterInterface<StopReply, StopRequest>*,
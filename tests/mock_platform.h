@@ -43,6 +43,7 @@ public:
     MOCK_CONST_METHOD2(chmod, int(const char*, unsigned int));
     MOCK_CONST_METHOD3(chown, int(const char*, unsigned int, unsigned int));
     MOCK_CONST_METHOD2(link, bool(const char*, const char*));
+    MOCK_CONST_METHOD5(copy_file_data, bool(int, qint64, int, qint64, qint64));
     MOCK_CONST_METHOD3(symlink, bool(const char*, const char*, bool));
     MOCK_CONST_METHOD3(utime, int(const char*, int, int));
     MOCK_CONST_METHOD2(create_alias_script, void(const std::string&, const AliasDefinition&));
@@ -37,4 +37,5 @@ extern "C"
     IMPL_MOCK_DEFAULT(3, sftp_setstat);
     IMPL_MOCK_DEFAULT(1, sftp_dir_eof);
     IMPL_MOCK_DEFAULT(3, sftp_chmod);
+    IMPL_MOCK_DEFAULT(3, sftp_utimes);
 }
@@ -41,5 +41,6 @@ DECL_MOCK(sftp_unlink);
 DECL_MOCK(sftp_setstat);
 DECL_MOCK(sftp_dir_eof);
 DECL_MOCK(sftp_chmod);
+DECL_MOCK(sftp_utimes);
 
 #endif // MULTIPASS_MOCK_SFTP_H
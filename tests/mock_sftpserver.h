@@ -23,7 +23,6 @@
 #include <libssh/sftp.h>
 
 DECL_MOCK(sftp_server_new);
-DECL_MOCK(sftp_server_init);
 DECL_MOCK(sftp_reply_status);
 DECL_MOCK(sftp_reply_attr);
 DECL_MOCK(sftp_reply_data);
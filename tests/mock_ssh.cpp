@@ -30,6 +30,10 @@ extern "C"
     IMPL_MOCK_DEFAULT(1, ssh_channel_open_session);
     IMPL_MOCK_DEFAULT(2, ssh_channel_request_exec);
     IMPL_MOCK_DEFAULT(5, ssh_channel_read_timeout);
+    IMPL_MOCK_DEFAULT(2, ssh_channel_poll);
+    IMPL_MOCK_DEFAULT(3, ssh_channel_write);
+    IMPL_MOCK_DEFAULT(1, ssh_channel_window_size);
+    IMPL_MOCK_DEFAULT(1, ssh_channel_send_eof);
     IMPL_MOCK_DEFAULT(1, ssh_channel_get_exit_status);
     IMPL_MOCK_DEFAULT(2, ssh_event_dopoll);
     IMPL_MOCK_DEFAULT(2, ssh_add_channel_callbacks);
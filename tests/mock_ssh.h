@@ -35,6 +35,10 @@ DECL_MOCK(ssh_channel_new);
 DECL_MOCK(ssh_channel_open_session);
 DECL_MOCK(ssh_channel_request_exec);
 DECL_MOCK(ssh_channel_read_timeout);
+DECL_MOCK(ssh_channel_poll);
+DECL_MOCK(ssh_channel_write);
+DECL_MOCK(ssh_channel_window_size);
+DECL_MOCK(ssh_channel_send_eof);
 DECL_MOCK(ssh_channel_get_exit_status);
 DECL_MOCK(ssh_event_dopoll);
 DECL_MOCK(ssh_add_channel_callbacks);
@@ -20,4 +20,10 @@ extern "C" {
 IMPL_MOCK_DEFAULT(1, ssh_channel_request_shell);
 IMPL_MOCK_DEFAULT(1, ssh_channel_request_pty);
 IMPL_MOCK_DEFAULT(3, ssh_channel_change_pty_size);
+IMPL_MOCK_DEFAULT(4, ssh_channel_request_pty_size);
+IMPL_MOCK_DEFAULT(5, ssh_event_add_fd);
+IMPL_MOCK_DEFAULT(2, ssh_event_remove_fd);
+IMPL_MOCK_DEFAULT(2, ssh_event_add_session);
+IMPL_MOCK_DEFAULT(2, ssh_event_add_connector);
+IMPL_MOCK_DEFAULT(2, ssh_event_remove_connector);
 }
@@ -25,5 +25,11 @@
 DECL_MOCK(ssh_channel_request_shell);
 DECL_MOCK(ssh_channel_request_pty);
 DECL_MOCK(ssh_channel_change_pty_size);
+DECL_MOCK(ssh_channel_request_pty_size);
+DECL_MOCK(ssh_event_add_fd);
+DECL_MOCK(ssh_event_remove_fd);
+DECL_MOCK(ssh_event_add_session);
+DECL_MOCK(ssh_event_add_connector);
+DECL_MOCK(ssh_event_remove_connector);
 
 #endif // MULTIPASS_MOCK_SSH_CLIENT
@@ -36,6 +36,8 @@ struct MockSSHTestFixture
         userauth_publickey.returnValue(SSH_OK);
         request_exec.returnValue(SSH_OK);
         channel_read.returnValue(0);
+        channel_poll.returnValue(0);
+        window_size.returnValue(1048576u);
         is_eof.returnValue(true);
         get_exit_status.returnValue(SSH_OK);
         channel_is_open.returnValue(true);
@@ -49,6 +51,8 @@ struct MockSSHTestFixture
     decltype(MOCK(ssh_userauth_publickey)) userauth_publickey{MOCK(ssh_userauth_publickey)};
     decltype(MOCK(ssh_channel_request_exec)) request_exec{MOCK(ssh_channel_request_exec)};
     decltype(MOCK(ssh_channel_read_timeout)) channel_read{MOCK(ssh_channel_read_timeout)};
+    decltype(MOCK(ssh_channel_poll)) channel_poll{MOCK(ssh_channel_poll)};
+    decltype(MOCK(ssh_channel_window_size)) window_size{MOCK(ssh_channel_window_size)};
     decltype(MOCK(ssh_channel_is_eof)) is_eof{MOCK(ssh_channel_is_eof)};
     decltype(MOCK(ssh_channel_get_exit_status)) get_exit_status{MOCK(ssh_channel_get_exit_status)};
     decltype(MOCK(ssh_channel_is_open)) channel_is_open{MOCK(ssh_channel_is_open)};
@@ -39,6 +39,7 @@ struct MockVirtualMachineFactory : public VirtualMachineFactory
     MOCK_METHOD1(prepare_networking, void(std::vector<NetworkInterface>&));
     MOCK_METHOD1(prepare_source_image, VMImage(const VMImage&));
     MOCK_METHOD2(prepare_instance_image, void(const VMImage&, const VirtualMachineDescription&));
+    MOCK_METHOD2(clone_instance_image, void(const VMImage&, const VMImage&));
     MOCK_METHOD0(hypervisor_health_check, void());
     MOCK_METHOD0(get_backend_directory_name, QString());
     MOCK_METHOD0(get_backend_version_string, QString());
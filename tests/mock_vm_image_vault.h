@@ -40,6 +40,9 @@ public:
         });
         ON_CALL(*this, has_record_for(_)).WillByDefault(Return(true));
         ON_CALL(*this, minimum_image_size_for(_)).WillByDefault(Return(MemorySize{"1048576"}));
+        ON_CALL(*this, clone(_, _)).WillByDefault([this](auto, auto) {
+            return VMImage{dummy_image.name(), dummy_image.name(), dummy_image.name(), {}, {}, {}, {}, {}};
+        });
     };
 
     MOCK_METHOD4(fetch_image, VMImage(const FetchType&, const Query&, const PrepareAction&, const ProgressMonitor&));
@@ -50,6 +53,7 @@ public:
     MOCK_METHOD1(minimum_image_size_for, MemorySize(const std::string&));
     MOCK_CONST_METHOD1(image_host_for, VMImageHost*(const std::string&));
     MOCK_CONST_METHOD1(all_info_for, std::vector<std::pair<std::string, VMImageInfo>>(const Query&));
+    MOCK_METHOD2(clone, VMImage(const std::string&, const std::string&));
 
 private:
     TempFile dummy_image;
@@ -246,6 +246,41 @@ TEST_F(QemuBackend, machine_start_suspend_sends_monitoring_event)
     machine->suspend();
 }
 
+TEST_F(QemuBackend, machine_request_shutdown_powers_down_without_waiting)
+{
+    mpt::MockProcess* vmproc = nullptr;
+    process_factory->register_callback([&vmproc](mpt::MockProcess* process) {
+        if (process->program().startsWith("qemu-system-") && !process->arguments().contains("-dump-vmstate"))
+        {
+            vmproc = process;
+            EXPECT_CALL(*process, write(_)).Times(AnyNumber());
+            EXPECT_CALL(*process,
+                        write(Truly([](const QByteArray& data) { return data.contains("system_powerdown"); })));
+            EXPECT_CALL(*process, wait_for_finished(_)).Times(0);
+        }
+    });
+
+    EXPECT_CALL(*mock_qemu_platform_factory, make_qemu_platform(_)).WillOnce([this](auto...) {
+        return std::move(mock_qemu_platform);
+    });
+
+    NiceMock<mpt::MockVMStatusMonitor> mock_monitor;
+    mp::QemuVirtualMachineFactory backend{data_dir.path()};
+
+    auto machine = backend.create_virtual_machine(default_description, mock_monitor);
+
+    machine->start();
+    machine->state = mp::VirtualMachine::State::running;
+
+    machine->request_shutdown();
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::running);
+
+    EXPECT_CALL(mock_monitor, on_shutdown());
+    mp::ProcessState exit_state{0, std::nullopt};
+    emit vmproc->finished(exit_state);
+    EXPECT_EQ(machine->current_state(), mp::VirtualMachine::State::off);
+}
+
 TEST_F(QemuBackend, throws_when_shutdown_while_starting)
 {
     mpt::MockProcess* vmproc = nullptr;
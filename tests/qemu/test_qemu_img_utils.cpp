@@ -16,13 +16,17 @@
  */
 
 #include "tests/common.h"
+#include "tests/file_operations.h"
 #include "tests/mock_process_factory.h"
+#include "tests/temp_dir.h"
 
 #include <src/platform/backends/shared/qemu_img_utils/qemu_img_utils.h>
 
 #include <multipass/constants.h>
 #include <multipass/memory_size.h>
 
+#include <QDir>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 
@@ -217,3 +221,59 @@ TEST_P(ImageConversionTestSuite, properly_handles_image_conversion)
 }
 
 INSTANTIATE_TEST_SUITE_P(QemuImgUtils, ImageConversionTestSuite, ValuesIn(image_conversion_inputs));
+
+struct LinkCloneInstanceImage : public Test
+{
+    LinkCloneInstanceImage()
+    {
+        QDir{temp_dir.path()}.mkpath("source");
+        QDir{temp_dir.path()}.mkpath("destination");
+        mpt::make_file_with_content(source_image, "source disk");
+    }
+
+    QStringList backing_images_in(const QString& dir_name)
+    {
+        return QDir{QDir{temp_dir.path()}.filePath(dir_name)}.entryList({"backing-*.qcow2"}, QDir::Files);
+    }
+
+    mpt::TempDir temp_dir;
+    const QString source_image = QDir{temp_dir.path()}.filePath("source/image.img");
+    const QString destination_image = QDir{temp_dir.path()}.filePath("destination/image.img");
+    std::unique_ptr<mpt::MockProcessFactory::Scope> mock_factory_scope = mpt::MockProcessFactory::Inject();
+};
+
+TEST_F(LinkCloneInstanceImage, sharesBackingImageBetweenTwoOverlays)
+{
+    std::vector<QStringList> overlays_created;
+    mock_factory_scope->register_callback([&overlays_created](mpt::MockProcess* process) {
+        ASSERT_EQ(process->program().toStdString(), "qemu-img");
+        overlays_created.push_back(process->arguments());
+        EXPECT_CALL(*process, execute).WillOnce(Return(success));
+    });
+
+    mp::backend::link_clone_instance_image(source_image, destination_image);
+
+    const auto backing_images = backing_images_in("source");
+    ASSERT_EQ(backing_images.size(), 1);
+    EXPECT_EQ(backing_images_in("destination"), backing_images);
+    EXPECT_EQ(mpt::load(QDir{temp_dir.path()}.filePath("destination/" + backing_images.first())), "source disk");
+
+    ASSERT_EQ(overlays_created.size(), 2u);
+    EXPECT_EQ(overlays_created[0],
+              QStringList({"create", "-f", "qcow2", "-F", "qcow2", "-b", backing_images.first(), source_image}));
+    EXPECT_EQ(overlays_created[1],
+              QStringList({"create", "-f", "qcow2", "-F", "qcow2", "-b", backing_images.first(), destination_image}));
+}
+
+TEST_F(LinkCloneInstanceImage, restoresSourceImageWhenItsOverlayFails)
+{
+    mock_factory_scope->register_callback(
+        [](mpt::MockProcess* process) { EXPECT_CALL(*process, execute).WillOnce(Return(failure)); });
+
+    MP_EXPECT_THROW_THAT(mp::backend::link_clone_instance_image(source_image, destination_image), std::runtime_error,
+                         mpt::match_what(HasSubstr("qemu-img failed")));
+
+    EXPECT_EQ(mpt::load(source_image), "source disk");
+    EXPECT_THAT(backing_images_in("source"), IsEmpty());
+    EXPECT_THAT(backing_images_in("destination"), IsEmpty());
+}
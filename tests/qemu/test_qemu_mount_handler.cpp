@@ -436,3 +436,48 @@ TEST_F(QemuMountHandlerTest, stopAllMountsDeletesAllMounts)
     qemu_mount_handler.stop_mount(vm.vm_name, default_target);
     EXPECT_FALSE(qemu_mount_handler.has_instance_already_mounted(vm.vm_name, default_target));
 }
+
+TEST_F(QemuMountHandlerTest, virtiofsDriverMountsWithVirtiofs)
+{
+    bool invoked_cmd{false};
+    std::string output;
+    auto remaining = output.size();
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked_cmd);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    CommandVector empty;
+    CommandVector::const_iterator it = empty.end();
+    std::optional<std::string> fail_cmd = std::nullopt;
+    std::optional<bool> invoked_fail = std::make_optional(false);
+    auto check_commands =
+        make_exec_to_check_commands(empty, remaining, it, output, invoked_cmd, fail_cmd, invoked_fail);
+
+    std::vector<std::string> executed;
+    auto request_exec = [&executed, &check_commands](ssh_channel channel, const char* raw_cmd) {
+        executed.emplace_back(raw_cmd);
+        return check_commands(channel, raw_cmd);
+    };
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    mp::QemuMountHandler qemu_mount_handler(key_provider, mp::QemuMountHandler::Driver::virtiofs);
+    qemu_mount_handler.start_mount(&vm, &server, default_target);
+
+    EXPECT_THAT(executed, Contains(StartsWith("sudo mount -t virtiofs m")));
+    EXPECT_THAT(executed, Not(Contains(HasSubstr("-t 9p"))));
+}
+
+TEST_F(QemuMountHandlerTest, virtiofsDriverWarnsAboutIdMappings)
+{
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).WillOnce(Return(true));
+    EXPECT_CALL(vm, current_state()).WillOnce(Return(mp::VirtualMachine::State::off));
+    EXPECT_CALL(vm, add_vm_mount(_, _)).WillOnce(Return());
+
+    logger_scope.mock_logger->screen_logs(mpl::Level::warning);
+    logger_scope.mock_logger->expect_log(mpl::Level::warning, "do not support id mappings");
+
+    mp::QemuMountHandler qemu_mount_handler(key_provider, mp::QemuMountHandler::Driver::virtiofs);
+
+    const mp::VMMount mount{default_source, gid_mappings, uid_mappings, mp::VMMount::MountType::Native};
+    qemu_mount_handler.init_mount(&vm, default_target, mount);
+}
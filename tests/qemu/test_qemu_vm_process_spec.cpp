@@ -82,6 +82,31 @@ TEST_F(TestQemuVMProcessSpec, default_arguments_correct)
                                              "path=path/to/target,mount_tag=m810e457178f448d9afffc9d950d726"}));
 }
 
+TEST_F(TestQemuVMProcessSpec, virtiofsMountsUseSharedMemoryBackend)
+{
+    const std::unordered_map<std::string, std::pair<std::string, QStringList>> virtiofs_mount_args{
+        {"path/to/target",
+         {"path/to/source",
+          {"-chardev", "socket,id=vfsm810e457178f448d9afffc9d950d726,path=/tmp/multipass-virtiofs-01234567.sock",
+           "-device",
+           "vhost-user-fs-pci,queue-size=1024,chardev=vfsm810e457178f448d9afffc9d950d726,"
+           "tag=m810e457178f448d9afffc9d950d726"}}}};
+
+    mp::QemuVMProcessSpec spec(desc, platform_args, virtiofs_mount_args, std::nullopt);
+
+    const auto args = spec.arguments();
+    EXPECT_THAT(args, IsSupersetOf({QString{"memory-backend-memfd,id=mem,size=3072M,share=on"},
+                                    QString{"node,memdev=mem"}}));
+    EXPECT_TRUE(spec.apparmor_profile().contains("/tmp/multipass-virtiofs-01234567.sock rw,"));
+}
+
+TEST_F(TestQemuVMProcessSpec, ninePMountsDoNotUseSharedMemoryBackend)
+{
+    mp::QemuVMProcessSpec spec(desc, platform_args, mount_args, std::nullopt);
+
+    EXPECT_FALSE(spec.arguments().contains("-object"));
+}
+
 TEST_F(TestQemuVMProcessSpec, resume_arguments_taken_from_resumedata)
 {
     const mp::QemuVMProcessSpec::ResumeData resume_data{"suspend_tag", "machine_type", false, {"-one", "-two"}};
@@ -136,6 +161,13 @@ TEST_F(TestQemuVMProcessSpec, apparmor_profile_includes_disk_images)
     EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/cloud_init.iso rk,"));
 }
 
+TEST_F(TestQemuVMProcessSpec, apparmorProfileIncludesBackingImagesNextToTheInstanceImage)
+{
+    mp::QemuVMProcessSpec spec(desc, platform_args, mount_args, std::nullopt);
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("/path/to/backing-*.qcow2 rk,"));
+}
+
 TEST_F(TestQemuVMProcessSpec, apparmor_profile_identifier)
 {
     mp::QemuVMProcessSpec spec(desc, platform_args, mount_args, std::nullopt);
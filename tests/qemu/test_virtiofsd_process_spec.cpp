@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tests/common.h"
+#include "tests/mock_environment_helpers.h"
+
+#include <src/platform/backends/qemu/virtiofsd_process_spec.h>
+
+#include <QTemporaryDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+struct TestVirtiofsdProcessSpec : public Test
+{
+    const std::string instance{"vm_name"};
+    const QString mount_tag{"m810e457178f448d9afffc9d950d726"};
+    const QString socket_path{"/tmp/multipass-virtiofs-0123456789abcdef.sock"};
+    const std::string source_path{"/path/to/source"};
+    const mp::VirtiofsdProcessSpec::Options options{"auto", 0};
+};
+
+TEST_F(TestVirtiofsdProcessSpec, defaultArgumentsCorrect)
+{
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, options};
+
+    EXPECT_EQ(spec.arguments(), QStringList({"--socket-path=/tmp/multipass-virtiofs-0123456789abcdef.sock", "-o",
+                                             "source=/path/to/source", "-o", "cache=auto", "-o", "sandbox=chroot"}));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, argumentsHonourCacheModeAndThreadPoolSize)
+{
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, {"always", 16}};
+
+    const auto args = spec.arguments();
+    EXPECT_TRUE(args.contains("cache=always"));
+    EXPECT_TRUE(args.contains("--thread-pool-size=16"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, argumentsEscapeCommasInSource)
+{
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, "/path/with,comma", options};
+
+    EXPECT_TRUE(spec.arguments().contains("source=/path/with\\,comma"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, programNotRunningAsSnapCorrect)
+{
+    mpt::UnsetEnvScope e("SNAP");
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, options};
+
+    EXPECT_EQ(spec.program(), "/usr/lib/qemu/virtiofsd");
+}
+
+TEST_F(TestVirtiofsdProcessSpec, programRunningAsSnapCorrect)
+{
+    QTemporaryDir snap_dir;
+
+    mpt::SetEnvScope e("SNAP", snap_dir.path().toUtf8());
+    mpt::SetEnvScope e2("SNAP_NAME", "multipass");
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, options};
+
+    EXPECT_EQ(spec.program(), snap_dir.path() + "/usr/lib/qemu/virtiofsd");
+}
+
+TEST_F(TestVirtiofsdProcessSpec, apparmorProfileIncludesSourceAndSocket)
+{
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, options};
+
+    const auto profile = spec.apparmor_profile();
+    EXPECT_TRUE(profile.contains("/path/to/source/ rw,"));
+    EXPECT_TRUE(profile.contains("/path/to/source/** rwlk,"));
+    EXPECT_TRUE(profile.contains("/tmp/multipass-virtiofs-0123456789abcdef.sock rw,"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, apparmorProfileHasCorrectName)
+{
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, options};
+
+    EXPECT_TRUE(spec.apparmor_profile().contains("profile multipass.vm_name.m810e457178f448d9afffc9d950d726.virtiofsd"));
+}
+
+TEST_F(TestVirtiofsdProcessSpec, identifierIsInstanceAndMountTag)
+{
+    mp::VirtiofsdProcessSpec spec{instance, mount_tag, socket_path, source_path, options};
+
+    EXPECT_EQ(spec.identifier(), "vm_name.m810e457178f448d9afffc9d950d726");
+}
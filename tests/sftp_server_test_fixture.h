@@ -23,6 +23,9 @@
 #include "mock_sftpserver.h"
 #include "mock_ssh_test_fixture.h"
 
+#include <algorithm>
+#include <string>
+
 namespace multipass
 {
 namespace test
@@ -35,13 +38,26 @@ struct SftpServerTest : public testing::Test
                         std::free(sftp);
                     }}
     {
-        init_sftp.returnValue(SSH_OK);
         reply_status.returnValue(SSH_OK);
         get_client_msg.returnValue(nullptr);
         handle_sftp.returnValue(nullptr);
     }
 
-    decltype(MOCK(sftp_server_init)) init_sftp{MOCK(sftp_server_init)};
+    // Reads what sshfs sends first on a new SFTP session, an INIT with its version, until it has all been read
+    int read_pending_init(void* dest, uint32_t count, int is_stderr)
+    {
+        if (is_stderr)
+            return 0;
+
+        const auto num_bytes = std::min<size_t>(count, pending_init.size());
+        std::copy_n(pending_init.begin(), num_bytes, static_cast<char*>(dest));
+        pending_init.erase(0, num_bytes);
+        return static_cast<int>(num_bytes);
+    }
+
+    inline static const std::string init_packet{"\0\0\0\5\1\0\0\0\3", 9}; // SSH_FXP_INIT, version 3
+    std::string pending_init;
+
     decltype(MOCK(sftp_reply_status)) reply_status{MOCK(sftp_reply_status)};
     decltype(MOCK(sftp_get_client_message)) get_client_msg{MOCK(sftp_get_client_message)};
     decltype(MOCK(sftp_client_message_free)) msg_free{MOCK(sftp_client_message_free)};
@@ -49,6 +65,18 @@ struct SftpServerTest : public testing::Test
     MockScope<decltype(mock_sftp_free)> free_sftp;
 
     MockSSHTestFixture mock_ssh_test_fixture;
+    MockScope<decltype(mock_sftp_server_new)> new_sftp{mock_sftp_server_new,
+                                                       [this, make = mock_sftp_server_new](auto... args) {
+                                                           pending_init = init_packet;
+                                                           return make(args...);
+                                                       }};
+    MockScope<decltype(mock_ssh_channel_read_timeout)> read_channel{
+        mock_ssh_channel_read_timeout,
+        [this](ssh_channel, void* dest, uint32_t count, int is_stderr, int) {
+            return read_pending_init(dest, count, is_stderr);
+        }};
+    MockScope<decltype(mock_ssh_channel_write)> write_channel{
+        mock_ssh_channel_write, [](ssh_channel, const void*, uint32_t len) { return static_cast<int>(len); }};
 };
 } // namespace test
 } // namespace multipass
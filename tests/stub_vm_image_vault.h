@@ -59,6 +59,11 @@ struct StubVMImageVault final : public multipass::VMImageVault
         return {};
     }
 
+    VMImage clone(const std::string&, const std::string&) override
+    {
+        return {};
+    }
+
     TempFile dummy_image;
 };
 }
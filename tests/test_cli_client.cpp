@@ -47,6 +47,8 @@
 #include <multipass/exceptions/settings_exceptions.h>
 #include <multipass/exceptions/ssh_exception.h>
 
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStringList>
 #include <QTemporaryFile>
 #include <QTimer>
@@ -144,6 +146,7 @@ struct Client : public Test
         EXPECT_CALL(mock_settings, get(Eq(mp::petenv_key))).WillRepeatedly(Return(petenv_name));
         EXPECT_CALL(mock_settings, get(Eq(mp::winterm_key))).WillRepeatedly(Return("none"));
         EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("true"));
+        EXPECT_CALL(mock_settings, get(Eq(mp::ssh_multiplexing_key))).WillRepeatedly(Return("false"));
         EXPECT_CALL(mock_settings, register_handler(_)).WillRepeatedly(Return(nullptr));
         EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
 
@@ -615,6 +618,34 @@ TEST_F(Client, transfer_cmd_local_source_instance_target)
     EXPECT_EQ(send_command({"transfer", "foo", "test-vm:bar"}), mp::ReturnCode::Ok);
 }
 
+TEST_F(Client, transfer_cmd_sync_local_source_instance_target)
+{
+    auto [mocked_sftp_utils, mocked_sftp_utils_guard] = mpt::MockSFTPUtils::inject();
+    auto mocked_sftp_client = std::make_unique<mpt::MockSFTPClient>();
+    auto mocked_sftp_client_p = mocked_sftp_client.get();
+
+    EXPECT_CALL(*mocked_sftp_utils, make_SFTPClient).WillOnce(Return(std::move(mocked_sftp_client)));
+    EXPECT_CALL(*mocked_sftp_client_p, push(_, _, mp::SFTPClient::Flags{mp::SFTPClient::Flag::Sync}))
+        .WillOnce(Return(true));
+    EXPECT_CALL(mock_daemon, ssh_info)
+        .WillOnce([](auto, grpc::ServerReaderWriter<mp::SSHInfoReply, mp::SSHInfoRequest>* server) {
+            mp::SSHInfoReply reply;
+            reply.mutable_ssh_info()->insert({"test-vm", mp::SSHInfo{}});
+            server->Write(reply);
+            return grpc::Status{};
+        });
+
+    EXPECT_EQ(send_command({"transfer", "--sync", "foo", "test-vm:bar"}), mp::ReturnCode::Ok);
+}
+
+TEST_F(Client, transfer_cmd_sync_instance_source_fails)
+{
+    std::stringstream err;
+    EXPECT_EQ(send_command({"transfer", "--sync", "test-vm:foo", "bar"}, trash_stream, err),
+              mp::ReturnCode::CommandLineError);
+    EXPECT_THAT(err.str(), HasSubstr("--sync is only supported"));
+}
+
 TEST_F(Client, transfer_cmd_help_ok)
 {
     EXPECT_THAT(send_command({"transfer", "-h"}), Eq(mp::ReturnCode::Ok));
@@ -1059,6 +1090,57 @@ TEST_F(Client, launch_cmd_cpu_option_fails_no_value)
     EXPECT_THAT(send_command({"launch", "-c"}), Eq(mp::ReturnCode::CommandLineError));
 }
 
+TEST_F(Client, launchCmdCountAsksForSeveralInstances)
+{
+    const auto count_matcher =
+        AllOf(Property(&mp::LaunchRequest::count, 3), Property(&mp::LaunchRequest::name_prefix, "web"),
+              Property(&mp::LaunchRequest::max_parallel, 2), Property(&mp::LaunchRequest::instance_name, IsEmpty()));
+
+    EXPECT_CALL(mock_daemon, launch)
+        .WillOnce(WithArg<1>(check_request_and_return<mp::LaunchReply, mp::LaunchRequest>(count_matcher, ok)));
+    EXPECT_THAT(send_command({"launch", "--count", "3", "--name-prefix", "web", "--parallel", "2"}),
+                Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, launchCmdCountFailsWithName)
+{
+    EXPECT_THAT(send_command({"launch", "--count", "2", "--name", "foo"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, launchCmdCountFailsOnZero)
+{
+    EXPECT_THAT(send_command({"launch", "--count", "0"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, launchCmdNamePrefixFailsWithoutCount)
+{
+    EXPECT_THAT(send_command({"launch", "--name-prefix", "web"}), Eq(mp::ReturnCode::CommandLineError));
+}
+
+TEST_F(Client, launchCmdMountsIntoEveryInstanceLaunched)
+{
+    const QTemporaryDir fake_directory{};
+    const auto fake_source = fake_directory.path().toStdString();
+
+    EXPECT_CALL(mock_daemon, launch)
+        .WillOnce(WithArg<1>([](grpc::ServerReaderWriter<mp::LaunchReply, mp::LaunchRequest>* server) {
+            mp::LaunchReply reply;
+            reply.add_vm_instance_names("web-1");
+            reply.add_vm_instance_names("web-2");
+            server->Write(reply);
+
+            return grpc::Status{};
+        }));
+    const auto first_mount_matcher = make_mount_matcher(fake_source, fake_source, "web-1");
+    const auto second_mount_matcher = make_mount_matcher(fake_source, fake_source, "web-2");
+    EXPECT_CALL(mock_daemon, mount)
+        .WillOnce(WithArg<1>(check_request_and_return<mp::MountReply, mp::MountRequest>(first_mount_matcher, ok)))
+        .WillOnce(WithArg<1>(check_request_and_return<mp::MountReply, mp::MountRequest>(second_mount_matcher, ok)));
+
+    EXPECT_EQ(send_command({"launch", "--count", "2", "--name-prefix", "web", "--mount", fake_source}),
+              mp::ReturnCode::Ok);
+}
+
 TEST_F(Client, DISABLE_ON_MACOS(launch_cmd_custom_image_file_ok))
 {
     EXPECT_CALL(mock_daemon, launch(_, _));
@@ -1412,14 +1494,12 @@ TEST_F(Client, purge_cmd_help_ok)
 TEST_F(Client, exec_cmd_double_dash_ok_cmd_arg)
 {
     EXPECT_CALL(mock_daemon, ssh_info(_, _));
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
     EXPECT_THAT(send_command({"exec", "foo", "--", "cmd"}), Eq(mp::ReturnCode::Ok));
 }
 
 TEST_F(Client, exec_cmd_double_dash_ok_cmd_arg_with_opts)
 {
     EXPECT_CALL(mock_daemon, ssh_info(_, _));
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
     EXPECT_THAT(send_command({"exec", "foo", "--", "cmd", "--foo", "--bar"}), Eq(mp::ReturnCode::Ok));
 }
 
@@ -1431,14 +1511,12 @@ TEST_F(Client, exec_cmd_double_dash_fails_missing_cmd_arg)
 TEST_F(Client, exec_cmd_no_double_dash_ok_cmd_arg)
 {
     EXPECT_CALL(mock_daemon, ssh_info(_, _));
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
     EXPECT_THAT(send_command({"exec", "foo", "cmd"}), Eq(mp::ReturnCode::Ok));
 }
 
 TEST_F(Client, exec_cmd_no_double_dash_ok_multiple_args)
 {
     EXPECT_CALL(mock_daemon, ssh_info(_, _));
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
     EXPECT_THAT(send_command({"exec", "foo", "cmd", "bar"}), Eq(mp::ReturnCode::Ok));
 }
 
@@ -1530,10 +1608,20 @@ mp::SSHInfo make_ssh_info(const std::string& host = "222.222.222.222", int port
     return ssh_info;
 }
 
-mp::SSHInfoReply make_fake_ssh_info_response(const std::string& instance_name)
+mp::SSHInfoReply make_fake_ssh_info_response(const std::string& instance_name, const std::string& source_path = "",
+                                             const std::string& target_path = "")
 {
+    auto ssh_info = make_ssh_info();
+
+    if (!source_path.empty() && !target_path.empty())
+    {
+        auto entry = ssh_info.add_mount_paths();
+        entry->set_source_path(source_path);
+        entry->set_target_path(target_path);
+    }
+
     mp::SSHInfoReply response;
-    (*response.mutable_ssh_info())[instance_name] = make_ssh_info();
+    (*response.mutable_ssh_info())[instance_name] = ssh_info;
 
     return response;
 }
@@ -1558,8 +1646,6 @@ TEST_P(SSHClientReturnTest, execCmdWithoutDirWorks)
             return grpc::Status{};
         });
 
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
-
     EXPECT_EQ(send_command({"exec", instance_name, "--", "cmd"}), failure_code);
 }
 
@@ -1669,6 +1755,53 @@ TEST_F(Client, execCmdFailsIfSshExecThrows)
     EXPECT_THAT(cerr_stream.str(), HasSubstr("exec failed: some exception\n"));
 }
 
+TEST_F(Client, execAsksForMountsWithSshInfo)
+{
+    const auto with_mounts_matcher = Property(&mp::SSHInfoRequest::with_mounts, IsTrue());
+    EXPECT_CALL(mock_daemon, info(_, _)).Times(0);
+    EXPECT_CALL(mock_daemon, ssh_info(_, _))
+        .WillOnce(WithArg<1>(check_request_and_return<mp::SSHInfoReply, mp::SSHInfoRequest>(with_mounts_matcher, ok)));
+
+    EXPECT_EQ(send_command({"exec", "instance", "--", "cmd"}), mp::ReturnCode::Ok);
+}
+
+TEST_F(Client, execDoesNotAskForMountsWithoutMapping)
+{
+    const auto without_mounts_matcher = Property(&mp::SSHInfoRequest::with_mounts, IsFalse());
+    EXPECT_CALL(mock_daemon, ssh_info(_, _))
+        .WillOnce(
+            WithArg<1>(check_request_and_return<mp::SSHInfoReply, mp::SSHInfoRequest>(without_mounts_matcher, ok)));
+
+    EXPECT_EQ(send_command({"exec", "instance", "--no-map-working-directory", "--", "cmd"}), mp::ReturnCode::Ok);
+}
+
+TEST_F(Client, execMapsWorkingDirectoryFromSshInfoMounts)
+{
+    std::string instance_name{"instance"};
+    std::string source_dir{QDir::current().canonicalPath().toStdString()};
+    std::string target_dir{"/home/ubuntu/dir"};
+    std::string cmd{"pwd"};
+
+    REPLACE(ssh_channel_request_exec, ([&target_dir, &cmd](ssh_channel, const char* raw_cmd) {
+                EXPECT_THAT(raw_cmd, StartsWith("'cd' '" + target_dir + "/'"));
+                EXPECT_THAT(raw_cmd, EndsWith("'" + cmd + "'"));
+
+                return SSH_OK;
+            }));
+
+    mp::SSHInfoReply response = make_fake_ssh_info_response(instance_name, source_dir, target_dir);
+
+    EXPECT_CALL(mock_daemon, info(_, _)).Times(0);
+    EXPECT_CALL(mock_daemon, ssh_info(_, _))
+        .WillOnce([&response](grpc::ServerContext* context,
+                              grpc::ServerReaderWriter<mp::SSHInfoReply, mp::SSHInfoRequest>* server) {
+            server->Write(response);
+            return grpc::Status{};
+        });
+
+    EXPECT_EQ(send_command({"exec", instance_name, "--", cmd}), mp::ReturnCode::Ok);
+}
+
 TEST_F(Client, execFailsOnArgumentClash)
 {
     std::stringstream cerr_stream;
@@ -1763,6 +1896,45 @@ TEST_F(Client, infoCmdSucceedsWithAllAndNoRuntimeInformation)
     EXPECT_THAT(send_command({"info", "name5", "--no-runtime-information"}), Eq(mp::ReturnCode::Ok));
 }
 
+TEST_F(Client, infoCmdAsksForStreamingWithStream)
+{
+    const auto info_matcher = Property(&mp::InfoRequest::streaming, IsTrue());
+
+    EXPECT_CALL(mock_daemon, info)
+        .WillOnce(WithArg<1>(check_request_and_return<mp::InfoReply, mp::InfoRequest>(info_matcher, ok)));
+    EXPECT_THAT(send_command({"info", "--all", "--stream"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, infoCmdClosesStreamedJsonWhenLaterInstancesFail)
+{
+    EXPECT_CALL(mock_daemon, info).WillOnce([](auto, grpc::ServerReaderWriter<mp::InfoReply, mp::InfoRequest>* server) {
+        mp::InfoReply reply;
+        reply.add_details()->set_name("good");
+        server->Write(reply);
+
+        return grpc::Status{grpc::StatusCode::NOT_FOUND, "instance \"missing\" does not exist"};
+    });
+
+    std::stringstream cout_stream, cerr_stream;
+    EXPECT_THAT(send_command({"info", "good", "missing", "--stream", "--format", "json"}, cout_stream, cerr_stream),
+                Eq(mp::ReturnCode::CommandFail));
+
+    QJsonParseError parse_error;
+    const auto doc = QJsonDocument::fromJson(QByteArray::fromStdString(cout_stream.str()), &parse_error);
+    ASSERT_EQ(parse_error.error, QJsonParseError::NoError) << cout_stream.str();
+    EXPECT_TRUE(doc.object()["info"].toObject().contains("good"));
+    EXPECT_THAT(cerr_stream.str(), HasSubstr("instance \"missing\" does not exist"));
+}
+
+TEST_F(Client, infoCmdPrintsNothingWhenItFailsBeforeAnyInstance)
+{
+    EXPECT_CALL(mock_daemon, info).WillOnce(Return(grpc::Status{grpc::StatusCode::NOT_FOUND, "msg"}));
+
+    std::stringstream cout_stream;
+    EXPECT_THAT(send_command({"info", "missing", "--format", "json"}, cout_stream), Eq(mp::ReturnCode::CommandFail));
+    EXPECT_TRUE(cout_stream.str().empty()) << cout_stream.str();
+}
+
 // list cli tests
 TEST_F(Client, list_cmd_ok_no_args)
 {
@@ -1792,6 +1964,45 @@ TEST_F(Client, list_cmd_no_ipv4_ok)
     EXPECT_THAT(send_command({"list", "--no-ipv4"}), Eq(mp::ReturnCode::Ok));
 }
 
+TEST_F(Client, listCmdDoesNotStreamByDefault)
+{
+    const auto list_matcher = Property(&mp::ListRequest::streaming, IsFalse());
+
+    EXPECT_CALL(mock_daemon, list)
+        .WillOnce(WithArg<1>(check_request_and_return<mp::ListReply, mp::ListRequest>(list_matcher, ok)));
+    EXPECT_THAT(send_command({"list"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, listCmdAsksForStreamingWithStream)
+{
+    const auto list_matcher = Property(&mp::ListRequest::streaming, IsTrue());
+
+    EXPECT_CALL(mock_daemon, list)
+        .WillOnce(WithArg<1>(check_request_and_return<mp::ListReply, mp::ListRequest>(list_matcher, ok)));
+    EXPECT_THAT(send_command({"list", "--stream"}), Eq(mp::ReturnCode::Ok));
+}
+
+TEST_F(Client, listCmdPrintsStreamedInstancesInTheOrderTheyCome)
+{
+    EXPECT_CALL(mock_daemon, list).WillOnce([](auto, grpc::ServerReaderWriter<mp::ListReply, mp::ListRequest>* server) {
+        mp::ListReply reply;
+        for (const auto& name : {"foo", "bar"})
+        {
+            reply.Clear();
+            reply.add_instances()->set_name(name);
+            server->Write(reply);
+        }
+
+        return grpc::Status{};
+    });
+
+    std::stringstream cout_stream;
+    EXPECT_THAT(send_command({"list", "--stream", "--format", "csv"}, cout_stream), Eq(mp::ReturnCode::Ok));
+    EXPECT_EQ(cout_stream.str(), "Name,State,IPv4,IPv6,Release,AllIPv4\n"
+                                 "foo,Unknown,,,Not Available,\"\"\n"
+                                 "bar,Unknown,,,Not Available,\"\"\n");
+}
+
 // mount cli tests
 // Note: mpt::test_data_path() returns an absolute path
 TEST_F(Client, mount_cmd_good_absolute_source_path)
@@ -1884,6 +2095,26 @@ TEST_F(Client, mountCmdFailsBogusMountType)
               mp::ReturnCode::CommandLineError);
 }
 
+TEST_F(Client, mountCmdGoodThroughputProfile)
+{
+    EXPECT_CALL(mock_daemon, mount(_, _));
+    EXPECT_EQ(send_command({"mount", "--profile", "throughput", mpt::test_data_path().toStdString(), "test-vm:test"}),
+              mp::ReturnCode::Ok);
+}
+
+TEST_F(Client, mountCmdFailsBogusProfile)
+{
+    EXPECT_EQ(send_command({"mount", "--profile", "bogus", mpt::test_data_path().toStdString(), "test-vm:test"}),
+              mp::ReturnCode::CommandLineError);
+}
+
+TEST_F(Client, mountCmdFailsProfileForNativeMounts)
+{
+    EXPECT_EQ(send_command({"mount", "-t", "native", "-p", "throughput", mpt::test_data_path().toStdString(),
+                            "test-vm:test"}),
+              mp::ReturnCode::CommandLineError);
+}
+
 // recover cli tests
 TEST_F(Client, recover_cmd_fails_no_args)
 {
@@ -3449,7 +3680,6 @@ TEST_F(ClientAlias, execute_existing_alias)
 {
     populate_db_file(AliasesVector{{"some_alias", {"some_instance", "some_command", "map"}}});
 
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
     EXPECT_CALL(mock_daemon, ssh_info(_, _));
 
     EXPECT_EQ(send_command({"some_alias"}), mp::ReturnCode::Ok);
@@ -3470,7 +3700,6 @@ TEST_F(ClientAlias, execute_alias_with_arguments)
 {
     populate_db_file(AliasesVector{{"some_alias", {"some_instance", "some_command", "map"}}});
 
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function());
     EXPECT_CALL(mock_daemon, ssh_info(_, _));
 
     EXPECT_EQ(send_command({"some_alias", "some_argument"}), mp::ReturnCode::Ok);
@@ -3743,7 +3972,7 @@ TEST_F(ClientAlias, execAliasRewritesMountedDir)
     std::string source_dir{(current_dir.canonicalPath()).toStdString()};
     std::string target_dir{"/home/ubuntu/dir"};
 
-    EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function(source_dir, target_dir));
+    EXPECT_CALL(mock_daemon, info(_, _)).Times(0);
 
     populate_db_file(AliasesVector{{alias_name, {instance_name, cmd, "map"}}});
 
@@ -3755,7 +3984,7 @@ TEST_F(ClientAlias, execAliasRewritesMountedDir)
                 return SSH_OK;
             }));
 
-    mp::SSHInfoReply ssh_info_response = make_fake_ssh_info_response(instance_name);
+    mp::SSHInfoReply ssh_info_response = make_fake_ssh_info_response(instance_name, source_dir, target_dir);
 
     EXPECT_CALL(mock_daemon, ssh_info(_, _))
         .WillOnce([&ssh_info_response](grpc::ServerContext* context,
@@ -3784,10 +4013,7 @@ TEST_P(NotDirRewriteTestsuite, execAliasDoesNotRewriteMountedDir)
     std::string source_dir{source_qdir.toStdString()};
     std::string target_dir{"/home/ubuntu/dir"};
 
-    if (map_dir)
-        EXPECT_CALL(mock_daemon, info(_, _)).WillOnce(make_info_function(source_dir, target_dir));
-    else
-        EXPECT_CALL(mock_daemon, info(_, _)).Times(0);
+    EXPECT_CALL(mock_daemon, info(_, _)).Times(0);
 
     populate_db_file(AliasesVector{{alias_name, {instance_name, cmd, map_dir ? "map" : "default"}}});
 
@@ -3799,7 +4025,7 @@ TEST_P(NotDirRewriteTestsuite, execAliasDoesNotRewriteMountedDir)
                 return SSH_OK;
             }));
 
-    mp::SSHInfoReply ssh_info_response = make_fake_ssh_info_response(instance_name);
+    mp::SSHInfoReply ssh_info_response = make_fake_ssh_info_response(instance_name, source_dir, target_dir);
 
     EXPECT_CALL(mock_daemon, ssh_info(_, _))
         .WillOnce([&ssh_info_response](grpc::ServerContext* context,
@@ -1327,6 +1327,30 @@ TEST_F(Daemon, reads_mac_addresses_from_json)
     check_interfaces_in_json(filename, mac_addr, extra_interfaces);
 }
 
+TEST_F(Daemon, listStreamsInstancesInRepliesOfTheirOwnWhenAsked)
+{
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+    const auto [temp_dir, filename] =
+        plant_instance_json(fake_json_contents("52:54:00:73:76:30", std::vector<mp::NetworkInterface>{}));
+
+    config_builder.data_directory = temp_dir->path();
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerReaderWriter<mp::ListReply, mp::ListRequest>> mock_server;
+    auto instance_matcher = Property(&mp::ListVMInstance::name, "real-zebraphant");
+
+    InSequence seq;
+    EXPECT_CALL(mock_server, Write(Property(&mp::ListReply::instances, ElementsAre(instance_matcher)), _))
+        .WillOnce(Return(true));
+    EXPECT_CALL(mock_server, Write(Property(&mp::ListReply::instances, IsEmpty()), _)) // for deleted instances
+        .WillOnce(Return(true));
+
+    mp::ListRequest request;
+    request.set_streaming(true);
+    EXPECT_TRUE(call_daemon_slot(daemon, &mp::Daemon::list, request, mock_server).ok());
+}
+
 TEST_F(Daemon, writesAndReadsMountsInJson)
 {
     config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
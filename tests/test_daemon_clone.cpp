@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "daemon_test_fixture.h"
+#include "file_operations.h"
+#include "mock_platform.h"
+#include "mock_server_reader_writer.h"
+#include "mock_settings.h"
+#include "mock_virtual_machine.h"
+#include "mock_vm_image_vault.h"
+
+#include <src/daemon/daemon.h>
+
+#include <multipass/constants.h>
+#include <multipass/format.h>
+
+#include <QDir>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+namespace
+{
+constexpr auto source_mac = "52:54:00:00:00:01";
+
+struct TestDaemonClone : public mpt::DaemonTestFixture
+{
+    void SetUp() override
+    {
+        EXPECT_CALL(mock_settings, register_handler).WillRepeatedly(Return(nullptr));
+        EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
+        EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("true"));
+
+        mpt::make_file_with_content(
+            QDir{temp_dir.path()}.filePath("multipassd-vm-instances.json"),
+            fmt::format(R"({{"source": {{"deleted": false, "disk_space": "5368709120", "extra_interfaces": [],
+                                         "mac_addr": "{}", "mem_size": "1073741824", "metadata": {{}},
+                                         "mounts": [], "num_cores": 1, "ssh_username": "ubuntu", "state": 0}}}})",
+                        source_mac));
+
+        config_builder.data_directory = temp_dir.path();
+        config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    }
+
+    grpc::Status clone(mp::Daemon& daemon, const std::string& destination_name = {})
+    {
+        mp::CloneRequest request;
+        request.set_source_name("source");
+        request.set_destination_name(destination_name);
+
+        return call_daemon_slot(daemon, &mp::Daemon::clone, request,
+                                NiceMock<mpt::MockServerReaderWriter<mp::CloneReply, mp::CloneRequest>>{});
+    }
+
+    mpt::TempDir temp_dir;
+
+    mpt::MockPlatform::GuardedMock attr{mpt::MockPlatform::inject<NiceMock>()};
+    mpt::MockPlatform* mock_platform = attr.first;
+
+    mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject<StrictMock>();
+    mpt::MockSettings& mock_settings = *mock_settings_injection.first;
+};
+} // namespace
+
+TEST_F(TestDaemonClone, createsStoppedInstanceWithIdentityOfItsOwn)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+
+    std::vector<mp::VirtualMachineDescription> descriptions;
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _))
+        .Times(2)
+        .WillRepeatedly([&descriptions](const mp::VirtualMachineDescription& desc, auto&) {
+            descriptions.push_back(desc);
+            return std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+        });
+    EXPECT_CALL(*mock_factory, clone_instance_image(_, _)).Times(1);
+
+    mp::Daemon daemon{config_builder.build()};
+
+    auto status = clone(daemon);
+    EXPECT_TRUE(status.ok()) << status.error_message();
+
+    ASSERT_EQ(descriptions.size(), 2u);
+    const auto& clone_desc = descriptions.back();
+    EXPECT_EQ(clone_desc.vm_name, "source-clone1");
+    EXPECT_NE(clone_desc.default_mac_address, source_mac);
+    EXPECT_EQ(clone_desc.meta_data_config["instance-id"].as<std::string>(), "source-clone1");
+    EXPECT_EQ(clone_desc.network_data_config["ethernets"]["default"]["dhcp-identifier"].as<std::string>(), "mac");
+}
+
+TEST_F(TestDaemonClone, refusesRunningSource)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _)).WillOnce([](const auto& desc, auto&) {
+        auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+        EXPECT_CALL(*vm, current_state()).WillRepeatedly(Return(mp::VirtualMachine::State::running));
+        return vm;
+    });
+    EXPECT_CALL(*mock_factory, clone_instance_image(_, _)).Times(0);
+
+    mp::Daemon daemon{config_builder.build()};
+
+    auto status = clone(daemon, "copy");
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+    EXPECT_THAT(status.error_message(), HasSubstr("must be stopped"));
+}
+
+TEST_F(TestDaemonClone, removesClonedImageWhenCloningFails)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+    auto& mock_vault = static_cast<mpt::MockVMImageVault&>(*config_builder.vault);
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _)).Times(1);
+    EXPECT_CALL(*mock_factory, clone_instance_image(_, _)).WillOnce(Throw(std::runtime_error{"qemu-img failed"}));
+    EXPECT_CALL(mock_vault, remove(Eq("copy"))).Times(1);
+
+    mp::Daemon daemon{config_builder.build()};
+
+    auto status = clone(daemon, "copy");
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::FAILED_PRECONDITION);
+    EXPECT_THAT(status.error_message(), HasSubstr("qemu-img failed"));
+}
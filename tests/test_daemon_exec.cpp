@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "daemon_test_fixture.h"
+#include "mock_platform.h"
+#include "mock_server_reader_writer.h"
+#include "mock_settings.h"
+#include "mock_ssh_test_fixture.h"
+#include "mock_virtual_machine.h"
+#include "mock_vm_image_vault.h"
+
+#include <src/daemon/daemon.h>
+
+#include <multipass/constants.h>
+
+#include <QEventLoop>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+struct TestDaemonExec : public mpt::DaemonTestFixture
+{
+    void SetUp() override
+    {
+        EXPECT_CALL(mock_settings, register_handler).WillRepeatedly(Return(nullptr));
+        EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
+    }
+
+    // Plants an instance in the given state, for the daemon to find
+    std::unique_ptr<mpt::TempDir> plant_instance(mp::VirtualMachine::State state)
+    {
+        auto mock_factory = use_a_mock_vm_factory();
+        auto [temp_dir, filename] = plant_instance_json(fake_json_contents(mac_addr, extra_interfaces));
+
+        instance_ptr = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(mock_instance_name);
+        EXPECT_CALL(*instance_ptr, current_state()).WillRepeatedly(Return(state));
+        EXPECT_CALL(*mock_factory, create_virtual_machine(_, _)).WillOnce([this](const auto&, auto&) {
+            return std::move(instance_ptr);
+        });
+
+        config_builder.data_directory = temp_dir->path();
+        config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+        return std::move(temp_dir);
+    }
+
+    // As call_daemon_slot, only with no call context, which is only used when clients do not close their side
+    grpc::Status call_exec(mp::Daemon& daemon, const mp::ExecRequest& request,
+                           mpt::MockServerReaderWriter<mp::ExecReply, mp::ExecRequest>& server)
+    {
+        std::promise<grpc::Status> status_promise;
+        auto status_future = status_promise.get_future();
+
+        auto thread = QThread::create([&daemon, &request, &server, &status_promise] {
+            QEventLoop loop;
+            daemon.exec(&request, &server, nullptr, &status_promise);
+            loop.exec();
+        });
+
+        thread->start();
+
+        EXPECT_TRUE(is_ready(status_future));
+
+        thread->quit();
+
+        return status_future.get();
+    }
+
+    const std::string mock_instance_name{"real-zebraphant"};
+    const std::string mac_addr{"52:54:00:73:76:28"};
+    std::vector<mp::NetworkInterface> extra_interfaces;
+    std::unique_ptr<NiceMock<mpt::MockVirtualMachine>> instance_ptr;
+
+    mpt::MockPlatform::GuardedMock attr{mpt::MockPlatform::inject<NiceMock>()};
+    mpt::MockPlatform* mock_platform = attr.first;
+
+    mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject<StrictMock>();
+    mpt::MockSettings& mock_settings = *mock_settings_injection.first;
+};
+
+TEST_F(TestDaemonExec, unknownInstanceIsNotFound)
+{
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::ExecRequest request;
+    request.set_instance_name("nonexistent");
+    request.add_command("ls");
+
+    StrictMock<mpt::MockServerReaderWriter<mp::ExecReply, mp::ExecRequest>> server;
+    auto status = call_exec(daemon, request, server);
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::NOT_FOUND);
+    EXPECT_THAT(status.error_message(), HasSubstr("does not exist"));
+}
+
+TEST_F(TestDaemonExec, stoppedInstanceIsAborted)
+{
+    const auto temp_dir = plant_instance(mp::VirtualMachine::State::stopped);
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::ExecRequest request;
+    request.set_instance_name(mock_instance_name);
+    request.add_command("ls");
+
+    StrictMock<mpt::MockServerReaderWriter<mp::ExecReply, mp::ExecRequest>> server;
+    auto status = call_exec(daemon, request, server);
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::ABORTED);
+    EXPECT_THAT(status.error_message(), HasSubstr("is not running"));
+}
+
+TEST_F(TestDaemonExec, missingCommandIsInvalid)
+{
+    const auto temp_dir = plant_instance(mp::VirtualMachine::State::running);
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::ExecRequest request;
+    request.set_instance_name(mock_instance_name);
+
+    StrictMock<mpt::MockServerReaderWriter<mp::ExecReply, mp::ExecRequest>> server;
+    auto status = call_exec(daemon, request, server);
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(TestDaemonExec, streamsInputAndOutputThroughChannel)
+{
+    mpt::MockSSHTestFixture mock_ssh_test_fixture;
+    const auto temp_dir = plant_instance(mp::VirtualMachine::State::running);
+    mp::Daemon daemon{config_builder.build()};
+
+    std::string cmd_line;
+    REPLACE(ssh_channel_request_exec, [&cmd_line](ssh_channel, const char* cmd) {
+        cmd_line = cmd;
+        return SSH_OK;
+    });
+
+    std::string sent_input;
+    REPLACE(ssh_channel_write, [&sent_input](ssh_channel, const void* data, uint32_t len) {
+        sent_input.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+
+    // The command ends once its input does, as cat would
+    std::atomic<bool> eof_sent{false};
+    REPLACE(ssh_channel_send_eof, [&eof_sent](ssh_channel) {
+        eof_sent = true;
+        return SSH_OK;
+    });
+    REPLACE(ssh_channel_is_eof, [&eof_sent](ssh_channel) { return eof_sent.load(); });
+
+    std::vector<std::pair<std::string, bool>> output{{"some output", false}, {"some error", true}};
+    REPLACE(ssh_channel_read_timeout, [&output](ssh_channel, void* dest, uint32_t count, int is_stderr, int) {
+        auto it = std::find_if(output.begin(), output.end(),
+                               [is_stderr](const auto& chunk) { return chunk.second == bool(is_stderr); });
+        if (it == output.end())
+            return 0;
+
+        const auto size = std::min<uint32_t>(count, it->first.size());
+        std::memcpy(dest, it->first.data(), size);
+        output.erase(it);
+        return static_cast<int>(size);
+    });
+    REPLACE(ssh_channel_get_exit_status, [](auto...) { return 3; });
+
+    mp::ExecRequest request;
+    request.set_instance_name(mock_instance_name);
+    request.add_command("cat");
+    request.set_input("some ");
+
+    StrictMock<mpt::MockServerReaderWriter<mp::ExecReply, mp::ExecRequest>> server;
+    EXPECT_CALL(server, Read(_))
+        .WillOnce([](mp::ExecRequest* next) {
+            next->set_input("input");
+            return true;
+        })
+        .WillOnce(Return(false)); // the client closes its side
+
+    std::vector<mp::ExecReply> replies;
+    std::mutex replies_mutex;
+    EXPECT_CALL(server, Write(_, _)).WillRepeatedly([&replies, &replies_mutex](const mp::ExecReply& reply, auto) {
+        std::lock_guard<std::mutex> lock{replies_mutex};
+        replies.push_back(reply);
+        return true;
+    });
+
+    auto status = call_exec(daemon, request, server);
+
+    EXPECT_TRUE(status.ok()) << status.error_message();
+    EXPECT_THAT(cmd_line, HasSubstr("cat"));
+    EXPECT_EQ(sent_input, "some input");
+
+    std::string received_output, received_error;
+    for (const auto& reply : replies)
+    {
+        received_output += reply.output();
+        received_error += reply.error_output();
+    }
+    EXPECT_EQ(received_output, "some output");
+    EXPECT_EQ(received_error, "some error");
+
+    ASSERT_FALSE(replies.empty());
+    EXPECT_TRUE(replies.back().exited());
+    EXPECT_EQ(replies.back().exit_status(), 3);
+}
@@ -18,10 +18,12 @@
 #include "blueprint_test_lambdas.h"
 #include "common.h"
 #include "daemon_test_fixture.h"
+#include "file_operations.h"
 #include "mock_image_host.h"
 #include "mock_platform.h"
 #include "mock_server_reader_writer.h"
 #include "mock_settings.h"
+#include "mock_utils.h"
 #include "mock_virtual_machine.h"
 #include "mock_vm_blueprint_provider.h"
 #include "mock_vm_image_vault.h"
@@ -33,6 +35,10 @@
 #include <multipass/constants.h>
 #include <multipass/format.h>
 
+#include <QDir>
+
+#include <unordered_set>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 using namespace testing;
@@ -53,6 +59,24 @@ struct TestDaemonLaunch : public mpt::DaemonTestFixture
     mpt::MockSettings& mock_settings = *mock_settings_injection.first;
 };
 
+// Two resting instances for a pool of one, so that claiming one leaves nothing to make up for
+std::unique_ptr<mpt::TempDir> plant_warm_pool_json()
+{
+    auto temp_dir = std::make_unique<mpt::TempDir>();
+    auto record = [](const std::string& mac) {
+        return fmt::format(R"({{"deleted": false, "disk_space": "5368709120", "extra_interfaces": [], "mac_addr": "{}",
+                              "mem_size": "1073741824", "metadata": {{}}, "mounts": [], "num_cores": 1,
+                              "ssh_username": "ubuntu", "state": 7}})",
+                           mac);
+    };
+
+    mpt::make_file_with_content(QDir{temp_dir->path()}.filePath("multipassd-warm-pool.json"),
+                                fmt::format(R"({{"warm-one": {}, "warm-two": {}}})", record("52:54:00:00:00:01"),
+                                            record("52:54:00:00:00:02")));
+
+    return temp_dir;
+}
+
 TEST_F(TestDaemonLaunch, blueprintFoundMountsWorkspaceWithNameOverride)
 {
     const std::string name{"ultimo-blueprint"};
@@ -102,3 +126,110 @@ TEST_F(TestDaemonLaunch, blueprintFoundMountsWorkspaceWithNameOverride)
     EXPECT_EQ(reply.workspaces_to_be_created_size(), 1);
     EXPECT_EQ(reply.workspaces_to_be_created(0), command_line_name);
 }
+
+TEST_F(TestDaemonLaunch, batchCreatesEveryInstanceWithMacsOfItsOwn)
+{
+    auto mock_factory = use_a_mock_vm_factory();
+
+    std::vector<std::string> created_names;
+    std::unordered_set<std::string> created_macs;
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _))
+        .Times(3)
+        .WillRepeatedly([&created_names, &created_macs](const mp::VirtualMachineDescription& desc, auto&) {
+            created_names.push_back(desc.vm_name);
+            created_macs.insert(desc.default_mac_address);
+            return std::make_unique<mpt::StubVirtualMachine>();
+        });
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _)).Times(3);
+
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::LaunchRequest request;
+    request.set_count(3);
+    request.set_name_prefix("web");
+    request.set_max_parallel(2);
+
+    mp::LaunchReply reply;
+    NiceMock<mpt::MockServerReaderWriter<mp::LaunchReply, mp::LaunchRequest>> writer{};
+    ON_CALL(writer, Write(_, _)).WillByDefault([&reply](const mp::LaunchReply& written_reply, auto) {
+        reply = written_reply;
+        return true;
+    });
+
+    auto status = call_daemon_slot(daemon, &mp::Daemon::create, request, writer);
+
+    EXPECT_TRUE(status.ok()) << status.error_message();
+    EXPECT_THAT(created_names, ElementsAre("web-1", "web-2", "web-3"));
+    EXPECT_EQ(created_macs.size(), 3u);
+    EXPECT_THAT(reply.vm_instance_names(), ElementsAre("web-1", "web-2", "web-3"));
+}
+
+TEST_F(TestDaemonLaunch, batchRefusesASingleName)
+{
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::LaunchRequest request;
+    request.set_count(2);
+    request.set_instance_name("foo");
+
+    auto status = call_daemon_slot(daemon, &mp::Daemon::create, request,
+                                   StrictMock<mpt::MockServerReaderWriter<mp::LaunchReply, mp::LaunchRequest>>{});
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+    EXPECT_THAT(status.error_message(), HasSubstr("prefix"));
+}
+
+TEST_F(TestDaemonLaunch, launchClaimsInstanceFromWarmPool)
+{
+    mpt::MockUtils::GuardedMock mock_utils_injection{mpt::MockUtils::inject<NiceMock>()};
+    auto temp_dir = plant_warm_pool_json();
+    auto mock_factory = use_a_mock_vm_factory();
+
+    int num_started{0};
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _))
+        .Times(2)
+        .WillRepeatedly([&num_started](const mp::VirtualMachineDescription& desc, auto&) {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            ON_CALL(*vm, start()).WillByDefault([&num_started] { ++num_started; });
+            return vm;
+        });
+    EXPECT_CALL(*mock_factory, prepare_instance_image(_, _)).Times(0);
+
+    config_builder.data_directory = temp_dir->path();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    config_builder.warm_pool_size = 1;
+
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::LaunchReply reply;
+    NiceMock<mpt::MockServerReaderWriter<mp::LaunchReply, mp::LaunchRequest>> writer{};
+    ON_CALL(writer, Write(_, _)).WillByDefault([&reply](const mp::LaunchReply& written_reply, auto) {
+        reply = written_reply;
+        return true;
+    });
+
+    auto status = call_daemon_slot(daemon, &mp::Daemon::launch, mp::LaunchRequest{}, writer);
+
+    EXPECT_TRUE(status.ok()) << status.error_message();
+    EXPECT_THAT(reply.vm_instance_name(), AnyOf("warm-one", "warm-two"));
+    EXPECT_EQ(num_started, 1);
+}
+
+TEST_F(TestDaemonLaunch, warmPoolInstancesAreNotListed)
+{
+    auto temp_dir = plant_warm_pool_json();
+    auto mock_factory = use_a_mock_vm_factory();
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _)).Times(2);
+
+    config_builder.data_directory = temp_dir->path();
+    config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    config_builder.warm_pool_size = 1;
+
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerReaderWriter<mp::ListReply, mp::ListRequest>> writer{};
+    EXPECT_CALL(writer, Write(Property(&mp::ListReply::instances, IsEmpty()), _)).WillRepeatedly(Return(true));
+
+    EXPECT_TRUE(call_daemon_slot(daemon, &mp::Daemon::list, mp::ListRequest{}, writer).ok());
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "daemon_test_fixture.h"
+#include "file_operations.h"
+#include "mock_platform.h"
+#include "mock_server_reader_writer.h"
+#include "mock_settings.h"
+#include "mock_virtual_machine.h"
+#include "mock_vm_image_vault.h"
+
+#include <src/daemon/daemon.h>
+
+#include <multipass/constants.h>
+#include <multipass/format.h>
+
+#include <QDir>
+
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+struct TestDaemonLifecycle : public mpt::DaemonTestFixture
+{
+    void SetUp() override
+    {
+        EXPECT_CALL(mock_settings, register_handler).WillRepeatedly(Return(nullptr));
+        EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
+        EXPECT_CALL(mock_settings, get(Eq(mp::mounts_key))).WillRepeatedly(Return("true"));
+    }
+
+    // Two stopped instances, named "one" and "two"
+    std::unique_ptr<mpt::TempDir> plant_two_instances()
+    {
+        auto temp_dir = std::make_unique<mpt::TempDir>();
+        auto record = [](const std::string& mac) {
+            return fmt::format(R"({{"deleted": false, "disk_space": "5368709120", "extra_interfaces": [],
+                                  "mac_addr": "{}", "mem_size": "1073741824", "metadata": {{}}, "mounts": [],
+                                  "num_cores": 1, "ssh_username": "ubuntu", "state": 0}})",
+                               mac);
+        };
+
+        mpt::make_file_with_content(QDir{temp_dir->path()}.filePath("multipassd-vm-instances.json"),
+                                    fmt::format(R"({{"one": {}, "two": {}}})", record("52:54:00:00:00:01"),
+                                                record("52:54:00:00:00:02")));
+
+        config_builder.data_directory = temp_dir->path();
+        config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+
+        return temp_dir;
+    }
+
+    mpt::MockPlatform::GuardedMock attr{mpt::MockPlatform::inject<NiceMock>()};
+    mpt::MockPlatform* mock_platform = attr.first;
+
+    mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject<StrictMock>();
+    mpt::MockSettings& mock_settings = *mock_settings_injection.first;
+};
+
+TEST_F(TestDaemonLifecycle, deleteAsksAllInstancesToShutDownBeforeWaitingForAny)
+{
+    const auto temp_dir = plant_two_instances();
+    auto mock_factory = use_a_mock_vm_factory();
+
+    // Guests only power off once both were asked to, and then take a few looks to get there
+    int num_asked{0};
+    std::set<std::thread::id> threads;
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _))
+        .Times(2)
+        .WillRepeatedly([&num_asked, &threads](const mp::VirtualMachineDescription& desc, auto&) {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            EXPECT_CALL(*vm, shutdown()).WillOnce([&num_asked, &threads] {
+                threads.insert(std::this_thread::get_id());
+                ++num_asked;
+            });
+            ON_CALL(*vm, current_state).WillByDefault([&num_asked, &threads, looks = 0]() mutable {
+                if (num_asked > 0)
+                    threads.insert(std::this_thread::get_id());
+
+                return num_asked < 2 || ++looks < 3 ? mp::VirtualMachine::State::running
+                                                    : mp::VirtualMachine::State::off;
+            });
+            return vm;
+        });
+
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::DeleteRequest request;
+    request.set_purge(true);
+    request.mutable_instance_names()->add_instance_name("one");
+    request.mutable_instance_names()->add_instance_name("two");
+
+    std::vector<std::string> purged;
+    NiceMock<mpt::MockServerReaderWriter<mp::DeleteReply, mp::DeleteRequest>> server;
+    EXPECT_CALL(server, Write).WillOnce([&purged](const mp::DeleteReply& reply, auto) {
+        purged.assign(reply.purged_instances().begin(), reply.purged_instances().end());
+        return true;
+    });
+
+    auto status = call_daemon_slot(daemon, &mp::Daemon::delet, request, std::move(server));
+
+    EXPECT_TRUE(status.ok()) << status.error_message();
+    EXPECT_THAT(purged, UnorderedElementsAre("one", "two"));
+    EXPECT_EQ(threads.size(), 1u); // backends are only ever called on the thread the daemon runs on
+}
+
+TEST_F(TestDaemonLifecycle, suspendCarriesOnPastFailuresAndReportsThem)
+{
+    const auto temp_dir = plant_two_instances();
+    auto mock_factory = use_a_mock_vm_factory();
+
+    EXPECT_CALL(*mock_factory, create_virtual_machine(_, _))
+        .Times(2)
+        .WillRepeatedly([](const mp::VirtualMachineDescription& desc, auto&) {
+            auto vm = std::make_unique<NiceMock<mpt::MockVirtualMachine>>(desc.vm_name);
+            if (desc.vm_name == "one")
+                EXPECT_CALL(*vm, suspend()).WillOnce(Throw(std::runtime_error{"no room to save the state"}));
+            else
+                EXPECT_CALL(*vm, suspend()).Times(1);
+            return vm;
+        });
+
+    mp::Daemon daemon{config_builder.build()};
+
+    mp::SuspendRequest request;
+    request.mutable_instance_names()->add_instance_name("one");
+    request.mutable_instance_names()->add_instance_name("two");
+
+    auto status = call_daemon_slot(daemon, &mp::Daemon::suspend, request,
+                                   StrictMock<mpt::MockServerReaderWriter<mp::SuspendReply, mp::SuspendRequest>>{});
+
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+    EXPECT_THAT(status.error_message(), HasSubstr("failed to suspend \"one\": no room to save the state"));
+    EXPECT_THAT(status.error_message(), Not(HasSubstr("\"two\"")));
+}
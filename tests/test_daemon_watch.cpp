@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "daemon_test_fixture.h"
+#include "mock_platform.h"
+#include "mock_server_reader_writer.h"
+#include "mock_settings.h"
+#include "mock_virtual_machine.h"
+#include "mock_vm_image_vault.h"
+
+#include <src/daemon/daemon.h>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+using namespace testing;
+
+namespace
+{
+struct TestDaemonWatch : public mpt::DaemonTestFixture
+{
+    void SetUp() override
+    {
+        EXPECT_CALL(mock_settings, register_handler).WillRepeatedly(Return(nullptr));
+        EXPECT_CALL(mock_settings, unregister_handler).Times(AnyNumber());
+
+        auto mock_factory = use_a_mock_vm_factory();
+        std::tie(temp_dir, std::ignore) = plant_instance_json(fake_json_contents(mac_addr, extra_interfaces));
+
+        EXPECT_CALL(*mock_factory, create_virtual_machine(_, _)).WillOnce([this](const auto&, auto&) {
+            return std::make_unique<NiceMock<mpt::MockVirtualMachine>>(mock_instance_name);
+        });
+
+        config_builder.data_directory = temp_dir->path();
+        config_builder.vault = std::make_unique<NiceMock<mpt::MockVMImageVault>>();
+    }
+
+    auto event_matcher(mp::InstanceEvent::Kind kind, mp::InstanceStatus::Status status)
+    {
+        return AllOf(Property(&mp::InstanceEvent::instance_name, mock_instance_name),
+                     Property(&mp::InstanceEvent::kind, kind),
+                     Property(&mp::InstanceEvent::instance_status, Property(&mp::InstanceStatus::status, status)));
+    }
+
+    const std::string mock_instance_name{"real-zebraphant"}; // the planted instance is starting
+    const std::string mac_addr{"52:54:00:73:76:28"};
+    std::vector<mp::NetworkInterface> extra_interfaces;
+    std::unique_ptr<mpt::TempDir> temp_dir;
+
+    mpt::MockPlatform::GuardedMock attr{mpt::MockPlatform::inject<NiceMock>()};
+    mpt::MockPlatform* mock_platform = attr.first;
+
+    mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject<StrictMock>();
+    mpt::MockSettings& mock_settings = *mock_settings_injection.first;
+};
+} // namespace
+
+TEST_F(TestDaemonWatch, sendsSnapshotFirst)
+{
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerReaderWriter<mp::WatchReply, mp::WatchRequest>> mock_server;
+    auto snapshot_matcher = event_matcher(mp::InstanceEvent::SNAPSHOT, mp::InstanceStatus::STARTING);
+    EXPECT_CALL(mock_server, Write(Property(&mp::WatchReply::events, ElementsAre(snapshot_matcher)), _))
+        .WillOnce(Return(false)); // the client is gone right after
+
+    EXPECT_TRUE(call_daemon_slot(daemon, &mp::Daemon::watch, mp::WatchRequest{}, mock_server).ok());
+}
+
+TEST_F(TestDaemonWatch, sendsStateChangesAfterSnapshot)
+{
+    mp::Daemon daemon{config_builder.build()};
+
+    StrictMock<mpt::MockServerReaderWriter<mp::WatchReply, mp::WatchRequest>> mock_server;
+
+    InSequence seq;
+    EXPECT_CALL(mock_server, Write(Property(&mp::WatchReply::events, SizeIs(1)), _))
+        .WillOnce(InvokeWithoutArgs([&daemon, this] {
+            daemon.persist_state_for(mock_instance_name, mp::VirtualMachine::State::running);
+            daemon.persist_state_for(mock_instance_name, mp::VirtualMachine::State::running); // no change, no event
+            daemon.persist_state_for(mock_instance_name, mp::VirtualMachine::State::suspended);
+            return true;
+        }));
+    auto running_matcher = event_matcher(mp::InstanceEvent::STATE_CHANGED, mp::InstanceStatus::RUNNING);
+    auto suspended_matcher = event_matcher(mp::InstanceEvent::STATE_CHANGED, mp::InstanceStatus::SUSPENDED);
+    auto changes_matcher = ElementsAre(running_matcher, suspended_matcher);
+    EXPECT_CALL(mock_server, Write(Property(&mp::WatchReply::events, changes_matcher), _))
+        .WillOnce(Return(false));
+
+    EXPECT_TRUE(call_daemon_slot(daemon, &mp::Daemon::watch, mp::WatchRequest{}, mock_server).ok());
+}
@@ -144,6 +144,22 @@ TEST_F(TestGlobalSettingsHandlers, clientsRegisterPersistentHandlerForClientSett
     EXPECT_EQ(QKeySequence{handler->get(mp::hotkey_key)}, QKeySequence{mp::hotkey_default});
 }
 
+TEST_F(TestGlobalSettingsHandlers, clientsMakeSettingSpecsOnlyOnceNeeded)
+{
+    bool made = false;
+    EXPECT_CALL(mock_platform, extra_client_settings).WillOnce([&made] {
+        made = true;
+        return mp::SettingSpec::Set{};
+    });
+
+    mp::client::register_global_settings_handlers();
+    EXPECT_FALSE(made);
+
+    inject_default_returning_mock_qsettings();
+    expect_setting_values({{mp::petenv_key, "primary"}, {mp::autostart_key, "true"}});
+    EXPECT_TRUE(made);
+}
+
 TEST_F(TestGlobalSettingsHandlers, clientsRegisterPersistentHandlerWithOverriddingPlatformSettings)
 {
     const auto platform_defaults = std::map<QString, QString>{{"client.a.setting", "a reasonably long value for this"},
@@ -250,7 +266,18 @@ TEST_F(TestGlobalSettingsHandlers, daemonRegistersPersistentHandlerForDaemonSett
     mp::daemon::register_global_settings_handlers();
     inject_default_returning_mock_qsettings();
 
-    expect_setting_values({{mp::driver_key, driver}, {mp::bridged_interface_key, ""}, {mp::mounts_key, mount}});
+    expect_setting_values({{mp::driver_key, driver},
+                           {mp::bridged_interface_key, ""},
+                           {mp::mounts_key, mount},
+                           {mp::native_mounts_driver_key, "9p"},
+                           {mp::virtiofs_cache_key, "auto"},
+                           {mp::virtiofs_threads_key, "0"},
+                           {mp::sshfs_shared_server_key, "false"},
+                           {mp::warm_pool_size_key, "0"},
+                           {mp::warm_pool_image_key, ""},
+                           {mp::warm_pool_cores_key, "1"},
+                           {mp::warm_pool_mem_size_key, "1G"},
+                           {mp::warm_pool_disk_size_key, ""}});
 }
 
 TEST_F(TestGlobalSettingsHandlers, daemonRegistersPersistentHandlerForDaemonPlatformSettings)
@@ -356,4 +383,120 @@ TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatResetsHashWhenPassw
     ASSERT_NO_THROW(handler->set(mp::passphrase_key, val));
 }
 
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsVirtiofsNativeMounts)
+{
+    const auto val = "virtiofs";
+
+    mp::daemon::register_global_settings_handlers();
+
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::native_mounts_driver_key), Eq(val)));
+    inject_mock_qsettings();
+
+    ASSERT_NO_THROW(handler->set(mp::native_mounts_driver_key, val));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsInvalidNativeMountsDriver)
+{
+    const auto key = mp::native_mounts_driver_key, val = "nfs";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsVirtiofsCacheModes)
+{
+    mp::daemon::register_global_settings_handlers();
+
+    for (const auto* val : {"none", "auto", "always"})
+    {
+        EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::virtiofs_cache_key), Eq(val)));
+    }
+    inject_mock_qsettings();
+
+    for (const auto* val : {"none", "auto", "always"})
+    {
+        ASSERT_NO_THROW(handler->set(mp::virtiofs_cache_key, val));
+    }
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatRejectsInvalidVirtiofsCacheMode)
+{
+    const auto key = mp::virtiofs_cache_key, val = "sometimes";
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsVirtiofsThreads)
+{
+    const auto val = "16";
+
+    mp::daemon::register_global_settings_handlers();
+
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::virtiofs_threads_key), Eq(val)));
+    inject_mock_qsettings();
+
+    ASSERT_NO_THROW(handler->set(mp::virtiofs_threads_key, val));
+}
+
+struct TestGlobalSettingsHandlersInvalidThreads : public TestGlobalSettingsHandlers,
+                                                  public WithParamInterface<const char*>
+{
+};
+
+TEST_P(TestGlobalSettingsHandlersInvalidThreads, daemonRegistersHandlerThatRejectsInvalidVirtiofsThreads)
+{
+    const auto key = mp::virtiofs_threads_key;
+    const auto val = GetParam();
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+INSTANTIATE_TEST_SUITE_P(TestGlobalSettingsHandlers, TestGlobalSettingsHandlersInvalidThreads,
+                         Values("-1", "many", "1.5", ""));
+
+TEST_F(TestGlobalSettingsHandlers, daemonRegistersHandlerThatAcceptsWarmPoolProfile)
+{
+    mp::daemon::register_global_settings_handlers();
+
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::warm_pool_size_key), Eq("3")));
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::warm_pool_mem_size_key), Eq("2G")));
+    EXPECT_CALL(*mock_qsettings, setValue(Eq(mp::warm_pool_disk_size_key), Eq("")));
+    inject_mock_qsettings();
+
+    ASSERT_NO_THROW(handler->set(mp::warm_pool_size_key, "3"));
+    ASSERT_NO_THROW(handler->set(mp::warm_pool_mem_size_key, "2G"));
+    ASSERT_NO_THROW(handler->set(mp::warm_pool_disk_size_key, ""));
+}
+
+struct TestGlobalSettingsHandlersInvalidWarmPool : public TestGlobalSettingsHandlers,
+                                                   public WithParamInterface<std::pair<const char*, const char*>>
+{
+};
+
+TEST_P(TestGlobalSettingsHandlersInvalidWarmPool, daemonRegistersHandlerThatRejectsInvalidWarmPoolProfile)
+{
+    const auto [key, val] = GetParam();
+
+    mp::daemon::register_global_settings_handlers();
+
+    MP_ASSERT_THROW_THAT(handler->set(key, val), mp::InvalidSettingException,
+                         mpt::match_what(AllOf(HasSubstr(key), HasSubstr(val))));
+}
+
+INSTANTIATE_TEST_SUITE_P(TestGlobalSettingsHandlers, TestGlobalSettingsHandlersInvalidWarmPool,
+                         Values(std::make_pair(mp::warm_pool_size_key, "-1"),
+                                std::make_pair(mp::warm_pool_size_key, "some"),
+                                std::make_pair(mp::warm_pool_cores_key, "0"),
+                                std::make_pair(mp::warm_pool_mem_size_key, "1K"),
+                                std::make_pair(mp::warm_pool_mem_size_key, ""),
+                                std::make_pair(mp::warm_pool_disk_size_key, "lots")));
+
 } // namespace
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/instance_event_hub.h>
+
+#include <thread>
+
+namespace mp = multipass;
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+mp::InstanceEvent make_event(const std::string& name, mp::InstanceEvent::Kind kind = mp::InstanceEvent::STATE_CHANGED)
+{
+    mp::InstanceEvent event;
+    event.set_instance_name(name);
+    event.set_kind(kind);
+    return event;
+}
+
+auto no_snapshot = [] { return mp::InstanceEventHub::Events{}; };
+
+auto named(const std::string& name, uint64_t sequence)
+{
+    return AllOf(Property(&mp::InstanceEvent::instance_name, name), Property(&mp::InstanceEvent::sequence, sequence));
+}
+
+struct InstanceEventHub : public Test
+{
+    mp::InstanceEventHub hub;
+};
+} // namespace
+
+TEST_F(InstanceEventHub, numbersEventsInTheOrderTheyArePublished)
+{
+    auto subscription = hub.subscribe(no_snapshot);
+
+    hub.publish(make_event("foo"));
+    hub.publish(make_event("bar"));
+
+    EXPECT_THAT(subscription->wait_for(0ms), Optional(ElementsAre(named("foo", 1), named("bar", 2))));
+}
+
+TEST_F(InstanceEventHub, snapshotIsTakenAtTheLastSequence)
+{
+    hub.publish(make_event("foo"));
+    hub.publish(make_event("foo"));
+
+    auto subscription = hub.subscribe([] { return mp::InstanceEventHub::Events{make_event("foo")}; });
+    hub.publish(make_event("bar"));
+
+    EXPECT_THAT(subscription->snapshot(),
+                ElementsAre(AllOf(named("foo", 2), Property(&mp::InstanceEvent::kind, mp::InstanceEvent::SNAPSHOT))));
+    EXPECT_THAT(subscription->wait_for(0ms), Optional(ElementsAre(named("bar", 3))));
+}
+
+TEST_F(InstanceEventHub, waitForGivesNoEventsWhenNoneCameInTime)
+{
+    auto subscription = hub.subscribe(no_snapshot);
+
+    EXPECT_THAT(subscription->wait_for(1ms), Optional(IsEmpty()));
+}
+
+TEST_F(InstanceEventHub, closingHandsOutQueuedEventsBeforeNothing)
+{
+    auto subscription = hub.subscribe(no_snapshot);
+
+    hub.publish(make_event("foo"));
+    hub.close_all();
+
+    EXPECT_THAT(subscription->wait_for(0ms), Optional(ElementsAre(named("foo", 1))));
+    EXPECT_FALSE(subscription->wait_for(0ms));
+    EXPECT_FALSE(subscription->overflowed());
+    EXPECT_EQ(hub.num_subscriptions(), 0u);
+}
+
+TEST_F(InstanceEventHub, unsubscribedGetNoMoreEvents)
+{
+    auto subscription = hub.subscribe(no_snapshot);
+    EXPECT_EQ(hub.num_subscriptions(), 1u);
+
+    hub.unsubscribe(subscription);
+    hub.publish(make_event("foo"));
+
+    EXPECT_FALSE(subscription->wait_for(0ms));
+    EXPECT_EQ(hub.num_subscriptions(), 0u);
+}
+
+TEST_F(InstanceEventHub, subscriptionFallingTooFarBehindIsClosed)
+{
+    auto subscription = hub.subscribe(no_snapshot);
+
+    for (auto i = 0; i < 2000; ++i)
+        hub.publish(make_event("foo"));
+
+    EXPECT_FALSE(subscription->wait_for(0ms));
+    EXPECT_TRUE(subscription->overflowed());
+}
+
+TEST_F(InstanceEventHub, waitForWakesUpOnEventsFromOtherThreads)
+{
+    auto subscription = hub.subscribe(no_snapshot);
+
+    std::thread publisher{[this] { hub.publish(make_event("foo")); }};
+    auto events = subscription->wait_for(10s);
+    publisher.join();
+
+    EXPECT_THAT(events, Optional(ElementsAre(named("foo", 1))));
+}
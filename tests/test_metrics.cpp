@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/metrics.h>
+
+namespace mp = multipass;
+namespace mpm = multipass::metrics;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+TEST(Metrics, sameNameAndLabelsGiveTheSameMetric)
+{
+    auto& counter = MP_METRICS.counter("test_same_metric_total", "help", {{"kind", "a"}});
+
+    EXPECT_EQ(&counter, &MP_METRICS.counter("test_same_metric_total", "help", {{"kind", "a"}}));
+    EXPECT_NE(&counter, &MP_METRICS.counter("test_same_metric_total", "help", {{"kind", "b"}}));
+}
+
+TEST(Metrics, counterAddsUp)
+{
+    auto& counter = MP_METRICS.counter("test_counter_total", "help");
+    counter.increment();
+    counter.increment(41);
+
+    EXPECT_EQ(counter.get(), 42u);
+}
+
+TEST(Metrics, histogramCountsIntoBuckets)
+{
+    mpm::Histogram histogram;
+    histogram.observe(50us);
+    histogram.observe(100us);
+    histogram.observe(2ms);
+    histogram.observe(1h);
+
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.counts.front(), 2u);
+    EXPECT_EQ(snapshot.counts[3], 1u);
+    EXPECT_EQ(snapshot.counts.back(), 1u);
+    EXPECT_EQ(snapshot.count(), 4u);
+    EXPECT_EQ(snapshot.sum_micros, 50u + 100u + 2000u + 3600000000u);
+}
+
+TEST(Metrics, snapshotsSubtract)
+{
+    mpm::Histogram histogram;
+    histogram.observe(1ms);
+    const auto earlier = histogram.snapshot();
+    histogram.observe(1ms);
+    histogram.observe(1s);
+
+    const auto delta = histogram.snapshot() - earlier;
+    EXPECT_EQ(delta.count(), 2u);
+    EXPECT_EQ(delta.sum_micros, 1001000u);
+}
+
+TEST(Metrics, snapshotSurvivesSerialisation)
+{
+    mpm::Histogram histogram;
+    histogram.observe(300us);
+    histogram.observe(20s);
+
+    const auto snapshot = histogram.snapshot();
+    const auto deserialised = mpm::Histogram::Snapshot::deserialise(snapshot.serialise());
+
+    ASSERT_TRUE(deserialised);
+    EXPECT_EQ(deserialised->counts, snapshot.counts);
+    EXPECT_EQ(deserialised->sum_micros, snapshot.sum_micros);
+}
+
+TEST(Metrics, snapshotRejectsGarbage)
+{
+    EXPECT_FALSE(mpm::Histogram::Snapshot::deserialise("12 3 nope"));
+    EXPECT_FALSE(mpm::Histogram::Snapshot::deserialise(""));
+}
+
+TEST(Metrics, histogramTakesInSnapshots)
+{
+    mpm::Histogram source, target;
+    source.observe(7ms);
+    target.observe(7ms);
+    target.add(source.snapshot());
+
+    EXPECT_EQ(target.snapshot().count(), 2u);
+    EXPECT_EQ(target.snapshot().sum_micros, 14000u);
+}
+
+TEST(Metrics, expositionHasCountersAndGauges)
+{
+    MP_METRICS.counter("test_exposed_total", "Things that happened", {{"what", "a \"thing\""}}).increment(3);
+    MP_METRICS.gauge("test_exposed_gauge", "A level").set(-5);
+
+    const auto exposition = MP_METRICS.exposition();
+    EXPECT_THAT(exposition, HasSubstr("# HELP test_exposed_total Things that happened\n"
+                                      "# TYPE test_exposed_total counter\n"));
+    EXPECT_THAT(exposition, HasSubstr("test_exposed_total{what=\"a \\\"thing\\\"\"} 3\n"));
+    EXPECT_THAT(exposition, HasSubstr("# TYPE test_exposed_gauge gauge\ntest_exposed_gauge -5\n"));
+}
+
+TEST(Metrics, expositionHasCumulativeBuckets)
+{
+    auto& histogram = MP_METRICS.histogram("test_exposed_seconds", "How long", {{"op", "x"}});
+    histogram.observe(50us);
+    histogram.observe(2h);
+
+    const auto exposition = MP_METRICS.exposition();
+    EXPECT_THAT(exposition, HasSubstr("# TYPE test_exposed_seconds histogram\n"));
+    EXPECT_THAT(exposition, HasSubstr("test_exposed_seconds_bucket{op=\"x\",le=\"0.0001\"} 1\n"));
+    EXPECT_THAT(exposition, HasSubstr("test_exposed_seconds_bucket{op=\"x\",le=\"+Inf\"} 2\n"));
+    EXPECT_THAT(exposition, HasSubstr("test_exposed_seconds_count{op=\"x\"} 2\n"));
+}
+
+TEST(Metrics, expositionCallsGaugeCallbacksUntilRemoved)
+{
+    MP_METRICS.set_gauge_callback("test_callback_gauge", "Looked up", [] {
+        return std::vector<std::pair<mpm::Labels, double>>{{{{"instance", "foo"}}, 1}};
+    });
+
+    EXPECT_THAT(MP_METRICS.exposition(), HasSubstr("test_callback_gauge{instance=\"foo\"} 1\n"));
+
+    MP_METRICS.remove_gauge_callback("test_callback_gauge");
+    EXPECT_THAT(MP_METRICS.exposition(), Not(HasSubstr("test_callback_gauge")));
+}
+
+TEST(Metrics, histogramSnapshotsComeByLabels)
+{
+    MP_METRICS.histogram("test_snapshots_seconds", "help", {{"op", "read"}}).observe(1ms);
+    MP_METRICS.histogram("test_snapshots_seconds", "help", {{"op", "write"}});
+
+    const auto snapshots = MP_METRICS.histogram_snapshots("test_snapshots_seconds");
+    ASSERT_EQ(snapshots.size(), 2u);
+    EXPECT_EQ(snapshots[0].first, (mpm::Labels{{"op", "read"}}));
+    EXPECT_EQ(snapshots[0].second.count(), 1u);
+    EXPECT_EQ(snapshots[1].second.count(), 0u);
+}
+} // namespace
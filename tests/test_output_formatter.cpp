@@ -394,6 +394,48 @@ auto print_param_name(const testing::TestParamInfo<FormatterSuite::ParamType>& i
     return std::get<3>(info.param);
 }
 
+struct StreamedFormatterSuite : public FormatterSuite
+{
+};
+
+// Feeds the formatter one part per instance, in name order, or the whole reply as a single part
+template <typename Reply, typename Instances, typename AddInstance>
+std::string format_streamed(std::unique_ptr<mp::StreamedFormat<Reply>> streamed_format, const Reply& reply,
+                            const Instances& instances, AddInstance add_instance, bool one_part_per_instance)
+{
+    std::string output;
+
+    if (one_part_per_instance)
+    {
+        auto sorted_instances = instances;
+        std::sort(sorted_instances.begin(), sorted_instances.end(),
+                  [](const auto& a, const auto& b) { return a.name() < b.name(); });
+
+        for (const auto& instance : sorted_instances)
+        {
+            Reply part;
+            *(part.*add_instance)() = instance;
+            output += streamed_format->next(part);
+        }
+    }
+    else
+        output += streamed_format->next(reply);
+
+    return output + streamed_format->end();
+}
+
+std::string format_streamed(const mp::Formatter& formatter, const google::protobuf::Message& reply,
+                            bool one_part_per_instance)
+{
+    if (auto input = dynamic_cast<const mp::ListReply*>(&reply))
+        return format_streamed(formatter.streamed_list_format(), *input, input->instances(),
+                               &mp::ListReply::add_instances, one_part_per_instance);
+
+    auto& input = dynamic_cast<const mp::InfoReply&>(reply);
+    return format_streamed(formatter.streamed_info_format(), input, input.info(), &mp::InfoReply::add_info,
+                           one_part_per_instance);
+}
+
 struct PetenvFormatterSuite : public BaseFormatterSuite,
                               public WithParamInterface<std::tuple<QString, bool, FormatterParamType>>
 {
@@ -1191,10 +1233,44 @@ TEST_P(FormatterSuite, properly_formats_output)
     EXPECT_EQ(output, expected_output);
 }
 
+TEST_P(StreamedFormatterSuite, formats_whole_reply_as_format_does)
+{
+    const auto& [formatter, reply, expected_output, test_name] = GetParam();
+    Q_UNUSED(test_name); // gcc 7.4 can't do [[maybe_unused]] for structured bindings
+
+    EXPECT_EQ(format_streamed(*formatter, *reply, /* one_part_per_instance = */ false), expected_output);
+}
+
+TEST_P(StreamedFormatterSuite, formats_one_instance_at_a_time_as_format_does)
+{
+    const auto& [formatter, reply, expected_output, test_name] = GetParam();
+    Q_UNUSED(test_name); // gcc 7.4 can't do [[maybe_unused]] for structured bindings
+
+    EXPECT_EQ(format_streamed(*formatter, *reply, /* one_part_per_instance = */ true), expected_output);
+}
+
+TEST_F(BaseFormatterSuite, streamed_table_list_widens_rows_with_later_long_names)
+{
+    auto streamed_format = mp::TableFormatter{}.streamed_list_format();
+
+    mp::ListReply first, second;
+    first.add_instances()->set_name("foo");
+    second.add_instances()->set_name("a-much-longer-name-than-the-column-is-wide");
+
+    const auto output = streamed_format->next(first) + streamed_format->next(second) + streamed_format->end();
+
+    EXPECT_THAT(output, HasSubstr("\nfoo                     Unknown"));
+    EXPECT_THAT(output, HasSubstr("\na-much-longer-name-than-the-column-is-wide  Unknown"));
+}
+
 INSTANTIATE_TEST_SUITE_P(OrderableListInfoOutputFormatter, FormatterSuite,
                          ValuesIn(orderable_list_info_formatter_outputs), print_param_name);
 INSTANTIATE_TEST_SUITE_P(NonOrderableListInfoOutputFormatter, FormatterSuite,
                          ValuesIn(non_orderable_list_info_formatter_outputs), print_param_name);
+INSTANTIATE_TEST_SUITE_P(OrderableListInfoOutputFormatter, StreamedFormatterSuite,
+                         ValuesIn(orderable_list_info_formatter_outputs), print_param_name);
+INSTANTIATE_TEST_SUITE_P(NonOrderableListInfoOutputFormatter, StreamedFormatterSuite,
+                         ValuesIn(non_orderable_list_info_formatter_outputs), print_param_name);
 INSTANTIATE_TEST_SUITE_P(FindOutputFormatter, FormatterSuite, ValuesIn(find_formatter_outputs), print_param_name);
 INSTANTIATE_TEST_SUITE_P(NonOrderableNetworksOutputFormatter, FormatterSuite,
                          ValuesIn(non_orderable_networks_formatter_outputs), print_param_name);
@@ -122,6 +122,33 @@ TEST_F(TestPersistentSettingsHandler, keysReturnsSpecsKey)
     EXPECT_THAT(handler.keys(), UnorderedPointwise(Eq(), expected));
 }
 
+TEST_F(TestPersistentSettingsHandler, deferredHandlerMakesSpecsOnFirstUseOnly)
+{
+    auto times_made = 0;
+    auto handler = mp::PersistentSettingsHandler::deferred(fake_filename, [this, &times_made] {
+        ++times_made;
+
+        mp::SettingSpec::Set ret;
+        for (const auto& [k, v] : defaults)
+            ret.insert(std::make_unique<mp::BasicSettingSpec>(k, v));
+
+        return ret;
+    });
+
+    EXPECT_EQ(times_made, 0);
+    EXPECT_THAT(handler->keys(), SizeIs(defaults.size()));
+    EXPECT_THAT(handler->keys(), Contains("a.key"));
+    EXPECT_EQ(times_made, 1);
+}
+
+TEST_F(TestPersistentSettingsHandler, deferredHandlerThrowsOnUnknownKey)
+{
+    auto handler = mp::PersistentSettingsHandler::deferred(fake_filename, [] { return mp::SettingSpec::Set{}; });
+
+    MP_EXPECT_THROW_THAT(handler->get("unknown.key"), mp::UnrecognizedSettingException,
+                         mpt::match_what(HasSubstr("unknown.key")));
+}
+
 TEST_F(TestPersistentSettingsHandler, getReadsUtf8)
 {
     const auto key = "asdf";
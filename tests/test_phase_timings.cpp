@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <multipass/phase_timings.h>
+
+#include <thread>
+
+namespace mp = multipass;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+TEST(PhaseTimings, recordsPhasesInTheOrderTheyFinish)
+{
+    mp::PhaseTimings timings;
+    {
+        mp::PhaseTimer outer{"outer", &timings};
+        mp::PhaseTimer inner{"inner", &timings};
+    }
+
+    const auto phases = timings.phases();
+    ASSERT_EQ(phases.size(), 2u);
+    EXPECT_EQ(phases[0].first, "inner");
+    EXPECT_EQ(phases[1].first, "outer");
+}
+
+TEST(PhaseTimings, timerRecordsHowLongItRan)
+{
+    mp::PhaseTimings timings;
+    {
+        mp::PhaseTimer timer{"sleep", &timings};
+        std::this_thread::sleep_for(20ms);
+    }
+
+    ASSERT_EQ(timings.phases().size(), 1u);
+    EXPECT_GE(timings.phases().front().second, 20ms);
+}
+
+TEST(PhaseTimings, timerRecordsOnlyOnce)
+{
+    mp::PhaseTimings timings;
+    {
+        mp::PhaseTimer timer{"phase", &timings};
+        timer.stop();
+        timer.stop();
+    }
+
+    EXPECT_EQ(timings.phases().size(), 1u);
+}
+
+TEST(PhaseTimings, timerWithoutTimingsDoesNothing)
+{
+    ASSERT_EQ(mp::PhaseTimings::current(), nullptr);
+    EXPECT_NO_THROW(mp::PhaseTimer{"phase"});
+}
+
+TEST(PhaseTimings, scopeMakesTimingsCurrentUntilItEnds)
+{
+    mp::PhaseTimings outer_timings, inner_timings;
+    {
+        mp::PhaseTimings::Scope outer_scope{&outer_timings};
+        {
+            mp::PhaseTimings::Scope inner_scope{&inner_timings};
+            EXPECT_EQ(mp::PhaseTimings::current(), &inner_timings);
+            mp::PhaseTimer timer{"inner"};
+        }
+
+        EXPECT_EQ(mp::PhaseTimings::current(), &outer_timings);
+        mp::PhaseTimer timer{"outer"};
+    }
+
+    EXPECT_EQ(mp::PhaseTimings::current(), nullptr);
+    EXPECT_THAT(inner_timings.phases(), ElementsAre(Pair("inner", _)));
+    EXPECT_THAT(outer_timings.phases(), ElementsAre(Pair("outer", _)));
+}
+
+TEST(PhaseTimings, timingsAreCurrentOnlyOnTheirThread)
+{
+    mp::PhaseTimings timings;
+    mp::PhaseTimings::Scope scope{&timings};
+
+    mp::PhaseTimings* current_elsewhere{&timings};
+    std::thread{[&current_elsewhere] { current_elsewhere = mp::PhaseTimings::current(); }}.join();
+
+    EXPECT_EQ(current_elsewhere, nullptr);
+}
+
+TEST(PhaseTimings, summaryListsPhasesInSeconds)
+{
+    mp::PhaseTimings timings;
+    timings.add("download", 12500ms);
+    timings.add("verify", 800ms);
+
+    EXPECT_EQ(timings.summary(), "download 12.5s, verify 0.8s");
+}
+} // namespace
@@ -22,14 +22,21 @@
 #include "mock_sftp.h"
 #include "mock_sftp_dir_iterator.h"
 #include "mock_sftp_utils.h"
+#include "mock_ssh_process_exit_status.h"
 #include "mock_ssh_test_fixture.h"
 #include <Poco/TeeStream.h>
 
 #include <multipass/ssh/sftp_client.h>
 #include <multipass/ssh/ssh_session.h>
+#include <src/ssh/sftp_sync.h>
+
+#include <QCryptographicHash>
 
 #include <fmt/std.h>
 
+#include <algorithm>
+#include <random>
+
 namespace mp = multipass;
 namespace mpt = multipass::test;
 namespace mpl = multipass::logging;
@@ -265,6 +272,277 @@ TEST_F(SFTPClient, push_file_cannot_set_perms)
     EXPECT_FALSE(sftp_client.push(source_path, target_path));
 }
 
+TEST_F(SFTPClient, push_file_sync_skips_unchanged_file)
+{
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _)).WillOnce(Return(target_path));
+
+    const auto mtime = fs::file_time_type::clock::now();
+    const auto remote_mtime = std::chrono::system_clock::to_time_t(
+        std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+            mtime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()));
+    REPLACE(sftp_stat, [&](auto...) {
+        auto attr = get_dummy_sftp_attr(SSH_FILEXFER_TYPE_REGULAR, target_path, 0777);
+        attr->size = 9;
+        attr->mtime = remote_mtime;
+        return attr;
+    });
+    EXPECT_CALL(*mock_file_ops, file_size(source_path, _)).WillOnce(Return(9));
+    EXPECT_CALL(*mock_file_ops, last_write_time(source_path, _)).WillOnce(Return(mtime));
+    EXPECT_CALL(*mock_file_ops, status(source_path, _))
+        .WillOnce(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
+    EXPECT_CALL(*mock_file_ops, open_read).Times(0);
+    REPLACE(sftp_open, [](auto...) {
+        ADD_FAILURE() << "unchanged file should not be sent";
+        return nullptr;
+    });
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.push(source_path, target_path, mp::SFTPClient::Flag::Sync));
+}
+
+TEST_F(SFTPClient, push_file_sync_sends_small_changed_file_whole)
+{
+    std::string test_data = "test_data";
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _)).WillOnce(Return(target_path));
+    REPLACE(sftp_stat, [&](auto...) { return get_dummy_sftp_attr(SSH_FILEXFER_TYPE_REGULAR, target_path, 0777); });
+    EXPECT_CALL(*mock_file_ops, file_size(source_path, _)).WillOnce(Return(test_data.size()));
+    EXPECT_CALL(*mock_file_ops, last_write_time(source_path, _))
+        .WillRepeatedly(Return(fs::file_time_type::clock::now()));
+    EXPECT_CALL(*mock_file_ops, status(source_path, _))
+        .WillRepeatedly(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
+    EXPECT_CALL(*mock_file_ops, open_read(source_path))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
+    REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
+
+    std::string written_data;
+    REPLACE(sftp_write, [&](auto, auto data, auto size) { return written_data.append((char*)data, size).size(); });
+    REPLACE(sftp_chmod, [](auto...) { return SSH_FX_OK; });
+    auto times_set = false;
+    REPLACE(sftp_utimes, [&](auto...) {
+        times_set = true;
+        return SSH_FX_OK;
+    });
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.push(source_path, target_path, mp::SFTPClient::Flag::Sync));
+    EXPECT_EQ(written_data, test_data);
+    EXPECT_TRUE(times_set);
+}
+
+TEST_F(SFTPClient, push_file_sync_sends_file_whole_when_helper_fails)
+{
+    std::string test_data(100000, 'x');
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _)).WillOnce(Return(target_path));
+    REPLACE(sftp_stat, [&](auto...) {
+        auto attr = get_dummy_sftp_attr(SSH_FILEXFER_TYPE_REGULAR, target_path, 0777);
+        attr->size = 90000;
+        return attr;
+    });
+    EXPECT_CALL(*mock_file_ops, file_size(source_path, _)).WillOnce(Return(test_data.size()));
+    EXPECT_CALL(*mock_file_ops, last_write_time(source_path, _))
+        .WillRepeatedly(Return(fs::file_time_type::clock::now()));
+    EXPECT_CALL(*mock_file_ops, status(source_path, _))
+        .WillRepeatedly(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
+
+    mpt::ExitStatusMock exit_status;
+    exit_status.return_exit_code(127);
+    std::string command;
+    REPLACE(ssh_channel_request_exec, [&](auto, auto cmd) {
+        command = cmd;
+        return SSH_OK;
+    });
+
+    EXPECT_CALL(*mock_file_ops, open_read(source_path))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
+    REPLACE(sftp_open, [](auto sftp, auto...) { return get_dummy_sftp_file(sftp); });
+    std::string written_data;
+    REPLACE(sftp_write, [&](auto, auto data, auto size) { return written_data.append((char*)data, size).size(); });
+    REPLACE(sftp_chmod, [](auto...) { return SSH_FX_OK; });
+    REPLACE(sftp_utimes, [](auto...) { return SSH_FX_OK; });
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.push(source_path, target_path, mp::SFTPClient::Flag::Sync));
+    EXPECT_THAT(command, HasSubstr("python3 -c"));
+    EXPECT_EQ(written_data, test_data);
+}
+
+TEST_F(SFTPClient, push_file_sync_sends_only_changed_blocks)
+{
+    std::mt19937 generator{42};
+    std::string remote_data(100000, '\0');
+    std::generate(remote_data.begin(), remote_data.end(), [&generator] { return static_cast<char>(generator()); });
+    auto test_data = remote_data;
+    test_data[0] = ~test_data[0];
+
+    const auto block_size = mp::sftp_sync::block_size_for(remote_data.size());
+    std::string sums;
+    for (size_t pos = 0; pos < remote_data.size(); pos += block_size)
+    {
+        const auto block = remote_data.substr(pos, block_size);
+        sums += fmt::format("{:08x} {}\n", mp::sftp_sync::RollingChecksum{block.data(), block.size()}.value(),
+                            QCryptographicHash::hash(QByteArray::fromStdString(block), QCryptographicHash::Sha256)
+                                .toHex()
+                                .toStdString());
+    }
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _)).WillOnce(Return(target_path));
+    REPLACE(sftp_stat, [&](auto...) {
+        auto attr = get_dummy_sftp_attr(SSH_FILEXFER_TYPE_REGULAR, target_path, 0777);
+        attr->size = remote_data.size();
+        return attr;
+    });
+    EXPECT_CALL(*mock_file_ops, file_size(source_path, _)).WillOnce(Return(test_data.size()));
+    EXPECT_CALL(*mock_file_ops, last_write_time(source_path, _))
+        .WillRepeatedly(Return(fs::file_time_type::clock::now()));
+    EXPECT_CALL(*mock_file_ops, status(source_path, _))
+        .WillRepeatedly(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
+
+    mpt::ExitStatusMock exit_status;
+    std::vector<std::string> commands;
+    REPLACE(ssh_channel_request_exec, [&](auto, auto cmd) {
+        commands.push_back(cmd);
+        return SSH_OK;
+    });
+    size_t sums_read = 0;
+    REPLACE(ssh_channel_read_timeout, [&](auto, void* dest, uint32_t count, int is_stderr, auto...) {
+        if (is_stderr || sums_read == sums.size())
+            return 0;
+        const auto length = std::min<size_t>(count, sums.size() - sums_read);
+        std::copy_n(sums.data() + sums_read, length, static_cast<char*>(dest));
+        sums_read += length;
+        return static_cast<int>(length);
+    });
+
+    EXPECT_CALL(*mock_file_ops, open_read(source_path))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
+    std::string opened_path;
+    REPLACE(sftp_open, [&](auto sftp, auto path, auto...) {
+        opened_path = path;
+        return get_dummy_sftp_file(sftp);
+    });
+    std::string written_data;
+    REPLACE(sftp_write, [&](auto, auto data, auto size) { return written_data.append((char*)data, size).size(); });
+    REPLACE(sftp_unlink, [](auto...) {
+        ADD_FAILURE() << "applied delta should be left to the helper to remove";
+        return SSH_FX_OK;
+    });
+    REPLACE(sftp_chmod, [](auto...) { return SSH_FX_OK; });
+    REPLACE(sftp_utimes, [](auto...) { return SSH_FX_OK; });
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.push(source_path, target_path, mp::SFTPClient::Flag::Sync));
+
+    auto expected_delta = std::string{"L\0\0\x10\0", 5} + test_data.substr(0, block_size);
+    for (char index = 1; index * block_size < remote_data.size(); ++index)
+        expected_delta += std::string{"C\0\0\0\0\0\0\0", 8} + index;
+    EXPECT_EQ(opened_path, target_path.u8string() + ".mp-sync-delta");
+    EXPECT_EQ(written_data, expected_delta);
+    ASSERT_EQ(commands.size(), 2u);
+    EXPECT_THAT(commands[1], HasSubstr(" patch "));
+}
+
+TEST_F(SFTPClient, push_file_sync_removes_delta_and_sends_file_whole_when_delta_write_fails)
+{
+    std::string test_data(100000, 'x');
+
+    REPLACE(sftp_init, [](auto...) { return SSH_OK; });
+    EXPECT_CALL(*mock_file_ops, is_directory(source_path, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_sftp_utils, get_remote_file_target(_, source_path, target_path, _)).WillOnce(Return(target_path));
+    REPLACE(sftp_stat, [&](auto...) {
+        auto attr = get_dummy_sftp_attr(SSH_FILEXFER_TYPE_REGULAR, target_path, 0777);
+        attr->size = 90000;
+        return attr;
+    });
+    EXPECT_CALL(*mock_file_ops, file_size(source_path, _)).WillOnce(Return(test_data.size()));
+    EXPECT_CALL(*mock_file_ops, last_write_time(source_path, _))
+        .WillRepeatedly(Return(fs::file_time_type::clock::now()));
+    EXPECT_CALL(*mock_file_ops, status(source_path, _))
+        .WillRepeatedly(Return(fs::file_status{fs::file_type::regular, fs::perms::all}));
+
+    mpt::ExitStatusMock exit_status;
+    const std::string sums{"00000001 0000\n"};
+    auto sums_sent = false;
+    REPLACE(ssh_channel_read_timeout, [&](auto, void* dest, uint32_t count, int is_stderr, auto...) {
+        if (is_stderr || std::exchange(sums_sent, true))
+            return 0;
+        std::copy(sums.begin(), sums.end(), static_cast<char*>(dest));
+        return static_cast<int>(sums.size());
+    });
+
+    EXPECT_CALL(*mock_file_ops, open_read(source_path))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)))
+        .WillOnce(Return(std::make_unique<std::stringstream>(test_data)));
+    const auto delta_path = target_path.u8string() + ".mp-sync-delta";
+    std::string opened_path;
+    REPLACE(sftp_open, [&](auto sftp, auto path, auto...) {
+        opened_path = path;
+        return get_dummy_sftp_file(sftp);
+    });
+    std::string written_data;
+    REPLACE(sftp_write, [&](auto, auto data, auto size) -> ssize_t {
+        if (opened_path == delta_path)
+            return -1;
+        return written_data.append((char*)data, size).size();
+    });
+    std::string unlinked_path;
+    REPLACE(sftp_unlink, [&](auto, auto path) {
+        unlinked_path = path;
+        return SSH_FX_OK;
+    });
+    REPLACE(sftp_chmod, [](auto...) { return SSH_FX_OK; });
+    REPLACE(sftp_utimes, [](auto...) { return SSH_FX_OK; });
+
+    auto sftp_client = make_sftp_client();
+
+    EXPECT_TRUE(sftp_client.push(source_path, target_path, mp::SFTPClient::Flag::Sync));
+    EXPECT_EQ(unlinked_path, delta_path);
+    EXPECT_EQ(opened_path, target_path.u8string());
+    EXPECT_EQ(written_data, test_data);
+}
+
+TEST(SFTPSync, rolling_checksum_is_adler32)
+{
+    const std::string data{"Wikipedia"};
+
+    EXPECT_EQ(mp::sftp_sync::RollingChecksum(data.data(), data.size()).value(), 0x11e60398u);
+}
+
+TEST(SFTPSync, rolled_checksum_matches_checksum_of_moved_window)
+{
+    std::mt19937 generator{7};
+    std::string data(20000, '\0');
+    std::generate(data.begin(), data.end(), [&generator] { return static_cast<char>(generator()); });
+    const size_t window = 4096;
+
+    mp::sftp_sync::RollingChecksum checksum{data.data(), window};
+    for (size_t pos = 1; pos + window <= data.size(); ++pos)
+    {
+        checksum.roll(data[pos - 1], data[pos + window - 1]);
+        ASSERT_EQ(checksum.value(), mp::sftp_sync::RollingChecksum(data.data() + pos, window).value()) << pos;
+    }
+}
+
+TEST(SFTPSync, block_size_grows_with_file_size_within_bounds)
+{
+    EXPECT_EQ(mp::sftp_sync::block_size_for(100000), mp::sftp_sync::min_block_size);
+    EXPECT_EQ(mp::sftp_sync::block_size_for(uint64_t{1} << 30), 32768u);
+    EXPECT_EQ(mp::sftp_sync::block_size_for(uint64_t{1} << 40), mp::sftp_sync::max_block_size);
+}
+
 TEST_F(SFTPClient, pull_file_success)
 {
     std::string test_data = "test_data";
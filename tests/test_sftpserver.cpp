@@ -33,6 +33,8 @@
 #include <multipass/platform.h>
 #include <multipass/ssh/ssh_session.h>
 
+#include <QCryptographicHash>
+
 #include <queue>
 
 namespace mp = multipass;
@@ -92,6 +94,28 @@ struct SftpServer : public mp::test::SftpServerTest
         return reply_status;
     }
 
+    // Handles that tell the files apart, as extended requests carry them in their fields
+    auto make_indexed_handle_alloc(std::vector<void*>& ids)
+    {
+        auto handle_alloc = [&ids](sftp_session, void* info) {
+            const char index = ids.size();
+            ids.push_back(info);
+
+            auto handle = ssh_string_new(1);
+            ssh_string_fill(handle, &index, 1);
+            return handle;
+        };
+        return handle_alloc;
+    }
+
+    auto make_indexed_handle_lookup(std::vector<void*>& ids)
+    {
+        auto handle_lookup = [&ids](sftp_session, ssh_string handle) {
+            return ids.at(*static_cast<char*>(ssh_string_data(handle)));
+        };
+        return handle_lookup;
+    }
+
     mpt::ExitStatusMock exit_status_mock;
     std::queue<sftp_client_message> messages;
     int default_id{1000};
@@ -256,14 +280,82 @@ bool compare_permission(uint32_t ssh_permissions, const QFileInfo& file, Permiss
 
     return ((ssh_permissions & ssh_perm_mask) >> ssh_bitshift) == ((file.permissions() & qt_perm_mask) >> qt_bitshift);
 }
+
+// The raw form of an extended request, which the server parses past the request id and name
+struct ExtendedRequest
+{
+    explicit ExtendedRequest(const std::string& name)
+    {
+        u32(0).string(name);
+    }
+
+    ExtendedRequest& u32(uint32_t value)
+    {
+        for (auto shift = 24; shift >= 0; shift -= 8)
+            bytes.push_back(static_cast<char>((value >> shift) & 0xff));
+        return *this;
+    }
+
+    ExtendedRequest& u64(uint64_t value)
+    {
+        return u32(value >> 32).u32(value & 0xffffffff);
+    }
+
+    ExtendedRequest& string(const std::string& value)
+    {
+        u32(value.size());
+        bytes += value;
+        return *this;
+    }
+
+    auto buffer() const
+    {
+        std::unique_ptr<ssh_buffer_struct, void (*)(ssh_buffer)> buffer{ssh_buffer_new(), ssh_buffer_free};
+        ssh_buffer_add_data(buffer.get(), bytes.data(), bytes.size());
+        return buffer;
+    }
+
+    std::string bytes;
+};
 } // namespace
 
 TEST_F(SftpServer, throws_when_failed_to_init)
 {
-    REPLACE(sftp_server_init, [](auto...) { return SSH_ERROR; });
+    REPLACE(ssh_channel_read_timeout, [](auto...) { return SSH_ERROR; });
+    EXPECT_THROW(make_sftpserver(), std::runtime_error);
+}
+
+TEST_F(SftpServer, throws_when_session_does_not_start_with_init)
+{
+    REPLACE(sftp_server_new, [this, make = mock_sftp_server_new](auto... args) {
+        auto sftp = make(args...);
+        pending_init = std::string{"\0\0\0\5\3\0\0\0\3", 9}; // SSH_FXP_OPEN instead
+        return sftp;
+    });
+
     EXPECT_THROW(make_sftpserver(), std::runtime_error);
 }
 
+TEST_F(SftpServer, advertises_the_extensions_it_serves)
+{
+    QByteArray reply;
+    REPLACE(ssh_channel_write, [&reply](ssh_channel, const void* data, uint32_t len) {
+        reply.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+
+    make_sftpserver();
+
+    ASSERT_THAT(reply.size(), Gt(9));
+    EXPECT_EQ(static_cast<uint8_t>(reply[4]), 2u); // SSH_FXP_VERSION
+    EXPECT_EQ(reply.mid(5, 4), QByteArray("\0\0\0\3", 4));
+    EXPECT_TRUE(reply.contains("posix-rename@openssh.com"));
+    EXPECT_TRUE(reply.contains("hardlink@openssh.com"));
+    EXPECT_TRUE(reply.contains("copy-data"));
+    EXPECT_TRUE(reply.contains("check-file"));
+    EXPECT_FALSE(reply.contains("statvfs@openssh.com"));
+}
+
 TEST_F(SftpServer, throws_when_sshfs_errors_on_start)
 {
     bool invoked{false};
@@ -1380,6 +1472,96 @@ TEST_F(SftpServer, handles_fstat)
     EXPECT_THAT(num_calls, Eq(1));
 }
 
+TEST_F(SftpServer, stat_sees_changes_between_requests)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name, "short");
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto first_msg = make_msg(SFTP_STAT);
+    auto second_msg = make_msg(SFTP_STAT);
+    auto name = name_as_char_array(file_name.toStdString());
+    first_msg->filename = name.data();
+    second_msg->filename = name.data();
+
+    const std::string longer_content{"quite a bit longer"};
+    auto msg_handler = [this, &second_msg, &file_name, &longer_content](auto...) -> sftp_client_message {
+        if (messages.empty())
+            return nullptr;
+
+        auto msg = messages.front();
+        messages.pop();
+
+        if (msg == second_msg.get())
+        {
+            QFile file{file_name};
+            EXPECT_TRUE(file.open(QFile::WriteOnly | QFile::Truncate));
+            file.write(longer_content.data(), longer_content.size());
+        }
+
+        return msg;
+    };
+
+    std::vector<uint64_t> sizes;
+    auto reply_attr = [&sizes](sftp_client_message, sftp_attributes attr) {
+        sizes.push_back(attr->size);
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_attr, reply_attr);
+    REPLACE(sftp_get_client_message, msg_handler);
+
+    sftp.run();
+
+    EXPECT_THAT(sizes, ElementsAre(5u, longer_content.size()));
+}
+
+TEST_F(SftpServer, stat_finds_files_created_after_not_finding_them)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto first_msg = make_msg(SFTP_LSTAT);
+    auto second_msg = make_msg(SFTP_LSTAT);
+    auto name = name_as_char_array(file_name.toStdString());
+    first_msg->filename = name.data();
+    second_msg->filename = name.data();
+
+    auto msg_handler = [this, &second_msg, &file_name](auto...) -> sftp_client_message {
+        if (messages.empty())
+            return nullptr;
+
+        auto msg = messages.front();
+        messages.pop();
+
+        if (msg == second_msg.get())
+            mpt::make_file_with_content(file_name);
+
+        return msg;
+    };
+
+    int no_such_file_calls{0};
+    auto reply_status = make_reply_status(first_msg.get(), SSH_FX_NO_SUCH_FILE, no_such_file_calls);
+
+    int attr_calls{0};
+    auto reply_attr = [&attr_calls, &second_msg](sftp_client_message reply_msg, sftp_attributes) {
+        EXPECT_THAT(reply_msg, Eq(second_msg.get()));
+        ++attr_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_reply_attr, reply_attr);
+    REPLACE(sftp_get_client_message, msg_handler);
+
+    sftp.run();
+
+    EXPECT_THAT(no_such_file_calls, Eq(1));
+    EXPECT_THAT(attr_calls, Eq(1));
+}
+
 TEST_F(SftpServer, handles_fsetstat)
 {
     mpt::TempDir temp_dir;
@@ -1701,6 +1883,136 @@ TEST_F(SftpServer, handles_writes)
     EXPECT_TRUE(content_match(file_name, "The answer is always 42"));
 }
 
+TEST_F(SftpServer, coalesces_sequential_writes_while_more_are_queued)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0777;
+
+    open_msg->filename = name.data();
+    open_msg->attr = &attr;
+    open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+
+    auto write_msg1 = make_msg(SFTP_WRITE);
+    auto data1 = make_data("The answer ");
+    write_msg1->data = data1.get();
+    write_msg1->offset = 0;
+
+    auto write_msg2 = make_msg(SFTP_WRITE);
+    auto data2 = make_data("is ");
+    write_msg2->data = data2.get();
+    write_msg2->offset = 11;
+
+    auto write_msg3 = make_msg(SFTP_WRITE);
+    auto data3 = make_data("always 42");
+    write_msg3->data = data3.get();
+    write_msg3->offset = 14;
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return ssh_string_new(4);
+    };
+
+    auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
+    EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce([](QFileDevice& file, QIODevice::OpenMode mode) {
+        return file.open(mode);
+    });
+    EXPECT_CALL(*mock_file_ops, setPermissions(_, _)).WillOnce(Return(true));
+    {
+        InSequence seq;
+        EXPECT_CALL(*mock_file_ops, seek(_, 0)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_ops, write(_, _, 11)).WillOnce(Return(11));
+        EXPECT_CALL(*mock_file_ops, seek(_, 11)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_ops, write(_, _, 12)).WillOnce(Return(12));
+    }
+
+    int num_calls{0};
+    auto reply_status = [&num_calls](sftp_client_message, uint32_t status, const char*) {
+        EXPECT_EQ(status, SSH_FX_OK);
+        ++num_calls;
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(ssh_channel_poll, [this](auto...) { return static_cast<int>(messages.size()); });
+
+    sftp.run();
+
+    EXPECT_EQ(num_calls, 3);
+}
+
+TEST_F(SftpServer, reports_held_back_write_failure_on_close)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0777;
+
+    open_msg->filename = name.data();
+    open_msg->attr = &attr;
+    open_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+
+    auto write_msg1 = make_msg(SFTP_WRITE);
+    auto data1 = make_data("The answer ");
+    write_msg1->data = data1.get();
+    write_msg1->offset = 0;
+
+    auto write_msg2 = make_msg(SFTP_WRITE);
+    auto data2 = make_data("is always 42");
+    write_msg2->data = data2.get();
+    write_msg2->offset = 11;
+
+    auto close_msg = make_msg(SFTP_CLOSE);
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return ssh_string_new(4);
+    };
+
+    auto [mock_file_ops, guard] = mpt::MockFileOps::inject();
+    EXPECT_CALL(*mock_file_ops, open(_, _)).WillOnce([](QFileDevice& file, QIODevice::OpenMode mode) {
+        return file.open(mode);
+    });
+    EXPECT_CALL(*mock_file_ops, setPermissions(_, _)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_file_ops, seek(_, _)).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mock_file_ops, write(_, _, 11)).WillOnce(Return(11));
+    EXPECT_CALL(*mock_file_ops, write(_, _, 12)).WillOnce(Return(-1));
+
+    std::vector<std::pair<sftp_client_message, uint32_t>> replies;
+    auto reply_status = [&replies](sftp_client_message msg, uint32_t status, const char*) {
+        replies.emplace_back(msg, status);
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_handle_remove, [](auto...) {});
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(ssh_channel_poll, [this](auto...) { return static_cast<int>(messages.size()); });
+
+    sftp.run();
+
+    EXPECT_THAT(replies, ElementsAre(Pair(write_msg1.get(), SSH_FX_OK), Pair(write_msg2.get(), SSH_FX_OK),
+                                     Pair(close_msg.get(), SSH_FX_FAILURE)));
+}
+
 TEST_F(SftpServer, write_cannot_seek_fails)
 {
     const int seek_pos{10};
@@ -1855,6 +2167,49 @@ TEST_F(SftpServer, handles_reads)
     ASSERT_THAT(num_calls, Eq(1));
 }
 
+TEST_F(SftpServer, reads_are_capped_at_the_max_read_size)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    const std::string content(300000, 'x');
+    mpt::make_file_with_content(file_name, content);
+
+    mp::SSHSession session{"a", 42};
+    const auto path = temp_dir.path().toStdString();
+    mp::SftpServer sftp{std::move(session), path, path, {}, {}, default_id, default_id, "sshfs", 262144u};
+
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    auto read_msg = make_msg(SFTP_READ);
+    read_msg->offset = 0;
+    read_msg->len = content.size();
+
+    void* id{nullptr};
+    auto handle_alloc = [&id](sftp_session, void* info) {
+        id = info;
+        return ssh_string_new(4);
+    };
+
+    std::vector<int> lengths;
+    auto reply_data = [&lengths](sftp_client_message, const void*, int len) {
+        lengths.push_back(len);
+        return SSH_OK;
+    };
+
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+    REPLACE(sftp_handle_alloc, handle_alloc);
+    REPLACE(sftp_handle, [&id](auto...) { return id; });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+    REPLACE(sftp_reply_data, reply_data);
+
+    sftp.run();
+
+    EXPECT_THAT(lengths, ElementsAre(262144));
+}
+
 TEST_F(SftpServer, read_cannot_seek_fails)
 {
     const int seek_pos{10};
@@ -2140,6 +2495,172 @@ TEST_F(SftpServer, extended_rename_in_invalid_dir_fails)
     EXPECT_THAT(perm_denied_num_calls, Eq(1));
 }
 
+TEST_F(SftpServer, handle_extended_copy_data)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    auto copy_name = temp_dir.path() + "/test-copy";
+    mpt::make_file_with_content(file_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    auto open_copy_msg = make_msg(SFTP_OPEN);
+    auto copy = name_as_char_array(copy_name.toStdString());
+    sftp_attributes_struct attr{};
+    attr.permissions = 0777;
+    open_copy_msg->filename = copy.data();
+    open_copy_msg->attr = &attr;
+    open_copy_msg->flags |= SSH_FXF_WRITE | SSH_FXF_TRUNC;
+
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("copy-data");
+    msg->submessage = submessage.data();
+    const auto request =
+        ExtendedRequest{"copy-data"}.string(std::string(1, 0)).u64(8).u64(0).string(std::string(1, 1)).u64(0);
+    auto payload = request.buffer();
+    msg->complete_message = payload.get();
+
+    std::vector<void*> ids;
+    REPLACE(sftp_handle_alloc, make_indexed_handle_alloc(ids));
+    REPLACE(sftp_handle, make_indexed_handle_lookup(ids));
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_OK, num_calls);
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    ASSERT_THAT(num_calls, Eq(1));
+    EXPECT_TRUE(content_match(copy_name, "a test file"));
+}
+
+TEST_F(SftpServer, extended_copy_data_with_bad_handle_fails)
+{
+    auto sftp = make_sftpserver();
+
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("copy-data");
+    msg->submessage = submessage.data();
+    const auto request = ExtendedRequest{"copy-data"}.string("foo").u64(0).u64(0).string("bar").u64(0);
+    auto payload = request.buffer();
+    msg->complete_message = payload.get();
+
+    REPLACE(sftp_handle, [](auto...) { return nullptr; });
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_BAD_MESSAGE, num_calls);
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    EXPECT_THAT(num_calls, Eq(1));
+}
+
+TEST_F(SftpServer, malformed_extended_copy_data_fails)
+{
+    auto sftp = make_sftpserver();
+
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("copy-data");
+    msg->submessage = submessage.data();
+    const auto request = ExtendedRequest{"copy-data"}.string("foo").u64(0);
+    auto payload = request.buffer();
+    msg->complete_message = payload.get();
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_BAD_MESSAGE, num_calls);
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    EXPECT_THAT(num_calls, Eq(1));
+}
+
+TEST_F(SftpServer, handle_extended_check_file_handle)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("check-file-handle");
+    msg->submessage = submessage.data();
+    const auto request =
+        ExtendedRequest{"check-file-handle"}.string(std::string(1, 0)).string("crc32,sha256").u64(0).u64(0).u32(0);
+    auto payload = request.buffer();
+    msg->complete_message = payload.get();
+
+    std::vector<void*> ids;
+    REPLACE(sftp_handle_alloc, make_indexed_handle_alloc(ids));
+    REPLACE(sftp_handle, make_indexed_handle_lookup(ids));
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+
+    QByteArray reply;
+    REPLACE(ssh_channel_write, [&reply](ssh_channel, const void* data, uint32_t len) {
+        reply.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    const auto expected_hash = QCryptographicHash::hash("this is a test file", QCryptographicHash::Sha256);
+    ASSERT_THAT(reply.size(), Gt(5));
+    EXPECT_EQ(static_cast<uint8_t>(reply[4]), 201u); // SSH_FXP_EXTENDED_REPLY
+    EXPECT_TRUE(reply.contains("check-file"));
+    EXPECT_TRUE(reply.contains("sha256"));
+    EXPECT_TRUE(reply.endsWith(expected_hash));
+}
+
+TEST_F(SftpServer, extended_check_file_handle_without_known_algorithm_fails)
+{
+    mpt::TempDir temp_dir;
+    auto file_name = temp_dir.path() + "/test-file";
+    mpt::make_file_with_content(file_name);
+
+    auto sftp = make_sftpserver(temp_dir.path().toStdString());
+    auto open_msg = make_msg(SFTP_OPEN);
+    auto name = name_as_char_array(file_name.toStdString());
+    open_msg->filename = name.data();
+    open_msg->flags |= SSH_FXF_READ;
+
+    auto msg = make_msg(SFTP_EXTENDED);
+    auto submessage = name_as_char_array("check-file-handle");
+    msg->submessage = submessage.data();
+    const auto request =
+        ExtendedRequest{"check-file-handle"}.string(std::string(1, 0)).string("crc32").u64(0).u64(0).u32(0);
+    auto payload = request.buffer();
+    msg->complete_message = payload.get();
+
+    std::vector<void*> ids;
+    REPLACE(sftp_handle_alloc, make_indexed_handle_alloc(ids));
+    REPLACE(sftp_handle, make_indexed_handle_lookup(ids));
+    REPLACE(sftp_reply_handle, [](auto...) { return SSH_OK; });
+
+    int num_calls{0};
+    auto reply_status = make_reply_status(msg.get(), SSH_FX_OP_UNSUPPORTED, num_calls);
+    REPLACE(sftp_reply_status, reply_status);
+    REPLACE(sftp_get_client_message, make_msg_handler());
+
+    sftp.run();
+
+    EXPECT_THAT(num_calls, Eq(1));
+}
+
 TEST_F(SftpServer, invalid_extended_fails)
 {
     auto sftp = make_sftpserver();
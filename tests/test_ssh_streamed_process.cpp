@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "mock_ssh_test_fixture.h"
+
+#include <multipass/exceptions/ssh_exception.h>
+#include <multipass/ssh/ssh_session.h>
+#include <multipass/ssh/ssh_streamed_process.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mp = multipass;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+struct SSHStreamedProcess : public Test
+{
+    // Hands out each of the given chunks once, on the stream it is meant for, and nothing after that
+    auto read_chunks(std::vector<std::pair<std::string, bool>> chunks)
+    {
+        return [chunks = std::move(chunks)](ssh_channel, void* dest, uint32_t count, int is_stderr, int) mutable {
+            auto it = std::find_if(chunks.begin(), chunks.end(),
+                                   [is_stderr](const auto& chunk) { return chunk.second == bool(is_stderr); });
+            if (it == chunks.end())
+                return 0;
+
+            const auto size = std::min<uint32_t>(count, it->first.size());
+            std::memcpy(dest, it->first.data(), size);
+            chunks.erase(it);
+            return static_cast<int>(size);
+        };
+    }
+
+    mpt::MockSSHTestFixture mock_ssh_test_fixture;
+    mp::SSHSession session{"theanswertoeverything", 42};
+};
+} // namespace
+
+TEST_F(SSHStreamedProcess, passesOutputAlongAndReturnsExitStatus)
+{
+    REPLACE(ssh_channel_read_timeout, read_chunks({{"some output", false}, {"some error", true}}));
+    REPLACE(ssh_channel_get_exit_status, [](auto...) { return 7; });
+
+    std::vector<std::pair<std::string, bool>> received;
+    mp::SSHStreamedProcess process{session, "something"};
+    auto exit_status = process.run([&received](const std::string& output, bool is_stderr) {
+        received.emplace_back(output, is_stderr);
+        return true;
+    });
+
+    EXPECT_EQ(exit_status, 7);
+    EXPECT_THAT(received, ElementsAre(Pair("some output", false), Pair("some error", true)));
+}
+
+TEST_F(SSHStreamedProcess, sendsInputAndThenEof)
+{
+    std::string sent_input;
+    REPLACE(ssh_channel_write, [&sent_input](ssh_channel, const void* data, uint32_t len) {
+        sent_input.append(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+
+    int eof_count{0};
+    REPLACE(ssh_channel_send_eof, [&eof_count](ssh_channel) {
+        ++eof_count;
+        return SSH_OK;
+    });
+
+    mp::SSHStreamedProcess process{session, "something"};
+    process.write_input("some ");
+    process.write_input("input");
+    process.close_input();
+
+    EXPECT_EQ(process.run([](auto...) { return true; }), SSH_OK);
+    EXPECT_EQ(sent_input, "some input");
+    EXPECT_EQ(eof_count, 1);
+}
+
+TEST_F(SSHStreamedProcess, givesUpWhenOutputIsNotTaken)
+{
+    REPLACE(ssh_channel_read_timeout, read_chunks({{"some output", false}}));
+    REPLACE(ssh_channel_get_exit_status, [](auto...) {
+        ADD_FAILURE() << "no exit status should be waited for";
+        return SSH_OK;
+    });
+
+    mp::SSHStreamedProcess process{session, "something"};
+
+    EXPECT_EQ(process.run([](auto...) { return false; }), std::nullopt);
+}
+
+TEST_F(SSHStreamedProcess, throwsOnReadFailure)
+{
+    REPLACE(ssh_channel_read_timeout, [](auto...) { return SSH_ERROR; });
+
+    mp::SSHStreamedProcess process{session, "something"};
+
+    EXPECT_THROW(process.run([](auto...) { return true; }), mp::SSHException);
+}
+
+TEST_F(SSHStreamedProcess, sendsNoMoreInputThanWindowTakesAndReadsOutputMeanwhile)
+{
+    std::vector<uint32_t> windows{4, 0, 3, 100};
+    REPLACE(ssh_channel_window_size, [&windows](ssh_channel) {
+        const auto window = windows.front();
+        if (windows.size() > 1)
+            windows.erase(windows.begin());
+        return window;
+    });
+
+    std::vector<std::string> events;
+    REPLACE(ssh_channel_write, [&events](ssh_channel, const void* data, uint32_t len) {
+        events.emplace_back(static_cast<const char*>(data), len);
+        return static_cast<int>(len);
+    });
+    REPLACE(ssh_channel_read_timeout, [&events](ssh_channel, void*, uint32_t, int is_stderr, int) {
+        if (!is_stderr && (events.empty() || events.back() != "<read>"))
+            events.emplace_back("<read>");
+        return 0;
+    });
+
+    auto eof_sent = false;
+    REPLACE(ssh_channel_send_eof, [&eof_sent](ssh_channel) {
+        eof_sent = true;
+        return SSH_OK;
+    });
+    REPLACE(ssh_channel_is_eof, [&eof_sent](ssh_channel) { return eof_sent; });
+
+    mp::SSHStreamedProcess process{session, "something"};
+    process.write_input("some input");
+    process.close_input();
+
+    EXPECT_EQ(process.run([](auto...) { return true; }), SSH_OK);
+    EXPECT_THAT(events, ElementsAre("some", "<read>", " in", "<read>", "put", "<read>"));
+}
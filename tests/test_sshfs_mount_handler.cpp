@@ -18,21 +18,27 @@
 #include "mock_ssh_test_fixture.h"
 
 #include "common.h"
+#include "file_operations.h"
 #include "mock_environment_helpers.h"
 #include "mock_file_ops.h"
 #include "mock_logger.h"
 #include "mock_process_factory.h"
 #include "mock_server_reader_writer.h"
+#include "mock_settings.h"
 #include "mock_ssh_process_exit_status.h"
 #include "mock_virtual_machine.h"
 #include "stub_ssh_key_provider.h"
 #include "stub_virtual_machine.h"
+#include "temp_dir.h"
 
+#include <multipass/constants.h>
 #include <multipass/exceptions/sshfs_missing_error.h>
 #include <multipass/sshfs_mount/sshfs_mount_handler.h>
 #include <multipass/vm_mount.h>
 
+#include <memory>
 #include <thread>
+#include <utility>
 
 #include <QCoreApplication>
 #include <QTimer>
@@ -50,6 +56,7 @@ struct SSHFSMountHandlerTest : public ::Test
     SSHFSMountHandlerTest()
     {
         EXPECT_CALL(server, Write(_, _)).WillRepeatedly(Return(true));
+        EXPECT_CALL(mock_settings, get(Eq(mp::sshfs_shared_server_key))).WillRepeatedly(Return("false"));
     }
 
     void TearDown() override
@@ -90,6 +97,8 @@ struct SSHFSMountHandlerTest : public ::Test
     mpt::MockSSHTestFixture mock_ssh_test_fixture;
     mpt::ExitStatusMock exit_status_mock;
     mpt::StubVirtualMachine vm;
+    mpt::MockSettings::GuardedMock mock_settings_injection = mpt::MockSettings::inject<StrictMock>();
+    mpt::MockSettings& mock_settings = *mock_settings_injection.first;
 
     mpt::MockProcessFactory::Callback sshfs_prints_connected = [](mpt::MockProcess* process) {
         if (process->program().contains("sshfs_server"))
@@ -450,3 +459,358 @@ TEST_F(SSHFSMountHandlerTest, install_sshfs_timeout_logs_info)
     EXPECT_THROW(sshfs_mount_handler.start_mount(&vm, &server, target_path, std::chrono::milliseconds(1)),
                  mp::SSHFSMissingError);
 }
+
+struct SSHFSMountHandlerCacheTest : public SSHFSMountHandlerTest
+{
+    mpt::MockProcessFactory::Callback sshfs_prints_exec_line = [](mpt::MockProcess* process) {
+        if (process->program().contains("sshfs_server"))
+        {
+            ON_CALL(*process, read_all_standard_output())
+                .WillByDefault(Return("sshfs exec line: /usr/bin/sshfs -o slave\nConnected"));
+            QTimer::singleShot(1, process, [process]() { emit process->ready_read_standard_output(); });
+
+            mp::ProcessState running_state;
+            ON_CALL(*process, process_state()).WillByDefault(Return(running_state));
+        }
+    };
+};
+
+TEST_F(SSHFSMountHandlerCacheTest, second_mount_skips_sshfs_installation)
+{
+    int snap_checks{0};
+    auto request_exec = [this, &snap_checks](ssh_channel, const char* raw_cmd) {
+        if (std::string{raw_cmd} == "which snap")
+            ++snap_checks;
+
+        exit_status_mock.return_exit_code(SSH_OK);
+        return SSH_OK;
+    };
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(sshfs_prints_exec_line);
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+
+    const mp::VMMount mount{source_path, gid_mappings, uid_mappings, mp::VMMount::MountType::Classic};
+    sshfs_mount_handler.init_mount(&vm, target_path, mount);
+    sshfs_mount_handler.start_mount(&vm, &server, target_path);
+
+    sshfs_mount_handler.init_mount(&vm, "/another/target", mount);
+    sshfs_mount_handler.start_mount(&vm, &server, "/another/target");
+
+    EXPECT_EQ(snap_checks, 1);
+    EXPECT_EQ(factory->process_list().size(), 2u);
+}
+
+TEST_F(SSHFSMountHandlerCacheTest, uses_sshfs_exec_lines_from_cache_dir)
+{
+    bool invoked{false};
+    auto request_exec = make_exec_that_fails_for({"which snap"}, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    mpt::TempDir cache_dir;
+    mpt::make_file_with_content(QDir{cache_dir.path()}.filePath("sshfs-exec-lines.json"),
+                                R"({"stub": "/usr/bin/sshfs -o slave"})");
+
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).WillOnce(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(sshfs_prints_exec_line);
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider, cache_dir.path());
+
+    const mp::VMMount mount{source_path, gid_mappings, uid_mappings, mp::VMMount::MountType::Classic};
+    sshfs_mount_handler.init_mount(&vm, target_path, mount);
+
+    EXPECT_NO_THROW(sshfs_mount_handler.start_mount(&vm, &server, target_path));
+    EXPECT_FALSE(invoked);
+}
+
+TEST_F(SSHFSMountHandlerCacheTest, persists_discovered_sshfs_exec_line)
+{
+    mpt::TempDir cache_dir;
+
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).WillOnce(Return(true));
+    EXPECT_CALL(mock_file_ops, open(_, _)).WillOnce(Return(true));
+    EXPECT_CALL(mock_file_ops, write(A<QFileDevice&>(), A<const QByteArray&>()))
+        .WillOnce([](QFileDevice&, const QByteArray& data) {
+            EXPECT_TRUE(data.contains("/usr/bin/sshfs -o slave"));
+            return data.size();
+        });
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(sshfs_prints_exec_line);
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider, cache_dir.path());
+
+    const mp::VMMount mount{source_path, gid_mappings, uid_mappings, mp::VMMount::MountType::Classic};
+    sshfs_mount_handler.init_mount(&vm, target_path, mount);
+    sshfs_mount_handler.start_mount(&vm, &server, target_path);
+}
+
+struct SSHFSMountHandlerSharedServerTest : public SSHFSMountHandlerTest
+{
+    SSHFSMountHandlerSharedServerTest()
+    {
+        EXPECT_CALL(mock_settings, get(Eq(mp::sshfs_shared_server_key))).WillRepeatedly(Return("true"));
+    }
+
+    void init_mounts(mp::SSHFSMountHandler& sshfs_mount_handler)
+    {
+        const mp::VMMount mount{source_path, gid_mappings, uid_mappings, mp::VMMount::MountType::Classic};
+        const mp::VMMount other_mount{other_source_path, {}, {}, mp::VMMount::MountType::Classic};
+
+        sshfs_mount_handler.init_mount(&vm, target_path, mount);
+        sshfs_mount_handler.init_mount(&vm, other_target_path, other_mount);
+    }
+
+    mpt::MockProcessFactory::Callback sshfs_reports(const std::string& output)
+    {
+        return [output](mpt::MockProcess* process) {
+            if (process->program().contains("sshfs_server"))
+            {
+                ON_CALL(*process, read_all_standard_output()).WillByDefault(Return(QByteArray::fromStdString(output)));
+                QTimer::singleShot(1, process, [process]() { emit process->ready_read_standard_output(); });
+
+                mp::ProcessState running_state;
+                ON_CALL(*process, process_state()).WillByDefault(Return(running_state));
+            }
+        };
+    }
+
+    // Serves the first mount it starts with, and answers a later mount request with reply
+    mpt::MockProcessFactory::Callback sshfs_answers_later_mount(const std::string& reply)
+    {
+        return [this, reply](mpt::MockProcess* process) {
+            if (!process->program().contains("sshfs_server"))
+                return;
+
+            auto pending = std::make_shared<QByteArray>(QByteArray::fromStdString(
+                fmt::format("Mounted \"{}\"\nConnected\n", target_path)));
+            ON_CALL(*process, read_all_standard_output()).WillByDefault([pending] {
+                return std::exchange(*pending, {});
+            });
+            QTimer::singleShot(1, process, [process]() { emit process->ready_read_standard_output(); });
+
+            const auto request = QByteArray::fromStdString(
+                fmt::format("mount {}\t{}\t\t\n", other_source_path, other_target_path));
+            EXPECT_CALL(*process, write(Eq(request))).WillOnce([process, pending, reply](const QByteArray& data) {
+                *pending = QByteArray::fromStdString(reply + "\n");
+                QTimer::singleShot(1, process, [process]() { emit process->ready_read_standard_output(); });
+                return data.size();
+            });
+
+            mp::ProcessState running_state;
+            ON_CALL(*process, process_state()).WillByDefault(Return(running_state));
+        };
+    }
+
+    void mount_one_then_the_other(mp::SSHFSMountHandler& sshfs_mount_handler)
+    {
+        const mp::VMMount mount{source_path, gid_mappings, uid_mappings, mp::VMMount::MountType::Classic};
+        const mp::VMMount other_mount{other_source_path, {}, {}, mp::VMMount::MountType::Classic};
+
+        sshfs_mount_handler.init_mount(&vm, target_path, mount);
+        sshfs_mount_handler.start_mount(&vm, &server, target_path);
+        sshfs_mount_handler.init_mount(&vm, other_target_path, other_mount);
+        sshfs_mount_handler.start_mount(&vm, &server, other_target_path);
+    }
+
+    std::string other_source_path{"/my/other/source"}, other_target_path{"/the/other/target"};
+};
+
+TEST_F(SSHFSMountHandlerSharedServerTest, one_process_serves_pending_mounts)
+{
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(
+        sshfs_reports("Mounted \"/the/target/path\"\nMounted \"/the/other/target\"\nConnected\n"));
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    init_mounts(sshfs_mount_handler);
+
+    sshfs_mount_handler.start_mount(&vm, &server, target_path);
+    sshfs_mount_handler.start_mount(&vm, &server, other_target_path);
+
+    ASSERT_EQ(factory->process_list().size(), 1u);
+    const auto& arguments = factory->process_list()[0].arguments;
+    ASSERT_EQ(arguments.size(), 12);
+    EXPECT_EQ(arguments[8], QString::fromStdString(other_source_path));
+    EXPECT_EQ(arguments[9], QString::fromStdString(other_target_path));
+
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, failed_mount_is_reported_when_started)
+{
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(
+        sshfs_reports("Mounted \"/the/target/path\"\nFailed to mount \"/the/other/target\": no way\nConnected\n"));
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    init_mounts(sshfs_mount_handler);
+
+    sshfs_mount_handler.start_mount(&vm, &server, target_path);
+    MP_EXPECT_THROW_THAT(sshfs_mount_handler.start_mount(&vm, &server, other_target_path), std::runtime_error,
+                         mpt::match_what(StrEq("no way")));
+
+    EXPECT_EQ(factory->process_list().size(), 1u);
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_FALSE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, stopping_one_mount_keeps_the_process_running)
+{
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    auto sshfs_reports_mounts =
+        sshfs_reports("Mounted \"/the/target/path\"\nMounted \"/the/other/target\"\nConnected\n");
+    factory->register_callback([&sshfs_reports_mounts](mpt::MockProcess* process) {
+        sshfs_reports_mounts(process);
+        EXPECT_CALL(*process, write(Eq(QByteArray{"stop /the/other/target\n"})));
+        EXPECT_CALL(*process, terminate).Times(0);
+    });
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    init_mounts(sshfs_mount_handler);
+
+    sshfs_mount_handler.start_mount(&vm, &server, target_path);
+    sshfs_mount_handler.stop_mount(vm.vm_name, other_target_path);
+
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_FALSE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, later_mount_joins_the_running_process)
+{
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(sshfs_answers_later_mount(fmt::format("Mounted \"{}\"", other_target_path)));
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    mount_one_then_the_other(sshfs_mount_handler);
+
+    ASSERT_EQ(factory->process_list().size(), 1u);
+    EXPECT_EQ(factory->process_list()[0].arguments.size(), 8);
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, later_mount_that_fails_to_join_is_reported)
+{
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(
+        sshfs_answers_later_mount(fmt::format("Failed to mount \"{}\": no way", other_target_path)));
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    MP_EXPECT_THROW_THAT(mount_one_then_the_other(sshfs_mount_handler), std::runtime_error,
+                         mpt::match_what(StrEq("no way")));
+
+    EXPECT_EQ(factory->process_list().size(), 1u);
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_FALSE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, disabled_shared_server_starts_one_process_per_mount)
+{
+    EXPECT_CALL(mock_settings, get(Eq(mp::sshfs_shared_server_key))).WillRepeatedly(Return("false"));
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback(sshfs_prints_connected);
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    init_mounts(sshfs_mount_handler);
+
+    sshfs_mount_handler.start_mount(&vm, &server, target_path);
+    sshfs_mount_handler.start_mount(&vm, &server, other_target_path);
+
+    ASSERT_EQ(factory->process_list().size(), 2u);
+    EXPECT_EQ(factory->process_list()[0].arguments.size(), 8);
+    EXPECT_EQ(factory->process_list()[1].arguments.size(), 8);
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, start_mounts_starts_processes_side_by_side)
+{
+    EXPECT_CALL(mock_settings, get(Eq(mp::sshfs_shared_server_key))).WillRepeatedly(Return("false"));
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    int snap_checks{0};
+    auto request_exec = [this, &snap_checks](ssh_channel, const char* raw_cmd) {
+        if (std::string{raw_cmd} == "which snap")
+            ++snap_checks;
+
+        exit_status_mock.return_exit_code(SSH_OK);
+        return SSH_OK;
+    };
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    std::vector<std::size_t> processes_when_connected;
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback([&factory, &processes_when_connected](mpt::MockProcess* process) {
+        if (process->program().contains("sshfs_server"))
+        {
+            ON_CALL(*process, read_all_standard_output()).WillByDefault(Return("Connected"));
+            QTimer::singleShot(1, process, [&factory, &processes_when_connected, process]() {
+                processes_when_connected.push_back(factory->process_list().size());
+                emit process->ready_read_standard_output();
+            });
+
+            mp::ProcessState running_state;
+            ON_CALL(*process, process_state()).WillByDefault(Return(running_state));
+        }
+    });
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    init_mounts(sshfs_mount_handler);
+
+    const auto errors = sshfs_mount_handler.start_mounts(&vm, &server, {target_path, other_target_path});
+
+    EXPECT_TRUE(errors.empty());
+    EXPECT_EQ(snap_checks, 1);
+    EXPECT_THAT(processes_when_connected, ElementsAre(2u, 2u));
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
+
+TEST_F(SSHFSMountHandlerSharedServerTest, start_mounts_returns_errors_by_target)
+{
+    EXPECT_CALL(mock_settings, get(Eq(mp::sshfs_shared_server_key))).WillRepeatedly(Return("false"));
+    EXPECT_CALL(mock_file_ops, exists(A<const QDir&>())).Times(2).WillRepeatedly(Return(true));
+
+    auto factory = mpt::MockProcessFactory::Inject();
+    factory->register_callback([this](mpt::MockProcess* process) {
+        if (!process->arguments().contains(QString::fromStdString(other_target_path)))
+            return sshfs_prints_connected(process);
+
+        mp::ProcessState exit_state;
+        exit_state.exit_code = 1;
+
+        ON_CALL(*process, read_all_standard_error()).WillByDefault(Return("Whoopsie"));
+        QTimer::singleShot(1, process, [process, exit_state]() { emit process->finished(exit_state); });
+
+        ON_CALL(*process, process_state()).WillByDefault(Return(exit_state));
+    });
+
+    mp::SSHFSMountHandler sshfs_mount_handler(key_provider);
+    init_mounts(sshfs_mount_handler);
+
+    const auto errors = sshfs_mount_handler.start_mounts(&vm, &server, {target_path, other_target_path});
+
+    ASSERT_EQ(errors.size(), 1u);
+    MP_EXPECT_THROW_THAT(std::rethrow_exception(errors.at(other_target_path)), std::runtime_error,
+                         mpt::match_what(StrEq("Process returned exit code: 1: Whoopsie")));
+    EXPECT_TRUE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, target_path));
+    EXPECT_FALSE(sshfs_mount_handler.has_instance_already_mounted(vm.vm_name, other_target_path));
+}
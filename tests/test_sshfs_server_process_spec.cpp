@@ -63,6 +63,18 @@ TEST_F(TestSSHFSServerProcessSpec, arguments_correct)
     EXPECT_EQ(spec.arguments()[7], "0");
 }
 
+TEST_F(TestSSHFSServerProcessSpec, arguments_include_additional_mounts)
+{
+    config.additional_mounts.push_back({"other_source", "other_target", {{7, 8}}, {{9, 10}}});
+    mp::SSHFSServerProcessSpec spec(config);
+
+    ASSERT_EQ(spec.arguments().size(), 12);
+    EXPECT_EQ(spec.arguments()[8], "other_source");
+    EXPECT_EQ(spec.arguments()[9], "other_target");
+    EXPECT_EQ(spec.arguments()[10], "9:10,");
+    EXPECT_EQ(spec.arguments()[11], "7:8,");
+}
+
 TEST_F(TestSSHFSServerProcessSpec, environment_correct)
 {
     mp::SSHFSServerProcessSpec spec(config);
@@ -71,6 +83,61 @@ TEST_F(TestSSHFSServerProcessSpec, environment_correct)
     EXPECT_EQ(spec.environment().value("KEY"), "private_key");
 }
 
+TEST_F(TestSSHFSServerProcessSpec, environment_has_no_sshfs_exec_line_by_default)
+{
+    mp::SSHFSServerProcessSpec spec(config);
+
+    EXPECT_FALSE(spec.environment().contains("SSHFS_EXEC_LINE"));
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_passes_cached_sshfs_exec_line)
+{
+    config.sshfs_exec_line = "/usr/bin/sshfs -o slave";
+    mp::SSHFSServerProcessSpec spec(config);
+
+    EXPECT_EQ(spec.environment().value("SSHFS_EXEC_LINE"), "/usr/bin/sshfs -o slave");
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_passes_throughput_profile)
+{
+    config.profile = mp::VMMount::Profile::Throughput;
+    mp::SSHFSServerProcessSpec spec(config);
+
+    EXPECT_EQ(spec.environment().value("SSHFS_PROFILE"), "throughput");
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_leaves_out_default_profile)
+{
+    mp::SSHFSServerProcessSpec spec(config);
+
+    EXPECT_FALSE(spec.environment().contains("SSHFS_PROFILE"));
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_asks_for_sftp_stats_only_when_told)
+{
+    EXPECT_FALSE(mp::SSHFSServerProcessSpec{config}.environment().contains("SSHFS_REPORT_STATS"));
+
+    config.report_sftp_stats = true;
+    EXPECT_TRUE(mp::SSHFSServerProcessSpec{config}.environment().contains("SSHFS_REPORT_STATS"));
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_asks_for_a_shared_server_only_when_told)
+{
+    EXPECT_FALSE(mp::SSHFSServerProcessSpec{config}.environment().contains("SSHFS_SHARED_SERVER"));
+
+    config.shared_server = true;
+    EXPECT_TRUE(mp::SSHFSServerProcessSpec{config}.environment().contains("SSHFS_SHARED_SERVER"));
+}
+
+TEST_F(TestSSHFSServerProcessSpec, environment_passes_trace_parent_when_tracing)
+{
+    EXPECT_FALSE(mp::SSHFSServerProcessSpec{config}.environment().contains("SSHFS_TRACE_PARENT"));
+
+    config.trace_parent = "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+    EXPECT_EQ(mp::SSHFSServerProcessSpec{config}.environment().value("SSHFS_TRACE_PARENT"),
+              "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+}
+
 TEST_F(TestSSHFSServerProcessSpec, snap_confined_apparmor_profile_returns_expected_data)
 {
     mpt::TempDir bin_dir;
@@ -103,3 +170,16 @@ TEST_F(TestSSHFSServerProcessSpec, unconfined_apparmor_profile_returns_expected_
     EXPECT_TRUE(apparmor_profile.contains(current_dir.absolutePath() + "/{usr/,}lib/**"));
     EXPECT_TRUE(apparmor_profile.contains("signal (receive) peer=unconfined"));
 }
+
+TEST_F(TestSSHFSServerProcessSpec, apparmor_profile_allows_all_source_paths)
+{
+    config.additional_mounts.push_back({"other_source", "other_target", {}, {}});
+    mp::SSHFSServerProcessSpec spec(config);
+
+    const auto apparmor_profile = spec.apparmor_profile();
+
+    EXPECT_TRUE(apparmor_profile.contains("source_path/ rw,"));
+    EXPECT_TRUE(apparmor_profile.contains("source_path/** rwlk,"));
+    EXPECT_TRUE(apparmor_profile.contains("other_source/ rw,"));
+    EXPECT_TRUE(apparmor_profile.contains("other_source/** rwlk,"));
+}
@@ -17,6 +17,7 @@
 
 #include "common.h"
 #include "mock_logger.h"
+#include "mock_ssh_client.h"
 #include "mock_ssh_process_exit_status.h"
 #include "sftp_server_test_fixture.h"
 #include "signal.h"
@@ -29,7 +30,9 @@
 #include <multipass/utils.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iterator>
+#include <thread>
 #include <tuple>
 #include <unordered_set>
 #include <vector>
@@ -46,11 +49,34 @@ namespace
 {
 struct SshfsMount : public mp::test::SftpServerTest
 {
-    mp::SshfsMount make_sshfsmount(std::optional<std::string> target = std::nullopt)
+    mp::SshfsMount make_sshfsmount(std::optional<std::string> target = std::nullopt,
+                                   const std::string& cached_sshfs_exec_line = {},
+                                   mp::VMMount::Profile profile = mp::VMMount::Profile::Default)
     {
         mp::SSHSession session{"a", 42};
-        return {std::move(session), default_source, target.value_or(default_target), default_mappings,
-                default_mappings};
+        return {std::move(session), default_source,         target.value_or(default_target), default_mappings,
+                default_mappings,   cached_sshfs_exec_line, profile};
+    }
+
+    // Answers the bootstrap script with the given output and records all the commands that were run
+    auto make_exec_answering_bootstrap(const std::string& bootstrap_output, std::vector<std::string>& executed,
+                                       std::string& output, std::string::size_type& remaining, bool& invoked)
+    {
+        auto request_exec = [&bootstrap_output, &executed, &output, &remaining, &invoked](ssh_channel,
+                                                                                         const char* raw_cmd) {
+            std::string cmd{raw_cmd};
+            executed.push_back(cmd);
+
+            invoked = cmd.find("MULTIPASS_BOOTSTRAP") != std::string::npos;
+            if (invoked)
+            {
+                output = bootstrap_output;
+                remaining = output.size();
+            }
+
+            return SSH_OK;
+        };
+        return request_exec;
     }
 
     auto make_exec_that_fails_for(const std::vector<std::string>& expected_cmds, bool& invoked)
@@ -140,8 +166,10 @@ struct SshfsMount : public mp::test::SftpServerTest
 
     auto make_channel_read_return(const std::string& output, std::string::size_type& remaining, bool& prereq_invoked)
     {
-        auto channel_read = [&output, &remaining, &prereq_invoked](ssh_channel, void* dest, uint32_t count,
-                                                                   int is_stderr, int) {
+        auto channel_read = [this, &output, &remaining, &prereq_invoked](ssh_channel, void* dest, uint32_t count,
+                                                                         int is_stderr, int) {
+            if (!pending_init.empty())
+                return static_cast<uint32_t>(read_pending_init(dest, count, is_stderr));
             if (!prereq_invoked)
                 return 0u;
             const auto num_to_copy = std::min(count, static_cast<uint32_t>(remaining));
@@ -415,3 +443,203 @@ TEST_F(SshfsMount, blank_fuse_version_logs_error)
 
     test_command_execution(commands);
 }
+
+TEST_F(SshfsMount, bootstrap_script_replaces_step_by_step_probing)
+{
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/\nuid=1000\ngid=1000\n"
+                                       "sshfs_exec=/usr/bin/sshfs\nsshfs_version=FUSE library version: 3.0.0\n"
+                                       "bootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    make_sshfsmount();
+
+    EXPECT_THAT(executed, Contains(HasSubstr("MULTIPASS_BOOTSTRAP")));
+    EXPECT_THAT(executed, Not(Contains("id -u")));
+    EXPECT_THAT(executed, Not(Contains("snap run multipass-sshfs.env")));
+    EXPECT_THAT(executed, Contains("sudo /usr/bin/sshfs -o slave -o transform_symlinks -o allow_other -o "
+                                   "Compression=no -o dcache_timeout=3 :\"source\" \"/home/ubuntu/target\""));
+}
+
+TEST_F(SshfsMount, bootstrap_script_checks_cached_sshfs)
+{
+    const std::string cached_sshfs_exec_line{"env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave"};
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/target/\nuid=1000\n"
+                                       "gid=1000\nsshfs_cached=yes\nbootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    make_sshfsmount(std::nullopt, cached_sshfs_exec_line);
+
+    ASSERT_THAT(executed, Contains(HasSubstr("MULTIPASS_BOOTSTRAP")));
+    EXPECT_THAT(executed.front(), HasSubstr("B=/baz/bin/sshfs\n"));
+    EXPECT_THAT(executed, Contains("sudo env LD_LIBRARY_PATH=/foo/bar /baz/bin/sshfs -o slave :\"source\" "
+                                   "\"/home/ubuntu/target/.\""));
+}
+
+TEST_F(SshfsMount, throughput_profile_asks_for_larger_requests_and_writeback)
+{
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/\nuid=1000\ngid=1000\n"
+                                       "sshfs_exec=/usr/bin/sshfs\nsshfs_version=FUSE library version: 3.0.0\n"
+                                       "sshfs_writeback=yes\nbootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    make_sshfsmount(std::nullopt, {}, mp::VMMount::Profile::Throughput);
+
+    ASSERT_THAT(executed, Contains(HasSubstr("MULTIPASS_BOOTSTRAP")));
+    EXPECT_THAT(executed.front(), HasSubstr("writeback_cache"));
+    EXPECT_THAT(executed, Contains("sudo /usr/bin/sshfs -o slave -o transform_symlinks -o allow_other -o "
+                                   "Compression=no -o dcache_timeout=3 -o max_read=262144 -o max_write=262144 -o "
+                                   "writeback_cache=yes :\"source\" \"/home/ubuntu/target\""));
+}
+
+TEST_F(SshfsMount, throughput_profile_enables_big_writes_for_fuse_2)
+{
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/\nuid=1000\ngid=1000\n"
+                                       "sshfs_exec=/usr/bin/sshfs\nsshfs_version=FUSE library version: 2.9.7\n"
+                                       "bootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    make_sshfsmount(std::nullopt, {}, mp::VMMount::Profile::Throughput);
+
+    EXPECT_THAT(executed, Contains(AllOf(HasSubstr("-o nonempty -o cache_timeout=3 -o big_writes -o max_read=262144"),
+                                         Not(HasSubstr("writeback_cache")))));
+}
+
+TEST_F(SshfsMount, default_profile_does_not_probe_for_writeback)
+{
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/\nuid=1000\ngid=1000\n"
+                                       "sshfs_exec=/usr/bin/sshfs\nsshfs_version=FUSE library version: 3.0.0\n"
+                                       "bootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    make_sshfsmount();
+
+    ASSERT_THAT(executed, Contains(HasSubstr("MULTIPASS_BOOTSTRAP")));
+    EXPECT_THAT(executed.front(), Not(HasSubstr("writeback_cache")));
+    EXPECT_THAT(executed, Not(Contains(HasSubstr("max_read"))));
+}
+
+TEST_F(SshfsMount, bootstrap_script_without_sshfs_throws)
+{
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/\nuid=1000\ngid=1000\n"
+                                       "sshfs_exec=\nbootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    EXPECT_THROW(make_sshfsmount(), mp::SSHFSMissingError);
+}
+
+TEST_F(SshfsMount, mount_group_serves_all_mounts_over_one_session)
+{
+    const std::string bootstrap_output{"absolute=/home/ubuntu/target\nexisting=/home/ubuntu/\nuid=1000\ngid=1000\n"
+                                       "sshfs_exec=/usr/bin/sshfs\nsshfs_version=FUSE library version: 3.0.0\n"
+                                       "bootstrap=done\n"};
+    std::vector<std::string> executed;
+    std::string output;
+    std::string::size_type remaining{0};
+    bool invoked{false};
+    int connections{0};
+
+    auto channel_read = make_channel_read_return(output, remaining, invoked);
+    REPLACE(ssh_channel_read_timeout, channel_read);
+
+    auto request_exec = make_exec_answering_bootstrap(bootstrap_output, executed, output, remaining, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+
+    REPLACE(ssh_connect, [&connections](ssh_session) {
+        ++connections;
+        return SSH_OK;
+    });
+    REPLACE(ssh_event_add_session, [](ssh_event, ssh_session) { return SSH_OK; });
+    REPLACE(ssh_event_dopoll, [](ssh_event, int) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return SSH_OK;
+    });
+
+    mp::SshfsMountGroup sshfs_mounts{mp::SSHSession{"a", 42}};
+    sshfs_mounts.add(default_source, "/home/ubuntu/one", default_mappings, default_mappings);
+    sshfs_mounts.add(default_source, "/home/ubuntu/two", default_mappings, default_mappings);
+
+    EXPECT_EQ(connections, 1);
+    EXPECT_EQ(std::count_if(executed.cbegin(), executed.cend(),
+                            [](const std::string& cmd) { return cmd.find("sudo /usr/bin/sshfs") == 0; }),
+              2);
+    EXPECT_THROW(sshfs_mounts.add(default_source, "/home/ubuntu/one", default_mappings, default_mappings),
+                 std::runtime_error);
+
+    EXPECT_TRUE(sshfs_mounts.remove("/home/ubuntu/one"));
+    EXPECT_FALSE(sshfs_mounts.remove("/home/ubuntu/one"));
+
+    sshfs_mounts.stop();
+    EXPECT_THROW(sshfs_mounts.remove("/home/ubuntu/two"), std::runtime_error);
+}
+
+TEST_F(SshfsMount, mount_group_reports_mounts_that_cannot_be_set_up)
+{
+    bool invoked{false};
+    auto request_exec = make_exec_that_fails_for({"sudo multipass-sshfs.env", "which sshfs"}, invoked);
+    REPLACE(ssh_channel_request_exec, request_exec);
+    REPLACE(ssh_event_add_session, [](ssh_event, ssh_session) { return SSH_OK; });
+    REPLACE(ssh_event_dopoll, [](ssh_event, int) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return SSH_OK;
+    });
+
+    mp::SshfsMountGroup sshfs_mounts{mp::SSHSession{"a", 42}};
+
+    EXPECT_THROW(sshfs_mounts.add(default_source, default_target, default_mappings, default_mappings),
+                 mp::SSHFSMissingError);
+    EXPECT_FALSE(sshfs_mounts.remove(default_target));
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+#include "temp_dir.h"
+
+#include <multipass/logging/json_lines_span_exporter.h>
+#include <multipass/logging/trace.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <mutex>
+#include <thread>
+
+namespace mpl = multipass::logging;
+namespace mpt = multipass::test;
+
+using namespace testing;
+
+namespace
+{
+constexpr auto traceparent = "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+
+struct SpanRecorder : public mpl::SpanExporter
+{
+    void export_span(const mpl::SpanData& span) override
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        spans.push_back(span);
+    }
+
+    std::mutex mutex;
+    std::vector<mpl::SpanData> spans;
+};
+
+struct Trace : public Test
+{
+    Trace()
+    {
+        mpl::set_span_exporter(recorder);
+    }
+
+    ~Trace() override
+    {
+        mpl::set_span_exporter(nullptr);
+    }
+
+    std::shared_ptr<SpanRecorder> recorder = std::make_shared<SpanRecorder>();
+};
+
+TEST_F(Trace, traceparentRoundTrips)
+{
+    const auto context = mpl::SpanContext::from_traceparent(traceparent);
+
+    ASSERT_TRUE(context.is_valid());
+    EXPECT_EQ(context.trace_id, "4bf92f3577b34da6a3ce929d0e0e4736");
+    EXPECT_EQ(context.span_id, "00f067aa0ba902b7");
+    EXPECT_EQ(context.to_traceparent(), traceparent);
+}
+
+TEST_F(Trace, malformedTraceparentGivesInvalidContext)
+{
+    auto is_valid = [](const char* value) { return mpl::SpanContext::from_traceparent(value).is_valid(); };
+
+    EXPECT_FALSE(is_valid(""));
+    EXPECT_FALSE(is_valid("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(is_valid("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(is_valid("00-00000000000000000000000000000000-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(is_valid("00-4bf92f3577b34da6a3ce929d0e0e4736_00f067aa0ba902b7-01"));
+}
+
+TEST_F(Trace, spanWithoutParentStartsTrace)
+{
+    {
+        mpl::Span span{"root"};
+        EXPECT_TRUE(span.context().is_valid());
+    }
+
+    ASSERT_EQ(recorder->spans.size(), 1u);
+    EXPECT_EQ(recorder->spans[0].name, "root");
+    EXPECT_TRUE(recorder->spans[0].parent_span_id.empty());
+    EXPECT_LE(recorder->spans[0].start, recorder->spans[0].end);
+}
+
+TEST_F(Trace, spansNestInTheCurrentOne)
+{
+    {
+        mpl::Span outer{"outer"};
+        mpl::Span inner{"inner"};
+
+        EXPECT_EQ(mpl::current_span_context().span_id, inner.context().span_id);
+    }
+
+    ASSERT_EQ(recorder->spans.size(), 2u);
+    const auto& inner = recorder->spans[0];
+    const auto& outer = recorder->spans[1];
+    EXPECT_EQ(inner.context.trace_id, outer.context.trace_id);
+    EXPECT_EQ(inner.parent_span_id, outer.context.span_id);
+    EXPECT_FALSE(mpl::current_span_context().is_valid());
+}
+
+TEST_F(Trace, scopedContextIsAdoptedOnlyOnItsThread)
+{
+    const auto context = mpl::SpanContext::from_traceparent(traceparent);
+    {
+        mpl::ScopedSpanContext scope{context};
+        mpl::Span span{"child"};
+
+        std::thread{[] { EXPECT_FALSE(mpl::current_span_context().is_valid()); }}.join();
+    }
+
+    ASSERT_EQ(recorder->spans.size(), 1u);
+    EXPECT_EQ(recorder->spans[0].context.trace_id, context.trace_id);
+    EXPECT_EQ(recorder->spans[0].parent_span_id, context.span_id);
+    EXPECT_FALSE(mpl::current_span_context().is_valid());
+}
+
+TEST_F(Trace, spansAreNotExportedWithoutExporter)
+{
+    mpl::set_span_exporter(nullptr);
+    EXPECT_FALSE(mpl::is_tracing());
+
+    {
+        mpl::Span span{"lost"};
+    }
+
+    EXPECT_TRUE(recorder->spans.empty());
+}
+
+TEST_F(Trace, spanDataSurvivesJson)
+{
+    {
+        mpl::ScopedSpanContext scope{mpl::SpanContext::from_traceparent(traceparent)};
+        mpl::Span span{"work"};
+        span.set_attribute("target", "/home/\"ubuntu\"");
+        span.set_failed();
+    }
+
+    ASSERT_EQ(recorder->spans.size(), 1u);
+    const auto& span = recorder->spans[0];
+    const auto parsed = mpl::SpanData::from_json(span.to_json());
+
+    ASSERT_TRUE(parsed);
+    EXPECT_EQ(parsed->name, span.name);
+    EXPECT_EQ(parsed->context.trace_id, span.context.trace_id);
+    EXPECT_EQ(parsed->context.span_id, span.context.span_id);
+    EXPECT_EQ(parsed->parent_span_id, span.parent_span_id);
+    EXPECT_EQ(parsed->start, span.start);
+    EXPECT_EQ(parsed->end, span.end);
+    EXPECT_EQ(parsed->attributes, span.attributes);
+    EXPECT_TRUE(parsed->failed);
+}
+
+TEST_F(Trace, spanDataRejectsGarbage)
+{
+    EXPECT_FALSE(mpl::SpanData::from_json("not json"));
+    EXPECT_FALSE(mpl::SpanData::from_json(R"({"name":"no ids"})"));
+}
+
+TEST_F(Trace, jsonLinesExporterWritesOtlpRequests)
+{
+    mpt::TempDir temp_dir;
+    const auto path = temp_dir.filePath("spans.jsonl");
+    {
+        mpl::JsonLinesSpanExporter exporter{path, "multipassd"};
+        mpl::SpanData span{"work", mpl::SpanContext::from_traceparent(traceparent)};
+        exporter.export_span(span);
+        exporter.export_span(span);
+    }
+
+    QFile file{path};
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    const auto lines = file.readAll().split('\n');
+    ASSERT_EQ(lines.size(), 3); // the last one is empty
+
+    const auto request = QJsonDocument::fromJson(lines[0]).object();
+    const auto resource_spans = request["resourceSpans"].toArray()[0].toObject();
+    EXPECT_EQ(resource_spans["resource"].toObject()["attributes"].toArray()[0].toObject()["value"].toObject()
+                  ["stringValue"].toString(),
+              "multipassd");
+
+    const auto spans = resource_spans["scopeSpans"].toArray()[0].toObject()["spans"].toArray();
+    ASSERT_EQ(spans.size(), 1);
+    EXPECT_EQ(spans[0].toObject()["name"].toString(), "work");
+    EXPECT_EQ(spans[0].toObject()["traceId"].toString(), "4bf92f3577b34da6a3ce929d0e0e4736");
+}
+
+TEST_F(Trace, jsonLinesExporterThrowsOnUnwritablePath)
+{
+    EXPECT_THROW((mpl::JsonLinesSpanExporter{"/nonexistent/dir/spans.jsonl", "multipassd"}), std::runtime_error);
+}
+
+#ifndef MULTIPASS_PLATFORM_WINDOWS
+TEST_F(Trace, jsonLinesExporterCreatesFileForOwnerOnly)
+{
+    mpt::TempDir temp_dir;
+    const auto path = temp_dir.filePath("spans.jsonl");
+    mpl::JsonLinesSpanExporter exporter{path, "multipassd"};
+
+    EXPECT_EQ(QFile::permissions(path) & ~(QFileDevice::ReadUser | QFileDevice::WriteUser),
+              QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+}
+
+TEST_F(Trace, jsonLinesExporterDoesNotFollowLinks)
+{
+    mpt::TempDir temp_dir;
+    const auto target = temp_dir.filePath("elsewhere");
+    const auto path = temp_dir.filePath("spans.jsonl");
+    ASSERT_TRUE(QFile::link(target, path));
+
+    EXPECT_THROW((mpl::JsonLinesSpanExporter{path, "multipassd"}), std::runtime_error);
+    EXPECT_FALSE(QFile::exists(target));
+}
+#endif
+} // namespace
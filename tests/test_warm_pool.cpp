@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2022 Canonical, Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common.h"
+
+#include <src/daemon/warm_pool.h>
+
+namespace mp = multipass;
+using namespace testing;
+
+namespace
+{
+struct WarmPool : public Test
+{
+    WarmPool()
+    {
+        profile.set_image("jammy");
+        profile.set_num_cores(2);
+        profile.set_mem_size("2G");
+    }
+
+    mp::LaunchRequest launch_of(const std::string& image, int num_cores, const std::string& mem_size)
+    {
+        mp::LaunchRequest request;
+        request.set_image(image);
+        request.set_num_cores(num_cores);
+        request.set_mem_size(mem_size);
+        return request;
+    }
+
+    mp::LaunchRequest profile;
+};
+} // namespace
+
+TEST_F(WarmPool, fitsLaunchesOfItsProfile)
+{
+    mp::WarmPool pool{1, profile};
+
+    EXPECT_TRUE(pool.fits(launch_of("jammy", 2, "2G")));
+    EXPECT_TRUE(pool.fits(launch_of("jammy", 2, "2048M")));
+    EXPECT_FALSE(pool.fits(launch_of("focal", 2, "2G")));
+    EXPECT_FALSE(pool.fits(launch_of("jammy", 4, "2G")));
+    EXPECT_FALSE(pool.fits(launch_of("jammy", 2, "4G")));
+}
+
+TEST_F(WarmPool, fitsLaunchesOfDefaultsWhenProfileHasDefaults)
+{
+    mp::WarmPool pool{1, mp::LaunchRequest{}};
+
+    EXPECT_TRUE(pool.fits(launch_of("", 0, "")));
+    EXPECT_TRUE(pool.fits(launch_of("", 1, "1G")));
+
+    auto with_disk = launch_of("", 0, "");
+    with_disk.set_disk_space("10G");
+    EXPECT_FALSE(pool.fits(with_disk));
+}
+
+TEST_F(WarmPool, doesNotFitLaunchesAskingForFirstBootConfig)
+{
+    mp::WarmPool pool{1, profile};
+
+    auto named = launch_of("jammy", 2, "2G");
+    named.set_instance_name("foo");
+    EXPECT_FALSE(pool.fits(named));
+
+    auto with_cloud_init = launch_of("jammy", 2, "2G");
+    with_cloud_init.set_cloud_init_user_data("packages: [htop]");
+    EXPECT_FALSE(pool.fits(with_cloud_init));
+
+    auto with_network = launch_of("jammy", 2, "2G");
+    with_network.add_network_options()->set_id("eth0");
+    EXPECT_FALSE(pool.fits(with_network));
+
+    auto several = launch_of("jammy", 2, "2G");
+    several.set_count(2);
+    EXPECT_FALSE(pool.fits(several));
+}
+
+TEST_F(WarmPool, disabledPoolFitsNothing)
+{
+    mp::WarmPool pool{0, profile};
+
+    EXPECT_FALSE(pool.fits(launch_of("jammy", 2, "2G")));
+}
+
+TEST_F(WarmPool, claimsInstancesInTheOrderTheyWereAdded)
+{
+    mp::WarmPool pool{2, profile};
+    pool.add("foo");
+    pool.add("bar");
+    pool.add("foo");
+
+    EXPECT_EQ(pool.num_ready(), 2);
+    EXPECT_THAT(pool.claim(), Optional(std::string{"foo"}));
+    EXPECT_THAT(pool.claim(), Optional(std::string{"bar"}));
+    EXPECT_FALSE(pool.claim());
+}
+
+TEST_F(WarmPool, removedInstancesAreNotClaimed)
+{
+    mp::WarmPool pool{2, profile};
+    pool.add("foo");
+    pool.add("bar");
+
+    EXPECT_TRUE(pool.remove("foo"));
+    EXPECT_FALSE(pool.remove("baz"));
+    EXPECT_FALSE(pool.contains("foo"));
+    EXPECT_THAT(pool.claim(), Optional(std::string{"bar"}));
+}
@@ -43,6 +43,11 @@ extern "C"
     {
         return mock_tcsetattr(fd, optional_actions, termios_p);
     }
+
+    pid_t ut_setsid()
+    {
+        return mock_setsid();
+    }
 }
 
 // By default, call real functions
@@ -50,3 +55,4 @@ std::function<int(int)> mock_isatty = isatty;
 std::function<int(FILE*)> mock_fileno = fileno;
 std::function<int(int, struct termios*)> mock_tcgetattr = tcgetattr;
 std::function<int(int, int, const struct termios*)> mock_tcsetattr = tcsetattr;
+std::function<pid_t()> mock_setsid = setsid;
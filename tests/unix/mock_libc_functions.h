@@ -23,6 +23,7 @@
 #include <grp.h>
 #include <stdio.h>
 #include <termios.h>
+#include <unistd.h>
 
 DECL_MOCK(getgrnam);
 
@@ -35,4 +36,5 @@ extern "C" std::function<int(int)> mock_isatty;
 extern "C" std::function<int(FILE*)> mock_fileno;
 extern "C" std::function<int(int, struct termios*)> mock_tcgetattr;
 extern "C" std::function<int(int, int, const struct termios*)> mock_tcsetattr;
+extern "C" std::function<pid_t()> mock_setsid;
 #endif // MULTIPASS_MOCK_LIBC_FUNCTIONS_H
@@ -0,0 +1,92 @@
+#!/bin/bash
+#
+# Copyright (C) 2022 Canonical, Ltd.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 3.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Wall-clock benchmark for short client commands, where startup is most of the time spent. Each command is run a
+# few times first, so that caches are warm, and then timed over the given number of runs, e.g.:
+#
+#   tools/cli_startup_benchmark.sh --runs 50
+#   MULTIPASS=build/bin/multipass tools/cli_startup_benchmark.sh version
+#
+# Results are printed as one "<command> <min> <median> <mean>" line per command, in milliseconds.
+
+set -euo pipefail
+
+MULTIPASS=${MULTIPASS:-multipass}
+
+usage()
+{
+  cat <<EOF
+Usage: $0 [--runs N] [--warmup N] [<command>...]
+
+Times N runs (default 20) of each of the given client commands (default: version, list), after running each
+of them a few times (default 3) first. Commands with arguments need quoting, e.g. "info --all".
+EOF
+  exit 1
+}
+
+# Print how long one run of the command took, in milliseconds.
+time_once()
+{
+  local start end
+  start=$(date +%s%N)
+  # shellcheck disable=SC2086 # the command is split into its arguments on purpose
+  "$MULTIPASS" $1 > /dev/null
+  end=$(date +%s%N)
+
+  echo $(( (end - start) / 1000000 ))
+}
+
+time_command()
+{
+  local command=$1 runs=$2 warmup=$3
+
+  for _ in $(seq "$warmup"); do
+    time_once "$command" > /dev/null
+  done
+
+  local times=()
+  for _ in $(seq "$runs"); do
+    times+=("$(time_once "$command")")
+  done
+
+  local sorted total=0
+  sorted=$(printf "%s\n" "${times[@]}" | sort -n)
+  for t in "${times[@]}"; do
+    total=$((total + t))
+  done
+
+  printf "%-20s %8s %8s %8s\n" "$command" "$(head -n 1 <<< "$sorted")" \
+    "$(sed -n "$(( (runs + 1) / 2 ))p" <<< "$sorted")" "$((total / runs))"
+}
+
+runs=20 warmup=3
+
+while [ $# -gt 0 ]; do
+  case $1 in
+    --runs) runs=$2; shift 2 ;;
+    --warmup) warmup=$2; shift 2 ;;
+    -h|--help) usage ;;
+    *) break ;;
+  esac
+done
+
+[ "$runs" -ge 1 ] || usage
+[ $# -ge 1 ] || set -- version list
+
+printf "%-20s %8s %8s %8s\n" command min median mean
+for command in "$@"; do
+  time_command "$command" "$runs" "$warmup"
+done
@@ -0,0 +1,164 @@
+#!/bin/bash
+#
+# Copyright (C) 2022 Canonical, Ltd.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 3.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Guest-side benchmarks for the different mount types. Each benchmark runs inside an existing instance,
+# once per given mount target, so that the same workload can be compared across sshfs (classic), 9p and
+# virtiofs (native, see `multipass set local.native-mounts.driver`) mounts, e.g.:
+#
+#   multipass mount ~/bench foo:/mnt/sshfs
+#   multipass mount --type native ~/bench foo:/mnt/native
+#   tools/mount_benchmarks.sh metadata foo /mnt/sshfs /mnt/native
+#
+# Results are printed as one "<target> <phase> <seconds>" line per phase.
+
+set -euo pipefail
+
+MULTIPASS=${MULTIPASS:-multipass}
+
+usage()
+{
+  cat <<EOF
+Usage: $0 <benchmark> [options] <instance> <target>...
+
+Benchmarks:
+  metadata [--files N]   create, stat and unlink N files (default 100000)
+  stat-storm [--dirs N] [--files M] [--passes P]
+                         stat a tree of N directories with M files each (default 100, 100), P times
+                         over (default 5), as builds and IDE indexers do
+  write [--size MB] [--files N]
+                         write a file of MB megabytes in 4KiB blocks with dd (default 512), then
+                         extract a tarball of N small files (default 10000)
+EOF
+  exit 1
+}
+
+# Run a phase in the guest and print how long it took, in seconds.
+time_in_guest()
+{
+  local instance=$1 target=$2 phase=$3 script=$4
+
+  local elapsed
+  elapsed=$( "$MULTIPASS" exec "$instance" -- bash -c "
+    set -e
+    cd '$target'
+    start=\$(date +%s.%N)
+    $script
+    end=\$(date +%s.%N)
+    echo \"\$end - \$start\" | bc" )
+
+  printf "%-30s %-10s %s\n" "$target" "$phase" "$elapsed"
+}
+
+metadata()
+{
+  local files=100000
+
+  while [ $# -gt 0 ]; do
+    case $1 in
+      --files) files=$2; shift 2 ;;
+      *) break ;;
+    esac
+  done
+
+  [ $# -ge 2 ] || usage
+  local instance=$1; shift
+
+  for target in "$@"; do
+    local dir="mp-bench-metadata.$$"
+
+    time_in_guest "$instance" "$target" create \
+      "mkdir $dir && cd $dir && seq $files | xargs touch"
+    time_in_guest "$instance" "$target" stat \
+      "cd $dir && seq $files | xargs stat --format=%s > /dev/null"
+    time_in_guest "$instance" "$target" unlink \
+      "cd $dir && seq $files | xargs rm -f && cd .. && rmdir $dir"
+  done
+}
+
+stat_storm()
+{
+  local dirs=100 files=100 passes=5
+
+  while [ $# -gt 0 ]; do
+    case $1 in
+      --dirs) dirs=$2; shift 2 ;;
+      --files) files=$2; shift 2 ;;
+      --passes) passes=$2; shift 2 ;;
+      *) break ;;
+    esac
+  done
+
+  [ $# -ge 2 ] || usage
+  local instance=$1; shift
+
+  for target in "$@"; do
+    local dir="mp-bench-stat-storm.$$"
+
+    time_in_guest "$instance" "$target" create \
+      "mkdir $dir && cd $dir && for d in \$(seq $dirs); do mkdir \$d && (cd \$d && seq $files | xargs touch); done"
+    time_in_guest "$instance" "$target" stat \
+      "cd $dir && for p in \$(seq $passes); do find . -type f -print0 | xargs -0 stat --format=%s > /dev/null; done"
+    time_in_guest "$instance" "$target" unlink \
+      "rm -rf $dir"
+  done
+}
+
+write()
+{
+  local size=512 files=10000
+
+  while [ $# -gt 0 ]; do
+    case $1 in
+      --size) size=$2; shift 2 ;;
+      --files) files=$2; shift 2 ;;
+      *) break ;;
+    esac
+  done
+
+  [ $# -ge 2 ] || usage
+  local instance=$1; shift
+
+  # The tarball is made outside of the mounts, so that only the extraction goes through them
+  local tarball="/tmp/mp-bench-write.$$.tar"
+  "$MULTIPASS" exec "$instance" -- bash -c "
+    set -e
+    src=\$(mktemp -d)
+    cd \$src && seq $files | xargs -n 1000 sh -c 'for f; do head -c 4096 /dev/urandom > \$f; done' _
+    tar -cf $tarball -C \$src . && rm -rf \$src"
+
+  for target in "$@"; do
+    local dir="mp-bench-write.$$"
+
+    time_in_guest "$instance" "$target" dd \
+      "mkdir $dir && dd if=/dev/zero of=$dir/file bs=4k count=$((size * 256)) conv=fsync status=none"
+    time_in_guest "$instance" "$target" untar \
+      "mkdir $dir/tree && tar -xf $tarball -C $dir/tree && sync"
+    time_in_guest "$instance" "$target" unlink \
+      "rm -rf $dir"
+  done
+
+  "$MULTIPASS" exec "$instance" -- rm -f "$tarball"
+}
+
+[ $# -ge 1 ] || usage
+benchmark=$1; shift
+
+case $benchmark in
+  metadata) metadata "$@" ;;
+  stat-storm) stat_storm "$@" ;;
+  write) write "$@" ;;
+  *) usage ;;
+esac